@@ -0,0 +1,364 @@
+/* Fast division by invariant integers
+ * Code from <https://github.com/nemequ/attic/>
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to
+ * the public domain worldwide. This software is distributed without
+ * any warranty.
+ *
+ * For details see http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ *********************************************************************
+ *
+ * Hardware division is slow (tens of cycles, and it often isn't
+ * pipelined). When the divisor is a compile-time constant compilers
+ * replace the division with a multiplication and a shift, but when
+ * it is only known at run time (a hash table's bucket count, a
+ * stride) they can't. The endiv API computes the multiplier and
+ * shift once, at run time, using the method from "Division by
+ * Invariant Integers using Multiplication" (Granlund and Montgomery)
+ * as refined by libdivide, and reuses them for every division:
+ *
+ *   endiv_u32 buckets;
+ *   endiv_u32_init(&buckets, n_buckets);
+ *   ...
+ *   bucket = endiv_u32_mod(hash, &buckets);
+ *
+ * If the compiler can tell that the divisor is a constant (see
+ * is_constant.h's IS_CONSTANT) the precomputed values are ignored
+ * and the plain / or % is used instead, so the compiler can fold
+ * it. With GCC-compatible compilers this includes the common case of
+ * an endiv_* initialized from a constant in the same function (after
+ * inlining), so it's safe to use endiv everywhere.
+ *
+ * The quotients and remainders are exactly the same as / and %. As
+ * with / and %, the divisor must not be 0.
+ *
+ * Only unsigned 32-bit and 64-bit integers are supported.
+ *
+ *********************************************************************
+ *
+ * void endiv_u32_init(endiv_u32* dv, uint32_t divisor)
+ * void endiv_u64_init(endiv_u64* dv, uint64_t divisor)
+ *
+ *   Compute the multiplier and shift for divisor. This costs about as
+ *   much as a couple of divisions, so only do it when the divisor
+ *   changes.
+ *
+ * uint32_t endiv_u32_div(uint32_t n, const endiv_u32* dv)
+ * uint32_t endiv_u32_mod(uint32_t n, const endiv_u32* dv)
+ * uint64_t endiv_u64_div(uint64_t n, const endiv_u64* dv)
+ * uint64_t endiv_u64_mod(uint64_t n, const endiv_u64* dv)
+ *
+ *   n / divisor and n % divisor.
+ *
+ * void endiv_u32_div_array(uint32_t* dest, const uint32_t* src, size_t nmemb, const endiv_u32* dv)
+ * void endiv_u32_mod_array(uint32_t* dest, const uint32_t* src, size_t nmemb, const endiv_u32* dv)
+ * void endiv_u64_div_array(uint64_t* dest, const uint64_t* src, size_t nmemb, const endiv_u64* dv)
+ * void endiv_u64_mod_array(uint64_t* dest, const uint64_t* src, size_t nmemb, const endiv_u64* dv)
+ *
+ *   dest[i] = src[i] / divisor (or % divisor) for each of the nmemb
+ *   elements. dest may be the same as src, but they must not
+ *   otherwise overlap. The 32-bit versions use SSE2 on x86 (define
+ *   ENDIV_NO_SIMD to disable it); everywhere else, including for
+ *   64-bit integers (SIMD has no 64-bit high multiply), the loops
+ *   are written so that compilers can auto-vectorize them.
+ */
+
+#if !defined(ENDIV_H)
+#define ENDIV_H
+
+#include "is_constant.h"
+#include "enmem.h"
+
+#if !defined(ENDIV_NO_SIMD) && \
+  (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#  include <emmintrin.h>
+#  define ENDIV_SSE2
+#endif
+
+/* magic is 0 for powers of two, which are just a shift.  Otherwise
+   the quotient is mulhi(n, magic) >> shift, and if add is set the
+   real multiplier is 2^N + magic, which needs an extra step to avoid
+   overflowing. */
+typedef struct {
+  uint32_t magic;
+  uint32_t divisor;
+  unsigned char shift;
+  unsigned char add;
+} endiv_u32;
+
+typedef struct {
+  uint64_t magic;
+  uint64_t divisor;
+  unsigned char shift;
+  unsigned char add;
+} endiv_u64;
+
+static EN_INLINE unsigned char endiv_log2_(uint64_t v) {
+#if defined(__GNUC__)
+  return (unsigned char) (63 - __builtin_clzll(v));
+#else
+  unsigned char r = 0;
+
+  while (v >>= 1)
+    r++;
+
+  return r;
+#endif
+}
+
+static EN_INLINE uint32_t endiv_mulhi_u32_(uint32_t a, uint32_t b) {
+  return (uint32_t) ((((uint64_t) a) * b) >> 32);
+}
+
+static EN_INLINE uint64_t endiv_mulhi_u64_(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  return (uint64_t) ((((unsigned __int128) a) * b) >> 64);
+#else
+  uint64_t lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+  uint64_t hi_lo = (a >> 32) * (b & 0xffffffff);
+  uint64_t lo_hi = (a & 0xffffffff) * (b >> 32);
+  uint64_t hi_hi = (a >> 32) * (b >> 32);
+  uint64_t mid = (lo_lo >> 32) + (hi_lo & 0xffffffff) + (lo_hi & 0xffffffff);
+
+  return hi_hi + (hi_lo >> 32) + (lo_hi >> 32) + (mid >> 32);
+#endif
+}
+
+/* Initialization */
+
+static EN_INLINE void endiv_u32_init(endiv_u32* dv, uint32_t divisor) {
+  const unsigned char l = endiv_log2_(divisor);
+
+  dv->divisor = divisor;
+  dv->shift = l;
+  dv->add = 0;
+
+  if ((divisor & (divisor - 1)) == 0) {
+    dv->magic = 0;
+  } else {
+    /* m = floor(2^(32 + l) / divisor), which fits in 32 bits since
+       divisor > 2^l. */
+    const uint64_t num = ((uint64_t) 1) << (32 + l);
+    uint32_t m = (uint32_t) (num / divisor);
+    uint32_t rem = (uint32_t) (num % divisor);
+
+    if ((divisor - rem) < (((uint32_t) 1) << l)) {
+      dv->magic = m + 1;
+    } else {
+      /* Need one more bit of precision: 2^(33 + l) / divisor. */
+      const uint32_t twice_rem = rem + rem;
+      m += m;
+      if (twice_rem >= divisor || twice_rem < rem)
+        m += 1;
+      dv->magic = m + 1;
+      dv->add = 1;
+    }
+  }
+}
+
+static EN_INLINE void endiv_u64_init(endiv_u64* dv, uint64_t divisor) {
+  const unsigned char l = endiv_log2_(divisor);
+
+  dv->divisor = divisor;
+  dv->shift = l;
+  dv->add = 0;
+
+  if ((divisor & (divisor - 1)) == 0) {
+    dv->magic = 0;
+  } else {
+    /* m = floor(2^(64 + l) / divisor) by long division, one bit at a
+       time; this is only done once per divisor so it doesn't need
+       to be fast, and it avoids depending on 128-bit division. */
+    uint64_t m = 0;
+    uint64_t rem = ((uint64_t) 1) << l;
+    int i;
+
+    for (i = 0 ; i < 64 ; i++) {
+      const uint64_t carry = rem >> 63;
+      rem <<= 1;
+      m <<= 1;
+      if (carry || rem >= divisor) {
+        rem -= divisor;
+        m |= 1;
+      }
+    }
+
+    if ((divisor - rem) < (((uint64_t) 1) << l)) {
+      dv->magic = m + 1;
+    } else {
+      const uint64_t twice_rem = rem + rem;
+      m += m;
+      if (twice_rem >= divisor || twice_rem < rem)
+        m += 1;
+      dv->magic = m + 1;
+      dv->add = 1;
+    }
+  }
+}
+
+/* Division */
+
+static EN_INLINE uint32_t endiv_u32_div_(uint32_t n, const endiv_u32* dv) {
+  uint32_t q;
+
+  if (dv->magic == 0)
+    return n >> dv->shift;
+
+  q = endiv_mulhi_u32_(n, dv->magic);
+  if (dv->add)
+    q = ((n - q) >> 1) + q;
+
+  return q >> dv->shift;
+}
+
+static EN_INLINE uint64_t endiv_u64_div_(uint64_t n, const endiv_u64* dv) {
+  uint64_t q;
+
+  if (dv->magic == 0)
+    return n >> dv->shift;
+
+  q = endiv_mulhi_u64_(n, dv->magic);
+  if (dv->add)
+    q = ((n - q) >> 1) + q;
+
+  return q >> dv->shift;
+}
+
+static EN_INLINE uint32_t endiv_u32_div(uint32_t n, const endiv_u32* dv) {
+  if (IS_CONSTANT(dv->divisor))
+    return n / dv->divisor;
+  return endiv_u32_div_(n, dv);
+}
+
+static EN_INLINE uint32_t endiv_u32_mod(uint32_t n, const endiv_u32* dv) {
+  if (IS_CONSTANT(dv->divisor))
+    return n % dv->divisor;
+  return n - (endiv_u32_div_(n, dv) * dv->divisor);
+}
+
+static EN_INLINE uint64_t endiv_u64_div(uint64_t n, const endiv_u64* dv) {
+  if (IS_CONSTANT(dv->divisor))
+    return n / dv->divisor;
+  return endiv_u64_div_(n, dv);
+}
+
+static EN_INLINE uint64_t endiv_u64_mod(uint64_t n, const endiv_u64* dv) {
+  if (IS_CONSTANT(dv->divisor))
+    return n % dv->divisor;
+  return n - (endiv_u64_div_(n, dv) * dv->divisor);
+}
+
+/* Arrays.  The branches on the kind of divisor are hoisted out of the
+   loops so each loop is simple enough to vectorize. */
+
+#if defined(ENDIV_SSE2)
+/* High 32 bits of each 32x32 product; SSE2 only multiplies the even
+   lanes, so do the odd ones separately. */
+static EN_INLINE __m128i endiv_mulhi_epu32_(__m128i a, __m128i b) {
+  const __m128i even = _mm_srli_epi64(_mm_mul_epu32(a, b), 32);
+  const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_or_si128(even, _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+}
+
+static EN_INLINE __m128i endiv_mullo_epu32_(__m128i a, __m128i b) {
+  const __m128i even = _mm_mul_epu32(a, b);
+  const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_or_si128(_mm_and_si128(even, _mm_set_epi32(0, -1, 0, -1)), _mm_slli_epi64(odd, 32));
+}
+
+/* Divide 4 lanes at a time, and return how many elements were done
+   so the caller can finish the tail. */
+static EN_INLINE size_t endiv_u32_array_sse2_(uint32_t* dest, const uint32_t* src, size_t nmemb, const endiv_u32* dv, int mod) {
+  const __m128i magic = _mm_set1_epi32((int) dv->magic);
+  const __m128i divisor = _mm_set1_epi32((int) dv->divisor);
+  const __m128i shift = _mm_cvtsi32_si128(dv->shift);
+  size_t i = 0;
+
+#define ENDIV_SSE2_LOOP_(stmt) \
+  for ( ; i + 4 <= nmemb ; i += 4) { \
+    const __m128i n = _mm_loadu_si128((const __m128i*) (src + i)); \
+    __m128i q; \
+    stmt; \
+    if (mod) \
+      q = _mm_sub_epi32(n, endiv_mullo_epu32_(q, divisor)); \
+    _mm_storeu_si128((__m128i*) (dest + i), q); \
+  }
+
+  if (dv->magic == 0) {
+    ENDIV_SSE2_LOOP_(q = _mm_srl_epi32(n, shift))
+  } else if (!dv->add) {
+    ENDIV_SSE2_LOOP_(q = _mm_srl_epi32(endiv_mulhi_epu32_(n, magic), shift))
+  } else {
+    ENDIV_SSE2_LOOP_(
+      const __m128i t = endiv_mulhi_epu32_(n, magic);
+      q = _mm_srl_epi32(_mm_add_epi32(_mm_srli_epi32(_mm_sub_epi32(n, t), 1), t), shift))
+  }
+
+#undef ENDIV_SSE2_LOOP_
+
+  return i;
+}
+#endif
+
+#define ENDIV_ARRAY_(T, sfx) \
+  static EN_INLINE void endiv_##sfx##_array_(T* dest, const T* src, size_t nmemb, const endiv_##sfx* dv, int mod) { \
+    const T d = dv->divisor, magic = dv->magic; \
+    const unsigned char shift = dv->shift; \
+    size_t i = 0; \
+    if (IS_CONSTANT(dv->divisor)) { \
+      if (mod) { \
+        for ( ; i < nmemb ; i++) \
+          dest[i] = src[i] % dv->divisor; \
+      } else { \
+        for ( ; i < nmemb ; i++) \
+          dest[i] = src[i] / dv->divisor; \
+      } \
+      return; \
+    } \
+    ENDIV_ARRAY_SIMD_##sfx##_ \
+    if (magic == 0) { \
+      for ( ; i < nmemb ; i++) \
+        dest[i] = mod ? (src[i] & (d - 1)) : (src[i] >> shift); \
+    } else if (!dv->add) { \
+      for ( ; i < nmemb ; i++) { \
+        const T q = endiv_mulhi_##sfx##_(src[i], magic) >> shift; \
+        dest[i] = mod ? (src[i] - (q * d)) : q; \
+      } \
+    } else { \
+      for ( ; i < nmemb ; i++) { \
+        const T t = endiv_mulhi_##sfx##_(src[i], magic); \
+        const T q = (((src[i] - t) >> 1) + t) >> shift; \
+        dest[i] = mod ? (src[i] - (q * d)) : q; \
+      } \
+    } \
+  }
+
+#if defined(ENDIV_SSE2)
+#  define ENDIV_ARRAY_SIMD_u32_ i = endiv_u32_array_sse2_(dest, src, nmemb, dv, mod);
+#else
+#  define ENDIV_ARRAY_SIMD_u32_
+#endif
+#define ENDIV_ARRAY_SIMD_u64_
+
+ENDIV_ARRAY_(uint32_t, u32)
+ENDIV_ARRAY_(uint64_t, u64)
+
+static EN_INLINE void endiv_u32_div_array(uint32_t* dest, const uint32_t* src, size_t nmemb, const endiv_u32* dv) {
+  endiv_u32_array_(dest, src, nmemb, dv, 0);
+}
+
+static EN_INLINE void endiv_u32_mod_array(uint32_t* dest, const uint32_t* src, size_t nmemb, const endiv_u32* dv) {
+  endiv_u32_array_(dest, src, nmemb, dv, 1);
+}
+
+static EN_INLINE void endiv_u64_div_array(uint64_t* dest, const uint64_t* src, size_t nmemb, const endiv_u64* dv) {
+  endiv_u64_array_(dest, src, nmemb, dv, 0);
+}
+
+static EN_INLINE void endiv_u64_mod_array(uint64_t* dest, const uint64_t* src, size_t nmemb, const endiv_u64* dv) {
+  endiv_u64_array_(dest, src, nmemb, dv, 1);
+}
+
+#endif /* !defined(ENDIV_H) */
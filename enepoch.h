@@ -0,0 +1,338 @@
+/* Epoch-based deferred reclamation for enmem.h
+ * Code from <https://github.com/nemequ/attic/>
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to
+ * the public domain worldwide. This software is distributed without
+ * any warranty.
+ *
+ * For details see http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ *********************************************************************
+ *
+ * When a shared structure is updated by swapping a pointer, the old
+ * version can't be freed right away since other threads may still be
+ * reading it. Instead of a reader lock, readers wrap each lookup in
+ * en_epoch_enter() and en_epoch_exit(), and writers pass the old
+ * version to enretire() instead of enfree():
+ *
+ *   Table* table;  (shared)
+ *
+ *   reader:
+ *     en_epoch_enter();
+ *     Table* t = EN_ATOMIC_LOAD(&table);
+ *     ... use t ...
+ *     en_epoch_exit();
+ *
+ *   writer:
+ *     Table* old = EN_ATOMIC_EXCHANGE(&table, new_table);
+ *     old = enretire(old);
+ *
+ * The retired object is freed with enfree() once every thread which
+ * was in a critical section when it was retired has left it. Entering
+ * and leaving a critical section only touches the calling thread's
+ * own state (a store and a fence to enter, a store to leave), so
+ * readers scale across cores.
+ *
+ * There is a global epoch number. Each thread announces the epoch it
+ * saw when it entered a critical section, and each retired pointer is
+ * tagged with the epoch it was retired in. The epoch can only advance
+ * once every thread in a critical section has seen the current one,
+ * so once it has advanced twice past a pointer's tag nobody can still
+ * be using it. Retired pointers are kept in a per-thread list, and
+ * every EN_EPOCH_BATCH (64 by default) retirements the thread tries
+ * to advance the epoch and frees whatever is safe to free, so the
+ * cost of scanning the other threads is amortized.
+ *
+ * A thread which stays in a critical section stops every thread's
+ * retired objects from being freed, so keep them short, and don't
+ * block inside them.
+ *
+ * Exactly one file in your program must define
+ * EN_EPOCH_IMPLEMENTATION before including this header to provide
+ * the global state. This requires thread-local storage and atomics
+ * (see EN_ATOMICS in enmem.h). The first call from each thread
+ * allocates a small record for it, which is reused after
+ * en_epoch_thread_exit(); if that allocation fails abort() is
+ * called.
+ *
+ *********************************************************************
+ *
+ * void en_epoch_enter(void)
+ * void en_epoch_exit(void)
+ *
+ *   Enter and leave a critical section. Pointers read from shared
+ *   structures inside a critical section stay valid until it ends.
+ *   Critical sections may be nested; only the outermost pair counts.
+ *
+ * T* enretire(T* ptr)
+ *
+ *   Free ptr once no thread can be using it, and return NULL (just
+ *   like enfree()). ptr must already be unreachable for threads
+ *   entering a critical section from now on, and must be memory
+ *   which can be passed to enfree(). ptr may be NULL. May be called
+ *   inside or outside a critical section.
+ *
+ *   If the thread's list of retired pointers can't grow, enretire()
+ *   waits for a grace period and frees ptr immediately, unless the
+ *   calling thread is in a critical section, in which case ptr is
+ *   leaked.
+ *
+ * void en_epoch_reclaim(void)
+ *
+ *   Try to advance the epoch, and free any of the calling thread's
+ *   retired objects which are safe to free. Doesn't block. enretire()
+ *   does this automatically.
+ *
+ * void en_epoch_barrier(void)
+ *
+ *   Wait until everything the calling thread has retired has been
+ *   freed. This spins until the other threads leave their current
+ *   critical sections, and must not be called inside one.
+ *
+ * void en_epoch_thread_exit(void)
+ *
+ *   Call en_epoch_barrier(), then release the calling thread's
+ *   record so another thread can use it. Call this before a thread
+ *   which has used this API exits, otherwise anything it retired
+ *   since the last reclamation is never freed. Must not be called
+ *   inside a critical section.
+ */
+
+#if !defined(ENEPOCH_H)
+#define ENEPOCH_H
+
+#include "enmem.h"
+
+#if !defined(EN_ATOMICS) || !defined(EN_THREAD_LOCAL)
+#  error enepoch.h requires atomics and thread-local storage
+#endif
+
+#if !defined(EN_EPOCH_BATCH)
+#  define EN_EPOCH_BATCH 64
+#endif
+
+typedef struct {
+  void* ptr;
+  size_t epoch;
+} en_epoch_retired_;
+
+typedef struct en_epoch_thread_ {
+  /* (epoch << 1) | 1 inside a critical section, 0 otherwise. Only
+     written by the owning thread. */
+  size_t state;
+  size_t nesting;
+  struct en_epoch_thread_* next;
+  int in_use;
+  size_t since_reclaim;
+  /* Oldest first; retired[head] to retired[count - 1] are pending. */
+  en_epoch_retired_* retired;
+  size_t head;
+  size_t count;
+  size_t capacity;
+} en_epoch_thread_;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+extern size_t en_epoch_global_;
+extern EN_THREAD_LOCAL en_epoch_thread_* en_epoch_self_;
+
+en_epoch_thread_* en_epoch_thread_new_(void);
+void en_epoch_retire_(void* ptr);
+void en_epoch_reclaim(void);
+void en_epoch_barrier(void);
+void en_epoch_thread_exit(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+static EN_INLINE void en_epoch_enter(void) {
+  en_epoch_thread_* self = en_epoch_self_;
+
+  if (EN_UNLIKELY(self == NULL))
+    self = en_epoch_thread_new_();
+
+  if (self->nesting++ == 0) {
+    EN_ATOMIC_STORE(&(self->state), (EN_ATOMIC_LOAD(&en_epoch_global_) << 1) | 1);
+    /* The announcement must be visible before we read anything the
+       critical section protects. */
+    EN_ATOMIC_FENCE();
+  }
+}
+
+static EN_INLINE void en_epoch_exit(void) {
+  en_epoch_thread_* self = en_epoch_self_;
+
+  if (--(self->nesting) == 0)
+    EN_ATOMIC_STORE(&(self->state), (size_t) 0);
+}
+
+#if defined(__cplusplus)
+  template<typename T>
+  static T* enretire(T* ptr) {
+    en_epoch_retire_(const_cast<void*>(static_cast<const volatile void*>(ptr)));
+    return static_cast<T*>(NULL);
+  }
+#elif defined(__GNUC__)
+#  define enretire(ptr) ((__typeof__(*ptr)*) (en_epoch_retire_((void*) (ptr)), NULL))
+#else
+#  define enretire(ptr) (en_epoch_retire_((void*) (ptr)), (void*) NULL)
+#endif
+
+#if defined(EN_EPOCH_IMPLEMENTATION)
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+size_t en_epoch_global_ = 0;
+EN_THREAD_LOCAL en_epoch_thread_* en_epoch_self_ = NULL;
+static en_epoch_thread_* en_epoch_threads_ = NULL;
+
+en_epoch_thread_* en_epoch_thread_new_(void) {
+  en_epoch_thread_* self;
+
+  for (self = EN_ATOMIC_LOAD(&en_epoch_threads_) ; self != NULL ; self = self->next) {
+    int unused = 0;
+    if (EN_ATOMIC_LOAD(&(self->in_use)) == 0 && EN_ATOMIC_CAS(&(self->in_use), &unused, 1))
+      break;
+  }
+
+  if (self == NULL) {
+    /* Readers write their state on every critical section, so keep
+       each thread's record on its own cache line. Records are never
+       freed, since other threads may be scanning them. */
+    self = ennew0_aligned(en_epoch_thread_, EN_CACHE_LINE_SIZE);
+    if (EN_UNLIKELY(self == NULL))
+      abort();
+    self->in_use = 1;
+    self->next = EN_ATOMIC_LOAD(&en_epoch_threads_);
+    while (!EN_ATOMIC_CAS(&en_epoch_threads_, &(self->next), self)) { }
+  }
+
+  en_epoch_self_ = self;
+  return self;
+}
+
+/* Free the calling thread's retired pointers which are at least two
+   epochs old. */
+static void en_epoch_free_(en_epoch_thread_* self, size_t epoch) {
+  while (self->head < self->count && (epoch - self->retired[self->head].epoch) >= 2) {
+    void* ptr = self->retired[self->head++].ptr;
+    ptr = enfree(ptr);
+  }
+
+  if (self->head == self->count) {
+    self->head = 0;
+    self->count = 0;
+  }
+}
+
+/* Advance the epoch if every thread in a critical section has seen
+   the current one. Returns the (possibly new) epoch. */
+static size_t en_epoch_try_advance_(void) {
+  const size_t epoch = EN_ATOMIC_LOAD(&en_epoch_global_);
+  const size_t announced = (epoch << 1) | 1;
+  const en_epoch_thread_* thread;
+  size_t expected = epoch;
+
+  /* Pairs with the fence in en_epoch_enter(), so either we see a
+     reader's announcement or it sees everything retired before
+     this. */
+  EN_ATOMIC_FENCE();
+
+  for (thread = EN_ATOMIC_LOAD(&en_epoch_threads_) ; thread != NULL ; thread = thread->next) {
+    const size_t state = EN_ATOMIC_LOAD(&(thread->state));
+    if (state != 0 && state != announced)
+      return epoch;
+  }
+
+  if (EN_ATOMIC_CAS(&en_epoch_global_, &expected, epoch + 1))
+    return epoch + 1;
+  /* Someone else advanced it. */
+  return expected;
+}
+
+void en_epoch_reclaim(void) {
+  en_epoch_thread_* self = en_epoch_self_;
+
+  if (self == NULL)
+    return;
+
+  self->since_reclaim = 0;
+  en_epoch_free_(self, en_epoch_try_advance_());
+}
+
+void en_epoch_barrier(void) {
+  en_epoch_thread_* self = en_epoch_self_;
+
+  if (self == NULL)
+    return;
+
+  self->since_reclaim = 0;
+  while (self->count != 0)
+    en_epoch_free_(self, en_epoch_try_advance_());
+}
+
+void en_epoch_retire_(void* ptr) {
+  en_epoch_thread_* self = en_epoch_self_;
+  en_epoch_retired_* retired;
+
+  if (ptr == NULL)
+    return;
+
+  if (EN_UNLIKELY(self == NULL))
+    self = en_epoch_thread_new_();
+
+  if (self->count == self->capacity) {
+    if (self->head != 0) {
+      memmove(self->retired, self->retired + self->head, (self->count - self->head) * sizeof(en_epoch_retired_));
+      self->count -= self->head;
+      self->head = 0;
+    } else {
+      const size_t capacity = (self->capacity == 0) ? EN_EPOCH_BATCH : (self->capacity * 2);
+      retired = enrealloc(self->retired, en_epoch_retired_, capacity);
+      if (EN_UNLIKELY(retired == NULL)) {
+        if (self->nesting == 0) {
+          const size_t epoch = EN_ATOMIC_LOAD(&en_epoch_global_);
+          while ((en_epoch_try_advance_() - epoch) < 2) { }
+          ptr = enfree(ptr);
+        }
+        return;
+      }
+      self->retired = retired;
+      self->capacity = capacity;
+    }
+  }
+
+  self->retired[self->count].ptr = ptr;
+  self->retired[self->count].epoch = EN_ATOMIC_LOAD(&en_epoch_global_);
+  self->count++;
+
+  if (++(self->since_reclaim) >= EN_EPOCH_BATCH)
+    en_epoch_reclaim();
+}
+
+void en_epoch_thread_exit(void) {
+  en_epoch_thread_* self = en_epoch_self_;
+
+  if (self == NULL)
+    return;
+
+  en_epoch_barrier();
+  self->retired = enfree(self->retired);
+  self->capacity = 0;
+  en_epoch_self_ = NULL;
+  EN_ATOMIC_STORE(&(self->in_use), 0);
+}
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* defined(EN_EPOCH_IMPLEMENTATION) */
+
+#endif /* !defined(ENEPOCH_H) */
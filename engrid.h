@@ -0,0 +1,415 @@
+/* Multi-dimensional arrays for enmem.h
+ * Code from <https://github.com/nemequ/attic/>
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to
+ * the public domain worldwide. This software is distributed without
+ * any warranty.
+ *
+ * For details see http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ *********************************************************************
+ *
+ * Building a matrix out of one ennewa() per row scatters the rows
+ * across the heap, so walking the matrix defeats the prefetcher, and
+ * allocating and freeing it costs one call per row. The functions in
+ * this header put the whole thing in a single row-major allocation
+ * instead, and check the product of the extents for overflow just
+ * like ennewa() does for nmemb:
+ *
+ *   double* m = ennewa2(double, rows, cols);
+ *   m[(r * cols) + c] = 1.0;
+ *   ...
+ *   m = enfree_grid(m);
+ *
+ * If you would rather write m[r][c], the "_rows" variants put a
+ * table of row pointers at the start of the same allocation:
+ *
+ *   double** m = ennewa2_rows(double, rows, cols);
+ *   m[r][c] = 1.0;
+ *
+ * and the "_aligned" variants pad every row so it starts on an align
+ * byte boundary (for example EN_CACHE_LINE_SIZE, or the width of
+ * your SIMD registers), so rows never share a cache line and aligned
+ * vector loads work on every row:
+ *
+ *   size_t stride;
+ *   float* m = ennewa2_aligned(float, rows, cols, 64, &stride);
+ *   m[(r * stride) + c] = 1.0f;
+ *   ...
+ *   m = enfree_aligned(m);
+ *
+ * In three dimensions the innermost extent (d2) is the row, and
+ * element (i, j, k) is at ((i * d1) + j) * d2 + k, or
+ * ((i * d1) + j) * stride + k for the aligned variants.
+ *
+ * Like the rest of enmem, memory comes from EN_MALLOC, EN_CALLOC,
+ * EN_REALLOC, and EN_FREE. These functions aren't profiled or traced
+ * (see EN_PROFILE and EN_TRACE), which is why they have their own
+ * free function. Types with an alignment requirement larger than
+ * malloc provides are only supported by the aligned variants. The
+ * realloc and resize variants move rows with memmove, so, like
+ * enrealloc(), in C++11 they reject types which aren't trivially
+ * relocatable at compile time.
+ *
+ *********************************************************************
+ *
+ * T* ennewa2(Type T, size_t rows, size_t cols)
+ * T* ennewa02(Type T, size_t rows, size_t cols)
+ * T* ennewa3(Type T, size_t d0, size_t d1, size_t d2)
+ * T* ennewa03(Type T, size_t d0, size_t d1, size_t d2)
+ *
+ *   Allocate a contiguous rows * cols (or d0 * d1 * d2) array of T.
+ *   The "0" variants zero-initialize it. Returns NULL if any extent
+ *   is 0, or (with errno set to ENOMEM) if the size overflows.
+ *
+ * T* enrealloc2(T* ptr, Type T, size_t old_rows, size_t old_cols, size_t rows, size_t cols)
+ * T* enresize2(T* ptr, Type T, size_t old_rows, size_t old_cols, size_t rows, size_t cols)
+ * T* enrealloc3(T* ptr, Type T, size_t old_d0, size_t old_d1, size_t old_d2, size_t d0, size_t d1, size_t d2)
+ * T* enresize3(T* ptr, Type T, size_t old_d0, size_t old_d1, size_t old_d2, size_t d0, size_t d1, size_t d2)
+ *
+ *   Change the extents of an array from ennewa2() (or ennewa3()),
+ *   which must currently be the old extents. Element (r, c) keeps its
+ *   value if it is within both the old and new extents; the other
+ *   elements are uninitialized. If only the outermost extent changes
+ *   this is a plain realloc; otherwise the rows are moved within the
+ *   block when possible, and copied to a new block if the extents
+ *   grow in one dimension and shrink in another. Otherwise this
+ *   behaves like enrealloc() and enresize(): if the new size is 0 the
+ *   array is freed and NULL is returned, and on failure NULL is
+ *   returned and ptr is left alone (enrealloc) or freed (enresize).
+ *
+ * T* enfree_grid(T* ptr)
+ *
+ *   Free memory from ennewa2(), ennewa3(), the "_rows" variants, or
+ *   enrealloc2()/enrealloc3(), and return NULL, like enfree().
+ *
+ * T** ennewa2_rows(Type T, size_t rows, size_t cols)
+ * T** ennewa02_rows(Type T, size_t rows, size_t cols)
+ * T*** ennewa3_rows(Type T, size_t d0, size_t d1, size_t d2)
+ * T*** ennewa03_rows(Type T, size_t d0, size_t d1, size_t d2)
+ *
+ *   Like ennewa2() and ennewa3(), but the allocation starts with a
+ *   table of pointers to each row (and, for ennewa3_rows(), a table
+ *   of pointers to each plane), followed by the elements, which are
+ *   laid out exactly as for ennewa2() and ennewa3(); m[0] (or
+ *   m[0][0]) points to the first one. The "0" variants only zero the
+ *   elements. To change the extents, allocate a new array.
+ *
+ * T* ennewa2_aligned(Type T, size_t rows, size_t cols, size_t align, size_t* stride)
+ * T* ennewa02_aligned(Type T, size_t rows, size_t cols, size_t align, size_t* stride)
+ * T* ennewa3_aligned(Type T, size_t d0, size_t d1, size_t d2, size_t align, size_t* stride)
+ * T* ennewa03_aligned(Type T, size_t d0, size_t d1, size_t d2, size_t align, size_t* stride)
+ * T* enrealloc2_aligned(T* ptr, Type T, size_t old_rows, size_t old_cols, size_t rows, size_t cols, size_t align, size_t* stride)
+ * T* enresize2_aligned(T* ptr, Type T, size_t old_rows, size_t old_cols, size_t rows, size_t cols, size_t align, size_t* stride)
+ * T* enrealloc3_aligned(T* ptr, Type T, size_t old_d0, ..., size_t d2, size_t align, size_t* stride)
+ * T* enresize3_aligned(T* ptr, Type T, size_t old_d0, ..., size_t d2, size_t align, size_t* stride)
+ *
+ *   Like the functions above, but each row is padded to
+ *   enstride(T, cols, align) elements and the array is aligned to
+ *   align bytes, which must be a power of two. If stride isn't NULL
+ *   the stride is stored there. The memory comes from (and must be
+ *   freed with) the aligned allocation functions in enmem.h, so use
+ *   enfree_aligned(), and pass the same align every time.
+ *
+ * size_t enstride(Type T, size_t cols, size_t align)
+ *
+ *   The number of elements each row of cols elements takes up in an
+ *   aligned array: the smallest number >= cols which is a multiple of
+ *   align bytes. Returns 0 on overflow.
+ */
+
+#if !defined(ENGRID_H)
+#define ENGRID_H
+
+#include "enmem.h"
+
+#define EN_GRID_ZERO_ 1
+#define EN_GRID_ALIGNED_ 2
+#define EN_GRID_RESIZE_ 4
+#define EN_GRID_PLANES_ 8
+
+static EN_INLINE size_t enstride_(size_t size, size_t cols, size_t align) {
+  size_t step = 1;
+
+  if (align > 1) {
+    /* Both are powers of two, so this is align / gcd(size, align). */
+    const size_t low = size & (~size + 1);
+    if (low < align)
+      step = align / low;
+  }
+
+  if (EN_UNLIKELY(cols > (SIZE_MAX - (step - 1)))) {
+    errno = ENOMEM;
+    return 0;
+  }
+
+  return (cols + (step - 1)) & ~(step - 1);
+}
+#define enstride(T, cols, align) enstride_(sizeof(T), cols, align)
+
+typedef struct {
+  size_t d0;
+  size_t d1;
+  size_t cols;
+  size_t stride;
+  /* d1 * stride */
+  size_t plane;
+  /* d0 * plane */
+  size_t nmemb;
+} engrid_layout_;
+
+/* Returns 0 and sets errno to ENOMEM on overflow. */
+static EN_INLINE int engrid_init_(engrid_layout_* layout, size_t size, size_t d0, size_t d1, size_t d2, size_t align, int flags) {
+  size_t bytes;
+
+  layout->d0 = d0;
+  layout->d1 = d1;
+  layout->cols = d2;
+  layout->stride = d2;
+  if ((flags & EN_GRID_ALIGNED_) && d2 != 0) {
+    layout->stride = enstride_(size, d2, align);
+    if (EN_UNLIKELY(layout->stride == 0))
+      return 0;
+  }
+
+  return
+    enmul_(d1, layout->stride, &(layout->plane)) &&
+    enmul_(d0, layout->plane, &(layout->nmemb)) &&
+    enmul_(size, layout->nmemb, &bytes);
+}
+
+static EN_INLINE void engrid_free_(void* ptr, int flags) {
+  if (flags & EN_GRID_ALIGNED_)
+    enfree_aligned_(ptr);
+  else
+    EN_FREE(ptr);
+}
+
+static EN_INLINE void* ennewa_grid_(size_t size, size_t d0, size_t d1, size_t d2, size_t align, size_t* stride, int flags) {
+  engrid_layout_ layout;
+
+  if (EN_UNLIKELY(!engrid_init_(&layout, size, d0, d1, d2, align, flags)))
+    return NULL;
+  if (stride != NULL)
+    *stride = layout.stride;
+
+  if (EN_UNLIKELY(layout.nmemb == 0))
+    return NULL;
+
+  if (flags & EN_GRID_ALIGNED_)
+    return ennewa_aligned_(size, layout.nmemb, align, flags & EN_GRID_ZERO_);
+  return (flags & EN_GRID_ZERO_) ? EN_CALLOC(layout.nmemb, size) : EN_MALLOC(size * layout.nmemb);
+}
+
+/* Copy the rows which are in both layouts from src to dest.  src and
+   dest may be the same block as long as every row moves in the same
+   direction; if backward is non-zero they all move towards the end,
+   so start with the last one so we don't overwrite anything we
+   haven't moved yet. */
+static EN_INLINE void engrid_move_(char* dest, const engrid_layout_* to, const char* src, const engrid_layout_* from, size_t size, int backward) {
+  const size_t n0 = (to->d0 < from->d0) ? to->d0 : from->d0;
+  const size_t n1 = (to->d1 < from->d1) ? to->d1 : from->d1;
+  const size_t len = ((to->cols < from->cols) ? to->cols : from->cols) * size;
+  size_t i, j;
+
+#define EN_GRID_MOVE_ROW_(i, j) \
+  memmove(dest + ((((i) * to->plane) + ((j) * to->stride)) * size), \
+          src + ((((i) * from->plane) + ((j) * from->stride)) * size), len)
+  if (backward) {
+    for (i = n0 ; i-- > 0 ; )
+      for (j = n1 ; j-- > 0 ; )
+        EN_GRID_MOVE_ROW_(i, j);
+  } else {
+    for (i = 0 ; i < n0 ; i++)
+      for (j = 0 ; j < n1 ; j++)
+        EN_GRID_MOVE_ROW_(i, j);
+  }
+#undef EN_GRID_MOVE_ROW_
+}
+
+static EN_INLINE void* engrid_realloc_block_(void* ptr, size_t size, size_t nmemb, size_t align, int flags) {
+  if (flags & EN_GRID_ALIGNED_)
+    return enrealloc_aligned_(ptr, size, nmemb, align);
+  return EN_REALLOC(ptr, size * nmemb);
+}
+
+static EN_INLINE void* enrealloc_grid_(void* ptr, size_t size,
+                                       size_t old_d0, size_t old_d1, size_t old_d2,
+                                       size_t d0, size_t d1, size_t d2,
+                                       size_t align, size_t* stride, int flags) {
+  engrid_layout_ from, to;
+  size_t n0, n1;
+  int forward, backward;
+  char* block;
+
+  if (ptr == NULL)
+    return ennewa_grid_(size, d0, d1, d2, align, stride, flags & EN_GRID_ALIGNED_);
+
+  if (EN_UNLIKELY(!engrid_init_(&to, size, d0, d1, d2, align, flags)) ||
+      EN_UNLIKELY(!engrid_init_(&from, size, old_d0, old_d1, old_d2, align, flags))) {
+    if (flags & EN_GRID_RESIZE_)
+      engrid_free_(ptr, flags);
+    return NULL;
+  }
+  if (stride != NULL)
+    *stride = to.stride;
+
+  if (EN_UNLIKELY(to.nmemb == 0)) {
+    engrid_free_(ptr, flags);
+    return NULL;
+  }
+
+  /* Row (i, j) starts at (i * plane) + (j * stride), so the rows we
+     keep all move towards the end if neither grows smaller (and
+     towards the start if neither grows larger), ignoring the ones
+     which only matter for row 0 or plane 0. */
+  n0 = (to.d0 < from.d0) ? to.d0 : from.d0;
+  n1 = (to.d1 < from.d1) ? to.d1 : from.d1;
+  backward = (n0 <= 1 || to.plane >= from.plane) && (n1 <= 1 || to.stride >= from.stride);
+  forward = (n0 <= 1 || to.plane <= from.plane) && (n1 <= 1 || to.stride <= from.stride);
+
+  if (forward && backward) {
+    /* Nothing moves. */
+    block = (char*) engrid_realloc_block_(ptr, size, to.nmemb, align, flags);
+  } else if (forward || backward) {
+    if (to.nmemb >= from.nmemb) {
+      block = (char*) engrid_realloc_block_(ptr, size, to.nmemb, align, flags);
+      if (EN_LIKELY(block != NULL))
+        engrid_move_(block, &to, block, &from, size, backward);
+    } else {
+      /* If shrinking fails the old block is still big enough for the
+         new layout, so we just keep it. */
+      engrid_move_((char*) ptr, &to, (char*) ptr, &from, size, backward);
+      block = (char*) engrid_realloc_block_(ptr, size, to.nmemb, align, flags);
+      if (block == NULL)
+        block = (char*) ptr;
+    }
+  } else {
+    /* Some rows move forward and others backward, so there is no
+       order which doesn't overwrite something. */
+    block = (char*) ennewa_grid_(size, d0, d1, d2, align, NULL, flags & EN_GRID_ALIGNED_);
+    if (EN_LIKELY(block != NULL)) {
+      engrid_move_(block, &to, (const char*) ptr, &from, size, 0);
+      engrid_free_(ptr, flags);
+    }
+  }
+
+  if (EN_UNLIKELY(block == NULL) && (flags & EN_GRID_RESIZE_))
+    engrid_free_(ptr, flags);
+
+  return block;
+}
+
+/* The pointer tables are written with memcpy so we don't violate
+   strict aliasing; they're read back as T* (or T**), which has the
+   same representation as char* on any platform we care about. */
+static EN_INLINE void* ennewa_grid_rows_(size_t size, size_t align, size_t d0, size_t d1, size_t d2, int flags) {
+  engrid_layout_ layout;
+  const size_t nplanes = (flags & EN_GRID_PLANES_) ? d0 : 0;
+  size_t lines, header, bytes, i;
+  char* block;
+  char* data;
+
+  if (EN_UNLIKELY(!engrid_init_(&layout, size, d0, d1, d2, 0, 0)))
+    return NULL;
+  if (EN_UNLIKELY(layout.nmemb == 0))
+    return NULL;
+
+  /* d2 isn't 0, so this can't overflow. */
+  lines = d0 * d1;
+
+  if (EN_UNLIKELY(lines > (SIZE_MAX - nplanes)) ||
+      EN_UNLIKELY(!enmul_(sizeof(char*), lines + nplanes, &header)) ||
+      EN_UNLIKELY(header > (SIZE_MAX - (align - 1)))) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  header = (header + (align - 1)) & ~(align - 1);
+
+  bytes = size * layout.nmemb;
+  if (EN_UNLIKELY(bytes > (SIZE_MAX - header))) {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  block = (char*) EN_MALLOC(header + bytes);
+  if (EN_UNLIKELY(block == NULL))
+    return NULL;
+  data = block + header;
+  if (flags & EN_GRID_ZERO_)
+    memset(data, 0, bytes);
+
+  for (i = 0 ; i < nplanes ; i++) {
+    char* plane = block + ((nplanes + (i * d1)) * sizeof(char*));
+    memcpy(block + (i * sizeof(char*)), &plane, sizeof(char*));
+  }
+  for (i = 0 ; i < lines ; i++) {
+    char* row = data + (i * d2 * size);
+    memcpy(block + ((nplanes + i) * sizeof(char*)), &row, sizeof(char*));
+  }
+
+  return block;
+}
+
+#if defined(__cplusplus)
+#  define EN_GRID_PTR_(T, ptr) EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr))))
+#  define EN_GRID_CAST_(T, expr) static_cast<T>(expr)
+#else
+#  define EN_GRID_PTR_(T, ptr) EN_CHECK_TYPE(T, ptr)
+#  define EN_GRID_CAST_(T, expr) ((T) (expr))
+#endif
+
+#define ennewa2(T, rows, cols) EN_GRID_CAST_(T*, ennewa_grid_(sizeof(T), 1, rows, cols, 0, NULL, 0))
+#define ennewa02(T, rows, cols) EN_GRID_CAST_(T*, ennewa_grid_(sizeof(T), 1, rows, cols, 0, NULL, EN_GRID_ZERO_))
+#define ennewa3(T, d0, d1, d2) EN_GRID_CAST_(T*, ennewa_grid_(sizeof(T), d0, d1, d2, 0, NULL, 0))
+#define ennewa03(T, d0, d1, d2) EN_GRID_CAST_(T*, ennewa_grid_(sizeof(T), d0, d1, d2, 0, NULL, EN_GRID_ZERO_))
+
+#define enrealloc2(ptr, T, old_rows, old_cols, rows, cols) \
+  EN_GRID_CAST_(T*, enrealloc_grid_(EN_GRID_PTR_(T, ptr), sizeof(T), 1, old_rows, old_cols, 1, rows, cols, 0, NULL, 0))
+#define enresize2(ptr, T, old_rows, old_cols, rows, cols) \
+  EN_GRID_CAST_(T*, enrealloc_grid_(EN_GRID_PTR_(T, ptr), sizeof(T), 1, old_rows, old_cols, 1, rows, cols, 0, NULL, EN_GRID_RESIZE_))
+#define enrealloc3(ptr, T, old_d0, old_d1, old_d2, d0, d1, d2) \
+  EN_GRID_CAST_(T*, enrealloc_grid_(EN_GRID_PTR_(T, ptr), sizeof(T), old_d0, old_d1, old_d2, d0, d1, d2, 0, NULL, 0))
+#define enresize3(ptr, T, old_d0, old_d1, old_d2, d0, d1, d2) \
+  EN_GRID_CAST_(T*, enrealloc_grid_(EN_GRID_PTR_(T, ptr), sizeof(T), old_d0, old_d1, old_d2, d0, d1, d2, 0, NULL, EN_GRID_RESIZE_))
+
+#define ennewa2_rows(T, rows, cols) EN_GRID_CAST_(T**, ennewa_grid_rows_(sizeof(T), EN_ALIGNOF(T), 1, rows, cols, 0))
+#define ennewa02_rows(T, rows, cols) EN_GRID_CAST_(T**, ennewa_grid_rows_(sizeof(T), EN_ALIGNOF(T), 1, rows, cols, EN_GRID_ZERO_))
+#define ennewa3_rows(T, d0, d1, d2) EN_GRID_CAST_(T***, ennewa_grid_rows_(sizeof(T), EN_ALIGNOF(T), d0, d1, d2, EN_GRID_PLANES_))
+#define ennewa03_rows(T, d0, d1, d2) EN_GRID_CAST_(T***, ennewa_grid_rows_(sizeof(T), EN_ALIGNOF(T), d0, d1, d2, EN_GRID_PLANES_ | EN_GRID_ZERO_))
+
+#define ennewa2_aligned(T, rows, cols, align, stride) \
+  EN_GRID_CAST_(T*, ennewa_grid_(sizeof(T), 1, rows, cols, align, stride, EN_GRID_ALIGNED_))
+#define ennewa02_aligned(T, rows, cols, align, stride) \
+  EN_GRID_CAST_(T*, ennewa_grid_(sizeof(T), 1, rows, cols, align, stride, EN_GRID_ALIGNED_ | EN_GRID_ZERO_))
+#define ennewa3_aligned(T, d0, d1, d2, align, stride) \
+  EN_GRID_CAST_(T*, ennewa_grid_(sizeof(T), d0, d1, d2, align, stride, EN_GRID_ALIGNED_))
+#define ennewa03_aligned(T, d0, d1, d2, align, stride) \
+  EN_GRID_CAST_(T*, ennewa_grid_(sizeof(T), d0, d1, d2, align, stride, EN_GRID_ALIGNED_ | EN_GRID_ZERO_))
+
+#define enrealloc2_aligned(ptr, T, old_rows, old_cols, rows, cols, align, stride) \
+  EN_GRID_CAST_(T*, enrealloc_grid_(EN_GRID_PTR_(T, ptr), sizeof(T), 1, old_rows, old_cols, 1, rows, cols, align, stride, EN_GRID_ALIGNED_))
+#define enresize2_aligned(ptr, T, old_rows, old_cols, rows, cols, align, stride) \
+  EN_GRID_CAST_(T*, enrealloc_grid_(EN_GRID_PTR_(T, ptr), sizeof(T), 1, old_rows, old_cols, 1, rows, cols, align, stride, EN_GRID_ALIGNED_ | EN_GRID_RESIZE_))
+#define enrealloc3_aligned(ptr, T, old_d0, old_d1, old_d2, d0, d1, d2, align, stride) \
+  EN_GRID_CAST_(T*, enrealloc_grid_(EN_GRID_PTR_(T, ptr), sizeof(T), old_d0, old_d1, old_d2, d0, d1, d2, align, stride, EN_GRID_ALIGNED_))
+#define enresize3_aligned(ptr, T, old_d0, old_d1, old_d2, d0, d1, d2, align, stride) \
+  EN_GRID_CAST_(T*, enrealloc_grid_(EN_GRID_PTR_(T, ptr), sizeof(T), old_d0, old_d1, old_d2, d0, d1, d2, align, stride, EN_GRID_ALIGNED_ | EN_GRID_RESIZE_))
+
+static EN_INLINE void enfree_grid_(void* ptr) {
+  EN_FREE(ptr);
+}
+#if defined(__cplusplus)
+  template<typename T>
+  static T* enfree_grid(T* ptr) {
+    enfree_grid_(static_cast<void*>(ptr));
+    return static_cast<T*>(NULL);
+  }
+#elif defined(__GNUC__)
+#  define enfree_grid(ptr) ((__typeof__(*ptr)*) (enfree_grid_(ptr), NULL))
+#else
+#  define enfree_grid(ptr) (enfree_grid_(ptr), (void*) NULL)
+#endif
+
+#endif /* !defined(ENGRID_H) */
@@ -0,0 +1,249 @@
+/* Typed memory mappings for enmem.h
+ * Code from <https://github.com/nemequ/attic/>
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to
+ * the public domain worldwide. This software is distributed without
+ * any warranty.
+ *
+ * For details see http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ *********************************************************************
+ *
+ * Loading an array of fixed-layout records from a file with ennewa()
+ * and fread() reads the whole thing up front and keeps two copies in
+ * memory (the page cache and the array). Mapping the file instead
+ * means pages are only read when they are touched, and the page cache
+ * is the only copy:
+ *
+ *   int fd = open("points.bin", O_RDONLY);
+ *   size_t n;
+ *   const Point* points = enmap_file(Point, fd, 0, 0, &n, ENMAP_SEQUENTIAL);
+ *   close(fd);
+ *   if (points == NULL)
+ *     return -1;
+ *   ...
+ *   points = enunmap(points, Point, n);
+ *
+ * Just like ennewa(), the result is a T*, the size calculations are
+ * checked for overflow, and the region is validated: it must be
+ * within the file, a multiple of sizeof(T), and the offset must be a
+ * multiple of alignof(T). The file descriptor may be closed once the
+ * mapping exists. Only available on POSIX systems.
+ *
+ * Keep in mind that the data is used as-is, so the file must have
+ * been written with the same layout (padding, byte order, etc.), and
+ * that if the file is truncated while it's mapped accessing the
+ * missing pages raises SIGBUS.
+ *
+ *********************************************************************
+ *
+ * Flags (combine with |):
+ *
+ *   ENMAP_READ: read-only, and changes to the file are visible. This
+ *     is the default (0).
+ *   ENMAP_PRIVATE: private copy-on-write mapping; you may write to
+ *     the memory, but the changes aren't written to the file. Only
+ *     the pages you write to are copied.
+ *   ENMAP_SEQUENTIAL, ENMAP_WILLNEED: hint that the memory will be
+ *     accessed sequentially, or soon, so the kernel should read ahead
+ *     aggressively (madvise() or posix_madvise(), if available).
+ *   ENMAP_HUGEPAGE: ask for transparent huge pages (MADV_HUGEPAGE, on
+ *     Linux); most useful for enmap_anon().
+ *
+ *********************************************************************
+ *
+ * T* enmap_file(Type T, int fd, off_t offset, size_t nmemb, size_t* count, int flags)
+ *
+ *   Map nmemb elements of type T starting at byte offset in the file.
+ *   If nmemb is 0 everything from offset to the end of the file is
+ *   mapped. offset doesn't need to be a multiple of the page size. If
+ *   count isn't NULL the number of elements is stored there (0 on
+ *   failure).
+ *
+ *   On failure NULL is returned and errno is set: EINVAL if the region
+ *   isn't valid (including if it is empty), ENOMEM if the size
+ *   overflows, or whatever fstat() or mmap() set.
+ *
+ * T* enmap_anon(Type T, size_t nmemb, int flags)
+ *
+ *   Map nmemb elements of zero-initialized anonymous memory, with the
+ *   same overflow checks as ennewa0(). Pages aren't allocated until
+ *   they're touched. ENMAP_PRIVATE doesn't matter; the memory is
+ *   always writable and private. Returns NULL if nmemb is 0.
+ *
+ * T* enunmap(T* ptr, Type T, size_t nmemb)
+ *
+ *   Unmap memory from enmap_file() or enmap_anon(), and return NULL.
+ *   nmemb must be the number of elements which were mapped. ptr may
+ *   be NULL. Never pass memory from these functions to enfree().
+ */
+
+#if !defined(ENMAP_H)
+#define ENMAP_H
+
+#include "enmem.h"
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define MAP_ANONYMOUS MAP_ANON
+#endif
+
+enum {
+  ENMAP_READ = 0,
+  ENMAP_PRIVATE = 1 << 0,
+  ENMAP_SEQUENTIAL = 1 << 1,
+  ENMAP_WILLNEED = 1 << 2,
+  ENMAP_HUGEPAGE = 1 << 3
+};
+
+static EN_INLINE size_t enmap_page_size_(void) {
+  return (size_t) sysconf(_SC_PAGESIZE);
+}
+
+/* These are only hints, so if the system (or the feature macros)
+   doesn't provide them we just skip them. */
+static EN_INLINE void enmap_advise_(void* addr, size_t len, int flags) {
+#if defined(MADV_SEQUENTIAL)
+  if (flags & ENMAP_SEQUENTIAL)
+    madvise(addr, len, MADV_SEQUENTIAL);
+#elif defined(POSIX_MADV_SEQUENTIAL)
+  if (flags & ENMAP_SEQUENTIAL)
+    posix_madvise(addr, len, POSIX_MADV_SEQUENTIAL);
+#endif
+#if defined(MADV_WILLNEED)
+  if (flags & ENMAP_WILLNEED)
+    madvise(addr, len, MADV_WILLNEED);
+#elif defined(POSIX_MADV_WILLNEED)
+  if (flags & ENMAP_WILLNEED)
+    posix_madvise(addr, len, POSIX_MADV_WILLNEED);
+#endif
+#if defined(MADV_HUGEPAGE)
+  if (flags & ENMAP_HUGEPAGE)
+    madvise(addr, len, MADV_HUGEPAGE);
+#endif
+  (void) addr;
+  (void) len;
+  (void) flags;
+}
+
+static EN_INLINE void* enmap_file_(int fd, off_t offset, size_t size, size_t align, size_t nmemb, size_t* count, int flags) {
+  struct stat st;
+  uint64_t avail;
+  size_t bytes, delta, len;
+  char* addr;
+
+  if (count != NULL)
+    *count = 0;
+
+  if (fstat(fd, &st) != 0)
+    return NULL;
+
+  if (offset < 0 || st.st_size < offset || ((uint64_t) offset % align) != 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+  avail = (uint64_t) (st.st_size - offset);
+
+  if (nmemb == 0) {
+    if ((avail % size) != 0) {
+      errno = EINVAL;
+      return NULL;
+    }
+    if (avail > SIZE_MAX) {
+      errno = ENOMEM;
+      return NULL;
+    }
+    bytes = (size_t) avail;
+    nmemb = bytes / size;
+  } else {
+    if (EN_UNLIKELY(!enmul_(size, nmemb, &bytes)))
+      return NULL;
+    if (bytes > avail) {
+      errno = EINVAL;
+      return NULL;
+    }
+  }
+
+  if (bytes == 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  /* mmap wants a page-aligned offset. */
+  delta = (size_t) ((uint64_t) offset % enmap_page_size_());
+  if (EN_UNLIKELY(bytes > (SIZE_MAX - delta))) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  len = bytes + delta;
+
+  addr = (char*) mmap(NULL, len,
+                      (flags & ENMAP_PRIVATE) ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                      (flags & ENMAP_PRIVATE) ? MAP_PRIVATE : MAP_SHARED,
+                      fd, offset - (off_t) delta);
+  if (addr == (char*) MAP_FAILED)
+    return NULL;
+  enmap_advise_(addr, len, flags);
+
+  if (count != NULL)
+    *count = nmemb;
+  return addr + delta;
+}
+
+static EN_INLINE void* enmap_anon_(size_t size, size_t nmemb, int flags) {
+  size_t bytes;
+  void* addr;
+
+  if (EN_UNLIKELY(!nmemb))
+    return NULL;
+
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &bytes)))
+    return NULL;
+
+#if defined(MAP_ANONYMOUS)
+  addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#else
+  {
+    /* Without feature macros (-std=c11 on glibc, for example) we may
+       not have MAP_ANONYMOUS, but /dev/zero works everywhere. */
+    int fd = open("/dev/zero", O_RDWR);
+    if (fd < 0)
+      return NULL;
+    addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+  }
+#endif
+  if (addr == MAP_FAILED)
+    return NULL;
+  enmap_advise_(addr, bytes, flags);
+
+  return addr;
+}
+
+static EN_INLINE void enunmap_(const void* ptr, size_t size, size_t nmemb) {
+  size_t delta;
+
+  if (ptr == NULL)
+    return;
+
+  delta = (size_t) (((uintptr_t) ptr) % enmap_page_size_());
+  munmap((void*) (((uintptr_t) ptr) - delta), (size * nmemb) + delta);
+}
+
+#if defined(__cplusplus)
+#  define enmap_file(T, fd, offset, nmemb, count, flags) static_cast<T*>(enmap_file_(fd, offset, sizeof(T), EN_ALIGNOF(T), nmemb, count, flags))
+#  define enmap_anon(T, nmemb, flags) static_cast<T*>(enmap_anon_(sizeof(T), nmemb, flags))
+#  define enunmap(ptr, T, nmemb) (enunmap_(static_cast<const void*>(EN_CHECK_TYPE(T, (ptr))), sizeof(T), nmemb), static_cast<T*>(NULL))
+#else
+#  define enmap_file(T, fd, offset, nmemb, count, flags) ((T*) enmap_file_(fd, offset, sizeof(T), EN_ALIGNOF(T), nmemb, count, flags))
+#  define enmap_anon(T, nmemb, flags) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), enmap_anon_(sizeof(T), nmemb, flags)))
+#  define enunmap(ptr, T, nmemb) (enunmap_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb), (T*) NULL)
+#endif
+
+#endif /* !defined(ENMAP_H) */
@@ -0,0 +1,710 @@
+/* Microbenchmarks for enmem.h. Like enmem.c, you shouldn't need this
+   file unless you're working on enmem.h itself.
+
+   It measures the allocation fast paths (with and without the
+   overflow checks), realloc growth patterns, zeroed allocations,
+   batch allocation, matrices built from one allocation per row
+   versus engrid.h, and malloc churn from several threads, and
+   reports ns/op along with the RSS high-water mark after each
+   benchmark. To compare the
+   different overflow checks, and C with C++, build it a few ways:
+
+     cc -O2 -o enmem-bench enmem-bench.c -lpthread
+     cc -O2 -DEN_NO_BUILTIN_MUL_OVERFLOW -o enmem-bench-portable enmem-bench.c -lpthread
+     c++ -x c++ -O2 -o enmem-bench-cxx enmem-bench.c -lpthread
+
+   It also compares endiv.h with the native / and % operators, for
+   divisors known at run time and at compile time, EN_AUTO_ARRAY
+   with heap-allocated temporary arrays, the _in variants with and
+   without an allocator context, and enepoch.h with a reader-writer
+   lock for a read-mostly table which is replaced by swapping a
+   pointer. Finally, it compares loading an array from a file with
+   ennewa() and fread() against enmap_file(), reading either a
+   sample of it or all of it. In C++11 it compares growing an array
+   of trivially copyable, opted-in trivially relocatable, and other
+   types with enresize_relocate() against std::vector.
+
+   To compare realloc with the mmap/mremap large array path:
+
+     cc -O2 -DEN_LARGE -o enmem-bench-large enmem-bench.c -lpthread
+
+   Requires POSIX (clock_gettime, getrusage, pthreads, and mmap). */
+
+#if defined(EN_LARGE)
+/* For mremap and MAP_ANONYMOUS. */
+#  if !defined(_GNU_SOURCE)
+#    define _GNU_SOURCE
+#  endif
+#else
+#  define _POSIX_C_SOURCE 200809L
+#endif
+
+#define EN_EPOCH_IMPLEMENTATION
+
+#include "enmem.h"
+#include "envec.h"
+#include "endiv.h"
+#include "enepoch.h"
+#include "enmap.h"
+#include "engrid.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+#  include <string>
+#  include <vector>
+#endif
+
+#if !defined(BENCH_THREADS)
+#  define BENCH_THREADS 4
+#endif
+
+/* Keep the compiler from optimizing away allocations, or folding
+   sizes which are supposed to be runtime values. */
+static void* volatile bench_sink;
+static volatile size_t bench_nmemb;
+static volatile int bench_value;
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (((double) ts.tv_sec) * 1e9) + ((double) ts.tv_nsec);
+}
+
+static long bench_rss_kib(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (long) usage.ru_maxrss;
+}
+
+static void bench_report(const char* name, size_t bytes, double ns, size_t ops) {
+  printf("%-28s %10zu %12.2f %10ld\n", name, bytes, ns / (double) ops, bench_rss_kib());
+}
+
+/* Run body iterations times and report ns/op. */
+#define BENCH(name, bytes, iterations, body) \
+  do { \
+    size_t bench_i_; \
+    double bench_start_ = bench_now(); \
+    for (bench_i_ = 0 ; bench_i_ < (iterations) ; bench_i_++) { \
+      body; \
+    } \
+    bench_report(name, bytes, bench_now() - bench_start_, iterations); \
+  } while (0)
+
+/* A context which just calls malloc, to measure the indirect calls.
+   It's read through a volatile pointer so the compiler can't see
+   which functions it calls. */
+static void* bench_ctx_malloc(void* ctx, size_t size) { (void) ctx; return malloc(size); }
+static void* bench_ctx_realloc(void* ctx, void* ptr, size_t size) { (void) ctx; return realloc(ptr, size); }
+static void bench_ctx_free(void* ctx, void* ptr) { (void) ctx; free(ptr); }
+static const enallocator bench_ctx = { bench_ctx_malloc, NULL, bench_ctx_realloc, bench_ctx_free, NULL, NULL };
+static const enallocator* volatile bench_allocator = &bench_ctx;
+
+static void bench_alloc(size_t nmemb, size_t iterations) {
+  size_t bytes = nmemb * sizeof(int);
+  const enallocator* allocator = bench_allocator;
+  int* p;
+
+  bench_nmemb = nmemb;
+
+  BENCH("malloc", bytes, iterations, {
+    p = (int*) malloc(sizeof(int) * bench_nmemb);
+    bench_sink = p;
+    free(p);
+  });
+  BENCH("ennewa", bytes, iterations, {
+    p = ennewa(int, bench_nmemb);
+    bench_sink = p;
+    p = enfree(p);
+  });
+  BENCH("ennewa_in (NULL)", bytes, iterations, {
+    p = ennewa_in(NULL, int, bench_nmemb);
+    bench_sink = p;
+    p = enfree_in(NULL, p);
+  });
+  BENCH("ennewa_in (context)", bytes, iterations, {
+    p = ennewa_in(allocator, int, bench_nmemb);
+    bench_sink = p;
+    p = enfree_in(allocator, p);
+  });
+  BENCH("calloc", bytes, iterations, {
+    p = (int*) calloc(bench_nmemb, sizeof(int));
+    bench_value = p[bench_nmemb - 1];
+    free(p);
+  });
+  BENCH("ennewa0", bytes, iterations, {
+    p = ennewa0(int, bench_nmemb);
+    bench_value = p[bench_nmemb - 1];
+    p = enfree(p);
+  });
+  BENCH("ennewa+memset", bytes, iterations, {
+    p = ennewa(int, bench_nmemb);
+    memset(p, 0, sizeof(int) * bench_nmemb);
+    bench_value = p[bench_nmemb - 1];
+    p = enfree(p);
+  });
+}
+
+/* A small temporary array, which EN_AUTO_ARRAY keeps on the stack. */
+static void bench_auto_array(size_t nmemb, size_t iterations) {
+  size_t bytes = nmemb * sizeof(int);
+
+  bench_nmemb = nmemb;
+
+  BENCH("ennewa temporary", bytes, iterations, {
+    int* p = ennewa(int, bench_nmemb);
+    p[bench_nmemb - 1] = bench_value;
+    bench_value = p[bench_nmemb - 1] + 1;
+    p = enfree(p);
+  });
+  BENCH("EN_AUTO_ARRAY", bytes, iterations, {
+    EN_AUTO_ARRAY(int, p, bench_nmemb, 64);
+    p[bench_nmemb - 1] = bench_value;
+    bench_value = p[bench_nmemb - 1] + 1;
+    EN_AUTO_ARRAY_FREE(p);
+  });
+}
+
+static void bench_overflow_check(size_t iterations) {
+  size_t res = 0;
+
+  BENCH("size * nmemb", sizeof(int), iterations, {
+    res += sizeof(int) * bench_nmemb;
+  });
+  BENCH("enmul_", sizeof(int), iterations, {
+    size_t tmp;
+    if (enmul_(sizeof(int), bench_nmemb, &tmp))
+      res += tmp;
+  });
+
+  bench_sink = (void*) (uintptr_t) res;
+}
+
+/* Divide by a divisor which is only known at run time (bench_nmemb),
+   and by a constant, which the compiler should fold either way. */
+static void bench_div(size_t iterations) {
+  uint32_t src32[1024], dest32[1024];
+  uint64_t src64[1024];
+  const uint32_t d = (uint32_t) bench_nmemb;
+  uint64_t res = 0;
+  endiv_u32 dv32, dv7;
+  endiv_u64 dv64;
+  size_t i;
+
+  endiv_u32_init(&dv32, d);
+  endiv_u32_init(&dv7, 7);
+  endiv_u64_init(&dv64, d);
+  for (i = 0 ; i < 1024 ; i++) {
+    src32[i] = (uint32_t) (i * 2654435761U);
+    src64[i] = ((uint64_t) src32[i] << 29) ^ i;
+  }
+
+  BENCH("u32 / d", sizeof(uint32_t), iterations, {
+    res += src32[bench_i_ & 1023] / d;
+  });
+  BENCH("endiv_u32_div", sizeof(uint32_t), iterations, {
+    res += endiv_u32_div(src32[bench_i_ & 1023], &dv32);
+  });
+  BENCH("u32 % d", sizeof(uint32_t), iterations, {
+    res += src32[bench_i_ & 1023] % d;
+  });
+  BENCH("endiv_u32_mod", sizeof(uint32_t), iterations, {
+    res += endiv_u32_mod(src32[bench_i_ & 1023], &dv32);
+  });
+  BENCH("u64 / d", sizeof(uint64_t), iterations, {
+    res += src64[bench_i_ & 1023] / d;
+  });
+  BENCH("endiv_u64_div", sizeof(uint64_t), iterations, {
+    res += endiv_u64_div(src64[bench_i_ & 1023], &dv64);
+  });
+  BENCH("u32 / 7", sizeof(uint32_t), iterations, {
+    res += src32[bench_i_ & 1023] / 7;
+  });
+  BENCH("endiv_u32_div (7)", sizeof(uint32_t), iterations, {
+    res += endiv_u32_div(src32[bench_i_ & 1023], &dv7);
+  });
+
+  BENCH("u32 / d (array)", sizeof(src32), iterations / 1024, {
+    for (i = 0 ; i < 1024 ; i++)
+      dest32[i] = src32[i] / d;
+    res += dest32[bench_i_ & 1023];
+  });
+  BENCH("endiv_u32_div_array", sizeof(src32), iterations / 1024, {
+    endiv_u32_div_array(dest32, src32, 1024, &dv32);
+    res += dest32[bench_i_ & 1023];
+  });
+  BENCH("u32 % d (array)", sizeof(src32), iterations / 1024, {
+    for (i = 0 ; i < 1024 ; i++)
+      dest32[i] = src32[i] % d;
+    res += dest32[bench_i_ & 1023];
+  });
+  BENCH("endiv_u32_mod_array", sizeof(src32), iterations / 1024, {
+    endiv_u32_mod_array(dest32, src32, 1024, &dv32);
+    res += dest32[bench_i_ & 1023];
+  });
+
+  bench_sink = (void*) (uintptr_t) res;
+}
+
+static void bench_growth(size_t nmemb) {
+  size_t bytes = nmemb * sizeof(int);
+  int* p = NULL;
+  size_t cap = 0;
+
+  BENCH("enresize(n + 1)", bytes, nmemb, {
+    p = enresize(p, int, bench_i_ + 1);
+    if (p == NULL)
+      exit(EXIT_FAILURE);
+    p[bench_i_] = (int) bench_i_;
+  });
+  p = enfree(p);
+
+  BENCH("enrealloc(n + 1)", bytes, nmemb, {
+    int* tmp = enrealloc(p, int, bench_i_ + 1);
+    if (tmp == NULL)
+      exit(EXIT_FAILURE);
+    p = tmp;
+    p[bench_i_] = (int) bench_i_;
+  });
+  p = enfree(p);
+
+  BENCH("enresize(n * 2)", bytes, nmemb, {
+    if (bench_i_ == cap) {
+      cap = (cap == 0) ? 4 : (cap * 2);
+      p = enresize(p, int, cap);
+      if (p == NULL)
+        exit(EXIT_FAILURE);
+    }
+    p[bench_i_] = (int) bench_i_;
+  });
+  p = enfree(p);
+
+  BENCH("envec_push", bytes, nmemb, {
+    envec_push(p, int, (int) bench_i_);
+  });
+  p = envec_free(p);
+}
+
+/* Grow a large array by doubling, touching every page along the way,
+   which is where mremap can avoid copying. */
+static void bench_large_growth(size_t min_bytes, size_t max_bytes, size_t iterations) {
+  BENCH("enresize(large * 2)", max_bytes, iterations, {
+    char* p = NULL;
+    size_t size;
+    size_t i;
+
+    for (size = min_bytes ; size <= max_bytes ; size *= 2) {
+      p = enresize(p, char, size);
+      if (p == NULL)
+        exit(EXIT_FAILURE);
+      for (i = size / 2 ; i < size ; i += 4096)
+        p[i] = (char) i;
+    }
+    bench_value = p[max_bytes - 1];
+    p = enfree(p);
+  });
+}
+
+/* Allocate a burst of small nodes, like building a graph. */
+static void bench_batch(size_t count, size_t iterations) {
+  typedef struct { void* next; size_t value; } node;
+  node** nodes = ennewa(node*, count);
+  size_t i;
+
+  BENCH("ennew loop", sizeof(node) * count, iterations, {
+    for (i = 0 ; i < count ; i++)
+      nodes[i] = ennew(node);
+    bench_sink = nodes[count - 1];
+    for (i = 0 ; i < count ; i++)
+      nodes[i] = enfree(nodes[i]);
+  });
+  BENCH("ennew_batch", sizeof(node) * count, iterations, {
+    ennew_batch(node, count, nodes);
+    bench_sink = nodes[count - 1];
+    enfree_batch(nodes, count);
+  });
+
+  nodes = enfree(nodes);
+}
+
+/* Build, fill, sum, and free a rows x cols matrix. */
+static void bench_grid(size_t rows, size_t cols, size_t iterations) {
+  const size_t bytes = rows * cols * sizeof(double);
+  size_t r, c;
+
+  BENCH("ennewa per row", bytes, iterations, {
+    double** m = ennewa(double*, rows);
+    double sum = 0.0;
+    for (r = 0 ; r < rows ; r++)
+      m[r] = ennewa(double, cols);
+    for (r = 0 ; r < rows ; r++)
+      for (c = 0 ; c < cols ; c++)
+        m[r][c] = (double) c;
+    for (c = 0 ; c < cols ; c++)
+      for (r = 0 ; r < rows ; r++)
+        sum += m[r][c];
+    bench_value = (int) sum;
+    for (r = 0 ; r < rows ; r++)
+      m[r] = enfree(m[r]);
+    m = enfree(m);
+  });
+  BENCH("ennewa2_rows", bytes, iterations, {
+    double** m = ennewa2_rows(double, rows, cols);
+    double sum = 0.0;
+    for (r = 0 ; r < rows ; r++)
+      for (c = 0 ; c < cols ; c++)
+        m[r][c] = (double) c;
+    for (c = 0 ; c < cols ; c++)
+      for (r = 0 ; r < rows ; r++)
+        sum += m[r][c];
+    bench_value = (int) sum;
+    m = enfree_grid(m);
+  });
+  BENCH("ennewa2", bytes, iterations, {
+    double* m = ennewa2(double, rows, cols);
+    double sum = 0.0;
+    for (r = 0 ; r < rows ; r++)
+      for (c = 0 ; c < cols ; c++)
+        m[(r * cols) + c] = (double) c;
+    for (c = 0 ; c < cols ; c++)
+      for (r = 0 ; r < rows ; r++)
+        sum += m[(r * cols) + c];
+    bench_value = (int) sum;
+    m = enfree_grid(m);
+  });
+}
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+struct bench_pod {
+  size_t a, b;
+  explicit bench_pod(size_t v) : a(v), b(v) { }
+  int value() const { return (int) a; }
+};
+
+/* libstdc++'s std::string points into itself, so it has to be moved
+   with its move constructor. */
+struct bench_name {
+  std::string s;
+  explicit bench_name(size_t v) : s(1 + (v % 8), 'x') { }
+  int value() const { return (int) s.size(); }
+};
+
+/* Like std::unique_ptr: not trivially copyable, but memcpy is a valid
+   move. */
+struct bench_handle {
+  size_t* p;
+  explicit bench_handle(size_t v) : p(NULL) { (void) v; }
+  bench_handle(bench_handle&& other) noexcept : p(other.p) { other.p = NULL; }
+  ~bench_handle() { delete p; }
+  int value() const { return p == NULL; }
+};
+EN_TRIVIALLY_RELOCATABLE(bench_handle);
+
+/* Append n elements one at a time, doubling the capacity. */
+template<typename T>
+static void bench_relocate_push(size_t n) {
+  T* p = NULL;
+  size_t len, cap = 0;
+
+  for (len = 0 ; len < n ; len++) {
+    if (len == cap) {
+      const size_t grown = (cap == 0) ? 4 : (cap * 2);
+      p = enresize_relocate(p, T, len, grown);
+      if (p == NULL)
+        exit(EXIT_FAILURE);
+      cap = grown;
+    }
+    ::new (static_cast<void*>(p + len)) T(len);
+  }
+
+  bench_value = p[n - 1].value();
+  p = enresize_relocate(p, T, n, 0);
+}
+
+template<typename T>
+static void bench_vector_push(size_t n) {
+  std::vector<T> v;
+  size_t len;
+
+  for (len = 0 ; len < n ; len++)
+    v.emplace_back(len);
+
+  bench_value = v[n - 1].value();
+}
+
+static void bench_relocate(size_t n, size_t iterations) {
+  BENCH("std::vector (pod)", n * sizeof(bench_pod), iterations, bench_vector_push<bench_pod>(n));
+  BENCH("enresize_relocate (pod)", n * sizeof(bench_pod), iterations, bench_relocate_push<bench_pod>(n));
+  BENCH("std::vector (handle)", n * sizeof(bench_handle), iterations, bench_vector_push<bench_handle>(n));
+  BENCH("enresize_relocate (handle)", n * sizeof(bench_handle), iterations, bench_relocate_push<bench_handle>(n));
+  BENCH("std::vector (string)", n * sizeof(bench_name), iterations, bench_vector_push<bench_name>(n));
+  BENCH("enresize_relocate (string)", n * sizeof(bench_name), iterations, bench_relocate_push<bench_name>(n));
+}
+#endif
+
+typedef struct {
+  size_t iterations;
+  unsigned int seed;
+} bench_churn_args;
+
+static void* bench_churn_thread(void* data) {
+  const bench_churn_args* args = (const bench_churn_args*) data;
+  char* slots[64] = { NULL };
+  unsigned int state = args->seed;
+  size_t i;
+
+  for (i = 0 ; i < args->iterations ; i++) {
+    size_t slot;
+
+    state = (state * 1103515245U) + 12345U;
+    slot = (state >> 16) % 64;
+    slots[slot] = enfree(slots[slot]);
+    slots[slot] = ennewa(char, 16 + ((state >> 8) % 1024));
+  }
+
+  for (i = 0 ; i < 64 ; i++)
+    slots[i] = enfree(slots[i]);
+
+  return NULL;
+}
+
+static void bench_churn(size_t threads, size_t iterations) {
+  pthread_t tids[BENCH_THREADS];
+  bench_churn_args args[BENCH_THREADS];
+  double start;
+  char name[32];
+  size_t i;
+
+  start = bench_now();
+  for (i = 0 ; i < threads ; i++) {
+    args[i].iterations = iterations;
+    args[i].seed = (unsigned int) i;
+    pthread_create(&(tids[i]), NULL, bench_churn_thread, &(args[i]));
+  }
+  for (i = 0 ; i < threads ; i++)
+    pthread_join(tids[i], NULL);
+
+  snprintf(name, sizeof(name), "churn (%zu threads)", threads);
+  bench_report(name, 0, bench_now() - start, threads * iterations);
+}
+
+static uint32_t bench_map_sum(const uint32_t* data, size_t n, size_t stride) {
+  uint32_t sum = 0;
+  size_t i;
+
+  for (i = 0 ; i < n ; i += stride)
+    sum += data[i];
+
+  return sum;
+}
+
+/* Load an array from a file (which is in the page cache, so this is
+   the cost of the copy and the page faults, not the disk), then read
+   every element or one per 64 KiB. */
+static void bench_map(size_t bytes, size_t iterations) {
+  const size_t n = bytes / sizeof(uint32_t);
+  const size_t sparse = (64 * 1024) / sizeof(uint32_t);
+  uint32_t* data = ennewa(uint32_t, n);
+  FILE* fp = tmpfile();
+  size_t i, stride;
+
+  if (data == NULL || fp == NULL) {
+    fprintf(stderr, "unable to create a %zu byte file\n", bytes);
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0 ; i < n ; i++)
+    data[i] = (uint32_t) i;
+  if (fwrite(data, sizeof(uint32_t), n, fp) != n || fflush(fp) != 0) {
+    fprintf(stderr, "unable to write a %zu byte file\n", bytes);
+    exit(EXIT_FAILURE);
+  }
+  data = enfree(data);
+
+  for (stride = sparse ; stride != 0 ; stride = (stride == 1) ? 0 : 1) {
+    const char* sample = (stride == 1) ? "all" : "sample";
+    char name[40];
+
+    snprintf(name, sizeof(name), "ennewa+fread (%s)", sample);
+    BENCH(name, bytes, iterations, {
+      data = ennewa(uint32_t, n);
+      rewind(fp);
+      if (data == NULL || fread(data, sizeof(uint32_t), n, fp) != n)
+        exit(EXIT_FAILURE);
+      bench_value = (int) bench_map_sum(data, n, stride);
+      data = enfree(data);
+    });
+
+    snprintf(name, sizeof(name), "enmap_file (%s)", sample);
+    BENCH(name, bytes, iterations, {
+      const uint32_t* mapped = enmap_file(uint32_t, fileno(fp), 0, n, NULL, (stride == 1) ? ENMAP_SEQUENTIAL : ENMAP_READ);
+      if (mapped == NULL)
+        exit(EXIT_FAILURE);
+      bench_value = (int) bench_map_sum(mapped, n, stride);
+      mapped = enunmap(mapped, uint32_t, n);
+    });
+  }
+
+  fclose(fp);
+}
+
+/* A read-mostly table which is updated by copying it and swapping the
+   pointer; one operation in BENCH_TABLE_WRITES is an update. */
+#define BENCH_TABLE_SIZE 64
+#define BENCH_TABLE_WRITES 1024
+
+typedef struct {
+  size_t values[BENCH_TABLE_SIZE];
+} bench_table;
+
+static bench_table* bench_shared_table;
+static pthread_rwlock_t bench_table_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+typedef struct {
+  size_t iterations;
+  int epoch;
+} bench_table_args;
+
+static bench_table* bench_table_copy(const bench_table* table, size_t i) {
+  bench_table* copy = ennew(bench_table);
+
+  if (copy == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(copy, table, sizeof(bench_table));
+  copy->values[i % BENCH_TABLE_SIZE]++;
+
+  return copy;
+}
+
+static void* bench_table_thread(void* data) {
+  const bench_table_args* args = (const bench_table_args*) data;
+  size_t sum = 0;
+  size_t i;
+
+  for (i = 0 ; i < args->iterations ; i++) {
+    if (args->epoch) {
+      en_epoch_enter();
+      if ((i % BENCH_TABLE_WRITES) == 0) {
+        /* Writers still need to be serialized with each other. */
+        bench_table* table;
+        pthread_rwlock_wrlock(&bench_table_lock);
+        table = bench_table_copy(EN_ATOMIC_LOAD(&bench_shared_table), i);
+        table = EN_ATOMIC_EXCHANGE(&bench_shared_table, table);
+        pthread_rwlock_unlock(&bench_table_lock);
+        table = enretire(table);
+      } else {
+        sum += EN_ATOMIC_LOAD(&bench_shared_table)->values[i % BENCH_TABLE_SIZE];
+      }
+      en_epoch_exit();
+    } else if ((i % BENCH_TABLE_WRITES) == 0) {
+      bench_table* table;
+      pthread_rwlock_wrlock(&bench_table_lock);
+      table = bench_shared_table;
+      bench_shared_table = bench_table_copy(table, i);
+      pthread_rwlock_unlock(&bench_table_lock);
+      table = enfree(table);
+    } else {
+      pthread_rwlock_rdlock(&bench_table_lock);
+      sum += bench_shared_table->values[i % BENCH_TABLE_SIZE];
+      pthread_rwlock_unlock(&bench_table_lock);
+    }
+  }
+
+  if (args->epoch)
+    en_epoch_thread_exit();
+  bench_value = (int) sum;
+
+  return NULL;
+}
+
+static void bench_table_lookup(size_t threads, size_t iterations) {
+  pthread_t tids[BENCH_THREADS];
+  bench_table_args args;
+  int epoch;
+  size_t i;
+
+  args.iterations = iterations;
+  for (epoch = 0 ; epoch < 2 ; epoch++) {
+    double start;
+    char name[40];
+
+    bench_shared_table = ennew0(bench_table);
+    args.epoch = epoch;
+
+    start = bench_now();
+    for (i = 0 ; i < threads ; i++)
+      pthread_create(&(tids[i]), NULL, bench_table_thread, &args);
+    for (i = 0 ; i < threads ; i++)
+      pthread_join(tids[i], NULL);
+
+    snprintf(name, sizeof(name), "%s (%zu threads)", epoch ? "table enepoch" : "table rwlock", threads);
+    bench_report(name, sizeof(bench_table), bench_now() - start, threads * iterations);
+    bench_shared_table = enfree(bench_shared_table);
+  }
+}
+
+int main(void) {
+  size_t threads;
+
+  printf("%s, %s overflow check, %s\n",
+#if defined(__cplusplus)
+         "C++",
+#else
+         "C",
+#endif
+#if defined(EN_MUL_OVERFLOW)
+         "builtin",
+#else
+         "portable",
+#endif
+#if defined(EN_LARGE)
+         "mmap large arrays"
+#else
+         "realloc large arrays"
+#endif
+    );
+  printf("%-28s %10s %12s %10s\n", "benchmark", "bytes", "ns/op", "rss (KiB)");
+
+  bench_nmemb = 4;
+  bench_overflow_check(100000000);
+
+  bench_nmemb = 641;
+  bench_div(100000000);
+  bench_nmemb = 4;
+
+  bench_alloc(4, 10000000);
+  bench_alloc(1024, 1000000);
+  bench_alloc(4 * 1024 * 1024, 1000);
+
+  bench_auto_array(16, 10000000);
+  bench_auto_array(1024, 1000000);
+
+  bench_growth(1000);
+  bench_growth(1000000);
+
+  bench_batch(10000, 1000);
+
+  bench_grid(1024, 30, 2000);
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+  bench_relocate(1000000, 20);
+  bench_relocate(100000000 / sizeof(bench_pod), 2);
+#endif
+
+  bench_large_growth(1024 * 1024, 256 * 1024 * 1024, 10);
+
+  for (threads = 1 ; threads <= BENCH_THREADS ; threads *= 2)
+    bench_churn(threads, 2000000);
+
+  for (threads = 1 ; threads <= BENCH_THREADS ; threads *= 2)
+    bench_table_lookup(threads, 10000000);
+
+  bench_map(64 * 1024 * 1024, 20);
+
+  return 0;
+}
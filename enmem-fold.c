@@ -0,0 +1,52 @@
+/* Check that enmem.h doesn't emit run-time overflow checks for
+   constant sizes. You shouldn't need this file; it is only meant to
+   be compiled to assembly and inspected:
+
+     cc -O2 -S -o - enmem-fold.c
+     cc -O2 -DEN_NO_BUILTIN_MUL_OVERFLOW -S -o - enmem-fold.c
+     c++ -x c++ -O2 -S -o - enmem-fold.c
+
+   constant_newa, constant_newa_c and constant_resize should be a
+   direct call (or tail call) to malloc/realloc with an immediate size
+   and no branches other than enresize's check for realloc failing,
+   and constant_zero should just return NULL. runtime_newa is there for
+   comparison, and should contain the overflow check. constant_div
+   should be the compiler's own multiply and shift for / 10, without
+   any loads from the endiv_u32.
+
+   Uncommenting constant_overflow should cause a compile-time error
+   (in C, with a GNU-compatible compiler). */
+
+#include "is_constant.h"
+#include "enmem.h"
+#include "endiv.h"
+
+int* constant_newa(void) {
+  return ennewa(int, 64);
+}
+
+int* constant_newa_c(void) {
+  return ennewa_c(int, 64);
+}
+
+int* constant_resize(int* ptr) {
+  return enresize(ptr, int, 64);
+}
+
+int* constant_zero(void) {
+  return ennewa(int, 0);
+}
+
+int* runtime_newa(size_t nmemb) {
+  return ennewa(int, nmemb);
+}
+
+uint32_t constant_div(uint32_t n) {
+  endiv_u32 dv;
+  endiv_u32_init(&dv, 10);
+  return endiv_u32_div(n, &dv);
+}
+
+/* int* constant_overflow(void) { */
+/*   return ennewa(int, SIZE_MAX / 2); */
+/* } */
@@ -8,14 +8,144 @@
      but I don't think it works with ASan, so you may want 2 runs.
    * If you're using ASan, you'll probably want to set
      ASAN_OPTIONS="allocator_may_return_null=1"
+   * To test the profiler, define EN_PROFILE and
+     EN_PROFILE_IMPLEMENTATION.
+   * To test tracing, define EN_TRACE and EN_TRACE_IMPLEMENTATION. The
+     trace is written to enmem.c.trace, then removed.
+   * To test the enfree_sized() checks, define EN_DEBUG_FREE_SIZED.
+   * To test large allocations, define EN_LARGE (and _GNU_SOURCE on
+     Linux so mremap is used).
 */
 
+#if defined(EN_DEBUG_FREE_SIZED)
+static int sized_mismatches = 0;
+#  define EN_FREE_SIZED_MISMATCH(ptr, size) (sized_mismatches++)
+#endif
+
+#define EN_EPOCH_IMPLEMENTATION
+#define EN_POOL_IMPLEMENTATION
+
 #include "enmem.h"
+#include "enpool.h"
+#include "enepoch.h"
+#if defined(__unix__) || defined(__APPLE__)
+#  include "enmap.h"
+#  include <pthread.h>
+#endif
+#include "envec.h"
+#include "ensoa.h"
+#include "engrid.h"
+#include "endiv.h"
 
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
 
+/* A header with a flexible array member, for the *_flex() tests. */
+typedef struct {
+  size_t len;
+  char tag;
+  short data[];
+} Flex;
+
+/* Constant values which overflow are compile-time errors. */
+static volatile size_t too_many = (SIZE_MAX / sizeof(int)) + 1;
+
+/* A type whose size isn't a power of two, for the enmap.h tests.
+   At file scope since C++98 doesn't allow local types as template
+   arguments. */
+typedef struct { uint32_t a, b, c; } Triple;
+
+/* An allocator context which counts live allocations. */
+typedef struct {
+  size_t live;
+  size_t sized_frees;
+  size_t last_size;
+} CountingHeap;
+
+static void* counting_malloc(void* ctx, size_t size) {
+  ((CountingHeap*) ctx)->live++;
+  return malloc(size);
+}
+
+static void* counting_realloc(void* ctx, void* ptr, size_t size) {
+  void* res = realloc(ptr, size);
+  if (ptr == NULL && res != NULL)
+    ((CountingHeap*) ctx)->live++;
+  return res;
+}
+
+static void counting_free(void* ctx, void* ptr) {
+  ((CountingHeap*) ctx)->live--;
+  free(ptr);
+}
+
+static void counting_free_sized(void* ctx, void* ptr, size_t size) {
+  ((CountingHeap*) ctx)->sized_frees++;
+  ((CountingHeap*) ctx)->last_size = size;
+  counting_free(ctx, ptr);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+/* Frees objects some other thread allocated from a pool. */
+typedef struct {
+  enpool* pool;
+  double** objs;
+  size_t nmemb;
+} PoolJob;
+
+static void* pool_free_thread(void* arg) {
+  PoolJob* job = (PoolJob*) arg;
+  size_t i;
+
+  for (i = 0 ; i < job->nmemb ; i++)
+    job->objs[i] = enpool_free(job->pool, job->objs[i]);
+  enpool_flush(job->pool);
+
+  return NULL;
+}
+#endif
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+/* Not trivially relocatable, so enrealloc_relocate() has to use the
+   move constructor.  Copying throws once copies_left reaches 0. */
+static int tracked_live = 0;
+static int tracked_copies_left = -1;
+
+struct Tracked {
+  int value;
+  Tracked* self;
+
+  explicit Tracked(int v) : value(v), self(this) { tracked_live++; }
+  Tracked(Tracked&& other) noexcept : value(other.value), self(this) { other.value = -1; tracked_live++; }
+  ~Tracked() { assert(self == this); tracked_live--; }
+};
+
+struct ThrowingCopy {
+  int value;
+
+  explicit ThrowingCopy(int v) : value(v) { tracked_live++; }
+  ThrowingCopy(const ThrowingCopy& other) : value(other.value) {
+    if (tracked_copies_left-- == 0)
+      throw 42;
+    tracked_live++;
+  }
+  ThrowingCopy(ThrowingCopy&& other) : value(other.value) { assert(0); }
+  ~ThrowingCopy() { tracked_live--; }
+};
+
+/* Owns a heap allocation, so it isn't trivially copyable, but it
+   doesn't point into itself so memcpy is a valid move. */
+struct Owner {
+  int* value;
+
+  explicit Owner(int v) : value(new int(v)) { }
+  Owner(Owner&& other) noexcept : value(other.value) { other.value = NULL; }
+  ~Owner() { delete value; }
+};
+EN_TRIVIALLY_RELOCATABLE(Owner);
+#endif
+
 int main(void) {
   int *x, *y;
 
@@ -48,13 +178,13 @@ int main(void) {
   x = enfree(x);
   assert(x == NULL);
 
-  x = ennewa(int, SIZE_MAX / sizeof(*x));
+  x = ennewa(int, too_many - 1);
   /* if (x == NULL) */
   /*   assert(errno == ENOMEM); */
   x = enfree(x);
 
   errno = 0;
-  x = ennewa(int, (SIZE_MAX / sizeof(*x)) + 1);
+  x = ennewa(int, too_many);
   assert(x == NULL);
   assert(errno == ENOMEM);
   x = enfree(x);
@@ -89,7 +219,7 @@ int main(void) {
 
 
 
-  x = enrealloc(x, int, (SIZE_MAX / sizeof(*x)) + 1);
+  x = enrealloc(x, int, too_many);
   assert(x == NULL);
 
 
@@ -97,7 +227,7 @@ int main(void) {
   x = enresize(x, int, 1);
   assert(x != NULL);
   x[0] = 1729;
-  x = enresize(x, int, (SIZE_MAX / sizeof(*x)) + 1);
+  x = enresize(x, int, too_many);
   assert(x == NULL);
 
 
@@ -108,5 +238,873 @@ int main(void) {
   assert(x == NULL);
 
 
+  {
+    enarena arena = ENARENA_INIT;
+    enarena_mark mark;
+    char* c;
+    double* d;
+
+    c = enarena_new(&arena, char);
+    assert(c != NULL);
+    d = enarena_newa0(&arena, double, 3);
+    assert(d != NULL);
+    assert((((uintptr_t) d) % EN_ALIGNOF(double)) == 0);
+    for (int i = 0 ; i < 3 ; i++)
+      assert(d[i] == 0.0);
+
+    errno = 0;
+    x = enarena_newa(&arena, int, too_many);
+    assert(x == NULL);
+    assert(errno == ENOMEM);
+
+    mark = enarena_save(&arena);
+    x = enarena_newa(&arena, int, EN_ARENA_CHUNK_SIZE);
+    assert(x != NULL);
+    x[EN_ARENA_CHUNK_SIZE - 1] = 1729;
+    {
+      enarena_mark inner = enarena_save(&arena);
+      y = enarena_newa(&arena, int, 42);
+      assert(y != NULL);
+      enarena_restore(&arena, inner);
+    }
+    enarena_restore(&arena, mark);
+    assert(enarena_new(&arena, char) == (char*) (d + 3));
+
+    enarena_reset(&arena);
+    assert(enarena_new(&arena, char) == c);
+
+    enarena_destroy(&arena);
+    assert(arena.chunk == NULL);
+  }
+
+
+  {
+    typedef struct { double a, b; } Pair;
+    enpool pool;
+    double* d[(2 * EN_POOL_MAGAZINE_SIZE) + 1];
+
+    assert(enpool_init(&pool, double) == 0);
+
+    for (int i = 0 ; i < (2 * EN_POOL_MAGAZINE_SIZE) + 1 ; i++) {
+      d[i] = enpool_new(&pool, double);
+      assert(d[i] != NULL);
+      assert((((uintptr_t) d[i]) % EN_ALIGNOF(double)) == 0);
+      *(d[i]) = i;
+    }
+    for (int i = 0 ; i < (2 * EN_POOL_MAGAZINE_SIZE) + 1 ; i++) {
+      assert(*(d[i]) == i);
+      d[i] = enpool_free(&pool, d[i]);
+      assert(d[i] == NULL);
+    }
+    /* The last free pushed a batch to the shared list. */
+    assert(pool.shared != NULL);
+
+    errno = 0;
+    assert(enpool_new(&pool, Pair) == NULL);
+    assert(errno == EINVAL);
+
+    enpool_flush(&pool);
+    d[0] = enpool_new(&pool, double);
+    assert(d[0] != NULL);
+    assert(pool.shared == NULL);
+    d[0] = enpool_free(&pool, d[0]);
+
+    enpool_destroy(&pool);
+
+    /* Thread keys sit at the same offset in TLS blocks with large,
+       aligned strides; they still have to start at different slots. */
+    {
+      const uintptr_t base = (uintptr_t) &enpool_thread_key_;
+      int spread = 0;
+
+      for (uintptr_t i = 1 ; i < 8 ; i++) {
+        if (enpool_home_((const void*) (base + (i << 21))) != enpool_home_((const void*) base))
+          spread++;
+      }
+      assert(spread >= 4);
+    }
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  {
+    enpool pool;
+    double* d[2 * EN_POOL_MAGAZINE_SIZE];
+    double* again[2 * EN_POOL_MAGAZINE_SIZE];
+    const size_t nmemb = 2 * EN_POOL_MAGAZINE_SIZE;
+    enpool_slab_* slabs;
+    PoolJob job;
+    pthread_t thread;
+
+    assert(enpool_init(&pool, double) == 0);
+
+    for (size_t i = 0 ; i < nmemb ; i++) {
+      d[i] = enpool_new(&pool, double);
+      assert(d[i] != NULL);
+      again[i] = d[i];
+    }
+    slabs = pool.slabs;
+
+    /* Another thread frees everything, then releases its magazine. */
+    job.pool = &pool;
+    job.objs = d;
+    job.nmemb = nmemb;
+    assert(pthread_create(&thread, NULL, pool_free_thread, &job) == 0);
+    assert(pthread_join(thread, NULL) == 0);
+    for (size_t i = 0 ; i < nmemb ; i++)
+      assert(d[i] == NULL);
+
+    /* The objects come back to this thread without touching a new
+       slab. */
+    for (size_t i = 0 ; i < nmemb ; i++) {
+      double* obj = enpool_new(&pool, double);
+      int found = 0;
+
+      for (size_t j = 0 ; j < nmemb ; j++) {
+        if (again[j] == obj) {
+          again[j] = NULL;
+          found = 1;
+        }
+      }
+      assert(found);
+      d[i] = obj;
+    }
+    assert(pool.slabs == slabs);
+    assert(pool.shared == NULL);
+
+    /* Flushed magazines are handed to later threads, so many more than
+       EN_POOL_MAX_THREADS threads over time never spill into the
+       overflow magazine. */
+    for (int i = 0 ; i < (2 * EN_POOL_MAX_THREADS) ; i++) {
+      job.objs = d + (i % nmemb);
+      job.nmemb = 1;
+      assert(pthread_create(&thread, NULL, pool_free_thread, &job) == 0);
+      assert(pthread_join(thread, NULL) == 0);
+      d[i % nmemb] = enpool_new(&pool, double);
+    }
+    assert(pool.overflow.bump == NULL);
+    for (int i = 0 ; i < EN_POOL_MAX_THREADS ; i++) {
+      enpool_magazine_* magazine = pool.magazines[i];
+      assert(magazine == NULL || magazine->owner == NULL || magazine->owner == &enpool_thread_key_);
+    }
+
+    enpool_destroy(&pool);
+  }
+#endif
+
+
+  x = ennewa_aligned(int, 3, 3);
+  assert(x == NULL);
+  assert(errno == EINVAL);
+
+  x = ennewa_aligned(int, too_many, 64);
+  assert(x == NULL);
+  assert(errno == ENOMEM);
+
+  x = ennewa0_aligned(int, 42, 64);
+  assert(x != NULL);
+  assert((((uintptr_t) x) % 64) == 0);
+  for (int i = 0 ; i < 42 ; i++)
+    assert(x[i] == 0);
+  for (int i = 0 ; i < 42 ; i++)
+    x[i] = i;
+  for (size_t n = 43 ; n < 65536 ; n *= 3) {
+    x = enresize_aligned(x, int, n, 64);
+    assert(x != NULL);
+    assert((((uintptr_t) x) % 64) == 0);
+    for (int i = 0 ; i < 42 ; i++)
+      assert(x[i] == i);
+  }
+  x = enrealloc_aligned(x, int, 1, 64);
+  assert(x != NULL);
+  assert(x[0] == 0);
+  x = enresize_aligned(x, int, too_many, 64);
+  assert(x == NULL);
+
+  x = ennew_aligned(int, EN_CACHE_LINE_SIZE);
+  assert(x != NULL);
+  x = enfree_aligned(x);
+  assert(x == NULL);
+
+
+  {
+    int* v = NULL;
+    const int src[3] = { 1, 2, 3 };
+    size_t cap;
+
+    assert(envec_len(v) == 0);
+    assert(envec_cap(v) == 0);
+
+    for (int i = 0 ; i < 1000 ; i++)
+      assert(envec_push(v, int, i));
+    assert(envec_len(v) == 1000);
+    assert(envec_cap(v) >= 1000);
+    for (int i = 0 ; i < 1000 ; i++)
+      assert(v[i] == i);
+
+    assert(envec_append(v, int, src, 3));
+    assert(envec_len(v) == 1003);
+    assert(envec_pop(v) == 3);
+    assert(envec_len(v) == 1002);
+
+    cap = envec_cap(v);
+    errno = 0;
+    assert(!envec_reserve(v, int, too_many));
+    assert(errno == ENOMEM);
+    assert(envec_cap(v) == cap);
+    assert(envec_len(v) == 1002);
+
+    assert(envec_shrink_to_fit(v, int));
+    assert(envec_cap(v) == 1002);
+    assert(v[1001] == 2);
+
+    envec_clear(v);
+    assert(envec_len(v) == 0);
+    assert(envec_shrink_to_fit(v, int));
+    assert(v == NULL);
+
+    assert(envec_reserve(v, int, 42));
+    assert(envec_cap(v) >= 42);
+    v = envec_free(v);
+    assert(v == NULL);
+  }
+
+
+#if defined(EN_PROFILE)
+  {
+    enprofile_site sites[EN_PROFILE_SITES + 1];
+    const enprofile_site* a = NULL;
+    const enprofile_site* r = NULL;
+    size_t count;
+    unsigned int line;
+
+    line = __LINE__ + 1;
+    x = ennewa(int, 4);
+    for (size_t n = 5 ; n < 100 ; n++)
+      x = enresize(x, int, n);
+    x = enfree(x);
+
+    count = enprofile_snapshot(sites, sizeof(sites) / sizeof(sites[0]));
+    for (size_t i = 0 ; i < count ; i++) {
+      if (sites[i].line == line)
+        a = &(sites[i]);
+      else if (sites[i].line == line + 2)
+        r = &(sites[i]);
+    }
+    assert(a != NULL && r != NULL);
+    assert(a->allocs == 1);
+    assert(a->frees == 0);
+    assert(a->type_size == sizeof(int));
+    assert(strcmp(a->type, "int") == 0);
+    assert(a->bytes_allocated == a->bytes_freed);
+    assert(r->reallocs == 95);
+    assert(r->growth[EN_PROFILE_GROWTH_TINY] > 0);
+    assert(r->frees == 1);
+    assert(r->bytes_allocated == r->bytes_freed);
+    assert(r->peak == 99 * sizeof(int));
+    enprofile_dump(2);
+  }
+#endif
+
+#if defined(EN_TRACE)
+  {
+    entrace_file_header header;
+    entrace_record r[5], record;
+    size_t count = 0;
+    void* old;
+    FILE* fp;
+
+    assert(entrace_open("enmem.c.trace") == 0);
+    x = ennewa(int, 4);
+    old = x;
+    x = enresize(x, int, 100);
+    x = enfree(x);
+    x = ennewa0(int, 2);
+    x = enfree_sized(x, int, 2);
+    entrace_flush();
+
+    fp = fopen("enmem.c.trace", "rb");
+    assert(fp != NULL);
+    assert(fread(&header, sizeof(header), 1, fp) == 1);
+    assert(memcmp(header.magic, ENTRACE_MAGIC, sizeof(header.magic)) == 0);
+    assert(header.record_size == sizeof(entrace_record));
+    /* Anything buffered before entrace_open() goes to the new file, so
+       keep the last 5 records. */
+    while (fread(&record, sizeof(record), 1, fp) == 1) {
+      memmove(&(r[0]), &(r[1]), sizeof(r) - sizeof(r[0]));
+      r[4] = record;
+      count++;
+    }
+    fclose(fp);
+    remove("enmem.c.trace");
+
+    assert(count >= 5);
+    assert(r[0].op == ENTRACE_MALLOC && r[0].type_size == sizeof(int) && r[0].nmemb == 4);
+    assert(r[0].ptr == (uint64_t) (uintptr_t) old);
+    assert(r[1].op == ENTRACE_REALLOC && r[1].old_ptr == r[0].ptr && r[1].nmemb == 100 && r[1].ptr != 0);
+    assert(r[2].op == ENTRACE_FREE && r[2].ptr == r[1].ptr);
+    assert(r[3].op == ENTRACE_CALLOC && r[3].nmemb == 2);
+    assert(r[4].op == ENTRACE_FREE && r[4].ptr == r[3].ptr && r[4].nmemb == 2);
+    for (size_t i = 1 ; i < 5 ; i++) {
+      assert(r[i].thread == r[0].thread);
+      assert(r[i].timestamp >= r[i - 1].timestamp);
+    }
+  }
+#endif
+
+
+  x = ennewa(int, 42);
+  assert(x != NULL);
+  x = enfree_sized(x, int, 42);
+  assert(x == NULL);
+  x = enfree_sized(x, int, 42);
+
+  x = ennew(int);
+  x = enresize(x, int, 1024);
+  assert(x != NULL);
+  x = enfree_sized(x, int, 1024);
+  assert(x == NULL);
+
+  x = ennewa(int, 16);
+  assert(x != NULL);
+  x = enfree_array(x, int, 16);
+  assert(x == NULL);
+
+#if defined(EN_DEBUG_FREE_SIZED)
+  x = ennewa(int, 1024);
+  x = enfree_sized(x, int, 1);
+  assert(sized_mismatches == 1);
+  x = ennewa(int, 4);
+  x = enfree_sized(x, int, too_many);
+  assert(sized_mismatches == 2);
+#endif
+
+
+#if defined(EN_LARGE)
+  {
+    size_t n = EN_LARGE_THRESHOLD / sizeof(*x);
+
+    x = ennewa0(int, n);
+    assert(x != NULL);
+    /* The header must not cost malloc's alignment. */
+    assert((((uintptr_t) x) % EN_ALIGNOF(long double)) == 0);
+#if defined(MADV_HUGEPAGE)
+    /* The mapping (and so the header) starts on a huge page. */
+    assert((((uintptr_t) x) & (EN_LARGE_HUGE_PAGE_SIZE - 1)) == sizeof(enlarge_header_));
+#endif
+    for (size_t i = 0 ; i < n ; i++)
+      assert(x[i] == 0);
+    for (size_t i = 0 ; i < n ; i++)
+      x[i] = (int) i;
+
+    for (int step = 0 ; step < 4 ; step++) {
+      n *= 2;
+      x = enresize(x, int, n);
+      assert(x != NULL);
+      for (size_t i = 0 ; i < EN_LARGE_THRESHOLD / sizeof(*x) ; i++)
+        assert(x[i] == (int) i);
+    }
+
+    x = enresize(x, int, 42);
+    assert(x != NULL);
+    assert((((uintptr_t) x) % EN_ALIGNOF(long double)) == 0);
+    for (int i = 0 ; i < 42 ; i++)
+      assert(x[i] == i);
+    x = enresize(x, int, EN_LARGE_THRESHOLD);
+    assert(x != NULL);
+    for (int i = 0 ; i < 42 ; i++)
+      assert(x[i] == i);
+    x = enfree(x);
+  }
+#endif
+
+
+  {
+    double* a;
+    char* b;
+    int* c;
+    size_t n = 1000;
+
+    assert(ennew0_soa3(n, double, a, char, b, int, c));
+    assert(((uintptr_t) c) % EN_ALIGNOF(int) == 0);
+    assert(((char*) c) >= b + n);
+    for (size_t i = 0 ; i < n ; i++) {
+      assert(a[i] == 0.0 && b[i] == 0 && c[i] == 0);
+      a[i] = (double) i;
+      b[i] = (char) i;
+      c[i] = (int) i;
+    }
+
+    assert(enrealloc0_soa3(n, n * 4, double, a, char, b, int, c));
+    for (size_t i = 0 ; i < n ; i++)
+      assert(a[i] == (double) i && b[i] == (char) i && c[i] == (int) i);
+    for (size_t i = n ; i < n * 4 ; i++)
+      assert(a[i] == 0.0 && b[i] == 0 && c[i] == 0);
+
+    assert(enrealloc_soa3(n * 4, 7, double, a, char, b, int, c));
+    for (size_t i = 0 ; i < 7 ; i++)
+      assert(a[i] == (double) i && b[i] == (char) i && c[i] == (int) i);
+
+    b = NULL;
+    assert(!enrealloc_soa3(7, too_many, double, a, char, b, int, c));
+    assert(b == NULL);
+    a = enfree_soa(a);
+
+    assert(!ennew_soa2(too_many, char, b, int, c));
+    assert(ennew_soa2(0, char, b, int, c));
+    b = enfree_soa(b);
+  }
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+  {
+    static_assert(en_trivially_relocatable<int>::value, "int");
+    static_assert(!en_trivially_relocatable<Tracked>::value, "Tracked");
+    static_assert(en_trivially_relocatable<Owner>::value, "Owner");
+
+    Tracked* t = enresize_relocate((Tracked*) NULL, Tracked, 0, 4);
+    assert(t != NULL);
+    for (int i = 0 ; i < 4 ; i++)
+      ::new (static_cast<void*>(t + i)) Tracked(i);
+    t = enresize_relocate(t, Tracked, 4, 1000);
+    assert(t != NULL && tracked_live == 4);
+    for (int i = 0 ; i < 4 ; i++)
+      assert(t[i].value == i && t[i].self == &(t[i]));
+    t = enresize_relocate(t, Tracked, 4, 2);
+    assert(t != NULL && tracked_live == 2 && t[1].value == 1);
+    assert(enrealloc_relocate(t, Tracked, 2, too_many) == NULL);
+    assert(tracked_live == 2 && t[1].value == 1);
+    t = enresize_relocate(t, Tracked, 2, 0);
+    assert(t == NULL && tracked_live == 0);
+
+    /* Moving may throw, so the elements are copied, and ptr is left
+       alone when a copy throws. */
+    ThrowingCopy* c = ennewa(ThrowingCopy, 3);
+    for (int i = 0 ; i < 3 ; i++)
+      ::new (static_cast<void*>(c + i)) ThrowingCopy(i);
+    tracked_copies_left = 1;
+    try {
+      c = enrealloc_relocate(c, ThrowingCopy, 3, 6);
+      assert(0);
+    } catch (int e) {
+      assert(e == 42);
+    }
+    assert(tracked_live == 3 && c[2].value == 2);
+    tracked_copies_left = -1;
+    c = enresize_relocate(c, ThrowingCopy, 3, 6);
+    assert(c != NULL && tracked_live == 3 && c[2].value == 2);
+    c = enresize_relocate(c, ThrowingCopy, 3, 0);
+    assert(c == NULL && tracked_live == 0);
+
+    Owner* o = ennewa(Owner, 2);
+    ::new (static_cast<void*>(o)) Owner(1);
+    ::new (static_cast<void*>(o + 1)) Owner(2);
+    int* first = o[0].value;
+    o = enresize_relocate(o, Owner, 2, 100000);
+    assert(o != NULL && o[0].value == first && *(o[1].value) == 2);
+    o = enresize_relocate(o, Owner, 2, 1);
+    assert(o != NULL && *(o[0].value) == 1);
+    o[0].~Owner();
+    o = enfree(o);
+
+    int* x = enresize(ennewa(int, 4), int, 8);
+    x = enfree(x);
+  }
+#endif
+
+  {
+    const size_t rows = 13, cols = 7;
+    size_t stride;
+    int* m = ennewa02(int, rows, cols);
+    assert(m != NULL);
+    for (size_t r = 0 ; r < rows ; r++) {
+      for (size_t c = 0 ; c < cols ; c++) {
+        assert(m[(r * cols) + c] == 0);
+        m[(r * cols) + c] = (int) ((r * 100) + c);
+      }
+    }
+
+    /* Wider rows move backward, narrower ones forward, and growing
+       one extent while shrinking the other needs a new block. */
+    m = enresize2(m, int, rows, cols, rows + 5, cols + 3);
+    assert(m != NULL);
+    for (size_t r = 0 ; r < rows ; r++)
+      for (size_t c = 0 ; c < cols ; c++)
+        assert(m[(r * (cols + 3)) + c] == (int) ((r * 100) + c));
+    m = enresize2(m, int, rows + 5, cols + 3, rows, 4);
+    assert(m != NULL);
+    for (size_t r = 0 ; r < rows ; r++)
+      for (size_t c = 0 ; c < 4 ; c++)
+        assert(m[(r * 4) + c] == (int) ((r * 100) + c));
+    m = enresize2(m, int, rows, 4, 2, 9);
+    assert(m != NULL);
+    for (size_t r = 0 ; r < 2 ; r++)
+      for (size_t c = 0 ; c < 4 ; c++)
+        assert(m[(r * 9) + c] == (int) ((r * 100) + c));
+
+    assert(enrealloc2(m, int, 2, 9, too_many, 2) == NULL);
+    assert(errno == ENOMEM);
+    assert(m[9] == 100);
+    m = enresize2(m, int, 2, 9, 0, 9);
+    assert(m == NULL);
+    assert(ennewa2(int, too_many - 1, 1) == NULL);
+    assert(ennewa2(int, (SIZE_MAX / 2) + 1, 2) == NULL);
+    assert(ennewa2(int, 3, 0) == NULL);
+
+    double* v = ennewa03(double, 3, 4, 5);
+    assert(v != NULL);
+    for (size_t i = 0 ; i < 3 * 4 * 5 ; i++)
+      v[i] = (double) i;
+    v = enresize3(v, double, 3, 4, 5, 4, 2, 6);
+    assert(v != NULL);
+    for (size_t i = 0 ; i < 3 ; i++)
+      for (size_t j = 0 ; j < 2 ; j++)
+        for (size_t k = 0 ; k < 5 ; k++)
+          assert(v[(((i * 2) + j) * 6) + k] == (double) ((((i * 4) + j) * 5) + k));
+    v = enfree_grid(v);
+
+    int** g = ennewa02_rows(int, rows, cols);
+    assert(g != NULL);
+    for (size_t r = 0 ; r < rows ; r++) {
+      assert(g[r] == g[0] + (r * cols));
+      for (size_t c = 0 ; c < cols ; c++)
+        assert(g[r][c] == 0);
+    }
+    g = enfree_grid(g);
+
+    double*** t = ennewa3_rows(double, 3, 4, 5);
+    assert(t != NULL);
+    for (size_t i = 0 ; i < 3 ; i++)
+      for (size_t j = 0 ; j < 4 ; j++)
+        assert(t[i][j] == t[0][0] + (((i * 4) + j) * 5));
+    assert(((uintptr_t) t[0][0]) % EN_ALIGNOF(double) == 0);
+    t = enfree_grid(t);
+
+    /* 3 bytes * 64 is the first multiple of 64 bytes. */
+    assert(enstride(char[3], 5, 64) == 64);
+    assert(enstride(double, 9, 64) == 16);
+    assert(enstride(double, 9, 4) == 9);
+    float* a = ennewa02_aligned(float, rows, cols, 64, &stride);
+    assert(a != NULL && stride == 16);
+    for (size_t r = 0 ; r < rows ; r++) {
+      assert(((uintptr_t) (a + (r * stride))) % 64 == 0);
+      for (size_t c = 0 ; c < cols ; c++)
+        a[(r * stride) + c] = (float) ((r * 100) + c);
+    }
+    a = enresize2_aligned(a, float, rows, cols, rows * 2, 20, 64, &stride);
+    assert(a != NULL && stride == 32);
+    assert(((uintptr_t) a) % 64 == 0);
+    for (size_t r = 0 ; r < rows ; r++)
+      for (size_t c = 0 ; c < cols ; c++)
+        assert(a[(r * stride) + c] == (float) ((r * 100) + c));
+    a = enfree_aligned(a);
+  }
+
+  {
+    Flex* f = ennew0_flex(Flex, data, 100);
+    assert(f != NULL);
+    for (int i = 0 ; i < 100 ; i++) {
+      assert(f->data[i] == 0);
+      f->data[i] = (short) i;
+    }
+    f->len = 100;
+
+    f = enresize_flex(f, Flex, data, 10000);
+    assert(f != NULL && f->len == 100);
+    for (int i = 0 ; i < 100 ; i++)
+      assert(f->data[i] == i);
+
+    Flex* g = enrealloc_flex(f, Flex, data, too_many * 2);
+    assert(g == NULL && errno == ENOMEM);
+    f = enresize_flex(f, Flex, data, too_many * 2);
+    assert(f == NULL);
+
+    assert(ennew_flex(Flex, data, SIZE_MAX - 1) == NULL);
+    f = ennew_flex(Flex, data, 0);
+    assert(f != NULL);
+    f = enfree(f);
+  }
+
+  {
+    Flex* nodes[1000];
+
+    assert(ennew_batch(Flex, 1000, nodes));
+    for (int i = 0 ; i < 1000 ; i++)
+      nodes[i]->len = (size_t) i;
+    for (int i = 0 ; i < 1000 ; i++)
+      assert(nodes[i]->len == (size_t) i);
+    nodes[0] = enfree(nodes[0]);
+    enfree_batch(nodes + 1, 999);
+
+    assert(ennew_batch(Flex, 0, nodes));
+  }
+
+  {
+    int* shared = ennewa(int, 10);
+    int* old;
+
+    /* Nothing can be freed while we're in a critical section. */
+    en_epoch_enter();
+    en_epoch_enter();
+    old = shared;
+    shared = ennewa(int, 10);
+    old = enretire(old);
+    assert(old == NULL);
+    en_epoch_exit();
+    en_epoch_reclaim();
+    en_epoch_reclaim();
+    en_epoch_reclaim();
+    assert(en_epoch_self_->count == 1);
+    en_epoch_exit();
+    en_epoch_reclaim();
+    assert(en_epoch_self_->count == 0);
+
+    /* It takes two epochs. */
+    old = shared;
+    shared = ennewa(int, 10);
+    old = enretire(old);
+    en_epoch_reclaim();
+    assert(en_epoch_self_->count == 1);
+    en_epoch_reclaim();
+    assert(en_epoch_self_->count == 0);
+
+    /* enretire() reclaims in batches, so the list doesn't grow. */
+    for (int i = 0 ; i < 1000 ; i++) {
+      old = shared;
+      shared = ennewa(int, 10);
+      old = enretire(old);
+      assert(en_epoch_self_->count - en_epoch_self_->head <= 3 * EN_EPOCH_BATCH);
+    }
+    assert(enretire((int*) NULL) == NULL);
+
+    en_epoch_thread_exit();
+    assert(en_epoch_self_ == NULL);
+    shared = enfree(shared);
+  }
+
+#if defined(ENMAP_H)
+  {
+    uint32_t values[1000];
+    const uint32_t* m;
+    uint32_t* p;
+    double* d;
+    size_t count;
+    FILE* fp;
+    int fd;
+
+    for (uint32_t i = 0 ; i < 1000 ; i++)
+      values[i] = i * 3;
+    fp = fopen("enmem.c.map", "wb");
+    assert(fp != NULL);
+    assert(fwrite(values, sizeof(values), 1, fp) == 1);
+    fclose(fp);
+    fd = open("enmem.c.map", O_RDONLY);
+    assert(fd >= 0);
+
+    m = enmap_file(uint32_t, fd, 0, 0, &count, ENMAP_READ | ENMAP_SEQUENTIAL);
+    assert(m != NULL && count == 1000);
+    assert(m[0] == 0 && m[999] == 999 * 3);
+    m = enunmap(m, uint32_t, count);
+    assert(m == NULL);
+
+    /* Offsets don't have to be page-aligned. */
+    m = enmap_file(uint32_t, fd, 10 * sizeof(uint32_t), 0, &count, ENMAP_WILLNEED);
+    assert(m != NULL && count == 990 && m[0] == 30);
+    m = enunmap(m, uint32_t, count);
+    m = enmap_file(uint32_t, fd, 4000 - sizeof(uint32_t), 1, &count, ENMAP_READ);
+    assert(m != NULL && count == 1 && m[0] == 999 * 3);
+    m = enunmap(m, uint32_t, count);
+
+    /* Writes to a private mapping don't reach the file. */
+    p = enmap_file(uint32_t, fd, 0, 100, &count, ENMAP_PRIVATE);
+    assert(p != NULL && count == 100);
+    p[5] = 42;
+    m = enmap_file(uint32_t, fd, 0, 100, NULL, ENMAP_READ);
+    assert(m != NULL && m[5] == 15);
+    m = enunmap(m, uint32_t, 100);
+    p = enunmap(p, uint32_t, count);
+
+    /* Invalid regions: misaligned, not a multiple of the size, past
+       the end of the file, empty, and overflowing. */
+    assert(enmap_file(uint32_t, fd, 2, 1, &count, ENMAP_READ) == NULL && errno == EINVAL && count == 0);
+    assert(enmap_file(Triple, fd, 0, 0, &count, ENMAP_READ) == NULL && errno == EINVAL);
+    {
+      const Triple* t = enmap_file(Triple, fd, 0, 333, &count, ENMAP_READ);
+      assert(t != NULL && count == 333 && t[1].a == 9);
+      t = enunmap(t, Triple, count);
+    }
+    assert(enmap_file(uint32_t, fd, 0, 1001, &count, ENMAP_READ) == NULL && errno == EINVAL);
+    assert(enmap_file(uint32_t, fd, 4000, 0, &count, ENMAP_READ) == NULL && errno == EINVAL);
+    assert(enmap_file(uint32_t, fd, 8000, 1, &count, ENMAP_READ) == NULL && errno == EINVAL);
+    assert(enmap_file(uint32_t, fd, 0, too_many, &count, ENMAP_READ) == NULL && errno == ENOMEM);
+    close(fd);
+    remove("enmem.c.map");
+
+    d = enmap_anon(double, 1 << 20, ENMAP_HUGEPAGE);
+    assert(d != NULL);
+    assert(d[0] == 0.0 && d[(1 << 20) - 1] == 0.0);
+    d[12345] = 1.5;
+    d = enunmap(d, double, 1 << 20);
+    assert(d == NULL);
+    assert(enmap_anon(double, 0, 0) == NULL);
+    assert(enmap_anon(int, too_many, 0) == NULL && errno == ENOMEM);
+  }
+#endif
+
+  {
+    CountingHeap heap = { 0, 0, 0 };
+    const enallocator counting = { counting_malloc, NULL, counting_realloc, counting_free, counting_free_sized, &heap };
+    Flex* nodes[100];
+    Flex* f;
+
+    x = ennew_in(&counting, int);
+    assert(x != NULL && heap.live == 1);
+    x = enfree_in(&counting, x);
+    assert(x == NULL && heap.live == 0);
+
+    /* No calloc_fn, so this is malloc_fn and memset. */
+    x = ennewa0_in(&counting, int, 100);
+    assert(x != NULL && heap.live == 1);
+    for (int i = 0 ; i < 100 ; i++)
+      assert(x[i] == 0);
+    x = enresize_in(&counting, x, int, 1000);
+    assert(x != NULL && heap.live == 1);
+    assert(enrealloc_in(&counting, x, int, too_many) == NULL && errno == ENOMEM);
+    x = enresize_in(&counting, x, int, too_many);
+    assert(x == NULL && heap.live == 0);
+
+    assert(ennewa_in(&counting, int, 0) == NULL);
+    assert(ennewa_in(&counting, int, too_many) == NULL);
+    assert(ennewa0_in(&counting, int, too_many) == NULL);
+    assert(heap.live == 0);
+
+    x = enrealloc_in(&counting, (int*) NULL, int, 10);
+    assert(x != NULL && heap.live == 1);
+    x = enfree_sized_in(&counting, x, int, 10);
+    assert(x == NULL && heap.live == 0);
+    assert(heap.sized_frees == 1 && heap.last_size == 10 * sizeof(int));
+
+    f = ennew0_flex_in(&counting, Flex, data, 10);
+    assert(f != NULL && f->data[9] == 0 && heap.live == 1);
+    f = enresize_flex_in(&counting, f, Flex, data, 1000);
+    assert(f != NULL && heap.live == 1);
+    f = enfree_in(&counting, f);
+    assert(heap.live == 0);
+
+    assert(ennew_batch_in(&counting, Flex, 100, nodes));
+    assert(heap.live == 100);
+    enfree_batch_in(&counting, nodes, 100);
+    assert(heap.live == 0);
+
+    /* NULL is EN_MALLOC and friends. */
+    x = ennewa_in(NULL, int, 10);
+    assert(x != NULL);
+    x = enresize_in(NULL, x, int, 20);
+    assert(x != NULL);
+    x = enfree_sized_in(NULL, x, int, 20);
+    x = ennew0_in(NULL, int);
+    assert(x != NULL && *x == 0);
+    x = enfree_in(NULL, x);
+    assert(x == NULL);
+  }
+
+  {
+    static volatile size_t small = 10;
+    static volatile size_t large = 1000;
+
+    for (int pass = 0 ; pass < 2 ; pass++) {
+      EN_AUTO_ARRAY(int, a, small, 64);
+      EN_AUTO_ARRAY(int, b, large, 64);
+      EN_AUTO_ARRAY(double, c, 64, 64);
+
+      assert(a == a_en_auto_);
+      assert(b != NULL && b != b_en_auto_);
+      assert(c == c_en_auto_);
+      for (size_t i = 0 ; i < small ; i++)
+        a[i] = (int) i;
+      for (size_t i = 0 ; i < large ; i++)
+        b[i] = (int) i;
+      assert(a[small - 1] == (int) small - 1 && b[large - 1] == (int) large - 1);
+
+      EN_AUTO_ARRAY_FREE(a);
+      EN_AUTO_ARRAY_FREE(b);
+      EN_AUTO_ARRAY_FREE(c);
+      assert(a == NULL && b == NULL && c == NULL);
+      EN_AUTO_ARRAY_FREE(b);
+    }
+
+    {
+      EN_AUTO_ARRAY(int, d, too_many, 16);
+      assert(d == NULL && errno == ENOMEM);
+      EN_AUTO_ARRAY_FREE(d);
+    }
+
+#if defined(__cplusplus) || defined(__GNUC__)
+    /* The heap copy is released at the end of the scope; build with
+       ASan to catch a leak. */
+    for (int pass = 0 ; pass < 2 ; pass++) {
+      EN_AUTO_ARRAY(int, e, large, 64);
+      assert(e != NULL && e != e_en_auto_);
+      e[large - 1] = pass;
+      if (pass == 0)
+        continue;
+      assert(e[large - 1] == 1);
+    }
+#endif
+  }
+
+  {
+    /* Small divisors, powers of two, and the largest values, with
+       numerators around each multiple. */
+    static const uint64_t divisors[] = {
+      1, 2, 3, 5, 6, 7, 10, 11, 25, 100, 641, 1000, 4096, 65537, 0x7fffffff, 0x80000000, 0x80000001, 0xfffffffe, 0xffffffff,
+      UINT64_C(0x100000000), UINT64_C(0x123456789), UINT64_C(0x7fffffffffffffff), UINT64_C(0x8000000000000000), UINT64_MAX
+    };
+    uint32_t src32[67], dest32[67];
+    uint64_t src64[67], dest64[67];
+
+    for (size_t i = 0 ; i < sizeof(divisors) / sizeof(divisors[0]) ; i++) {
+      const uint64_t d64 = divisors[i];
+      const uint32_t d32 = (d64 > UINT32_MAX) ? (uint32_t) (d64 % 0xfffffffb) : (uint32_t) d64;
+      endiv_u32 dv32;
+      endiv_u64 dv64;
+
+      endiv_u32_init(&dv32, d32);
+      endiv_u64_init(&dv64, d64);
+
+      for (size_t j = 0 ; j < 67 ; j++) {
+        const uint64_t k = (uint64_t) (j / 3);
+        src32[j] = (uint32_t) ((d32 * (uint32_t) k) + (uint32_t) (j % 3) - 1);
+        src64[j] = (d64 * k) + (j % 3) - 1;
+      }
+      src32[0] = UINT32_MAX;
+      src64[0] = UINT64_MAX;
+
+      for (size_t j = 0 ; j < 67 ; j++) {
+        assert(endiv_u32_div(src32[j], &dv32) == src32[j] / d32);
+        assert(endiv_u32_mod(src32[j], &dv32) == src32[j] % d32);
+        assert(endiv_u64_div(src64[j], &dv64) == src64[j] / d64);
+        assert(endiv_u64_mod(src64[j], &dv64) == src64[j] % d64);
+      }
+
+      endiv_u32_div_array(dest32, src32, 67, &dv32);
+      for (size_t j = 0 ; j < 67 ; j++)
+        assert(dest32[j] == src32[j] / d32);
+      endiv_u32_mod_array(dest32, src32, 67, &dv32);
+      for (size_t j = 0 ; j < 67 ; j++)
+        assert(dest32[j] == src32[j] % d32);
+      endiv_u64_div_array(dest64, src64, 67, &dv64);
+      for (size_t j = 0 ; j < 67 ; j++)
+        assert(dest64[j] == src64[j] / d64);
+      endiv_u64_mod_array(dest64, src64, 67, &dv64);
+      for (size_t j = 0 ; j < 67 ; j++)
+        assert(dest64[j] == src64[j] % d64);
+
+      /* In place. */
+      memcpy(dest32, src32, sizeof(src32));
+      endiv_u32_div_array(dest32, dest32, 67, &dv32);
+      for (size_t j = 0 ; j < 67 ; j++)
+        assert(dest32[j] == src32[j] / d32);
+    }
+  }
+
   return 0;
 }
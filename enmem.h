@@ -120,6 +120,21 @@
  *   ennewa() allocates an nmemb-long array of type T. ennewa0() does
  *   the same thing except it will initialize the array to 0.
  *
+ *   If nmemb is a compile-time constant the overflow check is done by
+ *   the compiler instead of at run time, and on GNU C compilers a
+ *   constant nmemb which overflows is a compile-time error (this also
+ *   applies to enrealloc(), enresize(), and the aligned and arena
+ *   variants). For best results include is_constant.h (if
+ *   __has_include is supported this happens automatically).
+ *
+ * T* ennewa_c(Type T, size_t nmemb)
+ * T* ennewa0_c(Type T, size_t nmemb)
+ *
+ *   Like ennewa() and ennewa0(), but nmemb must be a constant
+ *   expression. In C++11 this is enforced with a template and
+ *   static_assert, so a constant which overflows is an error even
+ *   though ennewa() can't detect it in C++.
+ *
  * T* enrealloc(T* ptr, Type T, size_t nmemb):
  *
  *   This is like realloc(), only it takes a type the number of
@@ -131,6 +146,31 @@
  *   enresize() is like enrealloc(), except that if reallocation fails
  *   the old data is freed.
  *
+ *   In C++ realloc() is only valid for types which can be moved by
+ *   copying their bytes, so in C++11 enrealloc(), enresize(), and the
+ *   _in and _aligned variants are a compile-time error for any other
+ *   type. By default that means trivially copyable types; if you know
+ *   a type is safe to move with memcpy (most types which don't point
+ *   into themselves, such as a unique_ptr), use
+ *   EN_TRIVIALLY_RELOCATABLE(T) at global scope to opt in.
+ *
+ * T* enrealloc_relocate(T* ptr, Type T, size_t old_nmemb, size_t nmemb)
+ * T* enresize_relocate(T* ptr, Type T, size_t old_nmemb, size_t nmemb)
+ *
+ *   (C++11 only.) Like enrealloc() and enresize(), but for an array
+ *   of old_nmemb constructed objects of any type. The first
+ *   min(old_nmemb, nmemb) objects are kept and the rest are
+ *   destroyed; new elements are not constructed. Trivially
+ *   relocatable types are reallocated in place (and with EN_LARGE,
+ *   large arrays are remapped); other types are moved to a new array
+ *   with their move constructor, or copied if moving could throw,
+ *   and the old ones destroyed, just like std::vector. On failure
+ *   the objects are left alone (enrealloc_relocate) or destroyed and
+ *   freed (enresize_relocate), and exceptions from the constructor
+ *   leave ptr untouched. The memory comes from ennewa() and
+ *   enrealloc(), so free it with enfree() (after destroying the
+ *   objects).
+ *
  * T* enfree(T* ptr)
  *
  *   Frees ptr, and returns NULL.  This is just to make it a little
@@ -143,22 +183,294 @@
  *   you try to do something like `x = enfree(y)` when x and y are
  *   different types. Otherwise T is void and you're on your own.
  *
+ * T* enfree_sized(T* ptr, Type T, size_t nmemb)
+ *
+ *   Like enfree(), but you also pass the type and number of elements
+ *   you allocated, which lets the allocator skip looking up the size
+ *   (which is often a cache miss). The size is passed to
+ *   EN_FREE_SIZED(ptr, size); by default that is C23's free_sized()
+ *   if stdlib.h provides it, jemalloc's sdallocx() if jemalloc.h was
+ *   included before this header, or just EN_FREE(ptr). If EN_MALLOC
+ *   is C++'s operator new you can define EN_FREE_SIZED as the sized
+ *   operator delete. Only use this for memory from ennew(),
+ *   ennewa(), and friends, and only with the nmemb you used for the
+ *   most recent allocation or reallocation.
+ *
+ *   Define EN_DEBUG_FREE_SIZED to check the size against the
+ *   allocator's idea of the size (via EN_USABLE_SIZE(ptr), which is
+ *   defined for glibc, macOS, and MSVC); mismatches call
+ *   EN_FREE_SIZED_MISMATCH(ptr, size), which defaults to abort(). If
+ *   EN_PROFILE is defined the check is exact.
+ *
+ * T* enfree_array(T* ptr, Type T, size_t nmemb)
+ *
+ *   Just enfree_sized(), spelled to match ennewa(). Use it for arrays
+ *   from ennewa() or enrealloc(); nmemb is the element count, not the
+ *   size in bytes.
+ *
+ *********************************************************************
+ *
+ * Batch allocations:
+ *
+ * int ennew_batch(Type T, size_t count, T** ptrs)
+ *
+ *   Allocate count separate T objects, storing the pointers in
+ *   ptrs[0] to ptrs[count - 1]. Each object can be freed
+ *   individually with enfree(), or together with enfree_batch().
+ *   Returns non-zero on success; on failure nothing is left
+ *   allocated and 0 is returned.
+ *
+ *   If EN_MALLOC_BATCH(size, ptrs, count) is defined it is used to
+ *   allocate up to EN_BATCH_CHUNK (256) objects per call; it must
+ *   return the number of objects it allocated, which may be fewer
+ *   than requested, in which case the remainder come from EN_MALLOC.
+ *   On macOS the default malloc zone's batch API is used. Otherwise
+ *   this is just a loop, though you still get the all-or-nothing
+ *   error handling.
+ *
+ * void enfree_batch(T** ptrs, size_t count)
+ *
+ *   Free count objects, for example the ones allocated by
+ *   ennew_batch(). Uses EN_FREE_BATCH(ptrs, count) if it is defined.
+ *
+ *********************************************************************
+ *
+ * Allocator contexts:
+ *
+ * EN_MALLOC and friends are fixed for each translation unit. To give
+ * different parts of a program different heaps at run time (a
+ * per-request heap, a long-lived cache heap, a NUMA-local heap, etc.)
+ * fill in an enallocator and pass it to the "_in" variants:
+ *
+ *   static void* cache_malloc(void* ctx, size_t size) { ... }
+ *   ...
+ *   enallocator cache = { cache_malloc, NULL, cache_realloc, cache_free, NULL, &heap };
+ *   Entry* entry = ennew_in(&cache, Entry);
+ *   ...
+ *   entry = enfree_in(&cache, entry);
+ *
+ * malloc_fn, realloc_fn, and free_fn are required and have the same
+ * semantics as malloc, realloc, and free, with ctx as the first
+ * argument. calloc_fn and free_sized_fn may be NULL, in which case
+ * malloc_fn and memset, or free_fn, are used instead. enallocator
+ * only holds pointers, so copy it around or share it as you like.
+ *
+ * T* ennew_in(const enallocator* allocator, Type T)
+ * T* ennew0_in(const enallocator* allocator, Type T)
+ * T* ennewa_in(const enallocator* allocator, Type T, size_t nmemb)
+ * T* ennewa0_in(const enallocator* allocator, Type T, size_t nmemb)
+ * T* enrealloc_in(const enallocator* allocator, T* ptr, Type T, size_t nmemb)
+ * T* enresize_in(const enallocator* allocator, T* ptr, Type T, size_t nmemb)
+ * T* enfree_in(const enallocator* allocator, T* ptr)
+ * T* enfree_sized_in(const enallocator* allocator, T* ptr, Type T, size_t nmemb)
+ * Header* ennew_flex_in(const enallocator* allocator, Type Header, member, size_t nmemb)
+ * Header* ennew0_flex_in(const enallocator* allocator, Type Header, member, size_t nmemb)
+ * Header* enrealloc_flex_in(const enallocator* allocator, Header* ptr, Type Header, member, size_t nmemb)
+ * Header* enresize_flex_in(const enallocator* allocator, Header* ptr, Type Header, member, size_t nmemb)
+ * int ennew_batch_in(const enallocator* allocator, Type T, size_t count, T** ptrs)
+ * void enfree_batch_in(const enallocator* allocator, T** ptrs, size_t count)
+ *
+ *   Just like the functions without the "_in" suffix, including the
+ *   type and overflow checks, except the memory comes from allocator.
+ *   Memory must be reallocated and freed with the same allocator.
+ *
+ *   If allocator is NULL, EN_MALLOC/CALLOC/REALLOC/FREE are used,
+ *   and when it's a constant NULL the compiler removes the check, so
+ *   code which takes an optional allocator costs nothing when it's
+ *   not used. The _in variants aren't profiled or traced (see
+ *   EN_PROFILE and EN_TRACE), so in that case only pass memory from
+ *   the NULL allocator to enfree_in(), not enfree().
+ *
  *********************************************************************
  *
- * As far as I can tell, the only (valid) thing this API really makes
- * harder is mixing types. For example, if you want to make a single
- * allocation for some metadata struct and the data itself (such as an
- * image with width and height fields).  It's a bit of a corner case,
- * though, and IMHO the additional safety for most use cases vastly
- * outweighs having to do something like `(Image*) ennewa(char, len)`
- * instead of just `malloc(len)`, especially since calculating len is
- * already likely non-trivial since you probably need to take struct
- * size, alignment, and padding into account.
+ * Small temporary arrays:
+ *
+ * Temporary arrays are usually small, but without VLAs (see
+ * is_constant.h's DIAGNOSTIC_ERROR_VLA) the only way to handle the
+ * occasional large one is to always use the heap. EN_AUTO_ARRAY puts
+ * the array in a fixed-size buffer on the stack when it fits, and
+ * only allocates when it doesn't:
+ *
+ *   EN_AUTO_ARRAY(int, tmp, n, 64);
+ *   if (tmp == NULL)
+ *     return -1;
+ *   ...
+ *   EN_AUTO_ARRAY_FREE(tmp);
+ *
+ * In C++, and in C with GNU extensions (GCC and clang), the heap copy
+ * is also freed automatically when name goes out of scope, so early
+ * returns can't leak it. Other C compilers have no way to run code
+ * at the end of a scope, so there you have to call
+ * EN_AUTO_ARRAY_FREE() yourself on every path.
+ *
+ * EN_AUTO_ARRAY(Type T, name, size_t nmemb, size_t inline_cap)
+ *
+ *   Declare a T* called name which points to room for nmemb elements
+ *   of type T. If nmemb <= inline_cap that is a T[inline_cap] array
+ *   declared alongside it (so this must appear where declarations
+ *   are allowed), otherwise it comes from ennewa(), with the same
+ *   overflow checks, and is NULL on failure. inline_cap must be a
+ *   constant expression greater than 0; if is_constant.h is included
+ *   anything else is an error instead of a VLA. nmemb is only
+ *   evaluated once. If nmemb is a compile-time constant the
+ *   compiler can pick the buffer statically.
+ *
+ *   Like the rest of the stack, the inline buffer is only valid
+ *   until the end of the enclosing block, and isn't initialized.
+ *
+ * void EN_AUTO_ARRAY_FREE(name)
+ *
+ *   Free name if it was allocated on the heap, and set it to NULL.
+ *   Calling it more than once is fine. Where the release isn't tied
+ *   to the scope (see above) call this before name goes out of scope
+ *   on every path; elsewhere it just frees the memory early.
+ *
+ *********************************************************************
+ *
+ * Aligned allocations:
+ *
+ * T* ennew_aligned(Type T, size_t align)
+ * T* ennew0_aligned(Type T, size_t align)
+ * T* ennewa_aligned(Type T, size_t nmemb, size_t align)
+ * T* ennewa0_aligned(Type T, size_t nmemb, size_t align)
+ * T* enrealloc_aligned(T* ptr, Type T, size_t nmemb, size_t align)
+ * T* enresize_aligned(T* ptr, Type T, size_t nmemb, size_t align)
+ * T* enfree_aligned(T* ptr)
+ *
+ *   Just like the functions without the "_aligned" suffix, except the
+ *   result is aligned to align bytes, which must be a power of two.
+ *   The size is rounded up to a multiple of align, so if you use
+ *   EN_CACHE_LINE_SIZE for align the buffer won't share a cache line
+ *   with anything else. Unlike enrealloc(), enrealloc_aligned() and
+ *   enresize_aligned() preserve the alignment, but you must pass the
+ *   same align each time.
+ *
+ *   Memory from these functions must only be passed to
+ *   enrealloc_aligned(), enresize_aligned(), and enfree_aligned(),
+ *   never to enrealloc(), enresize(), or enfree().
+ *
+ *   By default the memory comes from EN_MALLOC/EN_REALLOC/EN_FREE,
+ *   over-allocating by up to align - 1 bytes (plus a small header);
+ *   growing a buffer in place only requires copying if realloc
+ *   returns a block with a different alignment. If you would rather
+ *   use an aligned allocator define EN_ALIGNED_ALLOC(align, size)
+ *   (with the same semantics as C11's aligned_alloc) and
+ *   EN_ALIGNED_FREE(ptr), in which case enrealloc_aligned() always
+ *   allocates a new buffer and copies.
+ *
+ *********************************************************************
+ *
+ * Arenas:
+ *
+ * An arena (enarena) carves allocations out of large chunks obtained
+ * from EN_MALLOC, and everything is released at once instead of one
+ * object at a time. This is much faster than malloc/free when you
+ * allocate a lot of short-lived objects with the same lifetime (for
+ * example, everything needed to handle a single request).
+ *
+ *   enarena arena = ENARENA_INIT;
+ *   Foo* foo = enarena_new(&arena, Foo);
+ *   int* bar = enarena_newa(&arena, int, 512);
+ *   ...
+ *   enarena_destroy(&arena);
+ *
+ * void enarena_init(enarena* arena, size_t chunk_size)
+ *
+ *   Initialize an arena. If chunk_size is 0 EN_ARENA_CHUNK_SIZE (64
+ *   KiB unless you define it yourself) is used. Allocations larger
+ *   than the chunk size get a chunk of their own.
+ *
+ * T* enarena_new(enarena* arena, Type T)
+ * T* enarena_new0(enarena* arena, Type T)
+ * T* enarena_newa(enarena* arena, Type T, size_t nmemb)
+ * T* enarena_newa0(enarena* arena, Type T, size_t nmemb)
+ *
+ *   Like ennew(), ennew0(), ennewa(), and ennewa0(), except the memory
+ *   comes from the arena. The result is aligned to alignof(T), and
+ *   the overflow checks are the same as for ennewa(). Never pass the
+ *   result to enfree().
+ *
+ * enarena_mark enarena_save(const enarena* arena)
+ * void enarena_restore(enarena* arena, enarena_mark mark)
+ *
+ *   enarena_save() records the current position in the arena, and
+ *   enarena_restore() releases everything allocated since. Marks may
+ *   be nested, but must be restored in LIFO order, and are
+ *   invalidated by enarena_reset() and enarena_destroy().
+ *
+ * void enarena_reset(enarena* arena)
+ *
+ *   Release everything allocated from the arena. The first chunk is
+ *   kept so it can be reused.
+ *
+ * void enarena_destroy(enarena* arena)
+ *
+ *   Release everything allocated from the arena, including all
+ *   chunks. The arena may be reused afterwards.
+ *
+ *********************************************************************
+ *
+ * Headers with a flexible array member:
+ *
+ * A common reason to mix types in one allocation is a struct with
+ * some metadata followed by the data itself, such as an image with
+ * width and height fields:
+ *
+ *   typedef struct { size_t width, height; uint32_t pixels[]; } Image;
+ *   Image* img = ennew_flex(Image, pixels, width * height);
+ *
+ * Header* ennew_flex(Type Header, member, size_t nmemb)
+ * Header* ennew0_flex(Type Header, member, size_t nmemb)
+ * Header* enrealloc_flex(Header* ptr, Type Header, member, size_t nmemb)
+ * Header* enresize_flex(Header* ptr, Type Header, member, size_t nmemb)
+ *
+ *   Allocate (or reallocate) a Header whose last member is an array
+ *   with room for nmemb elements. The size is
+ *   offsetof(Header, member) + nmemb * sizeof(member[0]) (but never
+ *   less than sizeof(Header)), calculated with the same overflow
+ *   checks as ennewa(). Unlike ennewa(), an nmemb of 0 still
+ *   allocates the header. ennew0_flex() zeroes the whole allocation;
+ *   enrealloc_flex() and enresize_flex() behave like enrealloc() and
+ *   enresize() on failure. The result is freed with enfree(). On GNU
+ *   C compilers passing a pointer member instead of an array is an
+ *   error.
+ *
+ * Several arrays of the same length in a single allocation (a
+ * struct-of-arrays layout) are supported by ensoa.h, and contiguous
+ * two- and three-dimensional arrays by engrid.h.
+ *
+ *********************************************************************
  *
  * In general, all you need to do is #include this file. If you want
  * to use custom functions instead of malloc/calloc/realloc/free you
  * can define EN_MALLOC/CALLOC/REALLOC/FREE first.
  *
+ * Overflow checks use __builtin_mul_overflow when it is available; if
+ * you define EN_NO_BUILTIN_MUL_OVERFLOW a portable check is used
+ * instead (this is mostly useful for benchmarking; see
+ * enmem-bench.c).
+ *
+ * If you define EN_LARGE (on POSIX systems), allocations of at least
+ * EN_LARGE_THRESHOLD bytes (2 MiB by default) are mapped directly
+ * with mmap, and the kernel is asked to back them with transparent
+ * huge pages (MADV_HUGEPAGE) to reduce TLB misses. If mremap is
+ * available (define _GNU_SOURCE on Linux) growing a large array with
+ * enrealloc() or enresize() remaps the pages instead of copying
+ * them. Fresh mappings start on a huge page boundary
+ * (EN_LARGE_HUGE_PAGE_SIZE, 2 MiB by default) so the whole array can
+ * be covered, not just its interior. EN_LARGE replaces
+ * EN_MALLOC/CALLOC/REALLOC/FREE, and every allocation gets a small
+ * header (padded so the memory keeps malloc's alignment), so it must
+ * be defined for every file which allocates or frees a given pointer.
+ *
+ * If you define EN_PROFILE, ennew(), ennew0(), ennewa(), ennewa0(),
+ * enrealloc(), enresize(), enfree(), enfree_sized(), the batch
+ * functions, and the *_flex() variants record statistics for every
+ * call site; see enprofile.h for details. If you define EN_TRACE
+ * instead they append a binary record of every call to a trace file
+ * which entrace-replay.c can replay against other allocators; see
+ * entrace.h.
+ *
  * The API should work with any compiler, but some compilers (GCC,
  * clang, ICC, etc.) can provide more checks due to extensions like
  * typeof() and __builtin_types_compatible_p().
@@ -171,6 +483,17 @@
 #if !defined(ENMEM_H)
 #define ENMEM_H
 
+#if defined(EN_LARGE)
+#  if defined(EN_MALLOC) || defined(EN_CALLOC) || defined(EN_REALLOC) || defined(EN_FREE) || \
+     defined(EN_MALLOC_BATCH) || defined(EN_FREE_BATCH)
+#    error EN_LARGE can not be combined with a custom EN_MALLOC/CALLOC/REALLOC/FREE
+#  endif
+#  define EN_MALLOC enlarge_malloc_
+#  define EN_CALLOC enlarge_calloc_
+#  define EN_REALLOC enlarge_realloc_
+#  define EN_FREE enlarge_free_
+#endif
+
 #if !defined(EN_MALLOC)
 #  define EN_MALLOC malloc
 #endif
@@ -182,15 +505,75 @@
 #endif
 #if !defined(EN_FREE)
 #  define EN_FREE free
+#  define EN_FREE_IS_FREE_
 #endif
 #if !defined(EN_INCOMPATIBLE_TYPES)
 #  define EN_INCOMPATIBLE_TYPES "incompatible types"
 #endif
+#if !defined(EN_CONSTANT_OVERFLOW)
+#  define EN_CONSTANT_OVERFLOW "size * nmemb overflows"
+#endif
+#if !defined(EN_NOT_CONSTANT)
+#  define EN_NOT_CONSTANT "nmemb is not a constant expression"
+#endif
+#if !defined(EN_NOT_RELOCATABLE)
+#  define EN_NOT_RELOCATABLE "T is not trivially relocatable, use enrealloc_relocate()"
+#endif
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <errno.h>
 
+/* Sized deallocation.  free_sized (C23) and sdallocx (jemalloc) are
+   only used if EN_FREE is free(), since they need to match the
+   allocator. */
+#if !defined(EN_FREE_SIZED)
+#  if defined(EN_FREE_IS_FREE_) && defined(__STDC_VERSION_STDLIB_H__) && (__STDC_VERSION_STDLIB_H__ >= 202311L)
+#    define EN_FREE_SIZED(ptr, size) free_sized(ptr, size)
+#  elif defined(EN_FREE_IS_FREE_) && defined(JEMALLOC_VERSION)
+#    define EN_FREE_SIZED(ptr, size) sdallocx(ptr, size, 0)
+#  else
+#    define EN_FREE_SIZED(ptr, size) ((void) (size), EN_FREE(ptr))
+#  endif
+#endif
+
+/* Batch allocation.  macOS's default malloc zone can allocate many
+   blocks of the same size at once. */
+#if !defined(EN_MALLOC_BATCH) && defined(EN_FREE_IS_FREE_) && defined(__APPLE__)
+#  include <malloc/malloc.h>
+#  define EN_MALLOC_BATCH(size, ptrs, count) \
+  ((size_t) malloc_zone_batch_malloc(malloc_default_zone(), (size), (ptrs), (unsigned) (count)))
+#  if !defined(EN_FREE_BATCH)
+#    define EN_FREE_BATCH(ptrs, count) \
+  malloc_zone_batch_free(malloc_default_zone(), (ptrs), (unsigned) (count))
+#  endif
+#endif
+
+#if defined(EN_DEBUG_FREE_SIZED)
+#  if !defined(EN_FREE_SIZED_MISMATCH)
+#    define EN_FREE_SIZED_MISMATCH(ptr, size) abort()
+#  endif
+#  if defined(EN_USABLE_SIZE)
+#  elif defined(EN_FREE_IS_FREE_) && defined(__GLIBC__)
+#    include <malloc.h>
+#    define EN_USABLE_SIZE(ptr) malloc_usable_size(ptr)
+#  elif defined(EN_FREE_IS_FREE_) && defined(__APPLE__)
+#    include <malloc/malloc.h>
+#    define EN_USABLE_SIZE(ptr) malloc_size(ptr)
+#  elif defined(EN_FREE_IS_FREE_) && defined(_MSC_VER)
+#    include <malloc.h>
+#    define EN_USABLE_SIZE(ptr) _msize(ptr)
+#  endif
+#endif
+
+#if !defined(IS_CONSTANT_H) && defined(__has_include)
+#  if __has_include("is_constant.h")
+#    include "is_constant.h"
+#  endif
+#endif
+
 #if defined(HEDLEY_UNLIKELY)
 #  define EN_UNLIKELY(expr) HEDLEY_UNLIKELY(expr)
 #elif defined(__GNUC__) && (__GNUC__ >= 3)
@@ -199,9 +582,62 @@
 #  define EN_UNLIKELY(expr) (!!(expr))
 #endif
 
+#if defined(HEDLEY_INLINE)
+#  define EN_INLINE HEDLEY_INLINE
+#elif defined(__cplusplus) || (defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L))
+#  define EN_INLINE inline
+#elif defined(__GNUC__)
+#  define EN_INLINE __inline__
+#else
+#  define EN_INLINE
+#endif
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+#  define EN_ALIGNOF(T) alignof(T)
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#  define EN_ALIGNOF(T) _Alignof(T)
+#elif defined(__GNUC__)
+#  define EN_ALIGNOF(T) __alignof__(T)
+#elif defined(_MSC_VER)
+#  define EN_ALIGNOF(T) __alignof(T)
+#else
+#  define EN_ALIGNOF(T) offsetof(struct { char c_; T v_; }, v_)
+#endif
+
+#if defined(HEDLEY_LIKELY)
+#  define EN_LIKELY(expr) HEDLEY_LIKELY(expr)
+#elif defined(__GNUC__) && (__GNUC__ >= 3)
+#  define EN_LIKELY(expr) __builtin_expect(!!(expr), 1)
+#else
+#  define EN_LIKELY(expr) (!!(expr))
+#endif
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+#  define EN_THREAD_LOCAL thread_local
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#  define EN_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#  define EN_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#  define EN_THREAD_LOCAL __declspec(thread)
+#endif
+
+/* Just enough atomics for the thread-safe parts of the API (enpool.h,
+   etc.); ennew() and friends don't need them. */
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#  define EN_ATOMICS
+#  define EN_ATOMIC_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#  define EN_ATOMIC_STORE(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#  define EN_ATOMIC_EXCHANGE(ptr, value) __atomic_exchange_n((ptr), (value), __ATOMIC_ACQ_REL)
+#  define EN_ATOMIC_CAS(ptr, expected, desired) __atomic_compare_exchange_n((ptr), (expected), (desired), 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#  define EN_ATOMIC_FETCH_ADD(ptr, value) __atomic_fetch_add((ptr), (value), __ATOMIC_ACQ_REL)
+#  define EN_ATOMIC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
 #define EN_NO_OVERFLOW (((size_t) 1) << (sizeof(size_t) * 4))
 
-#if defined(__has_builtin)
+#if defined(EN_NO_BUILTIN_MUL_OVERFLOW)
+#elif defined(__has_builtin)
 #  if __has_builtin(__builtin_mul_overflow) && !defined(__ibmxl__)
 #    define EN_MUL_OVERFLOW
 #  endif
@@ -225,12 +661,214 @@
 #  define EN_STATIC_ASSERT
 #endif
 
+/* Large allocations (see EN_LARGE above).  Every allocation gets a
+   small header so we know whether to munmap or free it. */
+#if defined(EN_LARGE)
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#if !defined(EN_LARGE_THRESHOLD)
+#  define EN_LARGE_THRESHOLD ((size_t) 2 * 1024 * 1024)
+#endif
+#if !defined(EN_LARGE_HUGE_PAGE_SIZE)
+#  define EN_LARGE_HUGE_PAGE_SIZE ((size_t) 2 * 1024 * 1024)
+#endif
+
+/* Padded to the strictest fundamental alignment, like enprofile.h's
+   header; two size_ts are only 8 bytes on 32-bit targets. */
+typedef union {
+  struct {
+    size_t size;
+    size_t mapped;
+  } h;
+#if (defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)) || (defined(__cplusplus) && (__cplusplus >= 201103L))
+  max_align_t align_;
+#else
+  long double ld_;
+  double d_;
+  void* p_;
+  void (*fp_)(void);
+#endif
+} enlarge_header_;
+
+static EN_INLINE size_t enlarge_map_size_(size_t size) {
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+
+  if (EN_UNLIKELY(size > (SIZE_MAX - sizeof(enlarge_header_) - page)))
+    return 0;
+  return (size + sizeof(enlarge_header_) + (page - 1)) & ~(page - 1);
+}
+
+static EN_INLINE void enlarge_advise_(void* addr, size_t len) {
+#if defined(MADV_HUGEPAGE)
+  madvise(addr, len, MADV_HUGEPAGE);
+#else
+  (void) addr;
+  (void) len;
+#endif
+}
+
+static EN_INLINE void* enlarge_map_(size_t size) {
+  size_t len = enlarge_map_size_(size);
+  enlarge_header_* header;
+
+  if (EN_UNLIKELY(len == 0)) {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+#if defined(MADV_HUGEPAGE)
+  /* Map an extra huge page so the block can start on a huge page
+     boundary, then give back the ends. Otherwise the first and last
+     partial huge pages can't be backed by huge pages. */
+  if (len >= EN_LARGE_HUGE_PAGE_SIZE && len <= (SIZE_MAX - EN_LARGE_HUGE_PAGE_SIZE)) {
+    char* raw = (char*) mmap(NULL, len + EN_LARGE_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (EN_LIKELY(raw != (char*) MAP_FAILED)) {
+      size_t head = (size_t) ((-((uintptr_t) raw)) & (EN_LARGE_HUGE_PAGE_SIZE - 1));
+
+      if (head != 0)
+        munmap(raw, head);
+      munmap(raw + head + len, EN_LARGE_HUGE_PAGE_SIZE - head);
+      header = (enlarge_header_*) (raw + head);
+      enlarge_advise_(header, len);
+
+      header->h.size = size;
+      header->h.mapped = len;
+      return header + 1;
+    }
+  }
+#endif
+
+  header = (enlarge_header_*) mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (EN_UNLIKELY(header == (enlarge_header_*) MAP_FAILED)) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  enlarge_advise_(header, len);
+
+  header->h.size = size;
+  header->h.mapped = len;
+  return header + 1;
+}
+
+static EN_INLINE void* enlarge_malloc_(size_t size) {
+  enlarge_header_* header;
+
+  if (size >= EN_LARGE_THRESHOLD)
+    return enlarge_map_(size);
+
+  header = (enlarge_header_*) malloc(sizeof(enlarge_header_) + size);
+  if (EN_UNLIKELY(header == NULL))
+    return NULL;
+  header->h.size = size;
+  header->h.mapped = 0;
+  return header + 1;
+}
+
+static EN_INLINE void* enlarge_calloc_(size_t nmemb, size_t size) {
+  enlarge_header_* header;
+
+  if (EN_UNLIKELY(nmemb != 0 && size > (SIZE_MAX / nmemb)) ||
+      EN_UNLIKELY((size * nmemb) > (SIZE_MAX - sizeof(enlarge_header_)))) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  size *= nmemb;
+
+  /* Fresh mappings are already zeroed. */
+  if (size >= EN_LARGE_THRESHOLD)
+    return enlarge_map_(size);
+
+  header = (enlarge_header_*) calloc(1, sizeof(enlarge_header_) + size);
+  if (EN_UNLIKELY(header == NULL))
+    return NULL;
+  header->h.size = size;
+  header->h.mapped = 0;
+  return header + 1;
+}
+
+static EN_INLINE void enlarge_free_(void* ptr) {
+  enlarge_header_* header;
+
+  if (ptr == NULL)
+    return;
+
+  header = ((enlarge_header_*) ptr) - 1;
+  if (header->h.mapped != 0)
+    munmap(header, header->h.mapped);
+  else
+    free(header);
+}
+
+static EN_INLINE void* enlarge_realloc_(void* ptr, size_t size) {
+  enlarge_header_* header;
+  void* res;
+
+  if (ptr == NULL)
+    return enlarge_malloc_(size);
+
+  header = ((enlarge_header_*) ptr) - 1;
+
+  if (header->h.mapped == 0 && size < EN_LARGE_THRESHOLD) {
+    if (EN_UNLIKELY(size > (SIZE_MAX - sizeof(enlarge_header_)))) {
+      errno = ENOMEM;
+      return NULL;
+    }
+    header = (enlarge_header_*) realloc(header, sizeof(enlarge_header_) + size);
+    if (EN_UNLIKELY(header == NULL))
+      return NULL;
+    header->h.size = size;
+    return header + 1;
+  }
+
+#if defined(MREMAP_MAYMOVE)
+  /* Let the kernel move the pages instead of copying them. */
+  if (header->h.mapped != 0 && size >= EN_LARGE_THRESHOLD) {
+    size_t len = enlarge_map_size_(size);
+
+    if (EN_UNLIKELY(len == 0)) {
+      errno = ENOMEM;
+      return NULL;
+    }
+
+    if (len != header->h.mapped) {
+      res = mremap(header, header->h.mapped, len, MREMAP_MAYMOVE);
+      if (EN_UNLIKELY(res == MAP_FAILED)) {
+        errno = ENOMEM;
+        return NULL;
+      }
+      header = (enlarge_header_*) res;
+      header->h.mapped = len;
+      enlarge_advise_(header, len);
+    }
+    header->h.size = size;
+    return header + 1;
+  }
+#endif
+
+  /* Moving between malloc and mmap (or no mremap), so we have to
+     copy. */
+  res = enlarge_malloc_(size);
+  if (EN_UNLIKELY(res == NULL))
+    return NULL;
+  memcpy(res, ptr, (header->h.size < size) ? header->h.size : size);
+  enlarge_free_(ptr);
+  return res;
+}
+#endif /* defined(EN_LARGE) */
+
 /* If you're getting an error because of this macro, it's because the
    type isn't what was expected.  On some compilers we can make this
    pretty obvious, but on others the error message will be a bit
    cryptic. */
 #if defined(__cplusplus)
 template<typename T> static T* enchecktype_(T* ptr) { return ptr; }
+template<typename T> static const T* enchecktype_(const T* ptr) { return ptr; }
 #define EN_CHECK_TYPE(T, ptr) (enchecktype_<T>(ptr))
 #elif defined(EN_TYPES_COMPATIBLE_P) && defined(EN_STATIC_ASSERT)
 #define EN_CHECK_TYPE(T, ptr) (__extension__ ({ \
@@ -248,10 +886,76 @@ template<typename T> static T* enchecktype_(T* ptr) { return ptr; }
 #define EN_CHECK_TYPE(T, ptr) (ptr)
 #endif
 
+/* realloc() moves the bytes, which is only valid for types which are
+   trivially relocatable.  In C++11 enrealloc() and friends check that
+   at compile time; other types need enrealloc_relocate(). */
 #if defined(__cplusplus)
+#  if (__cplusplus >= 201103L) && (!defined(__GNUC__) || defined(__clang__) || (__GNUC__ >= 5))
+#    include <type_traits>
+#    define EN_TRIVIALLY_COPYABLE_(T) std::is_trivially_copyable<T>::value
+#  elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 5))
+#    define EN_TRIVIALLY_COPYABLE_(T) __is_trivially_copyable(T)
+#  elif defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3))
+#    define EN_TRIVIALLY_COPYABLE_(T) (__has_trivial_copy(T) && __has_trivial_destructor(T))
+#  else
+#    define EN_TRIVIALLY_COPYABLE_(T) true
+#  endif
+
+template<typename T>
+struct en_trivially_relocatable {
+  static const bool value = EN_TRIVIALLY_COPYABLE_(T);
+};
+#  define EN_TRIVIALLY_RELOCATABLE(T) \
+  template<> struct en_trivially_relocatable<T> { static const bool value = true; }
+
+#  if (__cplusplus >= 201103L)
+template<typename T> static void* enrelocatable_(void* ptr) {
+  static_assert(en_trivially_relocatable<T>::value, EN_NOT_RELOCATABLE);
+  return ptr;
+}
+#    define EN_CHECK_RELOCATABLE_(T, ptr) (enrelocatable_<T>(ptr))
+#  else
+#    define EN_CHECK_RELOCATABLE_(T, ptr) (ptr)
+#  endif
+#else
+#  define EN_CHECK_RELOCATABLE_(T, ptr) (ptr)
+#endif
+
+/* When nmemb is a compile-time constant the overflow checks can be
+   done by the compiler.  EN_IS_CONSTANT_ is used to pick a path which
+   the compiler can fold, and EN_CHECK_NMEMB_ turns a constant which
+   overflows into a compile-time error (currently only for GNU C). */
+#if defined(IS_CONSTANT)
+#  define EN_IS_CONSTANT_(expr) IS_CONSTANT(expr)
+#elif defined(__GNUC__) && ((__GNUC__ > 3) || (__GNUC__ == 3 && __GNUC_MINOR__ >= 1))
+#  define EN_IS_CONSTANT_(expr) __builtin_constant_p(expr)
+#else
+#  define EN_IS_CONSTANT_(expr) (0)
+#endif
+
+#if !defined(__cplusplus) && defined(__GNUC__) && defined(IS_CONSTEXPR) && defined(EN_STATIC_ASSERT)
+/* "<" and "==" rather than "<=", which -Wtype-limits warns about when
+   size is 1. */
+#  define EN_CHECK_NMEMB_VALUE_(nmemb) __builtin_choose_expr(IS_CONSTEXPR(nmemb), (nmemb), 0)
+#  define EN_CHECK_NMEMB_(size, nmemb) (__extension__ ({ \
+	_Static_assert((EN_CHECK_NMEMB_VALUE_(nmemb) < (SIZE_MAX / (size))) || \
+		       (EN_CHECK_NMEMB_VALUE_(nmemb) == (SIZE_MAX / (size))), EN_CONSTANT_OVERFLOW); \
+      }))
+#  define EN_REQUIRE_CONSTANT_(expr) (__extension__ ({ \
+	_Static_assert(IS_CONSTEXPR(expr), EN_NOT_CONSTANT); \
+      }))
+#else
+#  define EN_CHECK_NMEMB_(size, nmemb) ((void) 0)
+#  define EN_REQUIRE_CONSTANT_(expr) ((void) 0)
+#endif
+
+#if defined(__cplusplus) && (defined(EN_PROFILE) || defined(EN_TRACE))
+  /* See enprofile.h and entrace.h */
+  template<typename T> static T* enfree(T* ptr);
+#elif defined(__cplusplus)
   template<typename T>
   static T* enfree(T* ptr) {
-    free(static_cast<void*>(ptr));
+    EN_FREE(static_cast<void*>(ptr));
     return static_cast<T*>(NULL);
   }
 #elif defined(__GNUC__)
@@ -268,75 +972,915 @@ template<typename T> static T* enchecktype_(T* ptr) { return ptr; }
 #  define ennew0(T) ((T*) EN_CALLOC(1, sizeof(T)))
 #endif
 
-static void* ennewa_(size_t size, size_t nmemb) {
+/* Calculate size * nmemb, storing the result in *res.  Returns 0 and
+   sets errno to ENOMEM on overflow, non-zero otherwise. */
+static EN_INLINE int enmul_(size_t size, size_t nmemb, size_t* res) {
+#if defined(EN_MUL_OVERFLOW)
+  if (EN_UNLIKELY(__builtin_mul_overflow(size, nmemb, res))) {
+    errno = ENOMEM;
+    return 0;
+  }
+#else
+  if (EN_UNLIKELY(EN_UNLIKELY(nmemb >= EN_NO_OVERFLOW) || EN_UNLIKELY(size >= EN_NO_OVERFLOW)) && EN_UNLIKELY((SIZE_MAX / nmemb) < size)) {
+    errno = ENOMEM;
+    return 0;
+  } else {
+    *res = size * nmemb;
+  }
+#endif
+
+  return 1;
+}
+
+static EN_INLINE void* ennewa_(size_t size, size_t nmemb) {
   size_t alloc_size;
 
   if (EN_UNLIKELY(!nmemb))
     return NULL;
 
-#if defined(EN_MUL_OVERFLOW)
-  if (EN_UNLIKELY(__builtin_mul_overflow(size, nmemb, &alloc_size))) {
-    errno = ENOMEM;
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size)))
     return NULL;
+
+  return EN_MALLOC(alloc_size);
+}
+/* If nmemb is constant the compiler can fold the condition, so
+   non-zero constants which don't overflow skip ennewa_() entirely. */
+#define EN_NEWA_(size, nmemb) \
+  (EN_IS_CONSTANT_(nmemb) ? \
+    ((((nmemb) == 0) || ((nmemb) > (SIZE_MAX / (size)))) ? ennewa_(size, nmemb) : EN_MALLOC((size) * (nmemb))) : \
+    ennewa_(size, nmemb))
+#if defined(__cplusplus)
+#  define ennewa(T, nmemb) static_cast<T*>(EN_NEWA_(sizeof(T), nmemb))
+#  define ennewa0(T, nmemb) static_cast<T*>(EN_CALLOC(nmemb, sizeof(T)))
+#else
+#  define ennewa(T, nmemb) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), EN_NEWA_(sizeof(T), nmemb)))
+#  define ennewa0(T, nmemb) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), EN_CALLOC(nmemb, sizeof(T))))
+#endif
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+  template<typename T, size_t nmemb>
+  static T* ennewa_c_(bool zero) {
+    static_assert(nmemb <= (SIZE_MAX / sizeof(T)), EN_CONSTANT_OVERFLOW);
+    if (nmemb == 0)
+      return static_cast<T*>(NULL);
+    return static_cast<T*>(zero ? EN_CALLOC(nmemb, sizeof(T)) : EN_MALLOC(sizeof(T) * nmemb));
   }
+#  define ennewa_c(T, nmemb) (ennewa_c_<T, (nmemb)>(false))
+#  define ennewa0_c(T, nmemb) (ennewa_c_<T, (nmemb)>(true))
+#elif defined(__cplusplus)
+#  define ennewa_c(T, nmemb) ennewa(T, nmemb)
+#  define ennewa0_c(T, nmemb) ennewa0(T, nmemb)
 #else
-  if (EN_UNLIKELY(EN_UNLIKELY(nmemb >= EN_NO_OVERFLOW) || EN_UNLIKELY(size >= EN_NO_OVERFLOW)) && EN_UNLIKELY((SIZE_MAX / nmemb) < size)) {
+#  define ennewa_c(T, nmemb) ((T*) (EN_REQUIRE_CONSTANT_(nmemb), EN_CHECK_NMEMB_(sizeof(T), nmemb), EN_NEWA_(sizeof(T), nmemb)))
+#  define ennewa0_c(T, nmemb) ((T*) (EN_REQUIRE_CONSTANT_(nmemb), EN_CHECK_NMEMB_(sizeof(T), nmemb), EN_CALLOC(nmemb, sizeof(T))))
+#endif
+
+static EN_INLINE void* enrealloc_(void* ptr, size_t size, size_t nmemb) {
+  size_t alloc_size;
+
+  if (EN_UNLIKELY(!nmemb)) {
+    EN_FREE(ptr);
+    return NULL;
+  }
+
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size)))
+    return NULL;
+
+  return EN_REALLOC(ptr, alloc_size);
+}
+#define EN_REALLOC_(ptr, size, nmemb) \
+  (EN_IS_CONSTANT_(nmemb) ? \
+    ((((nmemb) == 0) || ((nmemb) > (SIZE_MAX / (size)))) ? enrealloc_(ptr, size, nmemb) : EN_REALLOC(ptr, (size) * (nmemb))) : \
+    enrealloc_(ptr, size, nmemb))
+#if defined(__cplusplus)
+#  define enrealloc(ptr, T, nmemb) static_cast<T*>(EN_REALLOC_(EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr)))), sizeof(T), nmemb))
+#else
+#  define enrealloc(ptr, T, nmemb) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), EN_REALLOC_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb)))
+#endif
+
+static EN_INLINE void* enresize_(void* ptr, size_t size, size_t nmemb) {
+  void* tmp_ = enrealloc_(ptr, size, nmemb);
+  /* If nmemb is 0 enrealloc_ has already freed ptr. */
+  if (EN_UNLIKELY(tmp_ == NULL) && EN_UNLIKELY(nmemb != 0))
+    EN_FREE(ptr);
+  return tmp_;
+}
+#define EN_RESIZE_(ptr, size, nmemb) \
+  (EN_IS_CONSTANT_(nmemb) ? \
+    ((((nmemb) == 0) || ((nmemb) > (SIZE_MAX / (size)))) ? enresize_(ptr, size, nmemb) : enresize_(ptr, 1, (size) * (nmemb))) : \
+    enresize_(ptr, size, nmemb))
+#if defined(__cplusplus)
+#  define enresize(ptr, T, nmemb) static_cast<T*>(EN_RESIZE_(EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr)))), sizeof(T), nmemb))
+#else
+#  define enresize(ptr, T, nmemb) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), EN_RESIZE_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb)))
+#endif
+
+static EN_INLINE void enfree_sized_(void* ptr, size_t size, size_t nmemb) {
+  size_t alloc_size;
+
+  if (ptr == NULL)
+    return;
+
+  /* Memory can't have been allocated with a size which overflows, so
+     don't pass it on to the allocator. */
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size))) {
+#if defined(EN_DEBUG_FREE_SIZED)
+    EN_FREE_SIZED_MISMATCH(ptr, SIZE_MAX);
+#endif
+    EN_FREE(ptr);
+    return;
+  }
+
+#if defined(EN_DEBUG_FREE_SIZED) && defined(EN_USABLE_SIZE)
+  {
+    /* The allocator may round up, so this can't be exact, but it will
+       catch the wrong type or nmemb in most cases. */
+    size_t usable = EN_USABLE_SIZE(ptr);
+    if (alloc_size > usable || (usable - alloc_size) > ((usable / 2) + 64)) {
+      EN_FREE_SIZED_MISMATCH(ptr, alloc_size);
+      EN_FREE(ptr);
+      return;
+    }
+  }
+#endif
+
+  EN_FREE_SIZED(ptr, alloc_size);
+}
+#if defined(__cplusplus)
+#  define enfree_sized(ptr, T, nmemb) (enfree_sized_(static_cast<void*>(EN_CHECK_TYPE(T, (ptr))), sizeof(T), nmemb), static_cast<T*>(NULL))
+#else
+#  define enfree_sized(ptr, T, nmemb) (enfree_sized_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb), (T*) NULL)
+#endif
+/* Expands to whichever enfree_sized() is in effect at the call site,
+   so the EN_PROFILE and EN_TRACE versions are picked up too. */
+#define enfree_array(ptr, T, nmemb) enfree_sized(ptr, T, nmemb)
+
+/* Headers with a flexible array member */
+
+/* Size of a header whose flexible array member has nmemb elements of
+   elem_size bytes, starting at offset.  offsetof(Header, member) may
+   be smaller than sizeof(Header) since the array can start in the
+   header's trailing padding, so the result is never smaller than
+   header_size.  Returns 0 and sets errno to ENOMEM on overflow. */
+static EN_INLINE size_t enflex_size_(size_t offset, size_t elem_size, size_t nmemb, size_t header_size) {
+  size_t size;
+
+  if (EN_UNLIKELY(!enmul_(elem_size, nmemb, &size)))
+    return 0;
+  if (EN_UNLIKELY(size > (SIZE_MAX - offset))) {
     errno = ENOMEM;
+    return 0;
+  }
+  size += offset;
+
+  return (size < header_size) ? header_size : size;
+}
+
+static EN_INLINE void* ennew_flex_(size_t size, int zero) {
+  if (EN_UNLIKELY(size == 0))
     return NULL;
-  } else {
-    alloc_size = size * nmemb;
+
+  return zero ? EN_CALLOC(1, size) : EN_MALLOC(size);
+}
+
+static EN_INLINE void* enrealloc_flex_(void* ptr, size_t size, int resize) {
+  void* res = NULL;
+
+  if (EN_LIKELY(size != 0))
+    res = EN_REALLOC(ptr, size);
+  if (EN_UNLIKELY(res == NULL) && resize)
+    EN_FREE(ptr);
+
+  return res;
+}
+
+/* The member must be an array, not a pointer.  sizeof(member[0])
+   would happily compile for a pointer, but the elements wouldn't be
+   part of the allocation. */
+#if !defined(__cplusplus) && defined(EN_TYPES_COMPATIBLE_P) && defined(EN_STATIC_ASSERT)
+#  define EN_CHECK_FLEX_(Header, member) (__extension__ ({ \
+	_Static_assert(!__builtin_types_compatible_p(__typeof__(((Header*) 0)->member), __typeof__(&(((Header*) 0)->member[0]))), "member is not an array"); \
+      }))
+#else
+#  define EN_CHECK_FLEX_(Header, member) ((void) 0)
+#endif
+
+#define EN_FLEX_SIZE_(Header, member, nmemb) \
+  (EN_CHECK_FLEX_(Header, member), \
+   enflex_size_(offsetof(Header, member), sizeof(((Header*) 0)->member[0]), nmemb, sizeof(Header)))
+
+#if defined(__cplusplus)
+#  define ennew_flex(Header, member, nmemb) static_cast<Header*>(ennew_flex_(EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#  define ennew0_flex(Header, member, nmemb) static_cast<Header*>(ennew_flex_(EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#  define enrealloc_flex(ptr, Header, member, nmemb) static_cast<Header*>(enrealloc_flex_(static_cast<void*>(EN_CHECK_TYPE(Header, (ptr))), EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#  define enresize_flex(ptr, Header, member, nmemb) static_cast<Header*>(enrealloc_flex_(static_cast<void*>(EN_CHECK_TYPE(Header, (ptr))), EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#else
+#  define ennew_flex(Header, member, nmemb) ((Header*) ennew_flex_(EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#  define ennew0_flex(Header, member, nmemb) ((Header*) ennew_flex_(EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#  define enrealloc_flex(ptr, Header, member, nmemb) ((Header*) enrealloc_flex_(EN_CHECK_TYPE(Header, ptr), EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#  define enresize_flex(ptr, Header, member, nmemb) ((Header*) enrealloc_flex_(EN_CHECK_TYPE(Header, ptr), EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#endif
+
+/* Batch allocation */
+
+#if !defined(EN_BATCH_CHUNK)
+#  define EN_BATCH_CHUNK 256
+#endif
+
+/* ptrs is really a T** and is accessed with memcpy so we don't violate
+   strict aliasing. */
+static EN_INLINE void enfree_batch_(void* ptrs, size_t count) {
+#if defined(EN_FREE_BATCH)
+  while (count > 0) {
+    size_t n = (count < EN_BATCH_CHUNK) ? count : EN_BATCH_CHUNK;
+    EN_FREE_BATCH((void**) ptrs, n);
+    ptrs = ((char*) ptrs) + (n * sizeof(void*));
+    count -= n;
+  }
+#else
+  size_t i;
+
+  for (i = 0 ; i < count ; i++) {
+    void* ptr;
+    memcpy(&ptr, ((char*) ptrs) + (i * sizeof(void*)), sizeof(void*));
+    EN_FREE(ptr);
   }
 #endif
+}
 
-  return EN_MALLOC(alloc_size);
+static EN_INLINE int ennew_batch_(size_t size, void* ptrs, size_t count) {
+  size_t n = 0;
+
+#if defined(EN_MALLOC_BATCH)
+  /* The allocator may hand out fewer blocks than requested, so ask in
+     chunks until it runs dry, then fall back on EN_MALLOC. */
+  while (n < count) {
+    size_t want = ((count - n) < EN_BATCH_CHUNK) ? (count - n) : EN_BATCH_CHUNK;
+    size_t got = EN_MALLOC_BATCH(size, (void**) (((char*) ptrs) + (n * sizeof(void*))), want);
+    n += got;
+    if (got < want)
+      break;
+  }
+#endif
+
+  for ( ; n < count ; n++) {
+    void* ptr = EN_MALLOC(size);
+    if (EN_UNLIKELY(ptr == NULL)) {
+      enfree_batch_(ptrs, n);
+      return 0;
+    }
+    memcpy(((char*) ptrs) + (n * sizeof(void*)), &ptr, sizeof(void*));
+  }
+
+  return 1;
 }
+
 #if defined(__cplusplus)
-#  define ennewa(T, nmemb) static_cast<T*>(ennewa_(sizeof(T), nmemb))
-#  define ennewa0(T, nmemb) static_cast<T*>(EN_CALLOC(nmemb, sizeof(T)))
+#  define ennew_batch(T, count, ptrs) ennew_batch_(sizeof(T), static_cast<void*>(EN_CHECK_TYPE(T*, (ptrs))), count)
+#  define enfree_batch(ptrs, count) enfree_batch_(static_cast<void*>(ptrs), count)
 #else
-#  define ennewa(T, nmemb) ((T*) ennewa_(sizeof(T), nmemb))
-#  define ennewa0(T, nmemb) ((T*) EN_CALLOC(nmemb, sizeof(T)))
+#  define ennew_batch(T, count, ptrs) ennew_batch_(sizeof(T), EN_CHECK_TYPE(T*, ptrs), count)
+#  define enfree_batch(ptrs, count) enfree_batch_(ptrs, count)
 #endif
 
-static void* enrealloc_(void* ptr, size_t size, size_t nmemb) {
+/* Allocator contexts */
+
+typedef struct {
+  void* (*malloc_fn)(void* ctx, size_t size);
+  void* (*calloc_fn)(void* ctx, size_t nmemb, size_t size);
+  void* (*realloc_fn)(void* ctx, void* ptr, size_t size);
+  void (*free_fn)(void* ctx, void* ptr);
+  void (*free_sized_fn)(void* ctx, void* ptr, size_t size);
+  void* ctx;
+} enallocator;
+
+/* A NULL allocator means EN_MALLOC and friends. When the allocator is
+   a constant NULL the compiler can drop the indirect calls, so
+   ennew_in(NULL, T) costs the same as ennew(T). */
+static EN_INLINE void* enallocator_malloc_(const enallocator* allocator, size_t size) {
+  return (allocator == NULL) ? EN_MALLOC(size) : allocator->malloc_fn(allocator->ctx, size);
+}
+
+static EN_INLINE void* enallocator_calloc_(const enallocator* allocator, size_t nmemb, size_t size) {
+  size_t alloc_size;
+  void* ptr;
+
+  if (allocator == NULL)
+    return EN_CALLOC(nmemb, size);
+  if (allocator->calloc_fn != NULL)
+    return allocator->calloc_fn(allocator->ctx, nmemb, size);
+
+  if (EN_UNLIKELY(!nmemb) || EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size)))
+    return NULL;
+  ptr = allocator->malloc_fn(allocator->ctx, alloc_size);
+  if (EN_LIKELY(ptr != NULL))
+    memset(ptr, 0, alloc_size);
+
+  return ptr;
+}
+
+static EN_INLINE void* enallocator_realloc_(const enallocator* allocator, void* ptr, size_t size) {
+  return (allocator == NULL) ? EN_REALLOC(ptr, size) : allocator->realloc_fn(allocator->ctx, ptr, size);
+}
+
+static EN_INLINE void enallocator_free_(const enallocator* allocator, void* ptr) {
+  if (allocator == NULL)
+    EN_FREE(ptr);
+  else if (ptr != NULL)
+    allocator->free_fn(allocator->ctx, ptr);
+}
+
+static EN_INLINE void* ennewa_in_(const enallocator* allocator, size_t size, size_t nmemb) {
   size_t alloc_size;
 
   if (EN_UNLIKELY(!nmemb))
-    return enfree(ptr);
+    return NULL;
 
-#if defined(EN_MUL_OVERFLOW)
-  if (EN_UNLIKELY(__builtin_mul_overflow(size, nmemb, &alloc_size))) {
-    errno = ENOMEM;
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size)))
+    return NULL;
+
+  return enallocator_malloc_(allocator, alloc_size);
+}
+
+static EN_INLINE void* enrealloc_in_(const enallocator* allocator, void* ptr, size_t size, size_t nmemb, int resize) {
+  size_t alloc_size;
+  void* res;
+
+  if (EN_UNLIKELY(!nmemb)) {
+    enallocator_free_(allocator, ptr);
+    return NULL;
+  }
+
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size)))
+    res = NULL;
+  else
+    res = enallocator_realloc_(allocator, ptr, alloc_size);
+
+  if (EN_UNLIKELY(res == NULL) && resize)
+    enallocator_free_(allocator, ptr);
+
+  return res;
+}
+
+static EN_INLINE void enfree_sized_in_(const enallocator* allocator, void* ptr, size_t size, size_t nmemb) {
+  size_t alloc_size;
+
+  if (allocator == NULL) {
+    enfree_sized_(ptr, size, nmemb);
+  } else if (ptr != NULL) {
+    if (allocator->free_sized_fn != NULL && EN_LIKELY(enmul_(size, nmemb, &alloc_size)))
+      allocator->free_sized_fn(allocator->ctx, ptr, alloc_size);
+    else
+      allocator->free_fn(allocator->ctx, ptr);
+  }
+}
+
+static EN_INLINE void* ennew_flex_in_(const enallocator* allocator, size_t size, int zero) {
+  if (EN_UNLIKELY(size == 0))
     return NULL;
+
+  return zero ? enallocator_calloc_(allocator, 1, size) : enallocator_malloc_(allocator, size);
+}
+
+static EN_INLINE void* enrealloc_flex_in_(const enallocator* allocator, void* ptr, size_t size, int resize) {
+  void* res = NULL;
+
+  if (EN_LIKELY(size != 0))
+    res = enallocator_realloc_(allocator, ptr, size);
+  if (EN_UNLIKELY(res == NULL) && resize)
+    enallocator_free_(allocator, ptr);
+
+  return res;
+}
+
+static EN_INLINE void enfree_batch_in_(const enallocator* allocator, void* ptrs, size_t count) {
+  size_t i;
+
+  if (allocator == NULL) {
+    enfree_batch_(ptrs, count);
+    return;
+  }
+
+  for (i = 0 ; i < count ; i++) {
+    void* ptr;
+    memcpy(&ptr, ((char*) ptrs) + (i * sizeof(void*)), sizeof(void*));
+    enallocator_free_(allocator, ptr);
+  }
+}
+
+static EN_INLINE int ennew_batch_in_(const enallocator* allocator, size_t size, void* ptrs, size_t count) {
+  size_t n;
+
+  if (allocator == NULL)
+    return ennew_batch_(size, ptrs, count);
+
+  for (n = 0 ; n < count ; n++) {
+    void* ptr = allocator->malloc_fn(allocator->ctx, size);
+    if (EN_UNLIKELY(ptr == NULL)) {
+      enfree_batch_in_(allocator, ptrs, n);
+      return 0;
+    }
+    memcpy(((char*) ptrs) + (n * sizeof(void*)), &ptr, sizeof(void*));
   }
+
+  return 1;
+}
+
+#if defined(__cplusplus)
+#  define ennew_in(allocator, T) static_cast<T*>(enallocator_malloc_(allocator, sizeof(T)))
+#  define ennew0_in(allocator, T) static_cast<T*>(enallocator_calloc_(allocator, 1, sizeof(T)))
+#  define ennewa_in(allocator, T, nmemb) static_cast<T*>(ennewa_in_(allocator, sizeof(T), nmemb))
+#  define ennewa0_in(allocator, T, nmemb) static_cast<T*>(enallocator_calloc_(allocator, nmemb, sizeof(T)))
+#  define enrealloc_in(allocator, ptr, T, nmemb) static_cast<T*>(enrealloc_in_(allocator, EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr)))), sizeof(T), nmemb, 0))
+#  define enresize_in(allocator, ptr, T, nmemb) static_cast<T*>(enrealloc_in_(allocator, EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr)))), sizeof(T), nmemb, 1))
+#  define enfree_sized_in(allocator, ptr, T, nmemb) (enfree_sized_in_(allocator, static_cast<void*>(EN_CHECK_TYPE(T, (ptr))), sizeof(T), nmemb), static_cast<T*>(NULL))
+#  define ennew_flex_in(allocator, Header, member, nmemb) static_cast<Header*>(ennew_flex_in_(allocator, EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#  define ennew0_flex_in(allocator, Header, member, nmemb) static_cast<Header*>(ennew_flex_in_(allocator, EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#  define enrealloc_flex_in(allocator, ptr, Header, member, nmemb) static_cast<Header*>(enrealloc_flex_in_(allocator, static_cast<void*>(EN_CHECK_TYPE(Header, (ptr))), EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#  define enresize_flex_in(allocator, ptr, Header, member, nmemb) static_cast<Header*>(enrealloc_flex_in_(allocator, static_cast<void*>(EN_CHECK_TYPE(Header, (ptr))), EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#  define ennew_batch_in(allocator, T, count, ptrs) ennew_batch_in_(allocator, sizeof(T), static_cast<void*>(EN_CHECK_TYPE(T*, (ptrs))), count)
+#  define enfree_batch_in(allocator, ptrs, count) enfree_batch_in_(allocator, static_cast<void*>(ptrs), count)
+  template<typename T>
+  static T* enfree_in(const enallocator* allocator, T* ptr) {
+    enallocator_free_(allocator, static_cast<void*>(ptr));
+    return static_cast<T*>(NULL);
+  }
+#else
+#  define ennew_in(allocator, T) ((T*) enallocator_malloc_(allocator, sizeof(T)))
+#  define ennew0_in(allocator, T) ((T*) enallocator_calloc_(allocator, 1, sizeof(T)))
+#  define ennewa_in(allocator, T, nmemb) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), ennewa_in_(allocator, sizeof(T), nmemb)))
+#  define ennewa0_in(allocator, T, nmemb) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), enallocator_calloc_(allocator, nmemb, sizeof(T))))
+#  define enrealloc_in(allocator, ptr, T, nmemb) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), enrealloc_in_(allocator, EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb, 0)))
+#  define enresize_in(allocator, ptr, T, nmemb) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), enrealloc_in_(allocator, EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb, 1)))
+#  define enfree_sized_in(allocator, ptr, T, nmemb) (enfree_sized_in_(allocator, EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb), (T*) NULL)
+#  define ennew_flex_in(allocator, Header, member, nmemb) ((Header*) ennew_flex_in_(allocator, EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#  define ennew0_flex_in(allocator, Header, member, nmemb) ((Header*) ennew_flex_in_(allocator, EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#  define enrealloc_flex_in(allocator, ptr, Header, member, nmemb) ((Header*) enrealloc_flex_in_(allocator, EN_CHECK_TYPE(Header, ptr), EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#  define enresize_flex_in(allocator, ptr, Header, member, nmemb) ((Header*) enrealloc_flex_in_(allocator, EN_CHECK_TYPE(Header, ptr), EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#  define ennew_batch_in(allocator, T, count, ptrs) ennew_batch_in_(allocator, sizeof(T), EN_CHECK_TYPE(T*, ptrs), count)
+#  define enfree_batch_in(allocator, ptrs, count) enfree_batch_in_(allocator, ptrs, count)
+#  if defined(__GNUC__)
+#    define enfree_in(allocator, ptr) ((__typeof__(*ptr)*) (enallocator_free_(allocator, ptr), NULL))
+#  else
+#    define enfree_in(allocator, ptr) (enallocator_free_(allocator, ptr), (void*) NULL)
+#  endif
+#endif
+
+/* Small temporary arrays */
+
+#if defined(REQUIRE_CONSTEXPR)
+#  define EN_AUTO_CAP_(inline_cap) REQUIRE_CONSTEXPR(inline_cap)
 #else
-  if ((EN_UNLIKELY(nmemb >= EN_NO_OVERFLOW) || EN_UNLIKELY(size >= EN_NO_OVERFLOW)) && EN_UNLIKELY((SIZE_MAX / nmemb) < size)) {
+#  define EN_AUTO_CAP_(inline_cap) (inline_cap)
+#endif
+
+/* Frees the heap copy (if any) and clears it, so it's safe to call
+   again. enprofile.h and entrace.h point EN_AUTO_ARRAY_CLEANUP_ at
+   their own versions, since the memory came from their ennewa(). */
+static EN_INLINE void en_auto_array_free_(void** heap) {
+  if (*heap != NULL) {
+    EN_FREE(*heap);
+    *heap = NULL;
+  }
+}
+#define EN_AUTO_ARRAY_CLEANUP_ en_auto_array_free_
+
+#if defined(__cplusplus)
+  struct en_auto_array_guard_ {
+    void** heap;
+    void (*cleanup)(void** heap);
+    ~en_auto_array_guard_() { cleanup(heap); }
+  };
+#  define EN_AUTO_ARRAY_HEAP_(name) \
+  void* name##_en_auto_heap_ = (name != name##_en_auto_) ? name : NULL; \
+  en_auto_array_guard_ name##_en_auto_guard_ = { &name##_en_auto_heap_, EN_AUTO_ARRAY_CLEANUP_ }
+#elif defined(__GNUC__)
+#  define EN_AUTO_ARRAY_HEAP_(name) \
+  void* name##_en_auto_heap_ __attribute__((__cleanup__(EN_AUTO_ARRAY_CLEANUP_))) = (name != name##_en_auto_) ? name : NULL
+#else
+#  define EN_AUTO_ARRAY_HEAP_(name) \
+  void* name##_en_auto_heap_ = (name != name##_en_auto_) ? name : NULL
+#endif
+
+#define EN_AUTO_ARRAY(T, name, nmemb, inline_cap) \
+  T name##_en_auto_[EN_AUTO_CAP_(inline_cap)]; \
+  const size_t name##_en_auto_nmemb_ = (nmemb); \
+  T* name = (name##_en_auto_nmemb_ <= (size_t) (inline_cap)) ? \
+    name##_en_auto_ : \
+    ennewa(T, name##_en_auto_nmemb_); \
+  EN_AUTO_ARRAY_HEAP_(name)
+
+#define EN_AUTO_ARRAY_FREE(name) \
+  do { \
+    EN_AUTO_ARRAY_CLEANUP_(&(name##_en_auto_heap_)); \
+    (name) = NULL; \
+  } while (0)
+
+/* Aligned allocations */
+
+#if !defined(EN_CACHE_LINE_SIZE)
+#  define EN_CACHE_LINE_SIZE 64
+#endif
+
+#if defined(EN_ALIGNED_ALLOC) && !defined(EN_ALIGNED_FREE)
+#  error EN_ALIGNED_ALLOC requires EN_ALIGNED_FREE
+#endif
+
+/* Stored immediately before every aligned allocation. */
+typedef struct {
+  size_t size;
+  size_t offset;
+} enaligned_header_;
+
+#define EN_ALIGNED_HEADER_(ptr) (((enaligned_header_*) (ptr)) - 1)
+
+/* Compute the size of the buffer we need to get from the allocator
+   and the offset of the user data, or return 0 and set errno. */
+static EN_INLINE int enaligned_sizes_(size_t* size, size_t nmemb, size_t* align, size_t* total) {
+  size_t alloc_size;
+
+  if (EN_UNLIKELY(*align == 0) || EN_UNLIKELY((*align & (*align - 1)) != 0)) {
+    errno = EINVAL;
+    return 0;
+  }
+#if defined(EN_ALIGNED_ALLOC)
+  if (*align < sizeof(void*))
+    *align = sizeof(void*);
+#endif
+
+  if (EN_UNLIKELY(!enmul_(*size, nmemb, &alloc_size)))
+    return 0;
+
+  /* Round up so nothing else ends up sharing the last chunk (i.e.,
+     cache line) with us. */
+  if (EN_UNLIKELY(alloc_size > (SIZE_MAX - (sizeof(enaligned_header_) * 2) - (*align * 2)))) {
     errno = ENOMEM;
+    return 0;
+  }
+  alloc_size = (alloc_size + (*align - 1)) & ~(*align - 1);
+
+#if defined(EN_ALIGNED_ALLOC)
+  *total = ((sizeof(enaligned_header_) + (*align - 1)) & ~(*align - 1)) + alloc_size;
+#else
+  *total = sizeof(enaligned_header_) + (*align - 1) + alloc_size;
+#endif
+  *size = alloc_size;
+
+  return 1;
+}
+
+static EN_INLINE size_t enaligned_offset_(void* raw, size_t align) {
+#if defined(EN_ALIGNED_ALLOC)
+  (void) raw;
+  return (sizeof(enaligned_header_) + (align - 1)) & ~(align - 1);
+#else
+  return sizeof(enaligned_header_) +
+    ((size_t) ((-(uintptr_t) (((char*) raw) + sizeof(enaligned_header_))) & (align - 1)));
+#endif
+}
+
+static EN_INLINE void* enaligned_raw_(void* ptr) {
+  return ((char*) ptr) - EN_ALIGNED_HEADER_(ptr)->offset;
+}
+
+static EN_INLINE void* ennewa_aligned_(size_t size, size_t nmemb, size_t align, int zero) {
+  size_t total, offset;
+  char* raw;
+  char* res;
+
+  if (EN_UNLIKELY(!nmemb))
+    return NULL;
+
+  if (EN_UNLIKELY(!enaligned_sizes_(&size, nmemb, &align, &total)))
+    return NULL;
+
+#if defined(EN_ALIGNED_ALLOC)
+  raw = (char*) EN_ALIGNED_ALLOC(align, total);
+#else
+  raw = (char*) EN_MALLOC(total);
+#endif
+  if (EN_UNLIKELY(raw == NULL))
     return NULL;
+
+  offset = enaligned_offset_(raw, align);
+  res = raw + offset;
+  EN_ALIGNED_HEADER_(res)->size = size;
+  EN_ALIGNED_HEADER_(res)->offset = offset;
+
+  if (zero)
+    memset(res, 0, size);
+
+  return res;
+}
+#if defined(__cplusplus)
+#  define ennew_aligned(T, align) static_cast<T*>(ennewa_aligned_(sizeof(T), 1, align, 0))
+#  define ennew0_aligned(T, align) static_cast<T*>(ennewa_aligned_(sizeof(T), 1, align, 1))
+#  define ennewa_aligned(T, nmemb, align) static_cast<T*>(ennewa_aligned_(sizeof(T), nmemb, align, 0))
+#  define ennewa0_aligned(T, nmemb, align) static_cast<T*>(ennewa_aligned_(sizeof(T), nmemb, align, 1))
+#else
+#  define ennew_aligned(T, align) ((T*) ennewa_aligned_(sizeof(T), 1, align, 0))
+#  define ennew0_aligned(T, align) ((T*) ennewa_aligned_(sizeof(T), 1, align, 1))
+#  define ennewa_aligned(T, nmemb, align) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), ennewa_aligned_(sizeof(T), nmemb, align, 0)))
+#  define ennewa0_aligned(T, nmemb, align) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), ennewa_aligned_(sizeof(T), nmemb, align, 1)))
+#endif
+
+static EN_INLINE void enfree_aligned_(void* ptr) {
+  if (ptr == NULL)
+    return;
+
+#if defined(EN_ALIGNED_FREE)
+  EN_ALIGNED_FREE(enaligned_raw_(ptr));
+#else
+  EN_FREE(enaligned_raw_(ptr));
+#endif
+}
+#if defined(__cplusplus)
+  template<typename T>
+  static T* enfree_aligned(T* ptr) {
+    enfree_aligned_(static_cast<void*>(ptr));
+    return static_cast<T*>(NULL);
   }
-  else {
-    alloc_size = size * nmemb;
+#elif defined(__GNUC__)
+#  define enfree_aligned(ptr) ((__typeof__(*ptr)*) (enfree_aligned_(ptr), NULL))
+#else
+#  define enfree_aligned(ptr) (enfree_aligned_(ptr), (void*) NULL)
+#endif
+
+static EN_INLINE void* enrealloc_aligned_(void* ptr, size_t size, size_t nmemb, size_t align) {
+  size_t total, old_size, offset;
+  char* raw;
+
+  if (ptr == NULL)
+    return ennewa_aligned_(size, nmemb, align, 0);
+
+  if (EN_UNLIKELY(!nmemb)) {
+    enfree_aligned_(ptr);
+    return NULL;
+  }
+
+  if (EN_UNLIKELY(!enaligned_sizes_(&size, nmemb, &align, &total)))
+    return NULL;
+
+  old_size = EN_ALIGNED_HEADER_(ptr)->size;
+
+#if defined(EN_ALIGNED_ALLOC)
+  raw = (char*) EN_ALIGNED_ALLOC(align, total);
+  if (EN_UNLIKELY(raw == NULL))
+    return NULL;
+  offset = enaligned_offset_(raw, align);
+  memcpy(raw + offset, ptr, (old_size < size) ? old_size : size);
+  EN_ALIGNED_FREE(enaligned_raw_(ptr));
+#else
+  /* realloc() may hand us a block with a different alignment, in which
+     case the data has to be shifted to the new aligned offset. */
+  {
+    size_t old_offset = EN_ALIGNED_HEADER_(ptr)->offset;
+
+    raw = (char*) EN_REALLOC(enaligned_raw_(ptr), total);
+    if (EN_UNLIKELY(raw == NULL))
+      return NULL;
+    offset = enaligned_offset_(raw, align);
+    if (offset != old_offset)
+      memmove(raw + offset, raw + old_offset, (old_size < size) ? old_size : size);
   }
 #endif
 
-  return EN_REALLOC(ptr, alloc_size);
+  EN_ALIGNED_HEADER_(raw + offset)->size = size;
+  EN_ALIGNED_HEADER_(raw + offset)->offset = offset;
+
+  return raw + offset;
 }
 #if defined(__cplusplus)
-#  define enrealloc(ptr, T, nmemb) static_cast<T*>(enrealloc_(static_cast<void*>(EN_CHECK_TYPE(T, (ptr))), sizeof(T), nmemb))
+#  define enrealloc_aligned(ptr, T, nmemb, align) static_cast<T*>(enrealloc_aligned_(EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr)))), sizeof(T), nmemb, align))
 #else
-#  define enrealloc(ptr, T, nmemb) ((T*) enrealloc_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb))
+#  define enrealloc_aligned(ptr, T, nmemb, align) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), enrealloc_aligned_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb, align)))
 #endif
 
-static void* enresize_(void* ptr, size_t size, size_t nmemb) {
-  void* tmp_ = enrealloc_(ptr, size, nmemb);
-  if (EN_UNLIKELY(tmp_ == NULL))
-    EN_FREE(ptr);
+static EN_INLINE void* enresize_aligned_(void* ptr, size_t size, size_t nmemb, size_t align) {
+  void* tmp_ = enrealloc_aligned_(ptr, size, nmemb, align);
+  if (EN_UNLIKELY(tmp_ == NULL) && EN_UNLIKELY(nmemb != 0))
+    enfree_aligned_(ptr);
   return tmp_;
 }
 #if defined(__cplusplus)
-#  define enresize(ptr, T, nmemb) static_cast<T*>(enresize_(static_cast<void*>(EN_CHECK_TYPE(T, (ptr))), sizeof(T), nmemb))
+#  define enresize_aligned(ptr, T, nmemb, align) static_cast<T*>(enresize_aligned_(EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr)))), sizeof(T), nmemb, align))
 #else
-#  define enresize(ptr, T, nmemb) ((T*) enresize_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb))
+#  define enresize_aligned(ptr, T, nmemb, align) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), enresize_aligned_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb, align)))
+#endif
+
+/* Arenas */
+
+#if !defined(EN_ARENA_CHUNK_SIZE)
+#  define EN_ARENA_CHUNK_SIZE ((size_t) 64 * 1024)
+#endif
+
+typedef struct enarena_chunk_ {
+  struct enarena_chunk_* prev;
+  size_t size;
+} enarena_chunk_;
+
+typedef struct {
+  enarena_chunk_* chunk;
+  size_t used;
+  size_t chunk_size;
+} enarena;
+
+typedef struct {
+  enarena_chunk_* chunk;
+  size_t used;
+} enarena_mark;
+
+#define ENARENA_INIT { NULL, 0, EN_ARENA_CHUNK_SIZE }
+
+static EN_INLINE void enarena_init(enarena* arena, size_t chunk_size) {
+  arena->chunk = NULL;
+  arena->used = 0;
+  arena->chunk_size = (chunk_size != 0) ? chunk_size : EN_ARENA_CHUNK_SIZE;
+}
+
+static EN_INLINE void* enarena_alloc_(enarena* arena, size_t size, size_t nmemb, size_t align, int zero) {
+  enarena_chunk_* chunk = arena->chunk;
+  size_t alloc_size;
+  size_t pad = 0;
+  char* res;
+
+  if (EN_UNLIKELY(!nmemb))
+    return NULL;
+
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size)))
+    return NULL;
+
+  if (chunk != NULL)
+    pad = (size_t) (-(uintptr_t) ((char*) (chunk + 1) + arena->used)) & (align - 1);
+
+  if (chunk == NULL || alloc_size > chunk->size - arena->used || pad > chunk->size - arena->used - alloc_size) {
+    size_t chunk_size;
+
+    if (EN_UNLIKELY(alloc_size > (SIZE_MAX - sizeof(enarena_chunk_) - align))) {
+      errno = ENOMEM;
+      return NULL;
+    }
+
+    chunk_size = alloc_size + (align - 1);
+    if (chunk_size < arena->chunk_size)
+      chunk_size = arena->chunk_size;
+
+    chunk = (enarena_chunk_*) EN_MALLOC(sizeof(enarena_chunk_) + chunk_size);
+    if (EN_UNLIKELY(chunk == NULL))
+      return NULL;
+    chunk->prev = arena->chunk;
+    chunk->size = chunk_size;
+
+    arena->chunk = chunk;
+    arena->used = 0;
+    pad = (size_t) (-(uintptr_t) (chunk + 1)) & (align - 1);
+  }
+
+  res = ((char*) (chunk + 1)) + arena->used + pad;
+  arena->used += pad + alloc_size;
+
+  if (zero)
+    memset(res, 0, alloc_size);
+
+  return res;
+}
+#if defined(__cplusplus)
+#  define enarena_new(arena, T) static_cast<T*>(enarena_alloc_(arena, sizeof(T), 1, EN_ALIGNOF(T), 0))
+#  define enarena_new0(arena, T) static_cast<T*>(enarena_alloc_(arena, sizeof(T), 1, EN_ALIGNOF(T), 1))
+#  define enarena_newa(arena, T, nmemb) static_cast<T*>(enarena_alloc_(arena, sizeof(T), nmemb, EN_ALIGNOF(T), 0))
+#  define enarena_newa0(arena, T, nmemb) static_cast<T*>(enarena_alloc_(arena, sizeof(T), nmemb, EN_ALIGNOF(T), 1))
+#else
+#  define enarena_new(arena, T) ((T*) enarena_alloc_(arena, sizeof(T), 1, EN_ALIGNOF(T), 0))
+#  define enarena_new0(arena, T) ((T*) enarena_alloc_(arena, sizeof(T), 1, EN_ALIGNOF(T), 1))
+#  define enarena_newa(arena, T, nmemb) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), enarena_alloc_(arena, sizeof(T), nmemb, EN_ALIGNOF(T), 0)))
+#  define enarena_newa0(arena, T, nmemb) ((T*) (EN_CHECK_NMEMB_(sizeof(T), nmemb), enarena_alloc_(arena, sizeof(T), nmemb, EN_ALIGNOF(T), 1)))
+#endif
+
+static EN_INLINE enarena_mark enarena_save(const enarena* arena) {
+  enarena_mark mark;
+  mark.chunk = arena->chunk;
+  mark.used = arena->used;
+  return mark;
+}
+
+static EN_INLINE void enarena_restore(enarena* arena, enarena_mark mark) {
+  while (arena->chunk != mark.chunk) {
+    enarena_chunk_* prev = arena->chunk->prev;
+    EN_FREE(arena->chunk);
+    arena->chunk = prev;
+  }
+  arena->used = mark.used;
+}
+
+static EN_INLINE void enarena_reset(enarena* arena) {
+  enarena_chunk_* chunk = arena->chunk;
+
+  if (chunk == NULL)
+    return;
+
+  /* Keep the oldest chunk around for the next round of allocations. */
+  while (chunk->prev != NULL) {
+    enarena_chunk_* prev = chunk->prev;
+    EN_FREE(chunk);
+    chunk = prev;
+  }
+  arena->chunk = chunk;
+  arena->used = 0;
+}
+
+static EN_INLINE void enarena_destroy(enarena* arena) {
+  enarena_mark empty = { NULL, 0 };
+  enarena_restore(arena, empty);
+}
+
+#if defined(EN_PROFILE)
+#  include "enprofile.h"
+#endif
+
+#if defined(EN_TRACE)
+#  include "entrace.h"
+#endif
+
+/* Relocating reallocation.  This comes after enprofile.h and
+   entrace.h so the allocations go through their ennewa(), enrealloc()
+   and enfree(). */
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template<typename T>
+static void endestroy_(T* ptr, size_t begin, size_t end) {
+  for ( ; begin < end ; begin++)
+    ptr[begin].~T();
+}
+
+/* Trivially relocatable: realloc() moves the elements for us. */
+template<typename T>
+static T* enrealloc_relocate_(T* ptr, size_t old_nmemb, size_t nmemb, bool resize, std::true_type) {
+  T* res;
+
+  if (nmemb < old_nmemb)
+    endestroy_(ptr, nmemb, old_nmemb);
+
+  res = enrealloc(ptr, T, nmemb);
+  if (EN_UNLIKELY(res == NULL) && nmemb != 0) {
+    /* If shrinking fails the old block is still big enough, so we
+       just keep it; the elements past nmemb are already gone. */
+    if (nmemb < old_nmemb)
+      return ptr;
+    if (resize) {
+      endestroy_(ptr, 0, old_nmemb);
+      ptr = enfree(ptr);
+    }
+  }
+
+  return res;
+}
+
+/* Everything else: move the elements to a new block, like
+   std::vector.  If moving may throw and copying is possible they are
+   copied instead, so if an exception is thrown ptr is untouched. */
+template<typename T>
+static T* enrealloc_relocate_(T* ptr, size_t old_nmemb, size_t nmemb, bool resize, std::false_type) {
+  const size_t n = (old_nmemb < nmemb) ? old_nmemb : nmemb;
+  size_t i = 0;
+  T* res = NULL;
+
+  if (nmemb != 0) {
+    res = ennewa(T, nmemb);
+    if (EN_UNLIKELY(res == NULL)) {
+      if (resize) {
+        endestroy_(ptr, 0, old_nmemb);
+        ptr = enfree(ptr);
+      }
+      return NULL;
+    }
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+    try {
+#endif
+      for ( ; i < n ; i++)
+        ::new (static_cast<void*>(res + i)) T(std::move_if_noexcept(ptr[i]));
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+    } catch (...) {
+      endestroy_(res, 0, i);
+      res = enfree(res);
+      throw;
+    }
+#endif
+  }
+
+  endestroy_(ptr, 0, old_nmemb);
+  ptr = enfree(ptr);
+
+  return res;
+}
+
+#define enrealloc_relocate(ptr, T, old_nmemb, nmemb) \
+  (enrealloc_relocate_<T>(ptr, old_nmemb, nmemb, false, std::integral_constant<bool, en_trivially_relocatable<T>::value>()))
+#define enresize_relocate(ptr, T, old_nmemb, nmemb) \
+  (enrealloc_relocate_<T>(ptr, old_nmemb, nmemb, true, std::integral_constant<bool, en_trivially_relocatable<T>::value>()))
 #endif
 
 #endif /* !defined(ENMEM_H) */
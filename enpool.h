@@ -0,0 +1,436 @@
+/* Typed object pools for enmem.h
+ * Code from <https://github.com/nemequ/attic/>
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to
+ * the public domain worldwide. This software is distributed without
+ * any warranty.
+ *
+ * For details see http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ *********************************************************************
+ *
+ * A pool hands out objects of a single type, carved from slabs which
+ * are allocated with EN_MALLOC. It is meant for code which allocates
+ * and frees lots of identical objects (list or tree nodes, for
+ * example) from many threads, where malloc lock contention can
+ * really hurt.
+ *
+ *   enpool pool;
+ *   enpool_init(&pool, Node);
+ *   Node* node = enpool_new(&pool, Node);
+ *   ...
+ *   node = enpool_free(&pool, node);
+ *   ...
+ *   enpool_destroy(&pool);
+ *
+ * Each thread gets its own cache (a "magazine") of free objects, so
+ * in the common case enpool_new() and enpool_free() are just a push
+ * or pop on a thread-local list; no locks, no atomics. Objects don't
+ * belong to a particular thread: whichever thread frees an object
+ * puts it in its own magazine. When a magazine grows past
+ * 2 * EN_POOL_MAGAZINE_SIZE objects, EN_POOL_MAGAZINE_SIZE of them are
+ * pushed to a lock-free list shared by all threads, and threads with
+ * an empty magazine take everything on that list before carving
+ * objects from their slab. This means that when one thread allocates
+ * objects and others free them, the objects flow back to the
+ * allocating thread without anyone taking a lock.
+ *
+ * Up to EN_POOL_MAX_THREADS (64 by default) concurrent threads get a
+ * magazine of their own; additional threads share a single,
+ * spinlock-protected magazine. A thread holds on to its magazine until
+ * it calls enpool_flush(), which hands it over to the next thread
+ * which needs one, so the limit is on threads using the pool at the
+ * same time, not on threads which have ever used it.
+ *
+ * Exactly one file in your program must define EN_POOL_IMPLEMENTATION
+ * before including this header; it provides the per-thread identity
+ * every file shares, so a thread using a pool from several files
+ * still only gets one magazine. This requires thread-local storage
+ * and atomics (see EN_ATOMICS in enmem.h), which basically means GCC
+ * 4.7+ or a compatible compiler.
+ *
+ *********************************************************************
+ *
+ * int enpool_init(enpool* pool, Type T)
+ *
+ *   Initialize a pool for objects of type T. Returns 0 on success.
+ *
+ * T* enpool_new(enpool* pool, Type T)
+ *
+ *   Allocate a single T from the pool. Like ennew(), the memory is
+ *   not initialized. If T doesn't fit in the objects the pool was
+ *   initialized for errno is set to EINVAL and NULL is returned.
+ *
+ * T* enpool_free(enpool* pool, T* ptr)
+ *
+ *   Return ptr to the pool, and return NULL (just like enfree()).
+ *   ptr may be NULL. Objects may be freed by any thread, not just the
+ *   one which allocated them.
+ *
+ * void enpool_flush(enpool* pool)
+ *
+ *   Move all the objects in the calling thread's magazine to the
+ *   shared list and release the magazine so another thread can use
+ *   it. Call this before a thread which has used the pool exits,
+ *   otherwise those objects won't be available to other threads until
+ *   the pool is destroyed, and the thread's magazine stays taken. It
+ *   is fine to keep using the pool afterwards; the thread will just
+ *   get a magazine again.
+ *
+ * void enpool_destroy(enpool* pool)
+ *
+ *   Free all slabs, and therefore every object allocated from the
+ *   pool. No other thread may be using the pool.
+ */
+
+#if !defined(ENPOOL_H)
+#define ENPOOL_H
+
+#include "enmem.h"
+
+#if !defined(EN_ATOMICS) || !defined(EN_THREAD_LOCAL)
+#  error enpool.h requires atomics and thread-local storage
+#endif
+
+#if !defined(EN_POOL_SLAB_SIZE)
+#  define EN_POOL_SLAB_SIZE ((size_t) 64 * 1024)
+#endif
+#if !defined(EN_POOL_MAGAZINE_SIZE)
+#  define EN_POOL_MAGAZINE_SIZE 64
+#endif
+#if !defined(EN_POOL_MAX_THREADS)
+#  define EN_POOL_MAX_THREADS 64
+#endif
+
+typedef struct enpool_slab_ {
+  struct enpool_slab_* next;
+} enpool_slab_;
+
+typedef struct {
+  const void* owner;
+  void* free;
+  size_t count;
+  char* bump;
+  char* bump_end;
+} enpool_magazine_;
+
+/* Magazines are allocated a cache line at a time so threads don't
+   false-share them. */
+typedef union {
+  enpool_magazine_ magazine;
+  char line_[EN_CACHE_LINE_SIZE];
+} enpool_magazine_line_;
+
+typedef struct {
+  size_t size;
+  size_t align;
+  size_t slab_nmemb;
+  enpool_slab_* slabs;
+  void* shared;
+  int overflow_lock;
+  enpool_magazine_ overflow;
+  enpool_magazine_* magazines[EN_POOL_MAX_THREADS];
+} enpool;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Only the address matters; it's unique to each running thread. */
+extern EN_THREAD_LOCAL char enpool_thread_key_;
+
+#if defined(__cplusplus)
+}
+#endif
+
+static EN_INLINE int enpool_init_(enpool* pool, size_t size, size_t align) {
+  size_t i;
+
+  if (align < EN_ALIGNOF(void*))
+    align = EN_ALIGNOF(void*);
+  if (size < sizeof(void*))
+    size = sizeof(void*);
+  if (EN_UNLIKELY(size > SIZE_MAX - align)) {
+    errno = ENOMEM;
+    return -1;
+  }
+  size = (size + (align - 1)) & ~(align - 1);
+
+  pool->size = size;
+  pool->align = align;
+  pool->slab_nmemb = (EN_POOL_SLAB_SIZE > size) ? (EN_POOL_SLAB_SIZE / size) : 1;
+  pool->slabs = NULL;
+  pool->shared = NULL;
+  pool->overflow_lock = 0;
+  memset(&(pool->overflow), 0, sizeof(pool->overflow));
+  for (i = 0 ; i < EN_POOL_MAX_THREADS ; i++)
+    pool->magazines[i] = NULL;
+
+  return 0;
+}
+#define enpool_init(pool, T) enpool_init_(pool, sizeof(T), EN_ALIGNOF(T))
+
+/* The key is at the same offset in every thread's TLS block, and the
+   blocks are usually at addresses with lots of trailing zeros, so it
+   needs to be mixed or every thread would start at the same slot. */
+static EN_INLINE size_t enpool_home_(const void* key) {
+  uint64_t h = ((uint64_t) (uintptr_t) key) * UINT64_C(0x9e3779b97f4a7c15);
+  return ((size_t) (h >> 32)) % EN_POOL_MAX_THREADS;
+}
+
+/* Returns the calling thread's magazine, or NULL if it doesn't have
+   one. Slots are never emptied once filled (enpool_flush() releases
+   the magazine, not the slot), so the probe can stop at the first
+   empty slot. */
+static EN_INLINE enpool_magazine_* enpool_magazine_find_(enpool* pool, const void* key) {
+  size_t i = enpool_home_(key);
+  size_t n;
+
+  for (n = 0 ; n < EN_POOL_MAX_THREADS ; n++) {
+    enpool_magazine_* magazine = EN_ATOMIC_LOAD(&(pool->magazines[i]));
+
+    if (EN_UNLIKELY(magazine == NULL))
+      break;
+    if (EN_LIKELY(EN_ATOMIC_LOAD(&(magazine->owner)) == key))
+      return magazine;
+
+    i = (i + 1) % EN_POOL_MAX_THREADS;
+  }
+
+  return NULL;
+}
+
+/* Returns the calling thread's magazine, claiming one (either an
+   empty slot or a magazine another thread released) if necessary, or
+   NULL if it should use the shared overflow magazine instead. */
+static EN_INLINE enpool_magazine_* enpool_magazine_get_(enpool* pool) {
+  const void* key = &enpool_thread_key_;
+  size_t i = enpool_home_(key);
+  enpool_magazine_* mine;
+  size_t n;
+
+  mine = enpool_magazine_find_(pool, key);
+  if (EN_LIKELY(mine != NULL))
+    return mine;
+
+  for (n = 0 ; n < EN_POOL_MAX_THREADS ; n++) {
+    enpool_magazine_* magazine = EN_ATOMIC_LOAD(&(pool->magazines[i]));
+    const void* unowned = NULL;
+
+    if (magazine == NULL) {
+      if (mine == NULL) {
+        enpool_magazine_line_* line = ennew0_aligned(enpool_magazine_line_, EN_CACHE_LINE_SIZE);
+        if (EN_UNLIKELY(line == NULL))
+          return NULL;
+        mine = &(line->magazine);
+        mine->owner = key;
+      }
+      /* The CAS may fail spuriously, so retry until the slot is
+         filled. If someone else filled it they may have released
+         their magazine already, so it's still worth checking below. */
+      do {
+        if (EN_ATOMIC_CAS(&(pool->magazines[i]), &magazine, mine))
+          return mine;
+      } while (magazine == NULL);
+    }
+
+    if (EN_ATOMIC_LOAD(&(magazine->owner)) == NULL) {
+      do {
+        if (EN_ATOMIC_CAS(&(magazine->owner), &unowned, key)) {
+          if (mine != NULL)
+            mine = enfree_aligned(mine);
+          return magazine;
+        }
+      } while (unowned == NULL);
+    }
+
+    i = (i + 1) % EN_POOL_MAX_THREADS;
+  }
+
+  if (mine != NULL)
+    mine = enfree_aligned(mine);
+  return NULL;
+}
+
+static EN_INLINE void enpool_push_shared_(enpool* pool, void* first, void* last) {
+  void* head = EN_ATOMIC_LOAD(&(pool->shared));
+  do {
+    *((void**) last) = head;
+  } while (!EN_ATOMIC_CAS(&(pool->shared), &head, first));
+}
+
+static EN_INLINE void* enpool_magazine_alloc_(enpool* pool, enpool_magazine_* magazine) {
+  void* res = magazine->free;
+
+  if (EN_LIKELY(res != NULL)) {
+    magazine->free = *((void**) res);
+    magazine->count--;
+    return res;
+  }
+
+  /* Nothing is ever popped individually from the shared list, we
+     always take the whole thing, so there is no ABA problem. */
+  if (EN_ATOMIC_LOAD(&(pool->shared)) != NULL) {
+    res = EN_ATOMIC_EXCHANGE(&(pool->shared), NULL);
+    if (EN_LIKELY(res != NULL)) {
+      void* obj;
+      size_t count = 0;
+
+      magazine->free = *((void**) res);
+      for (obj = magazine->free ; obj != NULL ; obj = *((void**) obj))
+        count++;
+      magazine->count = count;
+      return res;
+    }
+  }
+
+  if (magazine->bump == magazine->bump_end) {
+    enpool_slab_* slab;
+    size_t header = (sizeof(enpool_slab_) + (pool->align - 1)) & ~(pool->align - 1);
+    uintptr_t pad;
+
+    slab = (enpool_slab_*) EN_MALLOC(header + (pool->align - 1) + (pool->slab_nmemb * pool->size));
+    if (EN_UNLIKELY(slab == NULL))
+      return NULL;
+
+    slab->next = EN_ATOMIC_LOAD(&(pool->slabs));
+    while (!EN_ATOMIC_CAS(&(pool->slabs), &(slab->next), slab)) { }
+
+    pad = (-((uintptr_t) slab)) & (pool->align - 1);
+    magazine->bump = ((char*) slab) + header + pad;
+    magazine->bump_end = magazine->bump + (pool->slab_nmemb * pool->size);
+  }
+
+  res = magazine->bump;
+  magazine->bump += pool->size;
+  return res;
+}
+
+static EN_INLINE void enpool_magazine_free_(enpool* pool, enpool_magazine_* magazine, void* ptr) {
+  *((void**) ptr) = magazine->free;
+  magazine->free = ptr;
+
+  if (EN_UNLIKELY(++(magazine->count) > (2 * EN_POOL_MAGAZINE_SIZE))) {
+    void* last = ptr;
+    size_t i;
+
+    for (i = 1 ; i < EN_POOL_MAGAZINE_SIZE ; i++)
+      last = *((void**) last);
+
+    magazine->free = *((void**) last);
+    magazine->count -= EN_POOL_MAGAZINE_SIZE;
+    enpool_push_shared_(pool, ptr, last);
+  }
+}
+
+static EN_INLINE void enpool_overflow_lock_(enpool* pool) {
+  while (EN_ATOMIC_EXCHANGE(&(pool->overflow_lock), 1) != 0) { }
+}
+
+static EN_INLINE void enpool_overflow_unlock_(enpool* pool) {
+  EN_ATOMIC_STORE(&(pool->overflow_lock), 0);
+}
+
+static EN_INLINE void* enpool_alloc_(enpool* pool, size_t size, size_t align) {
+  enpool_magazine_* magazine;
+  void* res;
+
+  if (EN_UNLIKELY(size > pool->size) || EN_UNLIKELY(align > pool->align)) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  magazine = enpool_magazine_get_(pool);
+  if (EN_LIKELY(magazine != NULL))
+    return enpool_magazine_alloc_(pool, magazine);
+
+  enpool_overflow_lock_(pool);
+  res = enpool_magazine_alloc_(pool, &(pool->overflow));
+  enpool_overflow_unlock_(pool);
+  return res;
+}
+#if defined(__cplusplus)
+#  define enpool_new(pool, T) static_cast<T*>(enpool_alloc_(pool, sizeof(T), EN_ALIGNOF(T)))
+#else
+#  define enpool_new(pool, T) ((T*) enpool_alloc_(pool, sizeof(T), EN_ALIGNOF(T)))
+#endif
+
+static EN_INLINE void enpool_free_(enpool* pool, void* ptr) {
+  enpool_magazine_* magazine;
+
+  if (EN_UNLIKELY(ptr == NULL))
+    return;
+
+  magazine = enpool_magazine_get_(pool);
+  if (EN_LIKELY(magazine != NULL)) {
+    enpool_magazine_free_(pool, magazine, ptr);
+  } else {
+    enpool_overflow_lock_(pool);
+    enpool_magazine_free_(pool, &(pool->overflow), ptr);
+    enpool_overflow_unlock_(pool);
+  }
+}
+#if defined(__cplusplus)
+  template<typename T>
+  static T* enpool_free(enpool* pool, T* ptr) {
+    enpool_free_(pool, static_cast<void*>(ptr));
+    return static_cast<T*>(NULL);
+  }
+#elif defined(__GNUC__)
+#  define enpool_free(pool, ptr) ((__typeof__(*ptr)*) (enpool_free_(pool, ptr), NULL))
+#else
+#  define enpool_free(pool, ptr) (enpool_free_(pool, ptr), (void*) NULL)
+#endif
+
+static EN_INLINE void enpool_flush(enpool* pool) {
+  enpool_magazine_* magazine = enpool_magazine_find_(pool, &enpool_thread_key_);
+  void* last;
+
+  if (magazine == NULL)
+    return;
+
+  if (magazine->free != NULL) {
+    for (last = magazine->free ; *((void**) last) != NULL ; last = *((void**) last)) { }
+    enpool_push_shared_(pool, magazine->free, last);
+    magazine->free = NULL;
+    magazine->count = 0;
+  }
+
+  /* Whatever is left of the slab goes to the next owner. */
+  EN_ATOMIC_STORE(&(magazine->owner), (const void*) NULL);
+}
+
+static EN_INLINE void enpool_destroy(enpool* pool) {
+  enpool_slab_* slab = pool->slabs;
+  size_t i;
+
+  while (slab != NULL) {
+    enpool_slab_* next = slab->next;
+    EN_FREE(slab);
+    slab = next;
+  }
+
+  for (i = 0 ; i < EN_POOL_MAX_THREADS ; i++) {
+    if (pool->magazines[i] != NULL)
+      pool->magazines[i] = enfree_aligned(pool->magazines[i]);
+  }
+
+  enpool_init_(pool, pool->size, pool->align);
+}
+
+#if defined(EN_POOL_IMPLEMENTATION)
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+EN_THREAD_LOCAL char enpool_thread_key_ = 0;
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* defined(EN_POOL_IMPLEMENTATION) */
+
+#endif /* !defined(ENPOOL_H) */
@@ -0,0 +1,625 @@
+/* Per-call-site allocation profiling for enmem.h
+ * Code from <https://github.com/nemequ/attic/>
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to
+ * the public domain worldwide. This software is distributed without
+ * any warranty.
+ *
+ * For details see http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ *********************************************************************
+ *
+ * If EN_PROFILE is defined before including enmem.h, ennew(),
+ * ennew0(), ennewa(), ennewa0(), enrealloc(), enresize(), enfree(),
+ * enfree_sized(), ennew_batch(), enfree_batch(), and the *_flex()
+ * variants record the file, line, type name and type size of each
+ * call in a thread-local table, along with:
+ *
+ *  * the number of allocations, reallocations, and frees,
+ *  * bytes allocated and freed (the difference is bytes live),
+ *  * peak bytes live, and
+ *  * a histogram of how much each reallocation grew the buffer (see
+ *    EN_PROFILE_GROWTH_*). Lots of reallocations in the "tiny" bucket
+ *    is a sign of the `enresize(ptr, T, n + 1)` pattern.
+ *
+ * When EN_PROFILE isn't defined none of this code is used, so it
+ * costs nothing. When it is, each call costs a hash table lookup in
+ * a thread-local table and a few increments (no locks, no atomics).
+ * Each allocation also gets a 2 * sizeof(void*) byte header so we
+ * know the size and call site when it is freed, which means EN_PROFILE
+ * must be defined for every file which allocates or frees a given
+ * pointer. The other enmem APIs (arenas, pools, etc.) aren't
+ * profiled.
+ *
+ * Exactly one file in your program must define
+ * EN_PROFILE_IMPLEMENTATION before including this header (or
+ * enmem.h with EN_PROFILE defined) to provide the storage and the
+ * reporting functions.
+ *
+ * Frees are attributed to the call site which allocated the memory,
+ * but recorded in the table of the thread which frees it. Peak bytes
+ * live is tracked per thread, so for memory which is allocated in one
+ * thread and freed in another the sum reported by the functions below
+ * is an upper bound.
+ *
+ * Thread tables are never freed, so it is safe to take a snapshot at
+ * any time. The counters are read without synchronization, so a
+ * snapshot taken while other threads are allocating may be slightly
+ * inconsistent.
+ *
+ *********************************************************************
+ *
+ * size_t enprofile_snapshot(enprofile_site* sites, size_t max)
+ *
+ *   Merge the tables of all threads, writing up to max sites to the
+ *   sites array. Returns the number of sites written. Doesn't
+ *   allocate memory or take any locks.
+ *
+ * void enprofile_dump(int fd)
+ *
+ *   Write a human-readable report to a file descriptor. It only uses
+ *   write(2) and static storage, so it is safe to call from a signal
+ *   handler, but not from more than one thread at a time. Only
+ *   available on POSIX systems.
+ */
+
+#if !defined(ENPROFILE_H)
+#define ENPROFILE_H
+
+#include "enmem.h"
+
+#if !defined(EN_ATOMICS) || !defined(EN_THREAD_LOCAL)
+#  error enprofile.h requires atomics and thread-local storage
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#  define EN_PROFILE_DUMP
+#endif
+
+#if !defined(EN_PROFILE_SITES)
+#  define EN_PROFILE_SITES 256
+#endif
+
+enum {
+  EN_PROFILE_GROWTH_SHRINK = 0, /* new size <= old size */
+  EN_PROFILE_GROWTH_TINY,       /* < 1.125x */
+  EN_PROFILE_GROWTH_SMALL,      /* < 1.5x */
+  EN_PROFILE_GROWTH_DOUBLE,     /* < 2x */
+  EN_PROFILE_GROWTH_LARGE,      /* < 4x */
+  EN_PROFILE_GROWTH_HUGE,       /* >= 4x, or from NULL */
+  EN_PROFILE_GROWTH_BUCKETS
+};
+
+typedef struct {
+  const char* file;
+  unsigned int line;
+  const char* type;
+  size_t type_size;
+  size_t allocs;
+  size_t reallocs;
+  size_t frees;
+  size_t bytes_allocated;
+  size_t bytes_freed;
+  size_t peak;
+  size_t growth[EN_PROFILE_GROWTH_BUCKETS];
+} enprofile_site;
+
+typedef struct enprofile_thread_ {
+  struct enprofile_thread_* next;
+  /* The last one is for everything which doesn't fit. */
+  enprofile_site sites[EN_PROFILE_SITES + 1];
+} enprofile_thread_;
+
+/* The header is padded to the strictest fundamental alignment so the
+   memory after it is as aligned as what malloc returns; two pointers
+   aren't enough on 32-bit targets. */
+typedef union {
+  struct {
+    const enprofile_site* site;
+    size_t size;
+  } h;
+#if (defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)) || (defined(__cplusplus) && (__cplusplus >= 201103L))
+  max_align_t align_;
+#else
+  long double ld_;
+  double d_;
+  void* p_;
+  void (*fp_)(void);
+#endif
+} enprofile_header_;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+extern enprofile_thread_* enprofile_threads_;
+extern EN_THREAD_LOCAL enprofile_thread_* enprofile_self_;
+
+enprofile_thread_* enprofile_thread_new_(void);
+size_t enprofile_snapshot(enprofile_site* sites, size_t max);
+#if defined(EN_PROFILE_DUMP)
+void enprofile_dump(int fd);
+#endif
+
+#if defined(__cplusplus)
+}
+#endif
+
+static EN_INLINE enprofile_site* enprofile_site_(const char* file, unsigned int line, const char* type, size_t type_size) {
+  enprofile_thread_* self = enprofile_self_;
+  size_t i, n;
+
+  if (EN_UNLIKELY(self == NULL)) {
+    self = enprofile_thread_new_();
+    if (EN_UNLIKELY(self == NULL))
+      return NULL;
+  }
+
+  i = ((size_t) ((((uintptr_t) file) >> 3) ^ (line * 2654435761U))) % EN_PROFILE_SITES;
+  for (n = 0 ; n < EN_PROFILE_SITES ; n++) {
+    enprofile_site* site = &(self->sites[i]);
+
+    if (EN_LIKELY(site->file == file) && EN_LIKELY(site->line == line))
+      return site;
+
+    if (site->file == NULL) {
+      site->line = line;
+      site->type = type;
+      site->type_size = type_size;
+      /* file goes last so enprofile_snapshot() never sees a partially
+         initialized site. */
+      EN_ATOMIC_STORE(&(site->file), file);
+      return site;
+    }
+
+    i = (i + 1) % EN_PROFILE_SITES;
+  }
+
+  return &(self->sites[EN_PROFILE_SITES]);
+}
+
+static EN_INLINE void enprofile_record_alloc_(enprofile_site* site, size_t size) {
+  size_t live;
+
+  site->bytes_allocated += size;
+  if (site->bytes_allocated > site->bytes_freed) {
+    live = site->bytes_allocated - site->bytes_freed;
+    if (live > site->peak)
+      site->peak = live;
+  }
+}
+
+static EN_INLINE void enprofile_record_free_(const enprofile_site* origin, size_t size, int is_free) {
+  enprofile_site* site;
+
+  if (origin == NULL)
+    return;
+
+  site = enprofile_site_(origin->file, origin->line, origin->type, origin->type_size);
+  if (EN_LIKELY(site != NULL)) {
+    site->bytes_freed += size;
+    if (is_free)
+      site->frees++;
+  }
+}
+
+static EN_INLINE void* enprofile_alloc_(const char* file, unsigned int line, const char* type, size_t size, size_t nmemb, int zero) {
+  enprofile_header_* header;
+  enprofile_site* site;
+  size_t alloc_size;
+
+  if (EN_UNLIKELY(!nmemb))
+    return NULL;
+
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size)))
+    return NULL;
+  if (EN_UNLIKELY(alloc_size > (SIZE_MAX - sizeof(enprofile_header_)))) {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  header = (enprofile_header_*) (zero ?
+    EN_CALLOC(1, sizeof(enprofile_header_) + alloc_size) :
+    EN_MALLOC(sizeof(enprofile_header_) + alloc_size));
+  if (EN_UNLIKELY(header == NULL))
+    return NULL;
+
+  site = enprofile_site_(file, line, type, size);
+  if (EN_LIKELY(site != NULL)) {
+    site->allocs++;
+    enprofile_record_alloc_(site, alloc_size);
+  }
+  header->h.site = site;
+  header->h.size = alloc_size;
+
+  return header + 1;
+}
+
+static EN_INLINE void enprofile_free_(void* ptr) {
+  enprofile_header_* header;
+
+  if (ptr == NULL)
+    return;
+
+  header = ((enprofile_header_*) ptr) - 1;
+  enprofile_record_free_(header->h.site, header->h.size, 1);
+  EN_FREE(header);
+}
+
+static EN_INLINE void* enprofile_realloc_(const char* file, unsigned int line, const char* type, void* ptr, size_t size, size_t nmemb, int resize) {
+  enprofile_header_* header = (ptr != NULL) ? (((enprofile_header_*) ptr) - 1) : NULL;
+  const enprofile_site* origin = (header != NULL) ? header->h.site : NULL;
+  size_t old_size = (header != NULL) ? header->h.size : 0;
+  enprofile_site* site;
+  size_t alloc_size;
+
+  if (EN_UNLIKELY(!nmemb)) {
+    enprofile_free_(ptr);
+    return NULL;
+  }
+
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size)) ||
+      EN_UNLIKELY(alloc_size > (SIZE_MAX - sizeof(enprofile_header_)))) {
+    errno = ENOMEM;
+    header = NULL;
+  } else {
+    header = (enprofile_header_*) EN_REALLOC(header, sizeof(enprofile_header_) + alloc_size);
+  }
+
+  if (EN_UNLIKELY(header == NULL)) {
+    if (resize)
+      enprofile_free_(ptr);
+    return NULL;
+  }
+
+  enprofile_record_free_(origin, old_size, 0);
+
+  site = enprofile_site_(file, line, type, size);
+  if (EN_LIKELY(site != NULL)) {
+    int bucket;
+
+    if (origin == NULL)
+      bucket = EN_PROFILE_GROWTH_HUGE;
+    else if (alloc_size <= old_size)
+      bucket = EN_PROFILE_GROWTH_SHRINK;
+    else if ((alloc_size - old_size) < (old_size / 8))
+      bucket = EN_PROFILE_GROWTH_TINY;
+    else if ((alloc_size - old_size) < (old_size / 2))
+      bucket = EN_PROFILE_GROWTH_SMALL;
+    else if ((alloc_size - old_size) < old_size)
+      bucket = EN_PROFILE_GROWTH_DOUBLE;
+    else if ((alloc_size - old_size) < (old_size * 3))
+      bucket = EN_PROFILE_GROWTH_LARGE;
+    else
+      bucket = EN_PROFILE_GROWTH_HUGE;
+
+    site->reallocs++;
+    site->growth[bucket]++;
+    enprofile_record_alloc_(site, alloc_size);
+  }
+  header->h.site = site;
+  header->h.size = alloc_size;
+
+  return header + 1;
+}
+
+static EN_INLINE void enprofile_free_sized_(void* ptr, size_t size, size_t nmemb) {
+  enprofile_header_* header;
+  size_t alloc_size;
+
+  if (ptr == NULL)
+    return;
+
+  header = ((enprofile_header_*) ptr) - 1;
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size))) {
+#if defined(EN_DEBUG_FREE_SIZED)
+    EN_FREE_SIZED_MISMATCH(ptr, SIZE_MAX);
+#endif
+    enprofile_free_(ptr);
+    return;
+  }
+  if (EN_UNLIKELY(alloc_size != header->h.size)) {
+#if defined(EN_DEBUG_FREE_SIZED)
+    EN_FREE_SIZED_MISMATCH(ptr, alloc_size);
+#endif
+    enprofile_free_(ptr);
+    return;
+  }
+
+  enprofile_record_free_(header->h.site, alloc_size, 1);
+  EN_FREE_SIZED(header, sizeof(enprofile_header_) + alloc_size);
+}
+
+/* The flexible array sizes are already checked (0 means overflow), so
+   record them as nmemb bytes. */
+static EN_INLINE void* enprofile_alloc_flex_(const char* file, unsigned int line, const char* type, size_t size, int zero) {
+  return enprofile_alloc_(file, line, type, 1, size, zero);
+}
+
+static EN_INLINE void* enprofile_realloc_flex_(const char* file, unsigned int line, const char* type, void* ptr, size_t size, int resize) {
+  if (EN_UNLIKELY(size == 0)) {
+    if (resize)
+      enprofile_free_(ptr);
+    return NULL;
+  }
+
+  return enprofile_realloc_(file, line, type, ptr, 1, size, resize);
+}
+
+static EN_INLINE void enprofile_free_batch_(void* ptrs, size_t count) {
+  size_t i;
+
+  for (i = 0 ; i < count ; i++) {
+    void* ptr;
+    memcpy(&ptr, ((char*) ptrs) + (i * sizeof(void*)), sizeof(void*));
+    enprofile_free_(ptr);
+  }
+}
+
+/* Every object needs its own header, so EN_MALLOC_BATCH isn't used. */
+static EN_INLINE int enprofile_alloc_batch_(const char* file, unsigned int line, const char* type, size_t size, void* ptrs, size_t count) {
+  size_t n;
+
+  for (n = 0 ; n < count ; n++) {
+    void* ptr = enprofile_alloc_(file, line, type, size, 1, 0);
+    if (EN_UNLIKELY(ptr == NULL)) {
+      enprofile_free_batch_(ptrs, n);
+      return 0;
+    }
+    memcpy(((char*) ptrs) + (n * sizeof(void*)), &ptr, sizeof(void*));
+  }
+
+  return 1;
+}
+
+static EN_INLINE void enprofile_auto_array_free_(void** heap) {
+  if (*heap != NULL) {
+    enprofile_free_(*heap);
+    *heap = NULL;
+  }
+}
+
+#if defined(EN_PROFILE)
+#  undef EN_AUTO_ARRAY_CLEANUP_
+#  define EN_AUTO_ARRAY_CLEANUP_ enprofile_auto_array_free_
+#  undef enfree_sized
+#  undef ennew_batch
+#  undef enfree_batch
+#  undef ennew_flex
+#  undef ennew0_flex
+#  undef enrealloc_flex
+#  undef enresize_flex
+#  undef ennew
+#  undef ennew0
+#  undef ennewa
+#  undef ennewa0
+#  undef enrealloc
+#  undef enresize
+#  if defined(__cplusplus)
+#    define ennew(T) static_cast<T*>(enprofile_alloc_(__FILE__, __LINE__, #T, sizeof(T), 1, 0))
+#    define ennew0(T) static_cast<T*>(enprofile_alloc_(__FILE__, __LINE__, #T, sizeof(T), 1, 1))
+#    define ennewa(T, nmemb) static_cast<T*>(enprofile_alloc_(__FILE__, __LINE__, #T, sizeof(T), nmemb, 0))
+#    define ennewa0(T, nmemb) static_cast<T*>(enprofile_alloc_(__FILE__, __LINE__, #T, sizeof(T), nmemb, 1))
+#    define enrealloc(ptr, T, nmemb) static_cast<T*>(enprofile_realloc_(__FILE__, __LINE__, #T, EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr)))), sizeof(T), nmemb, 0))
+#    define enresize(ptr, T, nmemb) static_cast<T*>(enprofile_realloc_(__FILE__, __LINE__, #T, EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr)))), sizeof(T), nmemb, 1))
+#    define enfree_sized(ptr, T, nmemb) (enprofile_free_sized_(static_cast<void*>(EN_CHECK_TYPE(T, (ptr))), sizeof(T), nmemb), static_cast<T*>(NULL))
+#    define ennew_batch(T, count, ptrs) enprofile_alloc_batch_(__FILE__, __LINE__, #T, sizeof(T), static_cast<void*>(EN_CHECK_TYPE(T*, (ptrs))), count)
+#    define enfree_batch(ptrs, count) enprofile_free_batch_(static_cast<void*>(ptrs), count)
+#    define ennew_flex(Header, member, nmemb) static_cast<Header*>(enprofile_alloc_flex_(__FILE__, __LINE__, #Header, EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#    define ennew0_flex(Header, member, nmemb) static_cast<Header*>(enprofile_alloc_flex_(__FILE__, __LINE__, #Header, EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#    define enrealloc_flex(ptr, Header, member, nmemb) static_cast<Header*>(enprofile_realloc_flex_(__FILE__, __LINE__, #Header, static_cast<void*>(EN_CHECK_TYPE(Header, (ptr))), EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#    define enresize_flex(ptr, Header, member, nmemb) static_cast<Header*>(enprofile_realloc_flex_(__FILE__, __LINE__, #Header, static_cast<void*>(EN_CHECK_TYPE(Header, (ptr))), EN_FLEX_SIZE_(Header, member, nmemb), 1))
+  template<typename T>
+  static T* enfree(T* ptr) {
+    enprofile_free_(static_cast<void*>(ptr));
+    return static_cast<T*>(NULL);
+  }
+#  else
+#    undef enfree
+#    define ennew(T) ((T*) enprofile_alloc_(__FILE__, __LINE__, #T, sizeof(T), 1, 0))
+#    define ennew0(T) ((T*) enprofile_alloc_(__FILE__, __LINE__, #T, sizeof(T), 1, 1))
+#    define ennewa(T, nmemb) ((T*) enprofile_alloc_(__FILE__, __LINE__, #T, sizeof(T), nmemb, 0))
+#    define ennewa0(T, nmemb) ((T*) enprofile_alloc_(__FILE__, __LINE__, #T, sizeof(T), nmemb, 1))
+#    define enrealloc(ptr, T, nmemb) ((T*) enprofile_realloc_(__FILE__, __LINE__, #T, EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb, 0))
+#    define enresize(ptr, T, nmemb) ((T*) enprofile_realloc_(__FILE__, __LINE__, #T, EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb, 1))
+#    define enfree_sized(ptr, T, nmemb) (enprofile_free_sized_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb), (T*) NULL)
+#    define ennew_batch(T, count, ptrs) enprofile_alloc_batch_(__FILE__, __LINE__, #T, sizeof(T), EN_CHECK_TYPE(T*, ptrs), count)
+#    define enfree_batch(ptrs, count) enprofile_free_batch_(ptrs, count)
+#    define ennew_flex(Header, member, nmemb) ((Header*) enprofile_alloc_flex_(__FILE__, __LINE__, #Header, EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#    define ennew0_flex(Header, member, nmemb) ((Header*) enprofile_alloc_flex_(__FILE__, __LINE__, #Header, EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#    define enrealloc_flex(ptr, Header, member, nmemb) ((Header*) enprofile_realloc_flex_(__FILE__, __LINE__, #Header, EN_CHECK_TYPE(Header, ptr), EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#    define enresize_flex(ptr, Header, member, nmemb) ((Header*) enprofile_realloc_flex_(__FILE__, __LINE__, #Header, EN_CHECK_TYPE(Header, ptr), EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#    if defined(__GNUC__)
+#      define enfree(ptr) ((__typeof__(*ptr)*) (enprofile_free_(ptr), NULL))
+#    else
+#      define enfree(ptr) (enprofile_free_(ptr), (void*) NULL)
+#    endif
+#  endif
+#endif
+
+#if defined(EN_PROFILE_IMPLEMENTATION)
+
+#if defined(EN_PROFILE_DUMP)
+#  include <unistd.h>
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+enprofile_thread_* enprofile_threads_ = NULL;
+EN_THREAD_LOCAL enprofile_thread_* enprofile_self_ = NULL;
+
+enprofile_thread_* enprofile_thread_new_(void) {
+  enprofile_thread_* self = (enprofile_thread_*) EN_CALLOC(1, sizeof(enprofile_thread_));
+
+  if (EN_UNLIKELY(self == NULL))
+    return NULL;
+
+  self->sites[EN_PROFILE_SITES].file = "(other)";
+  self->sites[EN_PROFILE_SITES].type = "";
+
+  self->next = EN_ATOMIC_LOAD(&enprofile_threads_);
+  while (!EN_ATOMIC_CAS(&enprofile_threads_, &(self->next), self)) { }
+
+  enprofile_self_ = self;
+  return self;
+}
+
+static int enprofile_streq_(const char* a, const char* b) {
+  if (a == b)
+    return 1;
+  while (*a != '\0' && *a == *b) {
+    a++;
+    b++;
+  }
+  return *a == *b;
+}
+
+size_t enprofile_snapshot(enprofile_site* sites, size_t max) {
+  const enprofile_thread_* thread;
+  size_t count = 0;
+
+  for (thread = EN_ATOMIC_LOAD(&enprofile_threads_) ; thread != NULL ; thread = thread->next) {
+    size_t i;
+
+    for (i = 0 ; i <= EN_PROFILE_SITES ; i++) {
+      const enprofile_site* site = &(thread->sites[i]);
+      const char* file = EN_ATOMIC_LOAD(&(site->file));
+      size_t j, b;
+
+      if (file == NULL || (site->allocs == 0 && site->reallocs == 0 && site->frees == 0))
+        continue;
+
+      for (j = 0 ; j < count ; j++) {
+        if (sites[j].line == site->line && enprofile_streq_(sites[j].file, file))
+          break;
+      }
+
+      if (j == count) {
+        if (count == max)
+          continue;
+        sites[j] = *site;
+        sites[j].file = file;
+        count++;
+      } else {
+        sites[j].allocs += site->allocs;
+        sites[j].reallocs += site->reallocs;
+        sites[j].frees += site->frees;
+        sites[j].bytes_allocated += site->bytes_allocated;
+        sites[j].bytes_freed += site->bytes_freed;
+        sites[j].peak += site->peak;
+        for (b = 0 ; b < EN_PROFILE_GROWTH_BUCKETS ; b++)
+          sites[j].growth[b] += site->growth[b];
+      }
+    }
+  }
+
+  return count;
+}
+
+#if defined(EN_PROFILE_DUMP)
+static enprofile_site enprofile_dump_sites_[EN_PROFILE_SITES + 1];
+
+typedef struct {
+  int fd;
+  size_t len;
+  char buf[512];
+} enprofile_writer_;
+
+static void enprofile_flush_(enprofile_writer_* w) {
+  size_t pos = 0;
+
+  while (pos < w->len) {
+    ssize_t r = write(w->fd, w->buf + pos, w->len - pos);
+    if (r <= 0)
+      break;
+    pos += (size_t) r;
+  }
+  w->len = 0;
+}
+
+static void enprofile_puts_(enprofile_writer_* w, const char* str) {
+  for ( ; *str != '\0' ; str++) {
+    if (w->len == sizeof(w->buf))
+      enprofile_flush_(w);
+    w->buf[w->len++] = *str;
+  }
+}
+
+static void enprofile_putu_(enprofile_writer_* w, size_t value) {
+  char tmp[(sizeof(size_t) * 3) + 1];
+  char* p = tmp + sizeof(tmp) - 1;
+
+  *p = '\0';
+  do {
+    *(--p) = (char) ('0' + (value % 10));
+    value /= 10;
+  } while (value != 0);
+
+  enprofile_puts_(w, p);
+}
+
+void enprofile_dump(int fd) {
+  enprofile_writer_ w;
+  size_t count, i, b;
+  size_t live = 0, peak = 0;
+
+  w.fd = fd;
+  w.len = 0;
+
+  count = enprofile_snapshot(enprofile_dump_sites_, EN_PROFILE_SITES + 1);
+  for (i = 0 ; i < count ; i++) {
+    const enprofile_site* site = &(enprofile_dump_sites_[i]);
+    size_t site_live = (site->bytes_allocated > site->bytes_freed) ? (site->bytes_allocated - site->bytes_freed) : 0;
+
+    live += site_live;
+    peak += site->peak;
+
+    enprofile_puts_(&w, site->file);
+    enprofile_puts_(&w, ":");
+    enprofile_putu_(&w, site->line);
+    enprofile_puts_(&w, " ");
+    enprofile_puts_(&w, site->type);
+    enprofile_puts_(&w, " (");
+    enprofile_putu_(&w, site->type_size);
+    enprofile_puts_(&w, ") allocs=");
+    enprofile_putu_(&w, site->allocs);
+    enprofile_puts_(&w, " reallocs=");
+    enprofile_putu_(&w, site->reallocs);
+    enprofile_puts_(&w, " frees=");
+    enprofile_putu_(&w, site->frees);
+    enprofile_puts_(&w, " allocated=");
+    enprofile_putu_(&w, site->bytes_allocated);
+    enprofile_puts_(&w, " live=");
+    enprofile_putu_(&w, site_live);
+    enprofile_puts_(&w, " peak=");
+    enprofile_putu_(&w, site->peak);
+    enprofile_puts_(&w, " growth=");
+    for (b = 0 ; b < EN_PROFILE_GROWTH_BUCKETS ; b++) {
+      if (b != 0)
+        enprofile_puts_(&w, "/");
+      enprofile_putu_(&w, site->growth[b]);
+    }
+    enprofile_puts_(&w, "\n");
+  }
+
+  enprofile_puts_(&w, "total: sites=");
+  enprofile_putu_(&w, count);
+  enprofile_puts_(&w, " live=");
+  enprofile_putu_(&w, live);
+  enprofile_puts_(&w, " peak<=");
+  enprofile_putu_(&w, peak);
+  enprofile_puts_(&w, "\n");
+  enprofile_flush_(&w);
+}
+#endif /* defined(EN_PROFILE_DUMP) */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* defined(EN_PROFILE_IMPLEMENTATION) */
+
+#endif /* !defined(ENPROFILE_H) */
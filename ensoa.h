@@ -0,0 +1,248 @@
+/* Struct-of-arrays allocations for enmem.h
+ * Code from <https://github.com/nemequ/attic/>
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to
+ * the public domain worldwide. This software is distributed without
+ * any warranty.
+ *
+ * For details see http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ *********************************************************************
+ *
+ * Instead of an array of structs, it is often faster to keep one
+ * array per field (a "struct of arrays"), so loops which only touch
+ * some of the fields don't drag the rest through the cache, and each
+ * field is contiguous for the vectorizer. Doing that with ennewa()
+ * means one allocation per field; the ensoa API puts all of the
+ * fields in a single allocation instead, with each field padded to
+ * the alignment of its type:
+ *
+ *   float* x;
+ *   float* y;
+ *   unsigned char* flags;
+ *
+ *   if (!ennew_soa3(n, float, x, float, y, unsigned char, flags))
+ *     return -1;
+ *   ...
+ *   if (!enrealloc_soa3(n, n * 2, float, x, float, y, unsigned char, flags))
+ *     return -1;
+ *   n *= 2;
+ *   ...
+ *   x = enfree_soa(x);
+ *
+ * Each field is an lvalue of type T*; it is type-checked just like
+ * ennewa() and updated in place, so the field arguments are evaluated
+ * more than once and must not have side effects. The first field
+ * owns the allocation, and is the pointer you pass to
+ * enrealloc_soa*() and enfree_soa(). Between two and four fields are
+ * supported. Types with an alignment requirement larger than malloc
+ * provides aren't supported.
+ *
+ * Like the rest of enmem, memory comes from EN_MALLOC, EN_CALLOC,
+ * EN_REALLOC, and EN_FREE, and every size calculation is checked for
+ * overflow. The realloc variants move elements with memmove, so, like
+ * enrealloc(), in C++11 they reject types which aren't trivially
+ * relocatable at compile time.
+ *
+ *********************************************************************
+ *
+ * int ennew_soa2(size_t nmemb, Type T1, T1* p1, Type T2, T2* p2)
+ * int ennew_soa3(size_t nmemb, Type T1, T1* p1, ..., Type T3, T3* p3)
+ * int ennew_soa4(size_t nmemb, Type T1, T1* p1, ..., Type T4, T4* p4)
+ * int ennew0_soa2(...), ennew0_soa3(...), ennew0_soa4(...)
+ *
+ *   Allocate nmemb elements of every field and point each field at
+ *   its array. The "0" variants zero-initialize the arrays. Returns
+ *   non-zero on success; on failure the fields are left untouched and
+ *   errno is set to ENOMEM.
+ *
+ * int enrealloc_soa2(size_t old_nmemb, size_t nmemb, Type T1, T1* p1, Type T2, T2* p2)
+ * int enrealloc_soa3(...), enrealloc_soa4(...)
+ * int enrealloc0_soa2(...), enrealloc0_soa3(...), enrealloc0_soa4(...)
+ *
+ *   Resize every field from old_nmemb (which must be the nmemb the
+ *   fields were last allocated with) to nmemb elements, preserving
+ *   the first min(old_nmemb, nmemb) elements of each. The "0"
+ *   variants zero any new elements. Like enrealloc(), on failure
+ *   nothing is freed, the fields are left untouched, and 0 is
+ *   returned.
+ *
+ * T* enfree_soa(T* p1)
+ *
+ *   Free the allocation (p1 must be the first field) and return NULL,
+ *   like enfree(). The other fields are invalidated as well.
+ */
+
+#if !defined(ENSOA_H)
+#define ENSOA_H
+
+#include "enmem.h"
+
+#define EN_SOA_MAX_FIELDS_ 4
+
+#define EN_SOA_NEW_ 1
+#define EN_SOA_ZERO_ 2
+
+/* Compute the offset of every field and the total size for nmemb
+   elements.  Returns 0 (and sets errno) on overflow. */
+static EN_INLINE int ensoa_layout_(size_t nfields, const size_t* sizes, const size_t* aligns, size_t nmemb, size_t* offsets, size_t* total) {
+  size_t offset = 0;
+  size_t bytes;
+  size_t i;
+
+  for (i = 0 ; i < nfields ; i++) {
+    size_t pad = (aligns[i] - (offset % aligns[i])) % aligns[i];
+
+    if (EN_UNLIKELY(pad > (SIZE_MAX - offset))) {
+      errno = ENOMEM;
+      return 0;
+    }
+    offset += pad;
+    offsets[i] = offset;
+
+    if (EN_UNLIKELY(!enmul_(sizes[i], nmemb, &bytes)))
+      return 0;
+    if (EN_UNLIKELY(bytes > (SIZE_MAX - offset))) {
+      errno = ENOMEM;
+      return 0;
+    }
+    offset += bytes;
+  }
+
+  *total = offset;
+  return 1;
+}
+
+/* Each field is passed as the address of the field pointer (i.e., a
+   T**), its size, and its alignment; unused fields have a NULL
+   address.  The field pointers are accessed with memcpy so we don't
+   violate strict aliasing. */
+static EN_INLINE int ensoa_resize_(size_t old_nmemb, size_t nmemb, int flags,
+                                   void* f0, size_t s0, size_t a0,
+                                   void* f1, size_t s1, size_t a1,
+                                   void* f2, size_t s2, size_t a2,
+                                   void* f3, size_t s3, size_t a3) {
+  void* fields[EN_SOA_MAX_FIELDS_];
+  size_t sizes[EN_SOA_MAX_FIELDS_];
+  size_t aligns[EN_SOA_MAX_FIELDS_];
+  size_t old_offsets[EN_SOA_MAX_FIELDS_];
+  size_t offsets[EN_SOA_MAX_FIELDS_];
+  size_t nfields, total, old_total, i;
+  char* block = NULL;
+  char* old = NULL;
+
+  fields[0] = f0; sizes[0] = s0; aligns[0] = a0;
+  fields[1] = f1; sizes[1] = s1; aligns[1] = a1;
+  fields[2] = f2; sizes[2] = s2; aligns[2] = a2;
+  fields[3] = f3; sizes[3] = s3; aligns[3] = a3;
+  nfields = 0;
+  while (nfields < EN_SOA_MAX_FIELDS_ && fields[nfields] != NULL)
+    nfields++;
+
+  if (flags & EN_SOA_NEW_)
+    old_nmemb = 0;
+
+  if (EN_UNLIKELY(!ensoa_layout_(nfields, sizes, aligns, nmemb, offsets, &total)))
+    return 0;
+  if (!ensoa_layout_(nfields, sizes, aligns, old_nmemb, old_offsets, &old_total))
+    return 0;
+
+  /* Make sure the first field is never NULL on success. */
+  if (total == 0)
+    total = 1;
+
+  if (flags & EN_SOA_NEW_) {
+    block = (char*) ((flags & EN_SOA_ZERO_) ? EN_CALLOC(1, total) : EN_MALLOC(total));
+    if (EN_UNLIKELY(block == NULL))
+      return 0;
+  } else {
+    memcpy(&old, fields[0], sizeof(void*));
+
+    if (nmemb >= old_nmemb) {
+      /* Every field moves towards the end, so start with the last one
+         so we don't overwrite anything we haven't moved yet. */
+      block = (char*) EN_REALLOC(old, total);
+      if (EN_UNLIKELY(block == NULL))
+        return 0;
+      for (i = nfields ; i-- > 1 ; )
+        memmove(block + offsets[i], block + old_offsets[i], sizes[i] * old_nmemb);
+      if (flags & EN_SOA_ZERO_) {
+        for (i = 0 ; i < nfields ; i++)
+          memset(block + offsets[i] + (sizes[i] * old_nmemb), 0, sizes[i] * (nmemb - old_nmemb));
+      }
+    } else {
+      /* Every field moves towards the start, so compact them before
+         shrinking.  If shrinking fails the old block is still big
+         enough for the new layout, so we just keep it. */
+      for (i = 1 ; i < nfields ; i++)
+        memmove(old + offsets[i], old + old_offsets[i], sizes[i] * nmemb);
+      block = (char*) EN_REALLOC(old, total);
+      if (block == NULL)
+        block = old;
+    }
+  }
+
+  for (i = 0 ; i < nfields ; i++) {
+    void* field = block + offsets[i];
+    memcpy(fields[i], &field, sizeof(void*));
+  }
+
+  return 1;
+}
+
+/* EN_SOA_MOVED_FIELD_ is for the realloc variants, which move the
+   elements around with memmove(). */
+#if defined(__cplusplus)
+#  define EN_SOA_FIELD_(T, p) ((void) EN_CHECK_TYPE(T, (p)), static_cast<void*>(&(p))), sizeof(T), EN_ALIGNOF(T)
+#  define EN_SOA_MOVED_FIELD_(T, p) ((void) EN_CHECK_TYPE(T, (p)), EN_CHECK_RELOCATABLE_(T, static_cast<void*>(&(p)))), sizeof(T), EN_ALIGNOF(T)
+#else
+#  define EN_SOA_FIELD_(T, p) ((void) EN_CHECK_TYPE(T, (p)), (void*) &(p)), sizeof(T), EN_ALIGNOF(T)
+#  define EN_SOA_MOVED_FIELD_(T, p) EN_SOA_FIELD_(T, p)
+#endif
+#define EN_SOA_NONE_ NULL, 0, 1
+
+#define ennew_soa2(nmemb, T1, p1, T2, p2) \
+  ensoa_resize_(0, nmemb, EN_SOA_NEW_, EN_SOA_FIELD_(T1, p1), EN_SOA_FIELD_(T2, p2), EN_SOA_NONE_, EN_SOA_NONE_)
+#define ennew_soa3(nmemb, T1, p1, T2, p2, T3, p3) \
+  ensoa_resize_(0, nmemb, EN_SOA_NEW_, EN_SOA_FIELD_(T1, p1), EN_SOA_FIELD_(T2, p2), EN_SOA_FIELD_(T3, p3), EN_SOA_NONE_)
+#define ennew_soa4(nmemb, T1, p1, T2, p2, T3, p3, T4, p4) \
+  ensoa_resize_(0, nmemb, EN_SOA_NEW_, EN_SOA_FIELD_(T1, p1), EN_SOA_FIELD_(T2, p2), EN_SOA_FIELD_(T3, p3), EN_SOA_FIELD_(T4, p4))
+
+#define ennew0_soa2(nmemb, T1, p1, T2, p2) \
+  ensoa_resize_(0, nmemb, EN_SOA_NEW_ | EN_SOA_ZERO_, EN_SOA_FIELD_(T1, p1), EN_SOA_FIELD_(T2, p2), EN_SOA_NONE_, EN_SOA_NONE_)
+#define ennew0_soa3(nmemb, T1, p1, T2, p2, T3, p3) \
+  ensoa_resize_(0, nmemb, EN_SOA_NEW_ | EN_SOA_ZERO_, EN_SOA_FIELD_(T1, p1), EN_SOA_FIELD_(T2, p2), EN_SOA_FIELD_(T3, p3), EN_SOA_NONE_)
+#define ennew0_soa4(nmemb, T1, p1, T2, p2, T3, p3, T4, p4) \
+  ensoa_resize_(0, nmemb, EN_SOA_NEW_ | EN_SOA_ZERO_, EN_SOA_FIELD_(T1, p1), EN_SOA_FIELD_(T2, p2), EN_SOA_FIELD_(T3, p3), EN_SOA_FIELD_(T4, p4))
+
+#define enrealloc_soa2(old_nmemb, nmemb, T1, p1, T2, p2) \
+  ensoa_resize_(old_nmemb, nmemb, 0, EN_SOA_MOVED_FIELD_(T1, p1), EN_SOA_MOVED_FIELD_(T2, p2), EN_SOA_NONE_, EN_SOA_NONE_)
+#define enrealloc_soa3(old_nmemb, nmemb, T1, p1, T2, p2, T3, p3) \
+  ensoa_resize_(old_nmemb, nmemb, 0, EN_SOA_MOVED_FIELD_(T1, p1), EN_SOA_MOVED_FIELD_(T2, p2), EN_SOA_MOVED_FIELD_(T3, p3), EN_SOA_NONE_)
+#define enrealloc_soa4(old_nmemb, nmemb, T1, p1, T2, p2, T3, p3, T4, p4) \
+  ensoa_resize_(old_nmemb, nmemb, 0, EN_SOA_MOVED_FIELD_(T1, p1), EN_SOA_MOVED_FIELD_(T2, p2), EN_SOA_MOVED_FIELD_(T3, p3), EN_SOA_MOVED_FIELD_(T4, p4))
+
+#define enrealloc0_soa2(old_nmemb, nmemb, T1, p1, T2, p2) \
+  ensoa_resize_(old_nmemb, nmemb, EN_SOA_ZERO_, EN_SOA_MOVED_FIELD_(T1, p1), EN_SOA_MOVED_FIELD_(T2, p2), EN_SOA_NONE_, EN_SOA_NONE_)
+#define enrealloc0_soa3(old_nmemb, nmemb, T1, p1, T2, p2, T3, p3) \
+  ensoa_resize_(old_nmemb, nmemb, EN_SOA_ZERO_, EN_SOA_MOVED_FIELD_(T1, p1), EN_SOA_MOVED_FIELD_(T2, p2), EN_SOA_MOVED_FIELD_(T3, p3), EN_SOA_NONE_)
+#define enrealloc0_soa4(old_nmemb, nmemb, T1, p1, T2, p2, T3, p3, T4, p4) \
+  ensoa_resize_(old_nmemb, nmemb, EN_SOA_ZERO_, EN_SOA_MOVED_FIELD_(T1, p1), EN_SOA_MOVED_FIELD_(T2, p2), EN_SOA_MOVED_FIELD_(T3, p3), EN_SOA_MOVED_FIELD_(T4, p4))
+
+static EN_INLINE void enfree_soa_(void* ptr) {
+  EN_FREE(ptr);
+}
+#if defined(__cplusplus)
+  template<typename T>
+  static T* enfree_soa(T* ptr) {
+    enfree_soa_(static_cast<void*>(ptr));
+    return static_cast<T*>(NULL);
+  }
+#elif defined(__GNUC__)
+#  define enfree_soa(ptr) ((__typeof__(*ptr)*) (enfree_soa_(ptr), NULL))
+#else
+#  define enfree_soa(ptr) (enfree_soa_(ptr), (void*) NULL)
+#endif
+
+#endif /* !defined(ENSOA_H) */
@@ -0,0 +1,542 @@
+/* Replay an allocation trace recorded with EN_TRACE (see entrace.h)
+   against whatever EN_MALLOC/EN_CALLOC/EN_REALLOC/EN_FREE it's built
+   with, and report throughput, latency percentiles for each kind of
+   operation, and peak RSS:
+
+     cc -O2 -o entrace-replay entrace-replay.c -lpthread
+     cc -O2 -DEN_LARGE -o entrace-replay-large entrace-replay.c -lpthread
+     cc -O2 -DEN_MALLOC=je_malloc ... -o entrace-replay-je entrace-replay.c -ljemalloc -lpthread
+
+   Allocators which replace malloc can also just be LD_PRELOADed.
+
+   Usage: entrace-replay [-t] [-n] trace
+
+     -t  Replay each recorded thread in its own thread, instead of
+         everything in timestamp order in a single thread. Memory
+         which is freed (or reallocated) by a different thread than
+         the one which allocated it is handed over, so a thread may
+         have to wait for another to catch up.
+     -n  Don't touch the memory. By default one byte in every 4 KiB
+         is written after each allocation (outside of the timed
+         region), so the RSS reflects memory actually used.
+
+   Records are sorted by timestamp, and each allocation gets a slot
+   which is freed by the matching free. Frees of pointers which aren't
+   live and failed allocations are skipped, as are records which end
+   up out of order (see entrace.h); the number skipped is reported.
+   Anything still live at the end of the trace is freed after the
+   timed replay.
+
+   Latency includes the cost of reading the clock around each call,
+   which is usually around 20 ns. Requires POSIX (clock_gettime,
+   getrusage, and pthreads). */
+
+#if defined(EN_LARGE)
+/* For mremap and MAP_ANONYMOUS. */
+#  if !defined(_GNU_SOURCE)
+#    define _GNU_SOURCE
+#  endif
+#else
+#  define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "enmem.h"
+#include "entrace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+
+#define REPLAY_PAGE_SIZE 4096
+#define REPLAY_NO_SLOT SIZE_MAX
+
+typedef struct {
+  uint64_t timestamp;
+  uint64_t addr;
+  uint64_t old_addr;
+  size_t index;
+  size_t size;
+  size_t slot;
+  size_t old_slot;
+  uint16_t thread;
+  uint8_t op;
+} replay_op;
+
+typedef struct {
+  uint64_t addr;
+  size_t slot;
+} replay_entry;
+
+/* Open addressing from the trace's addresses to live slots. */
+typedef struct {
+  replay_entry* entries;
+  size_t mask;
+} replay_map;
+
+typedef struct {
+  replay_op* ops;
+  size_t* indices;
+  size_t count;
+  void** slots;
+  uint32_t* latency;
+  int touch;
+} replay_thread_args;
+
+static uint64_t replay_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (((uint64_t) ts.tv_sec) * UINT64_C(1000000000)) + ((uint64_t) ts.tv_nsec);
+}
+
+/* On Linux we can reset the RSS high-water mark once the trace is
+   loaded, and read the current RSS, so the trace data doesn't hide
+   the replay's peak. Elsewhere both are the ru_maxrss high-water
+   mark, so the peak is only accurate if it's above the trace data. */
+static long replay_rss_kib(const char* field) {
+#if defined(__linux__)
+  char line[256];
+  long kib = -1;
+  FILE* fp = fopen("/proc/self/status", "r");
+
+  if (fp != NULL) {
+    const size_t len = strlen(field);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+      if (strncmp(line, field, len) == 0 && line[len] == ':') {
+        kib = strtol(line + len + 1, NULL, 10);
+        break;
+      }
+    }
+    fclose(fp);
+  }
+  if (kib >= 0)
+    return kib;
+#endif
+  {
+    struct rusage usage;
+    (void) field;
+    getrusage(RUSAGE_SELF, &usage);
+    return (long) usage.ru_maxrss;
+  }
+}
+
+static void replay_rss_reset(void) {
+#if defined(__linux__)
+  FILE* fp = fopen("/proc/self/clear_refs", "w");
+
+  if (fp != NULL) {
+    fputs("5", fp);
+    fclose(fp);
+  }
+#endif
+}
+
+static void replay_die(const char* msg, const char* arg) {
+  fprintf(stderr, "entrace-replay: %s%s\n", msg, arg);
+  exit(EXIT_FAILURE);
+}
+
+static uint32_t replay_latency(uint64_t start) {
+  const uint64_t ns = replay_now() - start;
+  return (ns < UINT32_MAX) ? (uint32_t) ns : UINT32_MAX;
+}
+
+static int replay_compare_ops(const void* a, const void* b) {
+  const replay_op* x = (const replay_op*) a;
+  const replay_op* y = (const replay_op*) b;
+
+  if (x->timestamp != y->timestamp)
+    return (x->timestamp < y->timestamp) ? -1 : 1;
+  /* Each thread's records are in order in the file. */
+  return (x->index < y->index) ? -1 : (x->index > y->index);
+}
+
+static int replay_compare_u32(const void* a, const void* b) {
+  const uint32_t x = *((const uint32_t*) a);
+  const uint32_t y = *((const uint32_t*) b);
+  return (x < y) ? -1 : (x > y);
+}
+
+static size_t replay_hash(uint64_t addr, size_t mask) {
+  return (size_t) ((addr >> 4) * UINT64_C(0x9e3779b97f4a7c15) >> 17) & mask;
+}
+
+static size_t replay_map_find(const replay_map* map, uint64_t addr) {
+  size_t i;
+
+  for (i = replay_hash(addr, map->mask) ; map->entries[i].addr != 0 ; i = (i + 1) & map->mask) {
+    if (map->entries[i].addr == addr)
+      return i;
+  }
+
+  return REPLAY_NO_SLOT;
+}
+
+static void replay_map_set(replay_map* map, uint64_t addr, size_t slot) {
+  size_t i;
+
+  for (i = replay_hash(addr, map->mask) ; map->entries[i].addr != 0 && map->entries[i].addr != addr ; i = (i + 1) & map->mask) { }
+  map->entries[i].addr = addr;
+  map->entries[i].slot = slot;
+}
+
+/* Backward shift deletion, so we don't need tombstones. */
+static void replay_map_remove(replay_map* map, size_t i) {
+  size_t j = i;
+
+  for (;;) {
+    size_t home;
+
+    map->entries[i].addr = 0;
+    do {
+      j = (j + 1) & map->mask;
+      if (map->entries[j].addr == 0)
+        return;
+      home = replay_hash(map->entries[j].addr, map->mask);
+    } while ((i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j)));
+    map->entries[i] = map->entries[j];
+    i = j;
+  }
+}
+
+/* Read the trace into an array of ops, sorted by timestamp. */
+static replay_op* replay_load(const char* path, size_t* count) {
+  entrace_file_header header;
+  entrace_record record;
+  replay_op* ops = NULL;
+  size_t n = 0, cap = 0;
+  FILE* fp;
+
+  fp = fopen(path, "rb");
+  if (fp == NULL)
+    replay_die("unable to open ", path);
+  if (fread(&header, sizeof(header), 1, fp) != 1 ||
+      memcmp(header.magic, ENTRACE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.record_size != sizeof(entrace_record))
+    replay_die("not a trace from this version of entrace.h: ", path);
+
+  while (fread(&record, sizeof(record), 1, fp) == 1) {
+    replay_op* op;
+
+    if (n == cap) {
+      cap = (cap == 0) ? 4096 : (cap * 2);
+      ops = enresize(ops, replay_op, cap);
+      if (ops == NULL)
+        replay_die("out of memory", "");
+    }
+
+    op = &(ops[n]);
+    op->timestamp = record.timestamp;
+    op->index = n;
+    op->thread = record.thread;
+    op->op = record.op;
+    op->addr = record.ptr;
+    op->old_addr = record.old_ptr;
+    op->slot = REPLAY_NO_SLOT;
+    op->old_slot = REPLAY_NO_SLOT;
+    /* Sizes which overflow can only come from failed allocations. */
+    if (record.nmemb > SIZE_MAX || !enmul_(record.type_size, (size_t) record.nmemb, &(op->size)))
+      op->size = SIZE_MAX;
+    n++;
+  }
+  fclose(fp);
+
+  qsort(ops, n, sizeof(replay_op), replay_compare_ops);
+
+  *count = n;
+  return ops;
+}
+
+/* Replace the trace's addresses with slots, so each slot is set by
+   exactly one op and consumed by at most one other. Ops which can't
+   be replayed get an op of 0. Returns the number of slots. */
+static size_t replay_resolve(replay_op* ops, size_t count, size_t* skipped) {
+  replay_map map;
+  size_t slots = 0, cap = 16, i;
+
+  while (cap < (count * 2))
+    cap *= 2;
+  map.entries = ennewa0(replay_entry, cap);
+  if (map.entries == NULL)
+    replay_die("out of memory", "");
+  map.mask = cap - 1;
+
+  *skipped = 0;
+  for (i = 0 ; i < count ; i++) {
+    replay_op* op = &(ops[i]);
+    const uint64_t addr = op->addr;
+    const uint64_t old_addr = op->old_addr;
+    size_t e;
+
+    switch (op->op) {
+      case ENTRACE_MALLOC:
+      case ENTRACE_CALLOC:
+        break;
+      case ENTRACE_REALLOC:
+        if (old_addr != 0) {
+          e = replay_map_find(&map, old_addr);
+          if (e == REPLAY_NO_SLOT) {
+            /* We can still replay it as an allocation. */
+            (*skipped)++;
+          } else if (addr == 0 && op->size != 0) {
+            /* Failed, so the old pointer is still live. */
+            op->op = 0;
+            continue;
+          } else {
+            op->old_slot = map.entries[e].slot;
+            replay_map_remove(&map, e);
+            if (addr == 0) {
+              op->op = ENTRACE_FREE;
+              op->slot = op->old_slot;
+              op->old_slot = REPLAY_NO_SLOT;
+              continue;
+            }
+          }
+        }
+        break;
+      case ENTRACE_FREE:
+        e = replay_map_find(&map, addr);
+        if (e == REPLAY_NO_SLOT) {
+          op->op = 0;
+          (*skipped)++;
+        } else {
+          op->slot = map.entries[e].slot;
+          replay_map_remove(&map, e);
+        }
+        continue;
+      default:
+        op->op = 0;
+        (*skipped)++;
+        continue;
+    }
+
+    if (addr == 0) {
+      op->op = 0;
+      (*skipped)++;
+      continue;
+    }
+
+    /* An address which is already live means we missed the free. */
+    if (replay_map_find(&map, addr) != REPLAY_NO_SLOT)
+      (*skipped)++;
+    op->slot = slots++;
+    replay_map_set(&map, addr, op->slot);
+  }
+
+  map.entries = enfree(map.entries);
+  return slots;
+}
+
+static void replay_touch(char* ptr, size_t size) {
+  size_t i;
+
+  for (i = 0 ; i < size ; i += REPLAY_PAGE_SIZE)
+    ptr[i] = 1;
+}
+
+/* Wait for another thread to produce a slot; in single-threaded mode
+   it's already there. */
+static void* replay_wait(void** slot) {
+  void* ptr;
+
+  while ((ptr = EN_ATOMIC_LOAD(slot)) == NULL)
+    sched_yield();
+
+  return ptr;
+}
+
+static void* replay_thread(void* data) {
+  const replay_thread_args* args = (const replay_thread_args*) data;
+  size_t i;
+
+  for (i = 0 ; i < args->count ; i++) {
+    const size_t index = (args->indices != NULL) ? args->indices[i] : i;
+    const replay_op* op = &(args->ops[index]);
+    /* Some allocators return NULL for 0 bytes, which we can't tell
+       apart from a slot which isn't ready yet. */
+    const size_t size = (op->size != 0) ? op->size : 1;
+    void* old = NULL;
+    void* ptr = NULL;
+    uint64_t start;
+
+    if (op->op == ENTRACE_FREE || (op->op == ENTRACE_REALLOC && op->old_slot != REPLAY_NO_SLOT)) {
+      void** slot = &(args->slots[(op->op == ENTRACE_FREE) ? op->slot : op->old_slot]);
+      old = replay_wait(slot);
+      /* Nobody else uses the slot, so anything still set at the end
+         is live. */
+      *slot = NULL;
+    }
+
+    start = replay_now();
+    switch (op->op) {
+      case ENTRACE_MALLOC:
+        ptr = EN_MALLOC(size);
+        break;
+      case ENTRACE_CALLOC:
+        ptr = EN_CALLOC(1, size);
+        break;
+      case ENTRACE_REALLOC:
+        ptr = EN_REALLOC(old, size);
+        break;
+      case ENTRACE_FREE:
+        EN_FREE(old);
+        break;
+      default:
+        continue;
+    }
+    args->latency[index] = replay_latency(start);
+
+    if (op->op != ENTRACE_FREE) {
+      if (ptr == NULL)
+        replay_die("allocation failed", "");
+      if (args->touch)
+        replay_touch((char*) ptr, size);
+      EN_ATOMIC_STORE(&(args->slots[op->slot]), ptr);
+    }
+  }
+
+  return NULL;
+}
+
+static void replay_report(const char* name, const replay_op* ops, size_t count, const uint32_t* latency, int op, uint32_t* tmp) {
+  static const double percentiles[] = { 0.5, 0.9, 0.99, 0.999 };
+  size_t n = 0, i;
+
+  for (i = 0 ; i < count ; i++) {
+    if (ops[i].op != 0 && (op == 0 || ops[i].op == op))
+      tmp[n++] = latency[i];
+  }
+  if (n == 0)
+    return;
+
+  qsort(tmp, n, sizeof(uint32_t), replay_compare_u32);
+  printf("%-8s %10zu", name, n);
+  for (i = 0 ; i < sizeof(percentiles) / sizeof(percentiles[0]) ; i++)
+    printf(" %9lu", (unsigned long) tmp[(size_t) (percentiles[i] * (double) (n - 1))]);
+  printf(" %9lu\n", (unsigned long) tmp[n - 1]);
+}
+
+int main(int argc, char** argv) {
+  replay_op* ops;
+  void** slots;
+  uint32_t* latency;
+  size_t count, nslots, skipped, replayed = 0, live = 0, threads = 0, i;
+  const char* path = NULL;
+  int threaded = 0, touch = 1;
+  uint64_t start, elapsed;
+  long rss_before;
+
+  for (i = 1 ; i < (size_t) argc ; i++) {
+    if (strcmp(argv[i], "-t") == 0)
+      threaded = 1;
+    else if (strcmp(argv[i], "-n") == 0)
+      touch = 0;
+    else if (path == NULL && argv[i][0] != '-')
+      path = argv[i];
+    else {
+      path = NULL;
+      break;
+    }
+  }
+  if (path == NULL) {
+    fprintf(stderr, "Usage: %s [-t] [-n] trace\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  ops = replay_load(path, &count);
+  nslots = replay_resolve(ops, count, &skipped);
+  slots = ennewa0(void*, nslots + 1);
+  latency = ennewa0(uint32_t, count + 1);
+  if (slots == NULL || latency == NULL)
+    replay_die("out of memory", "");
+
+  for (i = 0 ; i < count ; i++) {
+    if (ops[i].op != 0)
+      replayed++;
+    if (ops[i].thread >= threads)
+      threads = (size_t) ops[i].thread + 1;
+  }
+
+  replay_rss_reset();
+  rss_before = replay_rss_kib("VmRSS");
+  if (!threaded) {
+    replay_thread_args args = { ops, NULL, count, slots, latency, touch };
+
+    start = replay_now();
+    replay_thread(&args);
+    elapsed = replay_now() - start;
+  } else {
+    replay_thread_args* args = ennewa0(replay_thread_args, threads + 1);
+    pthread_t* tids = ennewa(pthread_t, threads + 1);
+    size_t* indices = ennewa(size_t, count + 1);
+    size_t t, pos = 0;
+
+    if (args == NULL || tids == NULL || indices == NULL)
+      replay_die("out of memory", "");
+
+    /* Group the ops by thread, keeping them in order. */
+    for (i = 0 ; i < count ; i++)
+      args[ops[i].thread].count++;
+    for (t = 0 ; t < threads ; t++) {
+      args[t].ops = ops;
+      args[t].indices = indices + pos;
+      args[t].slots = slots;
+      args[t].latency = latency;
+      args[t].touch = touch;
+      pos += args[t].count;
+      args[t].count = 0;
+    }
+    for (i = 0 ; i < count ; i++) {
+      replay_thread_args* a = &(args[ops[i].thread]);
+      a->indices[a->count++] = i;
+    }
+
+    start = replay_now();
+    for (t = 0 ; t < threads ; t++) {
+      if (pthread_create(&(tids[t]), NULL, replay_thread, &(args[t])) != 0)
+        replay_die("unable to create thread", "");
+    }
+    for (t = 0 ; t < threads ; t++)
+      pthread_join(tids[t], NULL);
+    elapsed = replay_now() - start;
+
+    args = enfree(args);
+    tids = enfree(tids);
+    indices = enfree(indices);
+  }
+
+  printf("%s: %zu records, %zu threads, %zu skipped\n", path, count, threads, skipped);
+  printf("replayed %zu ops in %s mode: %.3f s, %.0f ops/s\n", replayed,
+         threaded ? "threaded" : "serial", (double) elapsed / 1e9,
+         (elapsed != 0) ? ((double) replayed / ((double) elapsed / 1e9)) : 0.0);
+  printf("peak RSS: %ld KiB (%ld KiB before replay)\n", replay_rss_kib("VmHWM"), rss_before);
+  printf("%-8s %10s %9s %9s %9s %9s %9s\n", "op (ns)", "count", "p50", "p90", "p99", "p99.9", "max");
+
+  {
+    uint32_t* tmp = ennewa(uint32_t, count + 1);
+    if (tmp == NULL)
+      replay_die("out of memory", "");
+    replay_report("malloc", ops, count, latency, ENTRACE_MALLOC, tmp);
+    replay_report("calloc", ops, count, latency, ENTRACE_CALLOC, tmp);
+    replay_report("realloc", ops, count, latency, ENTRACE_REALLOC, tmp);
+    replay_report("free", ops, count, latency, ENTRACE_FREE, tmp);
+    replay_report("all", ops, count, latency, 0, tmp);
+    tmp = enfree(tmp);
+  }
+
+  for (i = 0 ; i < nslots ; i++) {
+    if (slots[i] != NULL) {
+      live++;
+      EN_FREE(slots[i]);
+    }
+  }
+  printf("%zu allocations still live at the end of the trace\n", live);
+
+  slots = enfree(slots);
+  latency = enfree(latency);
+  ops = enfree(ops);
+
+  return 0;
+}
@@ -0,0 +1,510 @@
+/* Allocation tracing for enmem.h
+ * Code from <https://github.com/nemequ/attic/>
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to
+ * the public domain worldwide. This software is distributed without
+ * any warranty.
+ *
+ * For details see http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ *********************************************************************
+ *
+ * If EN_TRACE is defined before including enmem.h, ennew(), ennew0(),
+ * ennewa(), ennewa0(), enrealloc(), enresize(), enfree(),
+ * enfree_sized(), ennew_batch(), enfree_batch(), and the *_flex()
+ * variants append a record to a thread-local buffer for every call.
+ * When the buffer is full (EN_TRACE_BUFFER records) it is written to
+ * the trace file with a single write(2). entrace-replay.c can replay
+ * the file against any EN_MALLOC/EN_REALLOC/EN_FREE implementation.
+ *
+ * Unlike EN_PROFILE, allocations don't get a header, so it's fine to
+ * mix traced and untraced files (though anything the untraced files
+ * do won't be in the trace, of course). EN_TRACE and EN_PROFILE can't
+ * be used together. The other enmem APIs (arenas, pools, etc.) aren't
+ * traced.
+ *
+ * Exactly one file in your program must define
+ * EN_TRACE_IMPLEMENTATION before including this header (or enmem.h
+ * with EN_TRACE defined). Only available on POSIX systems.
+ *
+ * The trace goes to the file named by the ENMEM_TRACE environment
+ * variable, or EN_TRACE_FILE ("enmem.trace") if it isn't set, unless
+ * you call entrace_open() first. The file is opened on the first
+ * flush. Each thread's buffer is flushed when the thread exits, and
+ * everything is flushed at exit(3) by an atexit() handler.
+ *
+ * The file is a 16 byte header ("ENTRACE1", then the record size
+ * and 4 reserved bytes, as uint32_t) followed by entrace_record
+ * structs, all in native byte order:
+ *
+ *  * timestamp: nanoseconds, CLOCK_MONOTONIC if it's available.
+ *    Records from different threads aren't in order in the file, sort
+ *    them by timestamp.
+ *  * ptr: the pointer returned by the allocation, or passed to
+ *    enfree(). Failed allocations are recorded with ptr 0.
+ *  * old_ptr: for ENTRACE_REALLOC, the pointer passed in.
+ *  * nmemb, type_size: the requested size. The *_flex() variants are
+ *    recorded as nmemb bytes with a type_size of 1, and enfree() as
+ *    0 and 0 since it doesn't know the size.
+ *  * thread: a small number identifying the thread.
+ *  * op: one of ENTRACE_MALLOC, ENTRACE_CALLOC (ennew0(), ennewa0(),
+ *    and ennew0_flex()), ENTRACE_REALLOC, or ENTRACE_FREE.
+ *
+ * The pointer value is the id of the allocation; a pointer is live
+ * from the record which returns it until the record which frees it,
+ * either ENTRACE_FREE or an ENTRACE_REALLOC with it as old_ptr. An
+ * ENTRACE_REALLOC with ptr 0 freed old_ptr if nmemb is 0, and
+ * otherwise failed and left it alone (enresize() adds an ENTRACE_FREE
+ * record when it frees old_ptr after a failure).
+ *
+ * Frees and reallocations are timestamped before the call, and
+ * allocations after, so a pointer which is freed by one thread and
+ * returned to another is always in the right order. Nothing is
+ * locked while calling the allocator, though, so a reallocation
+ * which races with another thread can occasionally end up out of
+ * order; the replay tool counts and skips records it can't match.
+ *
+ * Each call costs a clock read and a 40 byte store, plus an amortized
+ * share of the write(2).
+ *
+ *********************************************************************
+ *
+ * int entrace_open(const char* path)
+ *
+ *   Start writing the trace to path, truncating it. Anything already
+ *   buffered by the calling thread goes to the previous file (if one
+ *   was open) or the new one. Returns 0 on success, or -1 with errno
+ *   set on failure, in which case records are discarded until a file
+ *   is opened.
+ *
+ * void entrace_flush(void)
+ *
+ *   Write the calling thread's buffered records to the file.
+ *
+ * void entrace_close(void)
+ *
+ *   Flush every thread's buffer and close the file. Other threads
+ *   must not be allocating while this runs. Records after this are
+ *   discarded until the next entrace_open().
+ */
+
+#if !defined(ENTRACE_H)
+#define ENTRACE_H
+
+#include "enmem.h"
+
+#if !defined(EN_ATOMICS) || !defined(EN_THREAD_LOCAL)
+#  error entrace.h requires atomics and thread-local storage
+#endif
+
+#if defined(EN_TRACE) && defined(EN_PROFILE)
+#  error EN_TRACE and EN_PROFILE are mutually exclusive
+#endif
+
+#if !defined(EN_TRACE_BUFFER)
+#  define EN_TRACE_BUFFER 4096
+#endif
+
+#if !defined(EN_TRACE_FILE)
+#  define EN_TRACE_FILE "enmem.trace"
+#endif
+
+#define ENTRACE_MAGIC "ENTRACE1"
+
+enum {
+  ENTRACE_MALLOC = 1,
+  ENTRACE_CALLOC,
+  ENTRACE_REALLOC,
+  ENTRACE_FREE
+};
+
+typedef struct {
+  uint64_t timestamp;
+  uint64_t ptr;
+  uint64_t old_ptr;
+  uint64_t nmemb;
+  uint32_t type_size;
+  uint16_t thread;
+  uint8_t op;
+  uint8_t reserved;
+} entrace_record;
+
+typedef struct {
+  char magic[8];
+  uint32_t record_size;
+  uint32_t reserved;
+} entrace_file_header;
+
+typedef struct entrace_thread_ {
+  struct entrace_thread_* next;
+  size_t count;
+  uint16_t id;
+  entrace_record records[EN_TRACE_BUFFER];
+} entrace_thread_;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+extern EN_THREAD_LOCAL entrace_thread_* entrace_self_;
+
+entrace_thread_* entrace_thread_new_(void);
+void entrace_write_(entrace_thread_* self);
+uint64_t entrace_now_(void);
+int entrace_open(const char* path);
+void entrace_flush(void);
+void entrace_close(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+static EN_INLINE void entrace_record_(uint8_t op, uint64_t timestamp, size_t size, size_t nmemb, const void* ptr, uint64_t old_ptr) {
+  entrace_thread_* self = entrace_self_;
+  entrace_record* record;
+
+  if (EN_UNLIKELY(self == NULL)) {
+    self = entrace_thread_new_();
+    if (EN_UNLIKELY(self == NULL))
+      return;
+  }
+
+  record = &(self->records[self->count]);
+  record->timestamp = timestamp;
+  record->ptr = (uint64_t) (uintptr_t) ptr;
+  record->old_ptr = old_ptr;
+  record->nmemb = (uint64_t) nmemb;
+  record->type_size = (uint32_t) size;
+  record->thread = self->id;
+  record->op = op;
+  record->reserved = 0;
+
+  if (EN_UNLIKELY(++(self->count) == EN_TRACE_BUFFER))
+    entrace_write_(self);
+}
+
+static EN_INLINE void* entrace_alloc_(size_t size, size_t nmemb, int zero) {
+  void* ptr = zero ? EN_CALLOC(nmemb, size) : ennewa_(size, nmemb);
+
+  entrace_record_(zero ? ENTRACE_CALLOC : ENTRACE_MALLOC, entrace_now_(), size, nmemb, ptr, 0);
+
+  return ptr;
+}
+
+static EN_INLINE void entrace_free_(void* ptr) {
+  if (ptr == NULL)
+    return;
+
+  entrace_record_(ENTRACE_FREE, entrace_now_(), 0, 0, ptr, 0);
+  EN_FREE(ptr);
+}
+
+static EN_INLINE void* entrace_realloc_(void* ptr, size_t size, size_t nmemb, int resize) {
+  const uint64_t timestamp = entrace_now_();
+  /* Converted before the call since ptr may not be valid after. */
+  const uint64_t old_ptr = (uint64_t) (uintptr_t) ptr;
+  void* res = enrealloc_(ptr, size, nmemb);
+
+  entrace_record_(ENTRACE_REALLOC, timestamp, size, nmemb, res, old_ptr);
+  if (EN_UNLIKELY(res == NULL) && nmemb != 0 && resize)
+    entrace_free_(ptr);
+
+  return res;
+}
+
+static EN_INLINE void entrace_free_sized_(void* ptr, size_t size, size_t nmemb) {
+  if (ptr == NULL)
+    return;
+
+  entrace_record_(ENTRACE_FREE, entrace_now_(), size, nmemb, ptr, 0);
+  enfree_sized_(ptr, size, nmemb);
+}
+
+/* The flexible array sizes are already checked (0 means overflow), so
+   record them as nmemb bytes. */
+static EN_INLINE void* entrace_alloc_flex_(size_t size, int zero) {
+  void* ptr = ennew_flex_(size, zero);
+
+  entrace_record_(zero ? ENTRACE_CALLOC : ENTRACE_MALLOC, entrace_now_(), 1, size, ptr, 0);
+
+  return ptr;
+}
+
+static EN_INLINE void* entrace_realloc_flex_(void* ptr, size_t size, int resize) {
+  if (EN_UNLIKELY(size == 0)) {
+    if (resize)
+      entrace_free_(ptr);
+    return NULL;
+  }
+
+  return entrace_realloc_(ptr, 1, size, resize);
+}
+
+static EN_INLINE void entrace_free_batch_(void* ptrs, size_t count) {
+  size_t i;
+
+  for (i = 0 ; i < count ; i++) {
+    void* ptr;
+    memcpy(&ptr, ((char*) ptrs) + (i * sizeof(void*)), sizeof(void*));
+    entrace_free_(ptr);
+  }
+}
+
+/* Each object gets its own record, so the trace looks the same
+   whether or not EN_MALLOC_BATCH is available. */
+static EN_INLINE int entrace_alloc_batch_(size_t size, void* ptrs, size_t count) {
+  size_t n;
+
+  if (!ennew_batch_(size, ptrs, count))
+    return 0;
+
+  for (n = 0 ; n < count ; n++) {
+    void* ptr;
+    memcpy(&ptr, ((char*) ptrs) + (n * sizeof(void*)), sizeof(void*));
+    entrace_record_(ENTRACE_MALLOC, entrace_now_(), size, 1, ptr, 0);
+  }
+
+  return 1;
+}
+
+static EN_INLINE void entrace_auto_array_free_(void** heap) {
+  if (*heap != NULL) {
+    entrace_free_(*heap);
+    *heap = NULL;
+  }
+}
+
+#if defined(EN_TRACE)
+#  undef EN_AUTO_ARRAY_CLEANUP_
+#  define EN_AUTO_ARRAY_CLEANUP_ entrace_auto_array_free_
+#  undef enfree_sized
+#  undef ennew_batch
+#  undef enfree_batch
+#  undef ennew_flex
+#  undef ennew0_flex
+#  undef enrealloc_flex
+#  undef enresize_flex
+#  undef ennew
+#  undef ennew0
+#  undef ennewa
+#  undef ennewa0
+#  undef enrealloc
+#  undef enresize
+#  if defined(__cplusplus)
+#    define ennew(T) static_cast<T*>(entrace_alloc_(sizeof(T), 1, 0))
+#    define ennew0(T) static_cast<T*>(entrace_alloc_(sizeof(T), 1, 1))
+#    define ennewa(T, nmemb) static_cast<T*>(entrace_alloc_(sizeof(T), nmemb, 0))
+#    define ennewa0(T, nmemb) static_cast<T*>(entrace_alloc_(sizeof(T), nmemb, 1))
+#    define enrealloc(ptr, T, nmemb) static_cast<T*>(entrace_realloc_(EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr)))), sizeof(T), nmemb, 0))
+#    define enresize(ptr, T, nmemb) static_cast<T*>(entrace_realloc_(EN_CHECK_RELOCATABLE_(T, static_cast<void*>(EN_CHECK_TYPE(T, (ptr)))), sizeof(T), nmemb, 1))
+#    define enfree_sized(ptr, T, nmemb) (entrace_free_sized_(static_cast<void*>(EN_CHECK_TYPE(T, (ptr))), sizeof(T), nmemb), static_cast<T*>(NULL))
+#    define ennew_batch(T, count, ptrs) entrace_alloc_batch_(sizeof(T), static_cast<void*>(EN_CHECK_TYPE(T*, (ptrs))), count)
+#    define enfree_batch(ptrs, count) entrace_free_batch_(static_cast<void*>(ptrs), count)
+#    define ennew_flex(Header, member, nmemb) static_cast<Header*>(entrace_alloc_flex_(EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#    define ennew0_flex(Header, member, nmemb) static_cast<Header*>(entrace_alloc_flex_(EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#    define enrealloc_flex(ptr, Header, member, nmemb) static_cast<Header*>(entrace_realloc_flex_(static_cast<void*>(EN_CHECK_TYPE(Header, (ptr))), EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#    define enresize_flex(ptr, Header, member, nmemb) static_cast<Header*>(entrace_realloc_flex_(static_cast<void*>(EN_CHECK_TYPE(Header, (ptr))), EN_FLEX_SIZE_(Header, member, nmemb), 1))
+  template<typename T>
+  static T* enfree(T* ptr) {
+    entrace_free_(static_cast<void*>(ptr));
+    return static_cast<T*>(NULL);
+  }
+#  else
+#    undef enfree
+#    define ennew(T) ((T*) entrace_alloc_(sizeof(T), 1, 0))
+#    define ennew0(T) ((T*) entrace_alloc_(sizeof(T), 1, 1))
+#    define ennewa(T, nmemb) ((T*) entrace_alloc_(sizeof(T), nmemb, 0))
+#    define ennewa0(T, nmemb) ((T*) entrace_alloc_(sizeof(T), nmemb, 1))
+#    define enrealloc(ptr, T, nmemb) ((T*) entrace_realloc_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb, 0))
+#    define enresize(ptr, T, nmemb) ((T*) entrace_realloc_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb, 1))
+#    define enfree_sized(ptr, T, nmemb) (entrace_free_sized_(EN_CHECK_TYPE(T, ptr), sizeof(T), nmemb), (T*) NULL)
+#    define ennew_batch(T, count, ptrs) entrace_alloc_batch_(sizeof(T), EN_CHECK_TYPE(T*, ptrs), count)
+#    define enfree_batch(ptrs, count) entrace_free_batch_(ptrs, count)
+#    define ennew_flex(Header, member, nmemb) ((Header*) entrace_alloc_flex_(EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#    define ennew0_flex(Header, member, nmemb) ((Header*) entrace_alloc_flex_(EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#    define enrealloc_flex(ptr, Header, member, nmemb) ((Header*) entrace_realloc_flex_(EN_CHECK_TYPE(Header, ptr), EN_FLEX_SIZE_(Header, member, nmemb), 0))
+#    define enresize_flex(ptr, Header, member, nmemb) ((Header*) entrace_realloc_flex_(EN_CHECK_TYPE(Header, ptr), EN_FLEX_SIZE_(Header, member, nmemb), 1))
+#    if defined(__GNUC__)
+#      define enfree(ptr) ((__typeof__(*ptr)*) (entrace_free_(ptr), NULL))
+#    else
+#      define enfree(ptr) (entrace_free_(ptr), (void*) NULL)
+#    endif
+#  endif
+#endif
+
+#if defined(EN_TRACE_IMPLEMENTATION)
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+EN_THREAD_LOCAL entrace_thread_* entrace_self_ = NULL;
+
+/* entrace_lock_ protects everything below it. */
+static pthread_mutex_t entrace_lock_ = PTHREAD_MUTEX_INITIALIZER;
+static int entrace_fd_ = -1;
+/* Set once we've tried to open a file, so a failure to open the
+   default one isn't retried on every flush. */
+static int entrace_tried_ = 0;
+static entrace_thread_* entrace_threads_ = NULL;
+static uint16_t entrace_next_id_ = 0;
+
+static pthread_once_t entrace_once_ = PTHREAD_ONCE_INIT;
+static pthread_key_t entrace_key_;
+
+uint64_t entrace_now_(void) {
+  struct timespec ts;
+
+#if defined(CLOCK_MONOTONIC)
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+  timespec_get(&ts, TIME_UTC);
+#endif
+
+  return (((uint64_t) ts.tv_sec) * UINT64_C(1000000000)) + ((uint64_t) ts.tv_nsec);
+}
+
+static void entrace_write_all_(int fd, const void* buf, size_t len) {
+  const char* p = (const char*) buf;
+
+  while (len != 0) {
+    ssize_t r = write(fd, p, len);
+    if (r <= 0)
+      break;
+    p += r;
+    len -= (size_t) r;
+  }
+}
+
+/* Must be called with entrace_lock_ held. */
+static int entrace_open_locked_(const char* path) {
+  entrace_file_header header;
+
+  if (entrace_fd_ >= 0)
+    close(entrace_fd_);
+  entrace_tried_ = 1;
+
+  entrace_fd_ = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (entrace_fd_ < 0)
+    return -1;
+
+  memcpy(header.magic, ENTRACE_MAGIC, sizeof(header.magic));
+  header.record_size = (uint32_t) sizeof(entrace_record);
+  header.reserved = 0;
+  entrace_write_all_(entrace_fd_, &header, sizeof(header));
+
+  return 0;
+}
+
+/* Must be called with entrace_lock_ held. */
+static void entrace_write_locked_(entrace_thread_* self) {
+  if (self->count == 0)
+    return;
+
+  if (entrace_fd_ < 0 && !entrace_tried_) {
+    const char* path = getenv("ENMEM_TRACE");
+    entrace_open_locked_((path != NULL && *path != '\0') ? path : EN_TRACE_FILE);
+  }
+
+  if (entrace_fd_ >= 0)
+    entrace_write_all_(entrace_fd_, self->records, self->count * sizeof(entrace_record));
+  self->count = 0;
+}
+
+void entrace_write_(entrace_thread_* self) {
+  pthread_mutex_lock(&entrace_lock_);
+  entrace_write_locked_(self);
+  pthread_mutex_unlock(&entrace_lock_);
+}
+
+/* Flush and free a thread's buffer when it exits. */
+static void entrace_thread_exit_(void* data) {
+  entrace_thread_* self = (entrace_thread_*) data;
+  entrace_thread_** p;
+
+  pthread_mutex_lock(&entrace_lock_);
+  entrace_write_locked_(self);
+  for (p = &entrace_threads_ ; *p != NULL ; p = &((*p)->next)) {
+    if (*p == self) {
+      *p = self->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&entrace_lock_);
+
+  entrace_self_ = NULL;
+  EN_FREE(self);
+}
+
+static void entrace_init_(void) {
+  pthread_key_create(&entrace_key_, entrace_thread_exit_);
+  atexit(entrace_close);
+}
+
+entrace_thread_* entrace_thread_new_(void) {
+  entrace_thread_* self;
+
+  pthread_once(&entrace_once_, entrace_init_);
+
+  self = (entrace_thread_*) EN_MALLOC(sizeof(entrace_thread_));
+  if (EN_UNLIKELY(self == NULL))
+    return NULL;
+  self->count = 0;
+
+  pthread_mutex_lock(&entrace_lock_);
+  self->id = entrace_next_id_++;
+  self->next = entrace_threads_;
+  entrace_threads_ = self;
+  pthread_mutex_unlock(&entrace_lock_);
+
+  pthread_setspecific(entrace_key_, self);
+  entrace_self_ = self;
+  return self;
+}
+
+int entrace_open(const char* path) {
+  entrace_thread_* self = entrace_self_;
+  int res;
+
+  pthread_mutex_lock(&entrace_lock_);
+  if (self != NULL && entrace_fd_ >= 0)
+    entrace_write_locked_(self);
+  res = entrace_open_locked_(path);
+  pthread_mutex_unlock(&entrace_lock_);
+
+  return res;
+}
+
+void entrace_flush(void) {
+  entrace_thread_* self = entrace_self_;
+
+  if (self != NULL)
+    entrace_write_(self);
+}
+
+void entrace_close(void) {
+  entrace_thread_* thread;
+
+  pthread_mutex_lock(&entrace_lock_);
+  for (thread = entrace_threads_ ; thread != NULL ; thread = thread->next)
+    entrace_write_locked_(thread);
+  if (entrace_fd_ >= 0) {
+    close(entrace_fd_);
+    entrace_fd_ = -1;
+  }
+  pthread_mutex_unlock(&entrace_lock_);
+}
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* defined(EN_TRACE_IMPLEMENTATION) */
+
+#endif /* !defined(ENTRACE_H) */
@@ -0,0 +1,233 @@
+/* Typed dynamic arrays for enmem.h
+ * Code from <https://github.com/nemequ/attic/>
+ *
+ * To the extent possible under law, the author(s) have dedicated all
+ * copyright and related and neighboring rights to this software to
+ * the public domain worldwide. This software is distributed without
+ * any warranty.
+ *
+ * For details see http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ *********************************************************************
+ *
+ * Appending to an array with `ptr = enresize(ptr, T, n + 1)` calls
+ * realloc for every element, which is often a copy, which makes
+ * building an array quadratic. The envec API stores the length and
+ * capacity in a small header in front of the elements and grows the
+ * capacity geometrically, so appends are amortized O(1).
+ *
+ * A vector is just a T* which is NULL when empty, so you can index it
+ * and pass it to functions expecting a T* like any other array:
+ *
+ *   int* v = NULL;
+ *   envec_push(v, int, 1729);
+ *   envec_append(v, int, other, other_len);
+ *   for (size_t i = 0 ; i < envec_len(v) ; i++)
+ *     printf("%d\n", v[i]);
+ *   v = envec_free(v);
+ *
+ * The macros which may reallocate take the vector as an lvalue and
+ * update it in place, so the vector argument is evaluated more than
+ * once; don't pass anything with side effects. Since the pointer may
+ * change, don't keep pointers into the vector across calls which may
+ * grow it.
+ *
+ * Like the rest of enmem, the memory comes from EN_REALLOC/EN_FREE
+ * and every size calculation is checked for overflow. Types with an
+ * alignment requirement larger than 2 * sizeof(size_t) aren't
+ * supported (malloc doesn't support them either). Growing moves the
+ * elements with realloc, so, like enrealloc(), C++11 rejects types
+ * which aren't trivially relocatable at compile time.
+ *
+ *********************************************************************
+ *
+ * size_t envec_len(T* v)
+ * size_t envec_cap(T* v)
+ *
+ *   Number of elements in use and allocated, respectively. Both are 0
+ *   for NULL.
+ *
+ * int envec_reserve(T* v, Type T, size_t nmemb)
+ *
+ *   Make sure there is room for at least nmemb elements without
+ *   reallocating. Returns non-zero on success. On failure v is left
+ *   untouched and errno is set to ENOMEM.
+ *
+ * int envec_push(T* v, Type T, T value)
+ * int envec_append(T* v, Type T, const T* src, size_t nmemb)
+ *
+ *   Append a single element or nmemb elements copied from src. They
+ *   return non-zero on success, 0 (with v untouched) on failure.
+ *
+ * T envec_pop(T* v)
+ *
+ *   Remove the last element and return it. v must not be empty.
+ *
+ * void envec_clear(T* v)
+ *
+ *   Set the length to 0 without releasing any memory.
+ *
+ * int envec_shrink_to_fit(T* v, Type T)
+ *
+ *   Reallocate so that the capacity matches the length. An empty
+ *   vector is freed and set to NULL.
+ *
+ * T* envec_free(T* v)
+ *
+ *   Free the vector and return NULL, like enfree().
+ */
+
+#if !defined(ENVEC_H)
+#define ENVEC_H
+
+#include "enmem.h"
+
+#if !defined(EN_VEC_MIN_CAPACITY)
+#  define EN_VEC_MIN_CAPACITY 4
+#endif
+
+typedef struct {
+  size_t len;
+  size_t cap;
+} envec_header_;
+
+static EN_INLINE envec_header_* envec_header_get_(const void* v) {
+  return ((envec_header_*) v) - 1;
+}
+
+static EN_INLINE size_t envec_len_(const void* v) {
+  return (v != NULL) ? envec_header_get_(v)->len : 0;
+}
+#define envec_len(v) envec_len_(v)
+
+static EN_INLINE size_t envec_cap_(const void* v) {
+  return (v != NULL) ? envec_header_get_(v)->cap : 0;
+}
+#define envec_cap(v) envec_cap_(v)
+
+/* vp is the address of the vector (i.e., a T**).  It is accessed with
+   memcpy so we don't violate strict aliasing. */
+static EN_INLINE int envec_reserve_(void* vp, size_t size, size_t nmemb, int exact) {
+  envec_header_* header;
+  size_t cap, alloc_size;
+  void* v;
+
+  memcpy(&v, vp, sizeof(void*));
+  header = (v != NULL) ? envec_header_get_(v) : NULL;
+  cap = (header != NULL) ? header->cap : 0;
+
+  if (nmemb <= cap && !exact)
+    return 1;
+
+  if (!exact) {
+    if (cap <= (SIZE_MAX - (cap / 2)) && (cap + (cap / 2)) > nmemb)
+      nmemb = cap + (cap / 2);
+    if (nmemb < EN_VEC_MIN_CAPACITY)
+      nmemb = EN_VEC_MIN_CAPACITY;
+  }
+
+  if (EN_UNLIKELY(!enmul_(size, nmemb, &alloc_size)))
+    return 0;
+  if (EN_UNLIKELY(alloc_size > (SIZE_MAX - sizeof(envec_header_)))) {
+    errno = ENOMEM;
+    return 0;
+  }
+
+  header = (envec_header_*) EN_REALLOC(header, sizeof(envec_header_) + alloc_size);
+  if (EN_UNLIKELY(header == NULL))
+    return 0;
+  if (v == NULL)
+    header->len = 0;
+  header->cap = nmemb;
+
+  v = header + 1;
+  memcpy(vp, &v, sizeof(void*));
+
+  return 1;
+}
+
+static EN_INLINE int envec_grow_(void* vp, size_t size, size_t nmemb) {
+  size_t len;
+  void* v;
+
+  memcpy(&v, vp, sizeof(void*));
+  len = envec_len_(v);
+
+  if (EN_LIKELY(v != NULL) && EN_LIKELY(nmemb <= (envec_header_get_(v)->cap - len)))
+    return 1;
+
+  if (EN_UNLIKELY(nmemb > (SIZE_MAX - len))) {
+    errno = ENOMEM;
+    return 0;
+  }
+
+  return envec_reserve_(vp, size, len + nmemb, 0);
+}
+
+static EN_INLINE int envec_append_(void* vp, size_t size, const void* src, size_t nmemb) {
+  envec_header_* header;
+  void* v;
+
+  if (nmemb == 0)
+    return 1;
+
+  if (EN_UNLIKELY(!envec_grow_(vp, size, nmemb)))
+    return 0;
+
+  memcpy(&v, vp, sizeof(void*));
+  header = envec_header_get_(v);
+  memcpy(((char*) v) + (header->len * size), src, nmemb * size);
+  header->len += nmemb;
+
+  return 1;
+}
+
+static EN_INLINE int envec_shrink_to_fit_(void* vp, size_t size) {
+  void* v;
+
+  memcpy(&v, vp, sizeof(void*));
+  if (v == NULL)
+    return 1;
+
+  if (envec_header_get_(v)->len == 0) {
+    EN_FREE(envec_header_get_(v));
+    v = NULL;
+    memcpy(vp, &v, sizeof(void*));
+    return 1;
+  }
+
+  return envec_reserve_(vp, size, envec_header_get_(v)->len, 1);
+}
+
+static EN_INLINE void envec_free_(void* v) {
+  if (v != NULL)
+    EN_FREE(envec_header_get_(v));
+}
+
+#define envec_reserve(v, T, nmemb) \
+  ((void) EN_CHECK_TYPE(T, (v)), envec_reserve_(EN_CHECK_RELOCATABLE_(T, (void*) &(v)), sizeof(T), nmemb, 0))
+#define envec_push(v, T, value) \
+  ((void) EN_CHECK_TYPE(T, (v)), \
+   (envec_grow_(EN_CHECK_RELOCATABLE_(T, (void*) &(v)), sizeof(T), 1) ? \
+     ((v)[envec_header_get_(v)->len++] = (value), 1) : 0))
+#define envec_append(v, T, src, nmemb) \
+  ((void) EN_CHECK_TYPE(T, (v)), (void) EN_CHECK_TYPE(T, (src)), \
+   envec_append_(EN_CHECK_RELOCATABLE_(T, (void*) &(v)), sizeof(T), (src), nmemb))
+#define envec_pop(v) ((v)[--(envec_header_get_(v)->len)])
+#define envec_clear(v) ((void) ((v) != NULL ? (envec_header_get_(v)->len = 0) : 0))
+#define envec_shrink_to_fit(v, T) \
+  ((void) EN_CHECK_TYPE(T, (v)), envec_shrink_to_fit_(EN_CHECK_RELOCATABLE_(T, (void*) &(v)), sizeof(T)))
+
+#if defined(__cplusplus)
+  template<typename T>
+  static T* envec_free(T* v) {
+    envec_free_(static_cast<void*>(v));
+    return static_cast<T*>(NULL);
+  }
+#elif defined(__GNUC__)
+#  define envec_free(v) ((__typeof__(*v)*) (envec_free_(v), NULL))
+#else
+#  define envec_free(v) (envec_free_(v), (void*) NULL)
+#endif
+
+#endif /* !defined(ENVEC_H) */
@@ -0,0 +1,186 @@
+/* Tests for is_constant.h. You shouldn't need this file unless you're
+   working on is_constant.h itself.
+
+   Most of the checks happen at compile time, so if it compiles (and
+   runs without an assertion failure) everything is working. It
+   should be built as C and as several versions of C++, with every
+   compiler you can find:
+
+     cc -std=c99 -o is_constant is_constant.c
+     cc -std=c11 -o is_constant is_constant.c
+     c++ -x c++ -std=c++98 -o is_constant is_constant.c
+     c++ -x c++ -std=c++11 -o is_constant is_constant.c
+     c++ -x c++ -std=c++14 -o is_constant is_constant.c
+     c++ -x c++ -std=c++20 -msse4.2 -mpopcnt -o is_constant is_constant.c
+
+   The last one makes sure CONSTEXPR_SELECT doesn't use the runtime
+   versions at compile time; _mm_popcnt_u32 and _mm_crc32_u8 aren't
+   allowed in constant expressions.
+
+   The dual-mode functions here (popcount, clz, bswap, and CRC-32C)
+   are also meant as examples of how to use CONSTEXPR_SELECT. The
+   compile-time versions are written as a single return statement so
+   they work with C++11 constexpr. */
+
+#include "is_constant.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#if defined(__POPCNT__) || defined(__SSE4_2__)
+#  include <nmmintrin.h>
+#endif
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+#  define TEST_CONSTEXPR constexpr
+#  define TEST_STATIC_ASSERT(expr) static_assert(expr, #expr)
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#  define TEST_CONSTEXPR
+#  define TEST_STATIC_ASSERT(expr) _Static_assert(expr, #expr)
+#else
+#  define TEST_CONSTEXPR
+#  define TEST_STATIC_ASSERT_(expr, line) typedef char test_static_assert_##line[(expr) ? 1 : -1]
+#  define TEST_STATIC_ASSERT_X_(expr, line) TEST_STATIC_ASSERT_(expr, line)
+#  define TEST_STATIC_ASSERT(expr) TEST_STATIC_ASSERT_X_(expr, __LINE__)
+#endif
+
+/* Dual-mode functions */
+
+static TEST_CONSTEXPR uint32_t popcount_portable(uint32_t v) {
+  return (v == 0) ? 0 : ((v & 1) + popcount_portable(v >> 1));
+}
+
+static uint32_t popcount_runtime(uint32_t v) {
+#if defined(__POPCNT__)
+  return (uint32_t) _mm_popcnt_u32(v);
+#elif defined(__GNUC__)
+  return (uint32_t) __builtin_popcount(v);
+#else
+  return popcount_portable(v);
+#endif
+}
+
+static TEST_CONSTEXPR uint32_t popcount(uint32_t v) {
+  return CONSTEXPR_SELECT(popcount_portable(v), popcount_runtime(v));
+}
+
+static TEST_CONSTEXPR uint32_t clz_portable(uint32_t v) {
+  return (v & UINT32_C(0x80000000)) ? 0 : (v == 0) ? 32 : (1 + clz_portable(v << 1));
+}
+
+static uint32_t clz_runtime(uint32_t v) {
+#if defined(__GNUC__)
+  return (v == 0) ? 32 : (uint32_t) __builtin_clz(v);
+#else
+  return clz_portable(v);
+#endif
+}
+
+static TEST_CONSTEXPR uint32_t clz(uint32_t v) {
+  return CONSTEXPR_SELECT(clz_portable(v), clz_runtime(v));
+}
+
+static TEST_CONSTEXPR uint32_t bswap_portable(uint32_t v) {
+  return ((v & 0xff) << 24) | ((v & 0xff00) << 8) | ((v >> 8) & 0xff00) | (v >> 24);
+}
+
+static uint32_t bswap_runtime(uint32_t v) {
+#if defined(__GNUC__)
+  return __builtin_bswap32(v);
+#else
+  return bswap_portable(v);
+#endif
+}
+
+static TEST_CONSTEXPR uint32_t bswap(uint32_t v) {
+  return CONSTEXPR_SELECT(bswap_portable(v), bswap_runtime(v));
+}
+
+/* CRC-32C, one bit at a time at compile time, and with the SSE4.2
+   instruction at run time if it's available. */
+static TEST_CONSTEXPR uint32_t crc32c_bits_(uint32_t crc, int bits) {
+  return (bits == 0) ? crc : crc32c_bits_((crc >> 1) ^ ((crc & 1) ? UINT32_C(0x82f63b78) : 0), bits - 1);
+}
+
+static TEST_CONSTEXPR uint32_t crc32c_portable_(uint32_t crc, const char* s) {
+  return (*s == '\0') ? crc : crc32c_portable_(crc32c_bits_(crc ^ (uint8_t) *s, 8), s + 1);
+}
+
+static TEST_CONSTEXPR uint32_t crc32c_portable(const char* s) {
+  return ~crc32c_portable_(~UINT32_C(0), s);
+}
+
+static uint32_t crc32c_runtime(const char* s) {
+  uint32_t crc = ~UINT32_C(0);
+
+  for ( ; *s != '\0' ; s++) {
+#if defined(__SSE4_2__)
+    crc = _mm_crc32_u8(crc, (unsigned char) *s);
+#else
+    crc = crc32c_bits_(crc ^ (uint8_t) *s, 8);
+#endif
+  }
+
+  return ~crc;
+}
+
+static TEST_CONSTEXPR uint32_t crc32c(const char* s) {
+  return CONSTEXPR_SELECT(crc32c_portable(s), crc32c_runtime(s));
+}
+
+/* Compile-time checks */
+
+enum { CONSTANT = 42 };
+
+TEST_STATIC_ASSERT(IS_CONSTANT(CONSTANT * 2));
+TEST_STATIC_ASSERT(REQUIRE_CONSTEXPR(CONSTANT) == CONSTANT);
+#if defined(IS_CONSTEXPR)
+TEST_STATIC_ASSERT(IS_CONSTEXPR(CONSTANT + 1));
+TEST_STATIC_ASSERT(IS_CONSTEXPR(sizeof(int)));
+#endif
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+static_assert(popcount(0) == 0, "popcount");
+static_assert(popcount(UINT32_C(0xf0f0f0f1)) == 17, "popcount");
+static_assert(clz(0) == 32 && clz(1) == 31 && clz(UINT32_C(0x80000000)) == 0, "clz");
+static_assert(bswap(UINT32_C(0x11223344)) == UINT32_C(0x44332211), "bswap");
+static_assert(crc32c("123456789") == UINT32_C(0xe3069283), "crc32c");
+#endif
+
+static volatile int runtime_value = 7;
+
+int main(void) {
+  int x = runtime_value;
+  uint32_t v = 1;
+  int i;
+
+  (void) x;
+
+  assert(IS_CONSTANT(CONSTANT));
+#if defined(IS_CONSTEXPR)
+  assert(IS_CONSTEXPR(CONSTANT));
+  assert(!IS_CONSTEXPR(x));
+  assert(!IS_CONSTEXPR(runtime_value));
+#endif
+  assert(REQUIRE_CONSTEXPR(CONSTANT) == CONSTANT);
+#if defined(IS_CONSTEXPR) && !defined(__SUNPRO_C)
+  assert(REQUIRE_CONSTEXPR(x) == -1);
+#endif
+
+  /* At run time the results have to match the portable versions. */
+  for (i = 0 ; i < 1000 ; i++) {
+    uint32_t s;
+
+    v = (v * UINT32_C(1664525)) + UINT32_C(1013904223);
+    s = v >> (i % 32);
+    assert(popcount(s) == popcount_portable(s));
+    assert(clz(s) == clz_portable(s));
+    assert(bswap(s) == bswap_portable(s));
+  }
+  assert(clz((uint32_t) runtime_value - 7) == 32);
+  assert(crc32c("123456789") == UINT32_C(0xe3069283));
+  assert(crc32c("") == 0);
+  assert(crc32c("The quick brown fox jumps over the lazy dog") == crc32c_portable("The quick brown fox jumps over the lazy dog"));
+
+  return 0;
+}
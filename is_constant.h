@@ -42,6 +42,34 @@
  *         CONST_FOLDABLE_MACRO(expr) :
  *         fast_runtime_func(expr);
  *
+ * - IS_CONSTANT_EVALUATED(): C++ only. Return true if the call is
+ *     being evaluated at compile time (i.e., in a constant
+ *     expression), false if it is running at run time. This is
+ *     std::is_constant_evaluated() where available, or the
+ *     __builtin_is_constant_evaluated() it is built on (GCC >= 9 and
+ *     clang >= 9, in any C++ mode); otherwise the macro is undefined.
+ *     Like std::is_constant_evaluated(), it is always true in `if
+ *     constexpr` and static_assert.
+ *
+ * - CONSTEXPR_SELECT(compile_time, run_time): Evaluate
+ *     `compile_time` in constant expressions and `run_time` otherwise.
+ *     This lets constexpr functions use intrinsics (or anything else
+ *     which isn't allowed in constant expressions) when they are
+ *     called at run time. Without IS_CONSTANT_EVALUATED this is
+ *     always `compile_time` in C++, which is correct but may be
+ *     slower, and always `run_time` in C, which doesn't have constexpr
+ *     functions. This macro is always available.
+ *
+ *     Usage:
+ *
+ *       constexpr unsigned popcount_portable(unsigned v) {
+ *         return (v == 0) ? 0 : ((v & 1) + popcount_portable(v >> 1));
+ *       }
+ *
+ *       constexpr unsigned popcount(unsigned v) {
+ *         return CONSTEXPR_SELECT(popcount_portable(v), _mm_popcnt_u32(v));
+ *       }
+ *
  * - DIAGNOSTIC_ERROR_VLA: Try to ask the compiler to emit an error if
  *     a VLA is encountered. The advantage is that this doesn't
  *     require modifications to existing code. The disadvantages are
@@ -50,6 +78,13 @@
  *     and that using conformant array parameters will trigger the
  *     diagnostic. This is always available, but may do nothing on
  *     some compilers.
+ *
+ * In C++ IS_CONSTEXPR is implemented by evaluating
+ * __builtin_constant_p in a template argument, which forces the
+ * compiler to answer right away, so it is only available where
+ * __builtin_constant_p is. Expressions which the compiler folds
+ * early, like `x * 0`, may be considered constant in C++ even though
+ * they aren't in C.
  */
 
 #if !defined(IS_CONSTANT_H)
@@ -70,6 +105,18 @@
 #    include <stdint.h>
 #    define IS_CONSTEXPR(expr) _Generic((1 ? (void*) ((intptr_t) ((expr) * 0)) : (int*) 0), int*: 1, void*: 0)
 #  endif
+#elif defined(__cplusplus)
+/* IS_CONSTANT is only defined at this point if __builtin_constant_p
+   is available. */
+#  if defined(IS_CONSTANT)
+extern "C++" {
+  template <bool Constant> struct is_constant_bool_ { enum { value = Constant ? 1 : 0 }; };
+}
+#    define IS_CONSTEXPR(expr) (is_constant_bool_<__builtin_constant_p(expr) ? true : false>::value)
+#  else
+#    define IS_CONSTANT(expr) (0)
+#    define REQUIRE_CONSTEXPR(expr) (expr)
+#  endif
 #elif /* Compilers known to support sizeof(void) */ \
   defined(__GNUC__) || \
   defined(__INTEL_COMPILER) || \
@@ -100,6 +147,33 @@
 #  define REQUIRE_CONSTEXPR(expr) (IS_CONSTEXPR(expr) ? (expr) : (-1))
 #endif
 
+#if defined(__cplusplus)
+#  if defined(__has_include) && (__cplusplus >= 202002L)
+#    if __has_include(<type_traits>)
+#      include <type_traits>
+#    endif
+#  endif
+#  if defined(__has_builtin)
+#    if __has_builtin(__builtin_is_constant_evaluated)
+#      define IS_CONSTANT_BUILTIN_IS_CONSTANT_EVALUATED_
+#    endif
+#  endif
+#  if defined(__cpp_lib_is_constant_evaluated)
+#    define IS_CONSTANT_EVALUATED() (std::is_constant_evaluated())
+#  elif defined(IS_CONSTANT_BUILTIN_IS_CONSTANT_EVALUATED_) || \
+  (defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 9))
+#    define IS_CONSTANT_EVALUATED() (__builtin_is_constant_evaluated())
+#  endif
+#endif
+
+#if defined(IS_CONSTANT_EVALUATED)
+#  define CONSTEXPR_SELECT(compile_time, run_time) (IS_CONSTANT_EVALUATED() ? (compile_time) : (run_time))
+#elif defined(__cplusplus)
+#  define CONSTEXPR_SELECT(compile_time, run_time) (compile_time)
+#else
+#  define CONSTEXPR_SELECT(compile_time, run_time) (run_time)
+#endif
+
 #if defined(__has_warning)
 #  if __has_warning("-Wvla")
 #    define DIAGNOSTIC_ERROR_VLA _Pragma("clang diagnostic error \"-Wvla\"")
@@ -0,0 +1,747 @@
+/* Tests for neon-generic.h (and neon-x86.h). Like enmem.c, you
+   shouldn't need this file unless you're working on the headers.
+
+   Every operation is run on random inputs and each lane is compared
+   with a scalar implementation of the NEON semantics, so the results
+   should be the same whether the intrinsics come from arm_neon.h or
+   from neon-x86.h. To cover all the neon-x86.h backends, build it a
+   few ways:
+
+     cc -std=c11 -o neon-generic neon-generic.c
+     cc -std=c11 -mavx2 -o neon-generic-avx2 neon-generic.c
+     cc -std=c11 -DNEON_X86_SCALAR -o neon-generic-scalar neon-generic.c
+
+   It also builds as C++ (c++ -x c++ neon-generic.c), which tests the
+   overloads and neon_generic_vec instead of the _Generic macros.
+
+   The kernels in neon-kernels.h are tested here too, against their
+   _scalar versions.
+*/
+
+#include "neon-generic.h"
+#include "neon-kernels.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ITERATIONS 1000
+
+static uint64_t rng_state = UINT64_C(0x9E3779B97F4A7C15);
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+/* Random bits, which covers overflow and the extremes of every type. */
+static void fill_int(void* buf, size_t size) {
+  unsigned char* p = (unsigned char*) buf;
+  size_t i;
+
+  for (i = 0 ; i < size ; i++)
+    p[i] = (unsigned char) rng();
+}
+
+/* Small multiples of 1/8, so the results are exact and don't depend
+   on rounding (or NaN propagation, which differs between ARM and
+   x86). */
+static void fill_f32(void* buf, size_t size) {
+  float32_t* p = (float32_t*) buf;
+  size_t i;
+
+  for (i = 0 ; i < (size / sizeof(float32_t)) ; i++)
+    p[i] = (float32_t) (((int) (rng() % 2001) - 1000) / 8.0);
+}
+
+#if defined(NEON_GENERIC_AARCH64)
+static void fill_f64(void* buf, size_t size) {
+  float64_t* p = (float64_t*) buf;
+  size_t i;
+
+  for (i = 0 ; i < (size / sizeof(float64_t)) ; i++)
+    p[i] = ((int) (rng() % 2001) - 1000) / 8.0;
+}
+#endif
+
+/* Equal, or both NaN. */
+#define SAME(a, b) (((a) == (b)) || (((a) != (a)) && ((b) != (b))))
+
+/* Run op on random inputs (from fill) for the d or q type with lanes
+   elements of type a_t and compare every lane of the result (of type
+   r_t) with expect(a, b).  The loads and stores go through the generic
+   vld1/vst1 too. */
+#define CHECK_OP_(op, a_t, b_t, r_t, lanes, q, fill, expect) \
+  do { \
+    a_t a[lanes]; \
+    b_t b[lanes]; \
+    r_t r[lanes]; \
+    int i, iter; \
+    for (iter = 0 ; iter < ITERATIONS ; iter++) { \
+      fill(a, sizeof(a)); \
+      fill(b, sizeof(b)); \
+      vst1(r, op(vld1##q(a), vld1##q(b))); \
+      for (i = 0 ; i < (lanes) ; i++) \
+        assert(SAME(r[i], (r_t) expect(a[i], b[i]))); \
+    } \
+  } while (0)
+#define CHECK_BINARY(op, lane_t, nd, nq, fill, expect) \
+  do { \
+    CHECK_OP_(op, lane_t, lane_t, lane_t, nd, , fill, expect); \
+    CHECK_OP_(op, lane_t, lane_t, lane_t, nq, q, fill, expect); \
+  } while (0)
+
+/* Comparisons return all ones where true. */
+#define CHECK_COMPARE_(op, lane_t, mask_t, lanes, q, fill, cond) \
+  do { \
+    lane_t a[lanes], b[lanes]; \
+    mask_t r[lanes]; \
+    int i, iter; \
+    for (iter = 0 ; iter < ITERATIONS ; iter++) { \
+      fill(a, sizeof(a)); \
+      fill(b, sizeof(b)); \
+      /* Make sure equal values are tested too. */ \
+      a[0] = b[0]; \
+      vst1(r, op(vld1##q(a), vld1##q(b))); \
+      for (i = 0 ; i < (lanes) ; i++) \
+        assert(r[i] == (cond(a[i], b[i]) ? (mask_t) -1 : 0)); \
+    } \
+  } while (0)
+#define CHECK_COMPARE(op, lane_t, mask_t, nd, nq, fill, cond) \
+  do { \
+    CHECK_COMPARE_(op, lane_t, mask_t, nd, , fill, cond); \
+    CHECK_COMPARE_(op, lane_t, mask_t, nq, q, fill, cond); \
+  } while (0)
+#define CHECK_COMPARES(lane_t, mask_t, nd, nq, fill) \
+  do { \
+    CHECK_COMPARE(vceq, lane_t, mask_t, nd, nq, fill, EQ); \
+    CHECK_COMPARE(vcge, lane_t, mask_t, nd, nq, fill, GE); \
+    CHECK_COMPARE(vcgt, lane_t, mask_t, nd, nq, fill, GT); \
+    CHECK_COMPARE(vcle, lane_t, mask_t, nd, nq, fill, LE); \
+    CHECK_COMPARE(vclt, lane_t, mask_t, nd, nq, fill, LT); \
+  } while (0)
+
+/* Scalar reference implementations.  Signed arithmetic is done on the
+   unsigned type so it wraps like NEON instead of overflowing. */
+#define ADD_8(a, b)  ((uint8_t) ((uint8_t) (a) + (uint8_t) (b)))
+#define ADD_16(a, b) ((uint16_t) ((uint16_t) (a) + (uint16_t) (b)))
+#define ADD_32(a, b) ((uint32_t) (a) + (uint32_t) (b))
+#define ADD_64(a, b) ((uint64_t) (a) + (uint64_t) (b))
+#define ADD_f(a, b)  ((a) + (b))
+#define SUB_8(a, b)  ((uint8_t) ((uint8_t) (a) - (uint8_t) (b)))
+#define SUB_16(a, b) ((uint16_t) ((uint16_t) (a) - (uint16_t) (b)))
+#define SUB_32(a, b) ((uint32_t) (a) - (uint32_t) (b))
+#define SUB_64(a, b) ((uint64_t) (a) - (uint64_t) (b))
+#define SUB_f(a, b)  ((a) - (b))
+#define MUL_8(a, b)  ((uint8_t) (1u * (uint8_t) (a) * (uint8_t) (b)))
+#define MUL_16(a, b) ((uint16_t) (1u * (uint16_t) (a) * (uint16_t) (b)))
+#define MUL_32(a, b) ((uint32_t) (a) * (uint32_t) (b))
+#define MUL_f(a, b)  ((a) * (b))
+#define DIV_f(a, b)  ((a) / (b))
+#define MIN(a, b)    (((a) < (b)) ? (a) : (b))
+#define MAX(a, b)    (((a) > (b)) ? (a) : (b))
+#define EQ(a, b)     ((a) == (b))
+#define GE(a, b)     ((a) >= (b))
+#define GT(a, b)     ((a) > (b))
+#define LE(a, b)     ((a) <= (b))
+#define LT(a, b)     ((a) < (b))
+#define AND(a, b)    ((a) & (b))
+#define ORR(a, b)    ((a) | (b))
+#define EOR(a, b)    ((a) ^ (b))
+#define BIC(a, b)    ((a) & ~(b))
+
+static void test_add(void) {
+  CHECK_BINARY(vadd, int8_t,    8, 16, fill_int, ADD_8);
+  CHECK_BINARY(vadd, int16_t,   4,  8, fill_int, ADD_16);
+  CHECK_BINARY(vadd, int32_t,   2,  4, fill_int, ADD_32);
+  CHECK_BINARY(vadd, int64_t,   1,  2, fill_int, ADD_64);
+  CHECK_BINARY(vadd, uint8_t,   8, 16, fill_int, ADD_8);
+  CHECK_BINARY(vadd, uint16_t,  4,  8, fill_int, ADD_16);
+  CHECK_BINARY(vadd, uint32_t,  2,  4, fill_int, ADD_32);
+  CHECK_BINARY(vadd, uint64_t,  1,  2, fill_int, ADD_64);
+  CHECK_BINARY(vadd, float32_t, 2,  4, fill_f32, ADD_f);
+#if defined(NEON_GENERIC_AARCH64)
+  CHECK_BINARY(vadd, float64_t, 1,  2, fill_f64, ADD_f);
+
+  assert(vadd((int64_t) INT64_MAX, (int64_t) 1) == INT64_MIN);
+  assert(vadd((uint64_t) UINT64_MAX, (uint64_t) 2) == 1);
+#endif
+}
+
+static void test_arithmetic(void) {
+  CHECK_BINARY(vsub, int8_t,    8, 16, fill_int, SUB_8);
+  CHECK_BINARY(vsub, int16_t,   4,  8, fill_int, SUB_16);
+  CHECK_BINARY(vsub, int32_t,   2,  4, fill_int, SUB_32);
+  CHECK_BINARY(vsub, int64_t,   1,  2, fill_int, SUB_64);
+  CHECK_BINARY(vsub, uint8_t,   8, 16, fill_int, SUB_8);
+  CHECK_BINARY(vsub, uint16_t,  4,  8, fill_int, SUB_16);
+  CHECK_BINARY(vsub, uint32_t,  2,  4, fill_int, SUB_32);
+  CHECK_BINARY(vsub, uint64_t,  1,  2, fill_int, SUB_64);
+  CHECK_BINARY(vsub, float32_t, 2,  4, fill_f32, SUB_f);
+
+  CHECK_BINARY(vmul, int8_t,    8, 16, fill_int, MUL_8);
+  CHECK_BINARY(vmul, int16_t,   4,  8, fill_int, MUL_16);
+  CHECK_BINARY(vmul, int32_t,   2,  4, fill_int, MUL_32);
+  CHECK_BINARY(vmul, uint8_t,   8, 16, fill_int, MUL_8);
+  CHECK_BINARY(vmul, uint16_t,  4,  8, fill_int, MUL_16);
+  CHECK_BINARY(vmul, uint32_t,  2,  4, fill_int, MUL_32);
+  CHECK_BINARY(vmul, float32_t, 2,  4, fill_f32, MUL_f);
+
+  CHECK_BINARY(vmin, int8_t,    8, 16, fill_int, MIN);
+  CHECK_BINARY(vmin, int16_t,   4,  8, fill_int, MIN);
+  CHECK_BINARY(vmin, int32_t,   2,  4, fill_int, MIN);
+  CHECK_BINARY(vmin, uint8_t,   8, 16, fill_int, MIN);
+  CHECK_BINARY(vmin, uint16_t,  4,  8, fill_int, MIN);
+  CHECK_BINARY(vmin, uint32_t,  2,  4, fill_int, MIN);
+  CHECK_BINARY(vmin, float32_t, 2,  4, fill_f32, MIN);
+
+  CHECK_BINARY(vmax, int8_t,    8, 16, fill_int, MAX);
+  CHECK_BINARY(vmax, int16_t,   4,  8, fill_int, MAX);
+  CHECK_BINARY(vmax, int32_t,   2,  4, fill_int, MAX);
+  CHECK_BINARY(vmax, uint8_t,   8, 16, fill_int, MAX);
+  CHECK_BINARY(vmax, uint16_t,  4,  8, fill_int, MAX);
+  CHECK_BINARY(vmax, uint32_t,  2,  4, fill_int, MAX);
+  CHECK_BINARY(vmax, float32_t, 2,  4, fill_f32, MAX);
+
+#if defined(NEON_GENERIC_AARCH64)
+  CHECK_BINARY(vsub, float64_t, 1,  2, fill_f64, SUB_f);
+  CHECK_BINARY(vmul, float64_t, 1,  2, fill_f64, MUL_f);
+  CHECK_BINARY(vmin, float64_t, 1,  2, fill_f64, MIN);
+  CHECK_BINARY(vmax, float64_t, 1,  2, fill_f64, MAX);
+  CHECK_BINARY(vdiv, float32_t, 2,  4, fill_f32, DIV_f);
+  CHECK_BINARY(vdiv, float64_t, 1,  2, fill_f64, DIV_f);
+
+  assert(vsub((int64_t) INT64_MIN, (int64_t) 1) == INT64_MAX);
+  assert(vsub((uint64_t) 0, (uint64_t) 1) == UINT64_MAX);
+#endif
+
+  {
+    /* vmin/vmax return NaN if either input is NaN, and -0.0 < 0.0. */
+    float32_t a[4] = { 1.0f, 0.0f, -0.0f, 2.0f };
+    float32_t b[4] = { 0.0f, -0.0f, 0.0f, 2.0f };
+    float32_t r[4];
+
+    a[3] = b[3] = 0.0f;
+    a[3] = a[3] / b[3];
+    vst1q_f32(r, vmin(vld1q_f32(a), vld1q_f32(b)));
+    assert(r[0] == 0.0f && r[3] != r[3]);
+    assert(r[1] == 0.0f && signbit(r[1]) && signbit(r[2]));
+    vst1q_f32(r, vmax(vld1q_f32(a), vld1q_f32(b)));
+    assert(r[0] == 1.0f && r[3] != r[3]);
+    assert(r[1] == 0.0f && !signbit(r[1]) && !signbit(r[2]));
+    vst1q_f32(r, vmax(vld1q_f32(b), vld1q_f32(a)));
+    assert(r[3] != r[3]);
+  }
+}
+
+#define MLA_8(a, b, c)  ((uint8_t) ((uint8_t) (a) + MUL_8(b, c)))
+#define MLA_16(a, b, c) ((uint16_t) ((uint16_t) (a) + MUL_16(b, c)))
+#define MLA_32(a, b, c) ((uint32_t) (a) + MUL_32(b, c))
+#define MLA_f(a, b, c)  ((a) + ((b) * (c)))
+
+#define CHECK_MLA_(lane_t, lanes, q, fill, expect) \
+  do { \
+    lane_t a[lanes], b[lanes], c[lanes], r[lanes]; \
+    int i, iter; \
+    for (iter = 0 ; iter < ITERATIONS ; iter++) { \
+      fill(a, sizeof(a)); \
+      fill(b, sizeof(b)); \
+      fill(c, sizeof(c)); \
+      vst1(r, vmla(vld1##q(a), vld1##q(b), vld1##q(c))); \
+      for (i = 0 ; i < (lanes) ; i++) \
+        assert(r[i] == (lane_t) expect(a[i], b[i], c[i])); \
+    } \
+  } while (0)
+#define CHECK_MLA(lane_t, nd, nq, fill, expect) \
+  do { \
+    CHECK_MLA_(lane_t, nd, , fill, expect); \
+    CHECK_MLA_(lane_t, nq, q, fill, expect); \
+  } while (0)
+
+static void test_mla(void) {
+  CHECK_MLA(int8_t,    8, 16, fill_int, MLA_8);
+  CHECK_MLA(int16_t,   4,  8, fill_int, MLA_16);
+  CHECK_MLA(int32_t,   2,  4, fill_int, MLA_32);
+  CHECK_MLA(uint8_t,   8, 16, fill_int, MLA_8);
+  CHECK_MLA(uint16_t,  4,  8, fill_int, MLA_16);
+  CHECK_MLA(uint32_t,  2,  4, fill_int, MLA_32);
+  CHECK_MLA(float32_t, 2,  4, fill_f32, MLA_f);
+#if defined(NEON_GENERIC_AARCH64)
+  CHECK_MLA(float64_t, 1,  2, fill_f64, MLA_f);
+#endif
+}
+
+static void test_compare(void) {
+  CHECK_COMPARES(int8_t,    uint8_t,   8, 16, fill_int);
+  CHECK_COMPARES(int16_t,   uint16_t,  4,  8, fill_int);
+  CHECK_COMPARES(int32_t,   uint32_t,  2,  4, fill_int);
+  CHECK_COMPARES(uint8_t,   uint8_t,   8, 16, fill_int);
+  CHECK_COMPARES(uint16_t,  uint16_t,  4,  8, fill_int);
+  CHECK_COMPARES(uint32_t,  uint32_t,  2,  4, fill_int);
+  CHECK_COMPARES(float32_t, uint32_t,  2,  4, fill_f32);
+#if defined(NEON_GENERIC_AARCH64)
+  CHECK_COMPARES(int64_t,   uint64_t,  1,  2, fill_int);
+  CHECK_COMPARES(uint64_t,  uint64_t,  1,  2, fill_int);
+  CHECK_COMPARES(float64_t, uint64_t,  1,  2, fill_f64);
+#endif
+
+  {
+    /* Comparisons with NaN are false. */
+    float32_t zero = 0.0f;
+    float32x4_t nan = vdupq_n_f32(zero / zero);
+
+    assert(vgetq_lane_u32(vceq(nan, nan), 0) == 0);
+    assert(vgetq_lane_u32(vcge(nan, vdupq_n_f32(zero)), 1) == 0);
+    assert(vgetq_lane_u32(vcle(nan, vdupq_n_f32(zero)), 2) == 0);
+  }
+}
+
+#define CHECK_BITWISE(lane_t, nd, nq) \
+  do { \
+    CHECK_BINARY(vand, lane_t, nd, nq, fill_int, AND); \
+    CHECK_BINARY(vorr, lane_t, nd, nq, fill_int, ORR); \
+    CHECK_BINARY(veor, lane_t, nd, nq, fill_int, EOR); \
+    CHECK_BINARY(vbic, lane_t, nd, nq, fill_int, BIC); \
+  } while (0)
+
+static void test_bitwise(void) {
+  CHECK_BITWISE(int8_t,   8, 16);
+  CHECK_BITWISE(int16_t,  4,  8);
+  CHECK_BITWISE(int32_t,  2,  4);
+  CHECK_BITWISE(int64_t,  1,  2);
+  CHECK_BITWISE(uint8_t,  8, 16);
+  CHECK_BITWISE(uint16_t, 4,  8);
+  CHECK_BITWISE(uint32_t, 2,  4);
+  CHECK_BITWISE(uint64_t, 1,  2);
+
+  assert(vget_lane_s8(vmvn(vdup_n_s8(5)), 3) == ~5);
+  assert(vgetq_lane_u16(vmvn(vdupq_n_u16(0x00ff)), 7) == 0xff00);
+  assert(vgetq_lane_u32(vmvn(vdupq_n_u32(0)), 0) == UINT32_MAX);
+}
+
+/* NEON shift semantics: the count is signed and negative counts shift
+   right; everything is shifted out for counts of at least the lane
+   width, leaving 0 (or -1 for negative signed values). */
+static uint64_t shl_ref(int64_t a, int width, int is_signed, int count) {
+  if (count >= 0)
+    return (count >= width) ? 0 : ((uint64_t) a << count);
+
+  count = -count;
+  if (is_signed) {
+    if (count >= width)
+      count = width - 1;
+    return (uint64_t) ((a < 0) ? ~(~a >> count) : (a >> count));
+  } else {
+    return (count >= width) ? 0 : ((uint64_t) a >> count);
+  }
+}
+
+#define SHL_s8(a, b)  shl_ref(a,  8, 1, (int8_t) (b))
+#define SHL_s16(a, b) shl_ref(a, 16, 1, (int8_t) (b))
+#define SHL_s32(a, b) shl_ref(a, 32, 1, (int8_t) (b))
+#define SHL_s64(a, b) shl_ref(a, 64, 1, (int8_t) (b))
+#define SHL_u8(a, b)  shl_ref(a,  8, 0, (int8_t) (b))
+#define SHL_u16(a, b) shl_ref(a, 16, 0, (int8_t) (b))
+#define SHL_u32(a, b) shl_ref(a, 32, 0, (int8_t) (b))
+#define SHL_u64(a, b) shl_ref((int64_t) (a), 64, 0, (int8_t) (b))
+
+/* Shift counts are random bytes, but mostly in [-width, width] so the
+   in-range shifts get tested too. */
+static void fill_count(void* buf, size_t size, int width) {
+  unsigned char* p = (unsigned char*) buf;
+  size_t i;
+
+  fill_int(buf, size);
+  for (i = 0 ; i < size ; i += (size_t) (width / 8)) {
+    if (rng() % 4 != 0)
+      p[i] = (unsigned char) ((int) (rng() % (unsigned) (2 * width + 1)) - width);
+  }
+}
+#define fill_count_8(buf, size)  fill_count(buf, size, 8)
+#define fill_count_16(buf, size) fill_count(buf, size, 16)
+#define fill_count_32(buf, size) fill_count(buf, size, 32)
+#define fill_count_64(buf, size) fill_count(buf, size, 64)
+
+#define CHECK_SHL_(lane_t, count_t, width, lanes, q, expect) \
+  do { \
+    lane_t a[lanes], r[lanes]; \
+    count_t b[lanes]; \
+    int i, iter; \
+    for (iter = 0 ; iter < ITERATIONS ; iter++) { \
+      fill_int(a, sizeof(a)); \
+      fill_count_##width(b, sizeof(b)); \
+      vst1(r, vshl(vld1##q(a), vld1##q(b))); \
+      for (i = 0 ; i < (lanes) ; i++) \
+        assert(r[i] == (lane_t) expect(a[i], b[i])); \
+    } \
+  } while (0)
+#define CHECK_SHL(lane_t, count_t, width, nd, nq, expect) \
+  do { \
+    CHECK_SHL_(lane_t, count_t, width, nd, , expect); \
+    CHECK_SHL_(lane_t, count_t, width, nq, q, expect); \
+  } while (0)
+
+/* The shift count of vshl_n and vshr_n has to be a constant. */
+#define CHECK_SHIFT_N_(op, lane_t, lanes, q, n, count, expect) \
+  do { \
+    lane_t a[lanes], r[lanes]; \
+    int i, iter; \
+    for (iter = 0 ; iter < ITERATIONS ; iter++) { \
+      fill_int(a, sizeof(a)); \
+      vst1(r, op(vld1##q(a), n)); \
+      for (i = 0 ; i < (lanes) ; i++) \
+        assert(r[i] == (lane_t) expect(a[i], count)); \
+    } \
+  } while (0)
+#define CHECK_SHIFT_N(lane_t, width, nd, nq, expect) \
+  do { \
+    CHECK_SHIFT_N_(vshl_n, lane_t, nd, , 1, 1, expect); \
+    CHECK_SHIFT_N_(vshl_n, lane_t, nq, q, (width) - 1, (width) - 1, expect); \
+    CHECK_SHIFT_N_(vshr_n, lane_t, nd, , 1, -1, expect); \
+    CHECK_SHIFT_N_(vshr_n, lane_t, nq, q, 3, -3, expect); \
+    CHECK_SHIFT_N_(vshr_n, lane_t, nd, , width, -(width), expect); \
+    CHECK_SHIFT_N_(vshr_n, lane_t, nq, q, width, -(width), expect); \
+  } while (0)
+
+static void test_shift(void) {
+  CHECK_SHL(int8_t,   int8_t,   8, 8, 16, SHL_s8);
+  CHECK_SHL(int16_t,  int16_t, 16, 4,  8, SHL_s16);
+  CHECK_SHL(int32_t,  int32_t, 32, 2,  4, SHL_s32);
+  CHECK_SHL(int64_t,  int64_t, 64, 1,  2, SHL_s64);
+  CHECK_SHL(uint8_t,  int8_t,   8, 8, 16, SHL_u8);
+  CHECK_SHL(uint16_t, int16_t, 16, 4,  8, SHL_u16);
+  CHECK_SHL(uint32_t, int32_t, 32, 2,  4, SHL_u32);
+  CHECK_SHL(uint64_t, int64_t, 64, 1,  2, SHL_u64);
+
+  CHECK_SHIFT_N(int8_t,    8, 8, 16, SHL_s8);
+  CHECK_SHIFT_N(int16_t,  16, 4,  8, SHL_s16);
+  CHECK_SHIFT_N(int32_t,  32, 2,  4, SHL_s32);
+  CHECK_SHIFT_N(int64_t,  64, 1,  2, SHL_s64);
+  CHECK_SHIFT_N(uint8_t,   8, 8, 16, SHL_u8);
+  CHECK_SHIFT_N(uint16_t, 16, 4,  8, SHL_u16);
+  CHECK_SHIFT_N(uint32_t, 32, 2,  4, SHL_u32);
+  CHECK_SHIFT_N(uint64_t, 64, 1,  2, SHL_u64);
+}
+
+/* vldN puts element j of every group of n in val[j]; vstN is the
+   inverse. */
+#define CHECK_LDST_(n, lane_t, lanes, q, fill) \
+  do { \
+    lane_t in[(n) * (lanes)], out[(n) * (lanes)], lane[lanes]; \
+    int i, j, iter; \
+    for (iter = 0 ; iter < 100 ; iter++) { \
+      fill(in, sizeof(in)); \
+      for (j = 0 ; j < (n) ; j++) { \
+        vst1(lane, vld##n##q(in).val[j]); \
+        for (i = 0 ; i < (lanes) ; i++) \
+          assert(SAME(lane[i], in[(i * (n)) + j])); \
+      } \
+      memset(out, 0, sizeof(out)); \
+      vst##n(out, vld##n##q(in)); \
+      assert(memcmp(in, out, sizeof(in)) == 0); \
+    } \
+  } while (0)
+#define CHECK_LDST(lane_t, nd, nq, fill) \
+  do { \
+    CHECK_LDST_(2, lane_t, nd, , fill); \
+    CHECK_LDST_(3, lane_t, nd, , fill); \
+    CHECK_LDST_(4, lane_t, nd, , fill); \
+    CHECK_LDST_(2, lane_t, nq, q, fill); \
+    CHECK_LDST_(3, lane_t, nq, q, fill); \
+    CHECK_LDST_(4, lane_t, nq, q, fill); \
+  } while (0)
+
+static void test_memory(void) {
+  int16_t in[9] = { 0, 1, -2, 3, INT16_MIN, 5, INT16_MAX, 7, 8 };
+  int16_t out[9] = { 0, };
+
+  /* Unaligned loads and stores, and lane order. */
+  vst1q_s16(out + 1, vld1q_s16(in + 1));
+  assert(memcmp(in + 1, out + 1, sizeof(int16_t) * 8) == 0);
+  assert(vgetq_lane_s16(vld1q_s16(in + 1), 0) == 1);
+  assert(vgetq_lane_s16(vld1q_s16(in + 1), 7) == 8);
+  assert(vget_lane_s16(vld1_s16(in), 2) == -2);
+  assert(vget_lane(vld1q(in + 1), 3) == INT16_MIN);
+
+  assert(vgetq_lane_u32(vdupq_n_u32(UINT32_MAX), 3) == UINT32_MAX);
+  assert(vget_lane_f32(vdup_n_f32(1.5f), 1) == 1.5f);
+  assert(vget_lane(vdupq_n((uint8_t) 200), 15) == 200);
+  assert(vget_lane(vdup_n(-7.5f), 0) == -7.5f);
+
+  {
+    /* Splitting packed RGB into planes. */
+    uint8_t rgb[48];
+    uint8x16x3_t planes;
+    int i;
+
+    for (i = 0 ; i < 48 ; i++)
+      rgb[i] = (uint8_t) i;
+    planes = vld3q(rgb);
+    assert(vgetq_lane_u8(planes.val[0], 0) == 0);
+    assert(vgetq_lane_u8(planes.val[1], 1) == 4);
+    assert(vgetq_lane_u8(planes.val[2], 15) == 47);
+  }
+
+  CHECK_LDST(int8_t,    8, 16, fill_int);
+  CHECK_LDST(int16_t,   4,  8, fill_int);
+  CHECK_LDST(int32_t,   2,  4, fill_int);
+  CHECK_LDST(uint8_t,   8, 16, fill_int);
+  CHECK_LDST(uint16_t,  4,  8, fill_int);
+  CHECK_LDST(uint32_t,  2,  4, fill_int);
+  CHECK_LDST(float32_t, 2,  4, fill_f32);
+#if defined(NEON_GENERIC_AARCH64)
+  CHECK_LDST(int64_t,   1,  2, fill_int);
+  CHECK_LDST(uint64_t,  1,  2, fill_int);
+  CHECK_LDST(float64_t, 1,  2, fill_f64);
+#endif
+}
+
+#if defined(NEON_GENERIC_AARCH64)
+/* Fold the lanes with expect, in the lane type. */
+#define CHECK_REDUCE_(op, lane_t, lanes, q, fill, expect) \
+  do { \
+    lane_t a[lanes], r; \
+    int i, iter; \
+    for (iter = 0 ; iter < ITERATIONS ; iter++) { \
+      fill(a, sizeof(a)); \
+      r = a[0]; \
+      for (i = 1 ; i < (lanes) ; i++) \
+        r = (lane_t) expect(r, a[i]); \
+      assert(op(vld1##q(a)) == r); \
+    } \
+  } while (0)
+#define CHECK_REDUCE(op, lane_t, nd, nq, fill, expect) \
+  do { \
+    CHECK_REDUCE_(op, lane_t, nd, , fill, expect); \
+    CHECK_REDUCE_(op, lane_t, nq, q, fill, expect); \
+  } while (0)
+#define CHECK_REDUCES(lane_t, nd, nq, fill, add) \
+  do { \
+    CHECK_REDUCE(vaddv, lane_t, nd, nq, fill, add); \
+    CHECK_REDUCE(vmaxv, lane_t, nd, nq, fill, MAX); \
+    CHECK_REDUCE(vminv, lane_t, nd, nq, fill, MIN); \
+  } while (0)
+
+static void test_reduce(void) {
+  CHECK_REDUCES(int8_t,    8, 16, fill_int, ADD_8);
+  CHECK_REDUCES(int16_t,   4,  8, fill_int, ADD_16);
+  CHECK_REDUCES(int32_t,   2,  4, fill_int, ADD_32);
+  CHECK_REDUCES(uint8_t,   8, 16, fill_int, ADD_8);
+  CHECK_REDUCES(uint16_t,  4,  8, fill_int, ADD_16);
+  CHECK_REDUCES(uint32_t,  2,  4, fill_int, ADD_32);
+  CHECK_REDUCES(float32_t, 2,  4, fill_f32, ADD_f);
+  CHECK_REDUCE_(vaddv, int64_t,   2, q, fill_int, ADD_64);
+  CHECK_REDUCE_(vaddv, uint64_t,  2, q, fill_int, ADD_64);
+  CHECK_REDUCE_(vaddv, float64_t, 2, q, fill_f64, ADD_f);
+  CHECK_REDUCE_(vmaxv, float64_t, 2, q, fill_f64, MAX);
+  CHECK_REDUCE_(vminv, float64_t, 2, q, fill_f64, MIN);
+}
+#endif
+
+/* Lengths around each of the kernels' loop boundaries, starting at
+   an unaligned offset. */
+static const size_t kernel_lengths[] = { 0, 1, 3, 4, 5, 15, 16, 17, 63, 64, 65, 79, 1000 };
+#define KERNEL_MAX 1024
+#define KERNEL_OFFSET 3
+
+static void test_kernels(void) {
+  float32_t fx[KERNEL_MAX + KERNEL_OFFSET], fy[KERNEL_MAX + KERNEL_OFFSET], fz[KERNEL_MAX + KERNEL_OFFSET];
+  uint8_t bx[KERNEL_MAX + KERNEL_OFFSET], by[KERNEL_MAX + KERNEL_OFFSET];
+  uint32_t hist[256], hist_ref[256];
+  size_t l, i;
+  int it;
+
+  for (it = 0 ; it < 10 ; it++) {
+    for (l = 0 ; l < (sizeof(kernel_lengths) / sizeof(kernel_lengths[0])) ; l++) {
+      const size_t n = kernel_lengths[l];
+      float32_t* x = fx + KERNEL_OFFSET;
+      float32_t* y = fy + KERNEL_OFFSET;
+      float32_t* z = fz + KERNEL_OFFSET;
+      uint8_t* b = bx + KERNEL_OFFSET;
+      uint8_t* c = by + KERNEL_OFFSET;
+
+      /* The float data are multiples of 1/8 and y is a small integer,
+         so sums and dot products are exact in any order. */
+      fill_f32(fx, sizeof(fx));
+      for (i = 0 ; i < (sizeof(fy) / sizeof(fy[0])) ; i++)
+        fy[i] = (float32_t) (rng() % 8);
+
+      assert(neon_kernel_sum_f32(x, n) == neon_kernel_sum_f32_scalar(x, n));
+      assert(neon_kernel_min_f32(x, n) == neon_kernel_min_f32_scalar(x, n));
+      assert(neon_kernel_max_f32(x, n) == neon_kernel_max_f32_scalar(x, n));
+      assert(neon_kernel_dot_f32(x, y, n) == neon_kernel_dot_f32_scalar(x, y, n));
+      if (n > 0) {
+        x[rng() % n] = (float32_t) NAN;
+        assert(isnan(neon_kernel_min_f32(x, n)) && isnan(neon_kernel_max_f32(x, n)));
+      }
+
+      fill_f32(fx, sizeof(fx));
+      memcpy(fz, fy, sizeof(fz));
+      neon_kernel_saxpy_f32(y, 0.5f, x, n);
+      neon_kernel_saxpy_f32_scalar(z, 0.5f, x, n);
+      assert(memcmp(fy, fz, sizeof(fy)) == 0);
+
+      memset(fy, 0, sizeof(fy));
+      memset(fz, 0, sizeof(fz));
+      neon_kernel_fill_f32(y, 1.5f, n);
+      neon_kernel_fill_f32_scalar(z, 1.5f, n);
+      assert(memcmp(fy, fz, sizeof(fy)) == 0);
+
+      memset(bx, 0, sizeof(bx));
+      memset(by, 0, sizeof(by));
+      neon_kernel_fill_u8(b, 0xa5, n);
+      neon_kernel_fill_u8_scalar(c, 0xa5, n);
+      assert(memcmp(bx, by, sizeof(bx)) == 0);
+
+      /* Few distinct values, so matches are found at all positions. */
+      for (i = 0 ; i < sizeof(bx) ; i++)
+        bx[i] = (uint8_t) (rng() % 64);
+      for (i = 0 ; i < 64 ; i++)
+        assert(neon_kernel_find_u8(b, (uint8_t) i, n) == neon_kernel_find_u8_scalar(b, (uint8_t) i, n));
+      assert(neon_kernel_find_u8(b, 0xff, n) == NULL);
+
+      fill_int(bx, sizeof(bx));
+      memset(hist, 0, sizeof(hist));
+      memset(hist_ref, 0, sizeof(hist_ref));
+      neon_kernel_histogram_u8(hist, b, n);
+      neon_kernel_histogram_u8_scalar(hist_ref, b, n);
+      assert(memcmp(hist, hist_ref, sizeof(hist)) == 0);
+    }
+  }
+
+  assert(neon_kernel_min_f32(fx, 0) == (float32_t) INFINITY);
+  assert(neon_kernel_max_f32(fx, 0) == (float32_t) -INFINITY);
+}
+
+#if defined(__cplusplus)
+typedef neon_generic_vec<float32x4_t> f32x4;
+typedef neon_generic_vec<int16x8_t> s16x8;
+typedef neon_generic_vec<uint32x4_t> u32x4;
+
+static void test_cxx(void) {
+  float32_t x[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+  float32_t y[4] = { 0.5f, 0.5f, 0.5f, -0.5f };
+  int16_t s[8] = { -3, -2, -1, 0, 1, 2, 3, INT16_MIN };
+  uint16_t mask[8];
+  int i;
+
+  assert((neon_generic_traits<int16x8_t>::lanes == 8));
+  assert((neon_generic_traits<uint8x8_t>::lanes == 8));
+  assert((neon_generic_traits<float32x2_t>::lanes == 2));
+  assert(sizeof(neon_generic_traits<uint64x1_t>::lane_type) == 8);
+  assert(sizeof(f32x4) == sizeof(float32x4_t));
+
+  (f32x4::load(x) * f32x4::dup(2.0f) + f32x4::load(y)).store(y);
+  assert(y[0] == 2.5f && y[3] == 7.5f);
+  assert((f32x4::load(y) - f32x4::load(x)).get<1>() == 2.5f);
+
+  (s16x8::load(s) < s16x8::dup(0)).store(mask);
+  for (i = 0 ; i < 8 ; i++)
+    assert(mask[i] == ((s[i] < 0) ? 0xffff : 0));
+  assert((s16x8::load(s) >> 1).get<0>() == -2);
+  assert((s16x8::load(s) << 1).get<7>() == 0);
+  assert((~s16x8::load(s)).get<2>() == 0);
+
+  {
+    u32x4 v = u32x4::dup(6);
+    v += u32x4::dup(1);
+    v *= v;
+    v &= u32x4::dup(0xff);
+    v ^= u32x4::dup(1);
+    assert(v.get<3>() == 48);
+    assert(vgetq_lane_u32(v == u32x4::dup(48), 0) == UINT32_MAX);
+  }
+}
+
+/* The overloads and operators should compile to the same code as the
+   intrinsics they wrap.  Each codegen_*_intrin function has a
+   codegen_*_generic (overloads) and codegen_*_vec (neon_generic_vec)
+   twin; to compare them:
+
+     c++ -O2 -c -x c++ -o neon-generic.o neon-generic.c
+     for f in axpy select shift sum; do
+       for v in intrin generic vec; do
+         objdump -d --no-show-raw-insn --disassemble=codegen_${f}_$v neon-generic.o |
+           sed -e '1,/>:$/d' -e 's/^ *[0-9a-f]*:\t//' -e 's/[0-9a-f]* <.*>$//' > $v.s
+       done
+       cmp intrin.s generic.s && cmp intrin.s vec.s || echo "$f differs"
+     done
+*/
+extern "C" {
+
+void codegen_axpy_intrin(float32_t* y, const float32_t* a, const float32_t* x) {
+  vst1q_f32(y, vaddq_f32(vmulq_f32(vld1q_f32(a), vld1q_f32(x)), vld1q_f32(y)));
+}
+void codegen_axpy_generic(float32_t* y, const float32_t* a, const float32_t* x) {
+  vst1(y, vadd(vmul(vld1q(a), vld1q(x)), vld1q(y)));
+}
+void codegen_axpy_vec(float32_t* y, const float32_t* a, const float32_t* x) {
+  (f32x4::load(a) * f32x4::load(x) + f32x4::load(y)).store(y);
+}
+
+void codegen_select_intrin(uint16_t* r, const int16_t* a, const int16_t* b) {
+  vst1q_u16(r, vandq_u16(vcgtq_s16(vld1q_s16(a), vld1q_s16(b)), vld1q_u16(r)));
+}
+void codegen_select_generic(uint16_t* r, const int16_t* a, const int16_t* b) {
+  vst1(r, vand(vcgt(vld1q(a), vld1q(b)), vld1q(r)));
+}
+void codegen_select_vec(uint16_t* r, const int16_t* a, const int16_t* b) {
+  ((s16x8::load(a) > s16x8::load(b)) & neon_generic_vec<uint16x8_t>::load(r)).store(r);
+}
+
+void codegen_shift_intrin(uint32_t* r) {
+  vst1q_u32(r, vshlq_u32(vld1q_u32(r), vdupq_n_s32(3)));
+}
+void codegen_shift_generic(uint32_t* r) {
+  vst1(r, vshl(vld1q(r), vdupq_n((int32_t) 3)));
+}
+void codegen_shift_vec(uint32_t* r) {
+  (u32x4::load(r) << 3).store(r);
+}
+
+void codegen_sum_intrin(uint32_t* out, const uint32_t* in, size_t n) {
+  uint32x4_t acc = vdupq_n_u32(0);
+  size_t i;
+  for (i = 0 ; i + 4 <= n ; i += 4)
+    acc = vaddq_u32(acc, vld1q_u32(in + i));
+  vst1q_u32(out, acc);
+}
+void codegen_sum_generic(uint32_t* out, const uint32_t* in, size_t n) {
+  uint32x4_t acc = vdupq_n((uint32_t) 0);
+  size_t i;
+  for (i = 0 ; i + 4 <= n ; i += 4)
+    acc = vadd(acc, vld1q(in + i));
+  vst1(out, acc);
+}
+void codegen_sum_vec(uint32_t* out, const uint32_t* in, size_t n) {
+  u32x4 acc = u32x4::dup(0);
+  size_t i;
+  for (i = 0 ; i + 4 <= n ; i += 4)
+    acc += u32x4::load(in + i);
+  acc.store(out);
+}
+
+}
+#endif
+
+int main(void) {
+  test_memory();
+  test_add();
+  test_arithmetic();
+  test_mla();
+  test_compare();
+  test_bitwise();
+  test_shift();
+#if defined(NEON_GENERIC_AARCH64)
+  test_reduce();
+#endif
+  test_kernels();
+#if defined(__cplusplus)
+  test_cxx();
+#endif
+
+  return 0;
+}
@@ -6,71 +6,595 @@
  * based on the argument(s). For example, instead of writing
  * `vaddq_s16(a, b)`, you can just write `vadd(a, b)`.
  *
+ * On targets without NEON (or if you define NEON_GENERIC_NO_NATIVE)
+ * the types and intrinsics come from neon-x86.h instead of
+ * arm_neon.h, which implements them with SSE2/AVX2 on x86 and plain C
+ * elsewhere, so the same code can run on ARM and x86. neon-generic.c
+ * checks the results lane by lane.
+ *
+ * Most aliases select on the type of the first vector argument, so
+ * vadd covers vadd_s8 through vaddq_f64. The exceptions are the loads
+ * (vld1, vld1q, vld2, vld2q, etc.) and vdup_n/vdupq_n, which select on
+ * the element type, and the interleaving stores (vst2, vst3, vst4),
+ * which select on the vector array type. Aliases for AArch64-only
+ * intrinsics (float64x*_t, 64-bit comparisons, vdiv, and the
+ * across-vector reductions vaddv, vmaxv, and vminv) are only
+ * available when NEON_GENERIC_AARCH64 is defined.
+ *
+ * C++ doesn't have _Generic, so there the same names are overloaded
+ * inline functions which compile to exactly the intrinsic they call.
+ * C++ also gets neon_generic_traits<V> (lane type, lane count, mask
+ * type) and neon_generic_vec<V>, a thin wrapper with operators.
+ *
+ * vshl_n, vshr_n, and vget_lane need the intrinsics to be functions,
+ * which they are in GCC's arm_neon.h and neon-x86.h; clang implements
+ * the immediate forms as macros.
+ *
  * I'm not sure when, or if, I'll finish this, so if someone else
  * wants to pick it up please feel free. There is a list of functions
  * at <https://developer.arm.com/technologies/neon/intrinsics>.
  */
 
-#include <arm_neon.h>
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(NEON_GENERIC_NO_NATIVE)
+#  include <arm_neon.h>
+#else
+#  include "neon-x86.h"
+#endif
 
 #if !defined(NEON_GENERIC_H)
 #define NEON_GENERIC_H
 
-#if defined(__aarch64__) || defined(_M_ARM64)
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(NEON_X86_H)
 #  define NEON_GENERIC_AARCH64
 #endif
 
 #define NEON_GENERIC_FUNC_X(pfx, name, sfx) pfx##name##sfx
 #define NEON_GENERIC_FUNC(name, sfx) NEON_GENERIC_FUNC_X(v, name, sfx)
 
+#if !defined(__cplusplus)
+
+/* Cases to include only on AArch64; put them after at least one other
+   group of cases. */
+#if defined(NEON_GENERIC_AARCH64)
+#  define NEON_GENERIC_A64_(...) , __VA_ARGS__
+#else
+#  define NEON_GENERIC_A64_(...)
+#endif
+
+/* Groups of _Generic cases.  For name add they select vadd_s8,
+   vaddq_s8, etc.; mid goes between the q and the type suffix, so
+   (shl, _n) selects vshl_n_s8 and vshlq_n_s8. */
+#define NEON_GENERIC_CASES_I8_32_(name, mid)        \
+  int8x8_t:    NEON_GENERIC_FUNC(name,    mid##_s8), \
+  int8x16_t:   NEON_GENERIC_FUNC(name, q##mid##_s8), \
+  int16x4_t:   NEON_GENERIC_FUNC(name,    mid##_s16), \
+  int16x8_t:   NEON_GENERIC_FUNC(name, q##mid##_s16), \
+  int32x2_t:   NEON_GENERIC_FUNC(name,    mid##_s32), \
+  int32x4_t:   NEON_GENERIC_FUNC(name, q##mid##_s32), \
+  uint8x8_t:   NEON_GENERIC_FUNC(name,    mid##_u8), \
+  uint8x16_t:  NEON_GENERIC_FUNC(name, q##mid##_u8), \
+  uint16x4_t:  NEON_GENERIC_FUNC(name,    mid##_u16), \
+  uint16x8_t:  NEON_GENERIC_FUNC(name, q##mid##_u16), \
+  uint32x2_t:  NEON_GENERIC_FUNC(name,    mid##_u32), \
+  uint32x4_t:  NEON_GENERIC_FUNC(name, q##mid##_u32)
+#define NEON_GENERIC_CASES_I64_(name, mid)          \
+  int64x1_t:   NEON_GENERIC_FUNC(name,    mid##_s64), \
+  int64x2_t:   NEON_GENERIC_FUNC(name, q##mid##_s64), \
+  uint64x1_t:  NEON_GENERIC_FUNC(name,    mid##_u64), \
+  uint64x2_t:  NEON_GENERIC_FUNC(name, q##mid##_u64)
+#define NEON_GENERIC_CASES_F32_(name, mid)          \
+  float32x2_t: NEON_GENERIC_FUNC(name,    mid##_f32), \
+  float32x4_t: NEON_GENERIC_FUNC(name, q##mid##_f32)
+#define NEON_GENERIC_CASES_F64_(name, mid)          \
+  float64x1_t: NEON_GENERIC_FUNC(name,    mid##_f64), \
+  float64x2_t: NEON_GENERIC_FUNC(name, q##mid##_f64)
+#define NEON_GENERIC_CASES_INT_(name, mid)          \
+  NEON_GENERIC_CASES_I8_32_(name, mid),             \
+  NEON_GENERIC_CASES_I64_(name, mid)
+
+/* Cases selecting on the element type, for loads and vdup_n.  The
+   interleaving q loads of 64-bit elements are AArch64-only. */
+#define NEON_GENERIC_CASES_LANE_8_32_(name)          \
+  int8_t:      NEON_GENERIC_FUNC(name, _s8),         \
+  int16_t:     NEON_GENERIC_FUNC(name, _s16),        \
+  int32_t:     NEON_GENERIC_FUNC(name, _s32),        \
+  uint8_t:     NEON_GENERIC_FUNC(name, _u8),         \
+  uint16_t:    NEON_GENERIC_FUNC(name, _u16),        \
+  uint32_t:    NEON_GENERIC_FUNC(name, _u32),        \
+  float32_t:   NEON_GENERIC_FUNC(name, _f32)
+#define NEON_GENERIC_CASES_LANE_(name)               \
+  NEON_GENERIC_CASES_LANE_8_32_(name),               \
+  int64_t:     NEON_GENERIC_FUNC(name, _s64),        \
+  uint64_t:    NEON_GENERIC_FUNC(name, _u64)         \
+  NEON_GENERIC_A64_(float64_t: NEON_GENERIC_FUNC(name, _f64))
+#define NEON_GENERIC_CASES_LANE_XNQ_(name)           \
+  NEON_GENERIC_CASES_LANE_8_32_(name)                \
+  NEON_GENERIC_A64_(                                 \
+    int64_t:   NEON_GENERIC_FUNC(name, _s64),        \
+    uint64_t:  NEON_GENERIC_FUNC(name, _u64),        \
+    float64_t: NEON_GENERIC_FUNC(name, _f64))
+
+/* Cases selecting on arrays of n vectors, for vst2, vst3, and vst4. */
+#define NEON_GENERIC_CASES_XN_(name, n)              \
+  int8x8x##n##_t:    NEON_GENERIC_FUNC(name,  _s8),  \
+  int8x16x##n##_t:   NEON_GENERIC_FUNC(name, q_s8),  \
+  int16x4x##n##_t:   NEON_GENERIC_FUNC(name,  _s16), \
+  int16x8x##n##_t:   NEON_GENERIC_FUNC(name, q_s16), \
+  int32x2x##n##_t:   NEON_GENERIC_FUNC(name,  _s32), \
+  int32x4x##n##_t:   NEON_GENERIC_FUNC(name, q_s32), \
+  int64x1x##n##_t:   NEON_GENERIC_FUNC(name,  _s64), \
+  uint8x8x##n##_t:   NEON_GENERIC_FUNC(name,  _u8),  \
+  uint8x16x##n##_t:  NEON_GENERIC_FUNC(name, q_u8),  \
+  uint16x4x##n##_t:  NEON_GENERIC_FUNC(name,  _u16), \
+  uint16x8x##n##_t:  NEON_GENERIC_FUNC(name, q_u16), \
+  uint32x2x##n##_t:  NEON_GENERIC_FUNC(name,  _u32), \
+  uint32x4x##n##_t:  NEON_GENERIC_FUNC(name, q_u32), \
+  uint64x1x##n##_t:  NEON_GENERIC_FUNC(name,  _u64), \
+  float32x2x##n##_t: NEON_GENERIC_FUNC(name,  _f32), \
+  float32x4x##n##_t: NEON_GENERIC_FUNC(name, q_f32)  \
+  NEON_GENERIC_A64_(                                 \
+    int64x2x##n##_t:   NEON_GENERIC_FUNC(name, q_s64), \
+    uint64x2x##n##_t:  NEON_GENERIC_FUNC(name, q_u64), \
+    float64x1x##n##_t: NEON_GENERIC_FUNC(name,  _f64), \
+    float64x2x##n##_t: NEON_GENERIC_FUNC(name, q_f64))
+
+/* Arithmetic */
+
+#define vadd(a, b)                            \
+  _Generic((a),                               \
+    NEON_GENERIC_CASES_INT_(add, ),           \
+    NEON_GENERIC_CASES_F32_(add, )            \
+    NEON_GENERIC_A64_(                        \
+      NEON_GENERIC_CASES_F64_(add, ),         \
+      int64_t:  NEON_GENERIC_FUNC(add, d_s64), \
+      uint64_t: NEON_GENERIC_FUNC(add, d_u64)) \
+  )(a, b)
+
+#define vsub(a, b)                            \
+  _Generic((a),                               \
+    NEON_GENERIC_CASES_INT_(sub, ),           \
+    NEON_GENERIC_CASES_F32_(sub, )            \
+    NEON_GENERIC_A64_(                        \
+      NEON_GENERIC_CASES_F64_(sub, ),         \
+      int64_t:  NEON_GENERIC_FUNC(sub, d_s64), \
+      uint64_t: NEON_GENERIC_FUNC(sub, d_u64)) \
+  )(a, b)
+
+#define vmul(a, b)                            \
+  _Generic((a),                               \
+    NEON_GENERIC_CASES_I8_32_(mul, ),         \
+    NEON_GENERIC_CASES_F32_(mul, )            \
+    NEON_GENERIC_A64_(NEON_GENERIC_CASES_F64_(mul, )) \
+  )(a, b)
+
+/* a + (b * c) */
+#define vmla(a, b, c)                         \
+  _Generic((a),                               \
+    NEON_GENERIC_CASES_I8_32_(mla, ),         \
+    NEON_GENERIC_CASES_F32_(mla, )            \
+    NEON_GENERIC_A64_(NEON_GENERIC_CASES_F64_(mla, )) \
+  )(a, b, c)
+
+#if defined(NEON_GENERIC_AARCH64)
+#  define vdiv(a, b)                          \
+  _Generic((a),                               \
+    NEON_GENERIC_CASES_F32_(div, ),           \
+    NEON_GENERIC_CASES_F64_(div, )            \
+  )(a, b)
+#endif
+
+#define vmin(a, b)                            \
+  _Generic((a),                               \
+    NEON_GENERIC_CASES_I8_32_(min, ),         \
+    NEON_GENERIC_CASES_F32_(min, )            \
+    NEON_GENERIC_A64_(NEON_GENERIC_CASES_F64_(min, )) \
+  )(a, b)
+
+#define vmax(a, b)                            \
+  _Generic((a),                               \
+    NEON_GENERIC_CASES_I8_32_(max, ),         \
+    NEON_GENERIC_CASES_F32_(max, )            \
+    NEON_GENERIC_A64_(NEON_GENERIC_CASES_F64_(max, )) \
+  )(a, b)
+
+/* Comparisons; the result is an unsigned vector with all bits of each
+   lane set where the comparison is true. */
+
+#define NEON_GENERIC_COMPARE_(name, a, b)     \
+  _Generic((a),                               \
+    NEON_GENERIC_CASES_I8_32_(name, ),        \
+    NEON_GENERIC_CASES_F32_(name, )           \
+    NEON_GENERIC_A64_(                        \
+      NEON_GENERIC_CASES_I64_(name, ),        \
+      NEON_GENERIC_CASES_F64_(name, ))        \
+  )(a, b)
+
+#define vceq(a, b) NEON_GENERIC_COMPARE_(ceq, a, b)
+#define vcge(a, b) NEON_GENERIC_COMPARE_(cge, a, b)
+#define vcgt(a, b) NEON_GENERIC_COMPARE_(cgt, a, b)
+#define vcle(a, b) NEON_GENERIC_COMPARE_(cle, a, b)
+#define vclt(a, b) NEON_GENERIC_COMPARE_(clt, a, b)
+
+/* Bitwise */
+
+#define vand(a, b) _Generic((a), NEON_GENERIC_CASES_INT_(and, ))(a, b)
+#define vorr(a, b) _Generic((a), NEON_GENERIC_CASES_INT_(orr, ))(a, b)
+#define veor(a, b) _Generic((a), NEON_GENERIC_CASES_INT_(eor, ))(a, b)
+/* a & ~b */
+#define vbic(a, b) _Generic((a), NEON_GENERIC_CASES_INT_(bic, ))(a, b)
+#define vmvn(a) _Generic((a), NEON_GENERIC_CASES_I8_32_(mvn, ))(a)
+
+/* Shifts.  vshl shifts each lane of a by the signed value in the
+   corresponding lane of b (negative values shift right); vshl_n and
+   vshr_n shift by a constant. */
+
+#define vshl(a, b) _Generic((a), NEON_GENERIC_CASES_INT_(shl, ))(a, b)
+#define vshl_n(a, n) _Generic((a), NEON_GENERIC_CASES_INT_(shl, _n))(a, n)
+#define vshr_n(a, n) _Generic((a), NEON_GENERIC_CASES_INT_(shr, _n))(a, n)
+
+/* Loads and stores.  The loads select on the element type, so pass a
+   pointer to the right type (e.g., not char* for int8_t). */
+
+#define vld1(ptr)  _Generic(*(ptr), NEON_GENERIC_CASES_LANE_(ld1))(ptr)
+#define vld1q(ptr) _Generic(*(ptr), NEON_GENERIC_CASES_LANE_(ld1q))(ptr)
+#define vld2(ptr)  _Generic(*(ptr), NEON_GENERIC_CASES_LANE_(ld2))(ptr)
+#define vld2q(ptr) _Generic(*(ptr), NEON_GENERIC_CASES_LANE_XNQ_(ld2q))(ptr)
+#define vld3(ptr)  _Generic(*(ptr), NEON_GENERIC_CASES_LANE_(ld3))(ptr)
+#define vld3q(ptr) _Generic(*(ptr), NEON_GENERIC_CASES_LANE_XNQ_(ld3q))(ptr)
+#define vld4(ptr)  _Generic(*(ptr), NEON_GENERIC_CASES_LANE_(ld4))(ptr)
+#define vld4q(ptr) _Generic(*(ptr), NEON_GENERIC_CASES_LANE_XNQ_(ld4q))(ptr)
+
+#define vst1(ptr, v)                          \
+  _Generic((v),                               \
+    NEON_GENERIC_CASES_INT_(st1, ),           \
+    NEON_GENERIC_CASES_F32_(st1, )            \
+    NEON_GENERIC_A64_(NEON_GENERIC_CASES_F64_(st1, )) \
+  )(ptr, v)
+#define vst2(ptr, v) _Generic((v), NEON_GENERIC_CASES_XN_(st2, 2))(ptr, v)
+#define vst3(ptr, v) _Generic((v), NEON_GENERIC_CASES_XN_(st3, 3))(ptr, v)
+#define vst4(ptr, v) _Generic((v), NEON_GENERIC_CASES_XN_(st4, 4))(ptr, v)
+
+/* Lanes */
+
+#define vdup_n(value)  _Generic((value), NEON_GENERIC_CASES_LANE_(dup_n))(value)
+#define vdupq_n(value) _Generic((value), NEON_GENERIC_CASES_LANE_(dupq_n))(value)
+
+#define vget_lane(v, lane)                    \
+  _Generic((v),                               \
+    NEON_GENERIC_CASES_INT_(get, _lane),      \
+    NEON_GENERIC_CASES_F32_(get, _lane)       \
+    NEON_GENERIC_A64_(NEON_GENERIC_CASES_F64_(get, _lane)) \
+  )(v, lane)
+
+/* Across-vector reductions (AArch64).  There are no 64-bit d versions,
+   and vmaxv/vminv don't support 64-bit integers. */
+
+#if defined(NEON_GENERIC_AARCH64)
+#  define vaddv(v)                            \
+  _Generic((v),                               \
+    NEON_GENERIC_CASES_I8_32_(addv, ),        \
+    NEON_GENERIC_CASES_F32_(addv, ),          \
+    int64x2_t:   vaddvq_s64,                  \
+    uint64x2_t:  vaddvq_u64,                  \
+    float64x2_t: vaddvq_f64                   \
+  )(v)
+#  define vmaxv(v)                            \
+  _Generic((v),                               \
+    NEON_GENERIC_CASES_I8_32_(maxv, ),        \
+    NEON_GENERIC_CASES_F32_(maxv, ),          \
+    float64x2_t: vmaxvq_f64                   \
+  )(v)
+#  define vminv(v)                            \
+  _Generic((v),                               \
+    NEON_GENERIC_CASES_I8_32_(minv, ),        \
+    NEON_GENERIC_CASES_F32_(minv, ),          \
+    float64x2_t: vminvq_f64                   \
+  )(v)
+#endif
+
+#else /* defined(__cplusplus) */
+
+/* C++ doesn't have _Generic, so the same names are overloaded inline
+   functions. Each one calls exactly one intrinsic, so once inlined
+   there is nothing left but the intrinsic (neon-generic.c has a check
+   for that). */
+
+#if defined(__GNUC__)
+#  define NEON_GENERIC_INLINE inline __attribute__((__always_inline__))
+#else
+#  define NEON_GENERIC_INLINE inline
+#endif
+
+/* Every vector type, as X(name, mid, base, q, sfx, lane_t, lanes,
+   mask, shift), where base##_t is the type, q and sfx are the parts of
+   the intrinsic names (vaddq_s8 is v add q _s8), mask##_t is the
+   comparison result type, and shift##_t is the type of the per-lane
+   shift counts for vshl. */
+#define NEON_GENERIC_CXX_I8_32_(X, name, mid) \
+  X(name, mid, int8x8,   ,  _s8,  int8_t,    8, uint8x8,   int8x8) \
+  X(name, mid, int8x16,  q, _s8,  int8_t,   16, uint8x16,  int8x16) \
+  X(name, mid, int16x4,  ,  _s16, int16_t,   4, uint16x4,  int16x4) \
+  X(name, mid, int16x8,  q, _s16, int16_t,   8, uint16x8,  int16x8) \
+  X(name, mid, int32x2,  ,  _s32, int32_t,   2, uint32x2,  int32x2) \
+  X(name, mid, int32x4,  q, _s32, int32_t,   4, uint32x4,  int32x4) \
+  X(name, mid, uint8x8,  ,  _u8,  uint8_t,   8, uint8x8,   int8x8) \
+  X(name, mid, uint8x16, q, _u8,  uint8_t,  16, uint8x16,  int8x16) \
+  X(name, mid, uint16x4, ,  _u16, uint16_t,  4, uint16x4,  int16x4) \
+  X(name, mid, uint16x8, q, _u16, uint16_t,  8, uint16x8,  int16x8) \
+  X(name, mid, uint32x2, ,  _u32, uint32_t,  2, uint32x2,  int32x2) \
+  X(name, mid, uint32x4, q, _u32, uint32_t,  4, uint32x4,  int32x4)
+#define NEON_GENERIC_CXX_I64D_(X, name, mid) \
+  X(name, mid, int64x1,  ,  _s64, int64_t,   1, uint64x1,  int64x1) \
+  X(name, mid, uint64x1, ,  _u64, uint64_t,  1, uint64x1,  int64x1)
+#define NEON_GENERIC_CXX_I64Q_(X, name, mid) \
+  X(name, mid, int64x2,  q, _s64, int64_t,   2, uint64x2,  int64x2) \
+  X(name, mid, uint64x2, q, _u64, uint64_t,  2, uint64x2,  int64x2)
+#define NEON_GENERIC_CXX_F32_(X, name, mid) \
+  X(name, mid, float32x2, ,  _f32, float32_t, 2, uint32x2, int32x2) \
+  X(name, mid, float32x4, q, _f32, float32_t, 4, uint32x4, int32x4)
+#define NEON_GENERIC_CXX_F64D_(X, name, mid) \
+  X(name, mid, float64x1, ,  _f64, float64_t, 1, uint64x1, int64x1)
+#define NEON_GENERIC_CXX_F64Q_(X, name, mid) \
+  X(name, mid, float64x2, q, _f64, float64_t, 2, uint64x2, int64x2)
+
+#define NEON_GENERIC_CXX_INT_(X, name, mid) \
+  NEON_GENERIC_CXX_I8_32_(X, name, mid) \
+  NEON_GENERIC_CXX_I64D_(X, name, mid) \
+  NEON_GENERIC_CXX_I64Q_(X, name, mid)
+#if defined(NEON_GENERIC_AARCH64)
+#  define NEON_GENERIC_CXX_F64_(X, name, mid) \
+  NEON_GENERIC_CXX_F64D_(X, name, mid) \
+  NEON_GENERIC_CXX_F64Q_(X, name, mid)
+#else
+#  define NEON_GENERIC_CXX_F64_(X, name, mid)
+#endif
+#define NEON_GENERIC_CXX_ALL_(X, name, mid) \
+  NEON_GENERIC_CXX_INT_(X, name, mid) \
+  NEON_GENERIC_CXX_F32_(X, name, mid) \
+  NEON_GENERIC_CXX_F64_(X, name, mid)
+
+/* Overload generators, one per signature. */
+#define NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx) NEON_GENERIC_FUNC(name, q##mid##sfx)
+#define NEON_GENERIC_CXX_UNARY_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE base##_t v##name(base##_t a) { \
+    return NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx)(a); \
+  }
+#define NEON_GENERIC_CXX_BINARY_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE base##_t v##name(base##_t a, base##_t b) { \
+    return NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx)(a, b); \
+  }
+#define NEON_GENERIC_CXX_TERNARY_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE base##_t v##name(base##_t a, base##_t b, base##_t c) { \
+    return NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx)(a, b, c); \
+  }
+#define NEON_GENERIC_CXX_COMPARE_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE mask##_t v##name(base##_t a, base##_t b) { \
+    return NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx)(a, b); \
+  }
+#define NEON_GENERIC_CXX_SHL_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE base##_t v##name(base##_t a, shift##_t b) { \
+    return NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx)(a, b); \
+  }
+#define NEON_GENERIC_CXX_IMM_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE NEON_GENERIC_CXX_IMM_RET_##name(base, lane_t) v##name##mid(base##_t a, const int n) { \
+    return NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx)(a, n); \
+  }
+#define NEON_GENERIC_CXX_IMM_RET_shl(base, lane_t) base##_t
+#define NEON_GENERIC_CXX_IMM_RET_shr(base, lane_t) base##_t
+#define NEON_GENERIC_CXX_IMM_RET_get(base, lane_t) lane_t
+#define NEON_GENERIC_CXX_REDUCE_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE lane_t v##name(base##_t a) { \
+    return NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx)(a); \
+  }
+#define NEON_GENERIC_CXX_LOAD_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE base##_t v##name##q(const lane_t* ptr) { \
+    return NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx)(ptr); \
+  }
+#define NEON_GENERIC_CXX_LOADN_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE base##x##mid##_t v##name##mid##q(const lane_t* ptr) { \
+    return NEON_GENERIC_FUNC(name, mid##q##sfx)(ptr); \
+  }
+#define NEON_GENERIC_CXX_STORE_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE void v##name(lane_t* ptr, base##_t v) { \
+    NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx)(ptr, v); \
+  }
+#define NEON_GENERIC_CXX_STOREN_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE void v##name##mid(lane_t* ptr, base##x##mid##_t v) { \
+    NEON_GENERIC_FUNC(name, mid##q##sfx)(ptr, v); \
+  }
+#define NEON_GENERIC_CXX_DUP_(name, mid, base, q, sfx, lane_t, lanes, mask, shift) \
+  NEON_GENERIC_INLINE base##_t v##name##q##mid(lane_t value) { \
+    return NEON_GENERIC_CXX_INTRIN_(name, mid, q, sfx)(value); \
+  }
+
+/* Arithmetic */
+NEON_GENERIC_CXX_ALL_(NEON_GENERIC_CXX_BINARY_, add, )
+NEON_GENERIC_CXX_ALL_(NEON_GENERIC_CXX_BINARY_, sub, )
+NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_BINARY_, mul, )
+NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_BINARY_, mul, )
+NEON_GENERIC_CXX_F64_(NEON_GENERIC_CXX_BINARY_, mul, )
+NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_TERNARY_, mla, )
+NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_TERNARY_, mla, )
+NEON_GENERIC_CXX_F64_(NEON_GENERIC_CXX_TERNARY_, mla, )
+NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_BINARY_, min, )
+NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_BINARY_, min, )
+NEON_GENERIC_CXX_F64_(NEON_GENERIC_CXX_BINARY_, min, )
+NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_BINARY_, max, )
+NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_BINARY_, max, )
+NEON_GENERIC_CXX_F64_(NEON_GENERIC_CXX_BINARY_, max, )
+#if defined(NEON_GENERIC_AARCH64)
+NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_BINARY_, div, )
+NEON_GENERIC_CXX_F64_(NEON_GENERIC_CXX_BINARY_, div, )
+NEON_GENERIC_INLINE int64_t vadd(int64_t a, int64_t b) { return vaddd_s64(a, b); }
+NEON_GENERIC_INLINE uint64_t vadd(uint64_t a, uint64_t b) { return vaddd_u64(a, b); }
+NEON_GENERIC_INLINE int64_t vsub(int64_t a, int64_t b) { return vsubd_s64(a, b); }
+NEON_GENERIC_INLINE uint64_t vsub(uint64_t a, uint64_t b) { return vsubd_u64(a, b); }
+#endif
+
+/* Comparisons */
+#define NEON_GENERIC_CXX_COMPARES_(name) \
+  NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_COMPARE_, name, ) \
+  NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_COMPARE_, name, ) \
+  NEON_GENERIC_CXX_A64_COMPARES_(name)
+#if defined(NEON_GENERIC_AARCH64)
+#  define NEON_GENERIC_CXX_A64_COMPARES_(name) \
+  NEON_GENERIC_CXX_I64D_(NEON_GENERIC_CXX_COMPARE_, name, ) \
+  NEON_GENERIC_CXX_I64Q_(NEON_GENERIC_CXX_COMPARE_, name, ) \
+  NEON_GENERIC_CXX_F64_(NEON_GENERIC_CXX_COMPARE_, name, )
+#else
+#  define NEON_GENERIC_CXX_A64_COMPARES_(name)
+#endif
+NEON_GENERIC_CXX_COMPARES_(ceq)
+NEON_GENERIC_CXX_COMPARES_(cge)
+NEON_GENERIC_CXX_COMPARES_(cgt)
+NEON_GENERIC_CXX_COMPARES_(cle)
+NEON_GENERIC_CXX_COMPARES_(clt)
+
+/* Bitwise */
+NEON_GENERIC_CXX_INT_(NEON_GENERIC_CXX_BINARY_, and, )
+NEON_GENERIC_CXX_INT_(NEON_GENERIC_CXX_BINARY_, orr, )
+NEON_GENERIC_CXX_INT_(NEON_GENERIC_CXX_BINARY_, eor, )
+NEON_GENERIC_CXX_INT_(NEON_GENERIC_CXX_BINARY_, bic, )
+NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_UNARY_, mvn, )
+
+/* Shifts */
+NEON_GENERIC_CXX_INT_(NEON_GENERIC_CXX_SHL_, shl, )
+NEON_GENERIC_CXX_INT_(NEON_GENERIC_CXX_IMM_, shl, _n)
+NEON_GENERIC_CXX_INT_(NEON_GENERIC_CXX_IMM_, shr, _n)
+
+/* Loads and stores */
+NEON_GENERIC_CXX_ALL_(NEON_GENERIC_CXX_LOAD_, ld1, )
+NEON_GENERIC_CXX_ALL_(NEON_GENERIC_CXX_STORE_, st1, )
+#define NEON_GENERIC_CXX_LDST_(n) \
+  NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_LOADN_, ld, n) \
+  NEON_GENERIC_CXX_I64D_(NEON_GENERIC_CXX_LOADN_, ld, n) \
+  NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_LOADN_, ld, n) \
+  NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_STOREN_, st, n) \
+  NEON_GENERIC_CXX_I64D_(NEON_GENERIC_CXX_STOREN_, st, n) \
+  NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_STOREN_, st, n) \
+  NEON_GENERIC_CXX_A64_LDST_(n)
 #if defined(NEON_GENERIC_AARCH64)
-#  define vadd(a, b)                            \
-  _Generic((a),                                 \
-    int8x8_t:    NEON_GENERIC_FUNC(add,   _s8),	\
-    int8x16_t:   NEON_GENERIC_FUNC(add,  q_s8), \
-    int16x4_t:   NEON_GENERIC_FUNC(add,  _s16),	\
-    int16x8_t:   NEON_GENERIC_FUNC(add, q_s16), \
-    int32x2_t:   NEON_GENERIC_FUNC(add,  _s32), \
-    int32x4_t:   NEON_GENERIC_FUNC(add, q_s32), \
-    int64x1_t:   NEON_GENERIC_FUNC(add,  _s64), \
-    int64x2_t:   NEON_GENERIC_FUNC(add, q_s64), \
-    uint8x8_t:   NEON_GENERIC_FUNC(add,   _u8), \
-    uint8x16_t:  NEON_GENERIC_FUNC(add,  q_u8), \
-    uint16x4_t:  NEON_GENERIC_FUNC(add,  _u16), \
-    uint16x8_t:  NEON_GENERIC_FUNC(add, q_u16), \
-    uint32x2_t:  NEON_GENERIC_FUNC(add,  _u32), \
-    uint32x4_t:  NEON_GENERIC_FUNC(add, q_u32), \
-    uint64x1_t:  NEON_GENERIC_FUNC(add,  _u64), \
-    uint64x2_t:  NEON_GENERIC_FUNC(add, q_u64), \
-    int64_t:     NEON_GENERIC_FUNC(add, d_s64), \
-    uint64_t:    NEON_GENERIC_FUNC(add, d_u64), \
-    float32x2_t: NEON_GENERIC_FUNC(add,  _f32), \
-    float32x4_t: NEON_GENERIC_FUNC(add, q_f32), \
-    float64x1_t: NEON_GENERIC_FUNC(add,  _f64), \
-    float64x2_t: NEON_GENERIC_FUNC(add, q_f64) \
-  )
+#  define NEON_GENERIC_CXX_A64_LDST_(n) \
+  NEON_GENERIC_CXX_I64Q_(NEON_GENERIC_CXX_LOADN_, ld, n) \
+  NEON_GENERIC_CXX_F64_(NEON_GENERIC_CXX_LOADN_, ld, n) \
+  NEON_GENERIC_CXX_I64Q_(NEON_GENERIC_CXX_STOREN_, st, n) \
+  NEON_GENERIC_CXX_F64_(NEON_GENERIC_CXX_STOREN_, st, n)
 #else
-#  define vadd(a, b)                            \
-  _Generic((a),                                 \
-    int8x8_t:    NEON_GENERIC_FUNC(add,   _s8), \
-    int8x16_t:   NEON_GENERIC_FUNC(add,  q_s8), \
-    int16x4_t:   NEON_GENERIC_FUNC(add,  _s16), \
-    int16x8_t:   NEON_GENERIC_FUNC(add, q_s16), \
-    int32x2_t:   NEON_GENERIC_FUNC(add,  _s32), \
-    int32x4_t:   NEON_GENERIC_FUNC(add, q_s32), \
-    int64x1_t:   NEON_GENERIC_FUNC(add,  _s64), \
-    int64x2_t:   NEON_GENERIC_FUNC(add, q_s64), \
-    uint8x8_t:   NEON_GENERIC_FUNC(add,   _u8), \
-    uint8x16_t:  NEON_GENERIC_FUNC(add,  q_u8), \
-    uint16x4_t:  NEON_GENERIC_FUNC(add,  _u16), \
-    uint16x8_t:  NEON_GENERIC_FUNC(add, q_u16), \
-    uint32x2_t:  NEON_GENERIC_FUNC(add,  _u32), \
-    uint32x4_t:  NEON_GENERIC_FUNC(add, q_u32), \
-    uint64x1_t:  NEON_GENERIC_FUNC(add,  _u64), \
-    uint64x2_t:  NEON_GENERIC_FUNC(add, q_u64), \
-    float32x2_t: NEON_GENERIC_FUNC(add,  _f32), \
-    float32x4_t: NEON_GENERIC_FUNC(add, q_f32)  \
-  )
+#  define NEON_GENERIC_CXX_A64_LDST_(n)
+#endif
+NEON_GENERIC_CXX_LDST_(2)
+NEON_GENERIC_CXX_LDST_(3)
+NEON_GENERIC_CXX_LDST_(4)
+
+/* Lanes */
+NEON_GENERIC_CXX_ALL_(NEON_GENERIC_CXX_DUP_, dup, _n)
+NEON_GENERIC_CXX_ALL_(NEON_GENERIC_CXX_IMM_, get, _lane)
+
+/* Across-vector reductions (AArch64) */
+#if defined(NEON_GENERIC_AARCH64)
+NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_REDUCE_, addv, )
+NEON_GENERIC_CXX_I64Q_(NEON_GENERIC_CXX_REDUCE_, addv, )
+NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_REDUCE_, addv, )
+NEON_GENERIC_CXX_F64Q_(NEON_GENERIC_CXX_REDUCE_, addv, )
+NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_REDUCE_, maxv, )
+NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_REDUCE_, maxv, )
+NEON_GENERIC_CXX_F64Q_(NEON_GENERIC_CXX_REDUCE_, maxv, )
+NEON_GENERIC_CXX_I8_32_(NEON_GENERIC_CXX_REDUCE_, minv, )
+NEON_GENERIC_CXX_F32_(NEON_GENERIC_CXX_REDUCE_, minv, )
+NEON_GENERIC_CXX_F64Q_(NEON_GENERIC_CXX_REDUCE_, minv, )
+#endif
+
+/* Type traits: neon_generic_traits<int16x8_t>::lane_type is int16_t,
+   ::lanes is 8, ::mask_type is the comparison result type (uint16x8_t)
+   and ::shift_type the vshl count type (int16x8_t). load, store, and
+   dup are vld1(q), vst1(q), and vdup(q)_n for the type. */
+template<typename V> struct neon_generic_traits;
+#define NEON_GENERIC_CXX_TRAITS_(name, mid, base, q, sfx, lane_t, n, mask, shift) \
+  template<> struct neon_generic_traits<base##_t> { \
+    typedef lane_t lane_type; \
+    typedef mask##_t mask_type; \
+    typedef shift##_t shift_type; \
+    static const int lanes = n; \
+    static NEON_GENERIC_INLINE base##_t load(const lane_t* ptr) { return NEON_GENERIC_FUNC(ld1, q##sfx)(ptr); } \
+    static NEON_GENERIC_INLINE void store(lane_t* ptr, base##_t v) { NEON_GENERIC_FUNC(st1, q##sfx)(ptr, v); } \
+    static NEON_GENERIC_INLINE base##_t dup(lane_t value) { return NEON_GENERIC_FUNC(dup, q##_n##sfx)(value); } \
+  };
+NEON_GENERIC_CXX_ALL_(NEON_GENERIC_CXX_TRAITS_, , )
+
+/* A thin wrapper with operators, e.g.
+ *
+ *   typedef neon_generic_vec<float32x4_t> f32x4;
+ *   (f32x4::load(x) * f32x4::dup(a) + f32x4::load(y)).store(y);
+ *
+ * It holds nothing but the vector and converts to and from it
+ * implicitly, so it can be passed straight to intrinsics. Every
+ * operator is a single intrinsic, and only exists where there is one
+ * (there is no * for 64-bit integers, for example). Comparisons
+ * return a vector of masks; << and >> shift every lane by a run-time
+ * count with vshl. */
+template<typename V>
+struct neon_generic_vec {
+  typedef neon_generic_traits<V> traits;
+  typedef typename traits::lane_type lane_type;
+  typedef typename traits::mask_type mask_type;
+  static const int lanes = traits::lanes;
+
+  V v;
+
+  NEON_GENERIC_INLINE neon_generic_vec() {}
+  NEON_GENERIC_INLINE neon_generic_vec(V value) : v(value) {}
+  NEON_GENERIC_INLINE operator V() const { return v; }
+
+  static NEON_GENERIC_INLINE neon_generic_vec load(const lane_type* ptr) { return traits::load(ptr); }
+  static NEON_GENERIC_INLINE neon_generic_vec dup(lane_type value) { return traits::dup(value); }
+  NEON_GENERIC_INLINE void store(lane_type* ptr) const { traits::store(ptr, v); }
+  template<int lane> NEON_GENERIC_INLINE lane_type get() const { return vget_lane(v, lane); }
+
+  NEON_GENERIC_INLINE neon_generic_vec& operator+=(neon_generic_vec b) { v = vadd(v, b.v); return *this; }
+  NEON_GENERIC_INLINE neon_generic_vec& operator-=(neon_generic_vec b) { v = vsub(v, b.v); return *this; }
+  NEON_GENERIC_INLINE neon_generic_vec& operator*=(neon_generic_vec b) { v = vmul(v, b.v); return *this; }
+  NEON_GENERIC_INLINE neon_generic_vec& operator&=(neon_generic_vec b) { v = vand(v, b.v); return *this; }
+  NEON_GENERIC_INLINE neon_generic_vec& operator|=(neon_generic_vec b) { v = vorr(v, b.v); return *this; }
+  NEON_GENERIC_INLINE neon_generic_vec& operator^=(neon_generic_vec b) { v = veor(v, b.v); return *this; }
+};
+
+#define NEON_GENERIC_CXX_OPERATOR_(op, R, intrin) \
+  template<typename V> \
+  NEON_GENERIC_INLINE R operator op(neon_generic_vec<V> a, neon_generic_vec<V> b) { \
+    return intrin(a.v, b.v); \
+  }
+NEON_GENERIC_CXX_OPERATOR_(+, neon_generic_vec<V>, vadd)
+NEON_GENERIC_CXX_OPERATOR_(-, neon_generic_vec<V>, vsub)
+NEON_GENERIC_CXX_OPERATOR_(*, neon_generic_vec<V>, vmul)
+NEON_GENERIC_CXX_OPERATOR_(&, neon_generic_vec<V>, vand)
+NEON_GENERIC_CXX_OPERATOR_(|, neon_generic_vec<V>, vorr)
+NEON_GENERIC_CXX_OPERATOR_(^, neon_generic_vec<V>, veor)
+NEON_GENERIC_CXX_OPERATOR_(==, neon_generic_vec<typename neon_generic_traits<V>::mask_type>, vceq)
+NEON_GENERIC_CXX_OPERATOR_(>=, neon_generic_vec<typename neon_generic_traits<V>::mask_type>, vcge)
+NEON_GENERIC_CXX_OPERATOR_(>, neon_generic_vec<typename neon_generic_traits<V>::mask_type>, vcgt)
+NEON_GENERIC_CXX_OPERATOR_(<=, neon_generic_vec<typename neon_generic_traits<V>::mask_type>, vcle)
+NEON_GENERIC_CXX_OPERATOR_(<, neon_generic_vec<typename neon_generic_traits<V>::mask_type>, vclt)
+#if defined(NEON_GENERIC_AARCH64)
+NEON_GENERIC_CXX_OPERATOR_(/, neon_generic_vec<V>, vdiv)
 #endif
 
+template<typename V>
+NEON_GENERIC_INLINE neon_generic_vec<V> operator~(neon_generic_vec<V> a) {
+  return vmvn(a.v);
+}
+
+template<typename V>
+NEON_GENERIC_INLINE neon_generic_vec<V> operator<<(neon_generic_vec<V> a, int n) {
+  typedef neon_generic_traits<typename neon_generic_traits<V>::shift_type> shift;
+  return vshl(a.v, shift::dup(static_cast<typename shift::lane_type>(n)));
+}
+
+template<typename V>
+NEON_GENERIC_INLINE neon_generic_vec<V> operator>>(neon_generic_vec<V> a, int n) {
+  typedef neon_generic_traits<typename neon_generic_traits<V>::shift_type> shift;
+  return vshl(a.v, shift::dup(static_cast<typename shift::lane_type>(-n)));
+}
+
+#endif /* defined(__cplusplus) */
+
 #endif /* !defined(NEON_GENERIC_H) */
@@ -0,0 +1,153 @@
+/* Benchmarks for neon-kernels.h. Like neon-generic.c, you shouldn't
+   need this file unless you're working on the headers.
+
+   Each kernel is run over buffers which fit in L1, L2, L3, and only
+   in DRAM, and compared with its _scalar version, which is plain C
+   for the compiler to auto-vectorize. Throughput is reported in GB/s
+   of data read and written by the kernel. Build it with the same
+   flags you'd use for your code:
+
+     cc -std=c11 -O3 -o neon-kernels-bench neon-kernels-bench.c
+     cc -std=c11 -O3 -mavx2 -o neon-kernels-bench-avx2 neon-kernels-bench.c
+     cc -std=c11 -O3 -DNEON_X86_SCALAR -o neon-kernels-bench-scalar neon-kernels-bench.c
+
+   Note that without -ffast-math compilers won't vectorize the scalar
+   float reductions (sum, min, max, and dot), since that would change
+   the result.
+
+   Buffers come from enmem.h's ennewa_aligned, aligned to
+   EN_CACHE_LINE_SIZE. Requires POSIX (clock_gettime). */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "enmem.h"
+#include "neon-kernels.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Each measurement processes at least this much data. */
+#if !defined(BENCH_TOTAL_BYTES)
+#  define BENCH_TOTAL_BYTES ((size_t) 512 * 1024 * 1024)
+#endif
+
+/* Keep the compiler from optimizing away the results, or folding
+   arguments which are supposed to be runtime values. */
+static volatile float32_t bench_f32;
+static const uint8_t* volatile bench_ptr;
+static volatile uint32_t bench_u32;
+static volatile uint8_t bench_byte = 0xff;
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (((double) ts.tv_sec) * 1e9) + ((double) ts.tv_nsec);
+}
+
+static void bench_report(const char* name, const char* level, size_t bytes, double ns_simd, double ns_scalar) {
+  printf("%-12s %-5s %10zu %10.2f %10.2f %8.2fx\n", name, level, bytes,
+         (double) bytes / ns_simd, (double) bytes / ns_scalar, ns_scalar / ns_simd);
+}
+
+/* Time body iterations times, once with the kernel and once with its
+   _scalar version, and report GB/s based on bytes per iteration. */
+#define BENCH(name, level, bytes, iterations, kernel, ...) \
+  do { \
+    size_t bench_i_; \
+    double bench_start_, bench_simd_; \
+    bench_start_ = bench_now(); \
+    for (bench_i_ = 0 ; bench_i_ < (iterations) ; bench_i_++) { \
+      kernel(__VA_ARGS__); \
+    } \
+    bench_simd_ = bench_now() - bench_start_; \
+    bench_start_ = bench_now(); \
+    for (bench_i_ = 0 ; bench_i_ < (iterations) ; bench_i_++) { \
+      kernel##_scalar(__VA_ARGS__); \
+    } \
+    bench_report(name, level, bytes, bench_simd_ / (double) (iterations), \
+                 (bench_now() - bench_start_) / (double) (iterations)); \
+  } while (0)
+
+#define BENCH_F32_(kernel, ...) (bench_f32 = (kernel)(__VA_ARGS__))
+#define bench_sum(x, n) BENCH_F32_(neon_kernel_sum_f32, x, n)
+#define bench_sum_scalar(x, n) BENCH_F32_(neon_kernel_sum_f32_scalar, x, n)
+#define bench_min(x, n) BENCH_F32_(neon_kernel_min_f32, x, n)
+#define bench_min_scalar(x, n) BENCH_F32_(neon_kernel_min_f32_scalar, x, n)
+#define bench_max(x, n) BENCH_F32_(neon_kernel_max_f32, x, n)
+#define bench_max_scalar(x, n) BENCH_F32_(neon_kernel_max_f32_scalar, x, n)
+#define bench_dot(x, y, n) BENCH_F32_(neon_kernel_dot_f32, x, y, n)
+#define bench_dot_scalar(x, y, n) BENCH_F32_(neon_kernel_dot_f32_scalar, x, y, n)
+#define bench_find(p, c, n) (bench_ptr = neon_kernel_find_u8(p, c, n))
+#define bench_find_scalar(p, c, n) (bench_ptr = neon_kernel_find_u8_scalar(p, c, n))
+
+static void bench_level(const char* level, size_t bytes) {
+  const size_t n = bytes / sizeof(float32_t);
+  const size_t iterations = (BENCH_TOTAL_BYTES + bytes - 1) / bytes;
+  float32_t* x = ennewa_aligned(float32_t, n, EN_CACHE_LINE_SIZE);
+  float32_t* y = ennewa_aligned(float32_t, n, EN_CACHE_LINE_SIZE);
+  uint8_t* b = ennewa_aligned(uint8_t, bytes, EN_CACHE_LINE_SIZE);
+  uint32_t hist[256];
+  size_t i;
+
+  if (x == NULL || y == NULL || b == NULL) {
+    fprintf(stderr, "unable to allocate %zu bytes\n", bytes);
+    exit(EXIT_FAILURE);
+  }
+
+  /* Small values, so saxpy doesn't overflow over many iterations. */
+  for (i = 0 ; i < n ; i++) {
+    x[i] = (float32_t) (i % 7) * 0.125f;
+    y[i] = (float32_t) (i % 5);
+  }
+  /* bench_byte doesn't occur, so find has to search everything. */
+  for (i = 0 ; i < bytes ; i++)
+    b[i] = (uint8_t) (i % 251);
+
+  BENCH("sum_f32", level, bytes, iterations, bench_sum, x, n);
+  BENCH("min_f32", level, bytes, iterations, bench_min, x, n);
+  BENCH("max_f32", level, bytes, iterations, bench_max, x, n);
+  BENCH("dot_f32", level, 2 * bytes, iterations, bench_dot, x, y, n);
+  BENCH("saxpy_f32", level, 3 * bytes, iterations, neon_kernel_saxpy_f32, y, 1e-6f, x, n);
+  BENCH("find_u8", level, bytes, iterations, bench_find, b, bench_byte, bytes);
+  memset(hist, 0, sizeof(hist));
+  BENCH("histogram_u8", level, bytes, iterations, neon_kernel_histogram_u8, hist, b, bytes);
+  bench_u32 = hist[0];
+  BENCH("fill_f32", level, bytes, iterations, neon_kernel_fill_f32, x, bench_f32, n);
+  BENCH("fill_u8", level, bytes, iterations, neon_kernel_fill_u8, b, bench_byte, bytes);
+
+  x = enfree_aligned(x);
+  y = enfree_aligned(y);
+  b = enfree_aligned(b);
+}
+
+int main(void) {
+  printf("%s, %s\n",
+#if defined(__cplusplus)
+         "C++",
+#else
+         "C",
+#endif
+#if !defined(NEON_X86_H)
+         "arm_neon.h"
+#elif defined(NEON_X86_SCALAR) || !(defined(__SSE2__) || defined(_M_X64))
+         "neon-x86.h scalar"
+#elif defined(__AVX2__)
+         "neon-x86.h AVX2"
+#elif defined(__SSE4_2__)
+         "neon-x86.h SSE4.2"
+#elif defined(__SSSE3__)
+         "neon-x86.h SSSE3"
+#else
+         "neon-x86.h SSE2"
+#endif
+    );
+  printf("%-12s %-5s %10s %10s %10s %9s\n", "kernel", "size", "bytes", "GB/s", "scalar", "speedup");
+
+  bench_level("L1", 16 * 1024);
+  bench_level("L2", 256 * 1024);
+  bench_level("L3", 4 * 1024 * 1024);
+  bench_level("DRAM", 64 * 1024 * 1024);
+
+  return 0;
+}
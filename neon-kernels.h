@@ -0,0 +1,349 @@
+/* SIMD kernels built on neon-generic.h
+ * Evan Nemerson <evan@nemerson.com>
+ * Public domain.
+ *
+ * The loops that keep getting rewritten: sum/min/max reductions, dot
+ * products, saxpy, byte search, histograms, and fills. They are
+ * written against the generic names from neon-generic.h, so they run
+ * on ARM with NEON and, through neon-x86.h, on x86 (or anything else).
+ * They work in C11 and C++.
+ *
+ * Every kernel handles any length; the vector loop runs over as many
+ * full vectors as fit and a scalar loop handles the tail. Pointers
+ * don't need any particular alignment, but cache-line-aligned buffers
+ * (e.g., from enmem.h's ennewa_aligned(T, n, EN_CACHE_LINE_SIZE)) are
+ * faster when they don't fit in L1.
+ *
+ * Each kernel has a plain C version with a _scalar suffix, which is
+ * the reference used by the tests (see neon-generic.c) and what the
+ * benchmark (neon-kernels-bench.c) compares against.
+ *
+ * float32_t neon_kernel_sum_f32(const float32_t* x, size_t n)
+ * float32_t neon_kernel_min_f32(const float32_t* x, size_t n)
+ * float32_t neon_kernel_max_f32(const float32_t* x, size_t n)
+ *
+ *   Sum, minimum, or maximum of x[0..n). The sum is accumulated in 16
+ *   lanes, so it is rounded differently from the scalar version. The
+ *   minimum and maximum are NaN if any element is NaN (like vmin and
+ *   vmax), and +/-INFINITY if n is 0.
+ *
+ * float32_t neon_kernel_dot_f32(const float32_t* x, const float32_t* y, size_t n)
+ *
+ *   Dot product of x and y; rounded like neon_kernel_sum_f32.
+ *
+ * void neon_kernel_saxpy_f32(float32_t* y, float32_t a, const float32_t* x, size_t n)
+ *
+ *   y[i] += a * x[i].
+ *
+ * const uint8_t* neon_kernel_find_u8(const uint8_t* p, uint8_t c, size_t n)
+ *
+ *   Like memchr: a pointer to the first c in p[0..n), or NULL.
+ *
+ * void neon_kernel_histogram_u8(uint32_t hist[256], const uint8_t* p, size_t n)
+ *
+ *   Add the number of times each byte value occurs in p[0..n) to
+ *   hist. NEON has no scatter, so this isn't vectorized; instead it
+ *   counts into four tables, which keeps runs of the same byte from
+ *   serializing on a single counter.
+ *
+ * void neon_kernel_fill_f32(float32_t* p, float32_t value, size_t n)
+ * void neon_kernel_fill_u8(uint8_t* p, uint8_t value, size_t n)
+ *
+ *   Set p[0..n) to value.
+ */
+
+#if !defined(NEON_KERNELS_H)
+#define NEON_KERNELS_H
+
+#include "neon-generic.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__cplusplus)
+#  define NEON_KERNEL_INLINE inline
+#else
+#  define NEON_KERNEL_INLINE static inline
+#endif
+
+/* Minimum and maximum with NaN propagation. */
+NEON_KERNEL_INLINE float32_t neon_kernel_fmin_(float32_t a, float32_t b) {
+  return ((b != b) || (b < a)) ? b : a;
+}
+NEON_KERNEL_INLINE float32_t neon_kernel_fmax_(float32_t a, float32_t b) {
+  return ((b != b) || (b > a)) ? b : a;
+}
+
+/* Horizontal reductions of a single vector.  AArch64 has instructions
+   for these; elsewhere go through memory. */
+NEON_KERNEL_INLINE float32_t neon_kernel_hsum_f32_(float32x4_t v) {
+#if defined(NEON_GENERIC_AARCH64)
+  return vaddv(v);
+#else
+  float32_t l[4];
+  vst1(l, v);
+  return (l[0] + l[1]) + (l[2] + l[3]);
+#endif
+}
+NEON_KERNEL_INLINE float32_t neon_kernel_hmin_f32_(float32x4_t v) {
+#if defined(NEON_GENERIC_AARCH64)
+  return vminv(v);
+#else
+  float32_t l[4];
+  vst1(l, v);
+  return neon_kernel_fmin_(neon_kernel_fmin_(l[0], l[1]), neon_kernel_fmin_(l[2], l[3]));
+#endif
+}
+NEON_KERNEL_INLINE float32_t neon_kernel_hmax_f32_(float32x4_t v) {
+#if defined(NEON_GENERIC_AARCH64)
+  return vmaxv(v);
+#else
+  float32_t l[4];
+  vst1(l, v);
+  return neon_kernel_fmax_(neon_kernel_fmax_(l[0], l[1]), neon_kernel_fmax_(l[2], l[3]));
+#endif
+}
+NEON_KERNEL_INLINE int neon_kernel_any_u8_(uint8x16_t v) {
+#if defined(NEON_GENERIC_AARCH64)
+  return vmaxv(v) != 0;
+#else
+  uint8_t l[16];
+  uint64_t w[2];
+  vst1(l, v);
+  memcpy(w, l, sizeof(w));
+  return (w[0] | w[1]) != 0;
+#endif
+}
+
+/* Reductions */
+
+NEON_KERNEL_INLINE float32_t neon_kernel_sum_f32_scalar(const float32_t* x, size_t n) {
+  float32_t r = 0.0f;
+  size_t i;
+
+  for (i = 0 ; i < n ; i++)
+    r += x[i];
+
+  return r;
+}
+
+NEON_KERNEL_INLINE float32_t neon_kernel_min_f32_scalar(const float32_t* x, size_t n) {
+  float32_t r = (float32_t) INFINITY;
+  size_t i;
+
+  for (i = 0 ; i < n ; i++)
+    r = neon_kernel_fmin_(r, x[i]);
+
+  return r;
+}
+
+NEON_KERNEL_INLINE float32_t neon_kernel_max_f32_scalar(const float32_t* x, size_t n) {
+  float32_t r = (float32_t) -INFINITY;
+  size_t i;
+
+  for (i = 0 ; i < n ; i++)
+    r = neon_kernel_fmax_(r, x[i]);
+
+  return r;
+}
+
+/* Four independent accumulators hide the latency of the adds. */
+NEON_KERNEL_INLINE float32_t neon_kernel_sum_f32(const float32_t* x, size_t n) {
+  float32x4_t a0 = vdupq_n(0.0f), a1 = a0, a2 = a0, a3 = a0;
+  float32_t r;
+  size_t i = 0;
+
+  for ( ; i + 16 <= n ; i += 16) {
+    a0 = vadd(a0, vld1q(x + i));
+    a1 = vadd(a1, vld1q(x + i + 4));
+    a2 = vadd(a2, vld1q(x + i + 8));
+    a3 = vadd(a3, vld1q(x + i + 12));
+  }
+  a0 = vadd(vadd(a0, a1), vadd(a2, a3));
+  for ( ; i + 4 <= n ; i += 4)
+    a0 = vadd(a0, vld1q(x + i));
+
+  r = neon_kernel_hsum_f32_(a0);
+  for ( ; i < n ; i++)
+    r += x[i];
+
+  return r;
+}
+
+#define NEON_KERNEL_MINMAX_(name, op, init) \
+  NEON_KERNEL_INLINE float32_t neon_kernel_##name##_f32(const float32_t* x, size_t n) { \
+    float32x4_t a0 = vdupq_n((float32_t) (init)), a1 = a0, a2 = a0, a3 = a0; \
+    float32_t r; \
+    size_t i = 0; \
+    for ( ; i + 16 <= n ; i += 16) { \
+      a0 = v##op(a0, vld1q(x + i)); \
+      a1 = v##op(a1, vld1q(x + i + 4)); \
+      a2 = v##op(a2, vld1q(x + i + 8)); \
+      a3 = v##op(a3, vld1q(x + i + 12)); \
+    } \
+    a0 = v##op(v##op(a0, a1), v##op(a2, a3)); \
+    for ( ; i + 4 <= n ; i += 4) \
+      a0 = v##op(a0, vld1q(x + i)); \
+    r = neon_kernel_h##op##_f32_(a0); \
+    for ( ; i < n ; i++) \
+      r = neon_kernel_f##op##_(r, x[i]); \
+    return r; \
+  }
+NEON_KERNEL_MINMAX_(min, min, INFINITY)
+NEON_KERNEL_MINMAX_(max, max, -INFINITY)
+
+/* Dot product and saxpy */
+
+NEON_KERNEL_INLINE float32_t neon_kernel_dot_f32_scalar(const float32_t* x, const float32_t* y, size_t n) {
+  float32_t r = 0.0f;
+  size_t i;
+
+  for (i = 0 ; i < n ; i++)
+    r += x[i] * y[i];
+
+  return r;
+}
+
+NEON_KERNEL_INLINE float32_t neon_kernel_dot_f32(const float32_t* x, const float32_t* y, size_t n) {
+  float32x4_t a0 = vdupq_n(0.0f), a1 = a0, a2 = a0, a3 = a0;
+  float32_t r;
+  size_t i = 0;
+
+  for ( ; i + 16 <= n ; i += 16) {
+    a0 = vmla(a0, vld1q(x + i), vld1q(y + i));
+    a1 = vmla(a1, vld1q(x + i + 4), vld1q(y + i + 4));
+    a2 = vmla(a2, vld1q(x + i + 8), vld1q(y + i + 8));
+    a3 = vmla(a3, vld1q(x + i + 12), vld1q(y + i + 12));
+  }
+  a0 = vadd(vadd(a0, a1), vadd(a2, a3));
+  for ( ; i + 4 <= n ; i += 4)
+    a0 = vmla(a0, vld1q(x + i), vld1q(y + i));
+
+  r = neon_kernel_hsum_f32_(a0);
+  for ( ; i < n ; i++)
+    r += x[i] * y[i];
+
+  return r;
+}
+
+NEON_KERNEL_INLINE void neon_kernel_saxpy_f32_scalar(float32_t* y, float32_t a, const float32_t* x, size_t n) {
+  size_t i;
+
+  for (i = 0 ; i < n ; i++)
+    y[i] += a * x[i];
+}
+
+NEON_KERNEL_INLINE void neon_kernel_saxpy_f32(float32_t* y, float32_t a, const float32_t* x, size_t n) {
+  const float32x4_t va = vdupq_n(a);
+  size_t i = 0;
+
+  for ( ; i + 16 <= n ; i += 16) {
+    vst1(y + i, vmla(vld1q(y + i), va, vld1q(x + i)));
+    vst1(y + i + 4, vmla(vld1q(y + i + 4), va, vld1q(x + i + 4)));
+    vst1(y + i + 8, vmla(vld1q(y + i + 8), va, vld1q(x + i + 8)));
+    vst1(y + i + 12, vmla(vld1q(y + i + 12), va, vld1q(x + i + 12)));
+  }
+  for ( ; i + 4 <= n ; i += 4)
+    vst1(y + i, vmla(vld1q(y + i), va, vld1q(x + i)));
+  for ( ; i < n ; i++)
+    y[i] += a * x[i];
+}
+
+/* Byte search */
+
+NEON_KERNEL_INLINE const uint8_t* neon_kernel_find_u8_scalar(const uint8_t* p, uint8_t c, size_t n) {
+  size_t i;
+
+  for (i = 0 ; i < n ; i++) {
+    if (p[i] == c)
+      return p + i;
+  }
+
+  return NULL;
+}
+
+/* Compare 64 bytes at a time and only look for the exact position
+   once there is a match somewhere. */
+NEON_KERNEL_INLINE const uint8_t* neon_kernel_find_u8(const uint8_t* p, uint8_t c, size_t n) {
+  const uint8x16_t vc = vdupq_n(c);
+  size_t i = 0;
+
+  for ( ; i + 64 <= n ; i += 64) {
+    uint8x16_t m = vorr(vorr(vceq(vld1q(p + i), vc), vceq(vld1q(p + i + 16), vc)),
+                        vorr(vceq(vld1q(p + i + 32), vc), vceq(vld1q(p + i + 48), vc)));
+    if (neon_kernel_any_u8_(m))
+      return neon_kernel_find_u8_scalar(p + i, c, 64);
+  }
+  for ( ; i + 16 <= n ; i += 16) {
+    if (neon_kernel_any_u8_(vceq(vld1q(p + i), vc)))
+      return neon_kernel_find_u8_scalar(p + i, c, 16);
+  }
+
+  return neon_kernel_find_u8_scalar(p + i, c, n - i);
+}
+
+/* Histogram */
+
+NEON_KERNEL_INLINE void neon_kernel_histogram_u8_scalar(uint32_t hist[256], const uint8_t* p, size_t n) {
+  size_t i;
+
+  for (i = 0 ; i < n ; i++)
+    hist[p[i]]++;
+}
+
+NEON_KERNEL_INLINE void neon_kernel_histogram_u8(uint32_t hist[256], const uint8_t* p, size_t n) {
+  uint32_t t[4][256];
+  size_t i = 0;
+  int j;
+
+  memset(t, 0, sizeof(t));
+  for ( ; i + 4 <= n ; i += 4) {
+    t[0][p[i]]++;
+    t[1][p[i + 1]]++;
+    t[2][p[i + 2]]++;
+    t[3][p[i + 3]]++;
+  }
+  for ( ; i < n ; i++)
+    t[0][p[i]]++;
+
+  for (j = 0 ; j < 256 ; j++)
+    hist[j] += (t[0][j] + t[1][j]) + (t[2][j] + t[3][j]);
+}
+
+/* Fills */
+
+NEON_KERNEL_INLINE void neon_kernel_fill_f32_scalar(float32_t* p, float32_t value, size_t n) {
+  size_t i;
+
+  for (i = 0 ; i < n ; i++)
+    p[i] = value;
+}
+
+NEON_KERNEL_INLINE void neon_kernel_fill_u8_scalar(uint8_t* p, uint8_t value, size_t n) {
+  size_t i;
+
+  for (i = 0 ; i < n ; i++)
+    p[i] = value;
+}
+
+#define NEON_KERNEL_FILL_(sfx, T, VT, l) \
+  NEON_KERNEL_INLINE void neon_kernel_fill_##sfx(T* p, T value, size_t n) { \
+    const VT v = vdupq_n(value); \
+    size_t i = 0; \
+    for ( ; i + (4 * (l)) <= n ; i += 4 * (l)) { \
+      vst1(p + i, v); \
+      vst1(p + i + (l), v); \
+      vst1(p + i + (2 * (l)), v); \
+      vst1(p + i + (3 * (l)), v); \
+    } \
+    for ( ; i + (l) <= n ; i += (l)) \
+      vst1(p + i, v); \
+    for ( ; i < n ; i++) \
+      p[i] = value; \
+  }
+NEON_KERNEL_FILL_(f32, float32_t, float32x4_t, 4)
+NEON_KERNEL_FILL_(u8, uint8_t, uint8x16_t, 16)
+
+#endif /* !defined(NEON_KERNELS_H) */
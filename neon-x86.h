@@ -0,0 +1,1102 @@
+/* NEON types and intrinsics for x86 (and everything else)
+ * Evan Nemerson <evan@nemerson.com>
+ * Public domain.
+ *
+ * This provides the NEON vector types (int8x16_t, float32x4_t, etc.)
+ * and intrinsics (vaddq_s16, etc.) on machines without NEON, so code
+ * written against arm_neon.h (or neon-generic.h) can be compiled and
+ * tested anywhere. neon-generic.h includes it automatically when
+ * arm_neon.h isn't available.
+ *
+ * On x86 the 128-bit (q) intrinsics are implemented with SSE2, plus
+ * SSSE3, SSE4.1, SSE4.2, and AVX2 where those are enabled (e.g.,
+ * -mavx2) and the operation benefits from them. The 64-bit (d)
+ * intrinsics use the low half of an SSE register. Everywhere else (or
+ * if you define NEON_X86_SCALAR) plain C loops are used, which
+ * compilers will often vectorize anyway.
+ *
+ * Implemented so far: vadd, vsub, vmul, vmla, vdiv, vmin, vmax, vceq,
+ * vcge, vcgt, vcle, vclt, vand, vorr, veor, vbic, vmvn, vshl,
+ * vshl_n, vshr_n, vld1-4, vst1-4, vdup_n, vget_lane, vaddv, vmaxv,
+ * and vminv. The interleaving loads and stores of bytes (e.g.,
+ * vld3q_u8 for RGB data) use SSE2/SSSE3 shuffles.
+ *
+ * Results are lane-for-lane identical to NEON: integer arithmetic
+ * wraps, lanes are numbered from the lowest address, and vld1/vst1
+ * don't require any alignment. The only known difference is that
+ * 32-bit ARM flushes denormal floats to zero and x86 doesn't.
+ *
+ * The AArch64 set is provided (float64x1_t, float64x2_t, vaddd_s64,
+ * vdiv, 64-bit comparisons, and the across-vector reductions such as
+ * vaddvq_u8), so neon-generic.h enables NEON_GENERIC_AARCH64 when using
+ * this header. Polynomial and half-precision types aren't
+ * implemented.
+ *
+ * The types are unions, so on x86 you can also get at the native SSE
+ * vector (the m128i, m128, or m128d member of a q type) or the lanes
+ * (values), but code which does so won't compile on ARM. The header
+ * works in C99 and C++.
+ */
+
+#if !defined(NEON_X86_H)
+#define NEON_X86_H
+
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(NEON_X86_SCALAR)
+#  if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define NEON_X86_SSE2
+#    include <emmintrin.h>
+#  endif
+#  if defined(NEON_X86_SSE2) && defined(__SSSE3__)
+#    define NEON_X86_SSSE3
+#    include <tmmintrin.h>
+#  endif
+#  if defined(NEON_X86_SSSE3) && defined(__SSE4_1__)
+#    define NEON_X86_SSE4_1
+#    include <smmintrin.h>
+#  endif
+#  if defined(NEON_X86_SSE4_1) && defined(__SSE4_2__)
+#    define NEON_X86_SSE4_2
+#    include <nmmintrin.h>
+#  endif
+#  if defined(NEON_X86_SSE4_2) && defined(__AVX2__)
+#    define NEON_X86_AVX2
+#    include <immintrin.h>
+#  endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__cplusplus)
+#  define NEON_X86_INLINE static __inline
+#else
+#  define NEON_X86_INLINE static inline
+#endif
+
+/* Types.  The d (64-bit) types only hold the lanes, so they have the
+   same size as on ARM; the q (128-bit) types overlay the lanes with an
+   SSE register. */
+
+#define NEON_X86_D_TYPE_(T, lane_t, n) \
+  typedef union { lane_t values[n]; } T;
+#if defined(NEON_X86_SSE2)
+#  define NEON_X86_Q_TYPE_(T, lane_t, n, m, member) \
+  typedef union { lane_t values[n]; m member; } T;
+#else
+#  define NEON_X86_Q_TYPE_(T, lane_t, n, m, member) \
+  typedef union { lane_t values[n]; } T;
+#endif
+
+NEON_X86_D_TYPE_(int8x8_t,    int8_t,   8)
+NEON_X86_D_TYPE_(int16x4_t,   int16_t,  4)
+NEON_X86_D_TYPE_(int32x2_t,   int32_t,  2)
+NEON_X86_D_TYPE_(int64x1_t,   int64_t,  1)
+NEON_X86_D_TYPE_(uint8x8_t,   uint8_t,  8)
+NEON_X86_D_TYPE_(uint16x4_t,  uint16_t, 4)
+NEON_X86_D_TYPE_(uint32x2_t,  uint32_t, 2)
+NEON_X86_D_TYPE_(uint64x1_t,  uint64_t, 1)
+NEON_X86_D_TYPE_(float32x2_t, float,    2)
+NEON_X86_D_TYPE_(float64x1_t, double,   1)
+
+NEON_X86_Q_TYPE_(int8x16_t,   int8_t,   16, __m128i, m128i)
+NEON_X86_Q_TYPE_(int16x8_t,   int16_t,   8, __m128i, m128i)
+NEON_X86_Q_TYPE_(int32x4_t,   int32_t,   4, __m128i, m128i)
+NEON_X86_Q_TYPE_(int64x2_t,   int64_t,   2, __m128i, m128i)
+NEON_X86_Q_TYPE_(uint8x16_t,  uint8_t,  16, __m128i, m128i)
+NEON_X86_Q_TYPE_(uint16x8_t,  uint16_t,  8, __m128i, m128i)
+NEON_X86_Q_TYPE_(uint32x4_t,  uint32_t,  4, __m128i, m128i)
+NEON_X86_Q_TYPE_(uint64x2_t,  uint64_t,  2, __m128i, m128i)
+NEON_X86_Q_TYPE_(float32x4_t, float,     4, __m128,  m128)
+NEON_X86_Q_TYPE_(float64x2_t, double,    2, __m128d, m128d)
+
+/* Arrays of vectors for the interleaving loads and stores. */
+#define NEON_X86_XN_TYPES_(base) \
+  typedef struct { base##_t val[2]; } base##x2_t; \
+  typedef struct { base##_t val[3]; } base##x3_t; \
+  typedef struct { base##_t val[4]; } base##x4_t;
+
+NEON_X86_XN_TYPES_(int8x8)
+NEON_X86_XN_TYPES_(int16x4)
+NEON_X86_XN_TYPES_(int32x2)
+NEON_X86_XN_TYPES_(int64x1)
+NEON_X86_XN_TYPES_(uint8x8)
+NEON_X86_XN_TYPES_(uint16x4)
+NEON_X86_XN_TYPES_(uint32x2)
+NEON_X86_XN_TYPES_(uint64x1)
+NEON_X86_XN_TYPES_(float32x2)
+NEON_X86_XN_TYPES_(float64x1)
+NEON_X86_XN_TYPES_(int8x16)
+NEON_X86_XN_TYPES_(int16x8)
+NEON_X86_XN_TYPES_(int32x4)
+NEON_X86_XN_TYPES_(int64x2)
+NEON_X86_XN_TYPES_(uint8x16)
+NEON_X86_XN_TYPES_(uint16x8)
+NEON_X86_XN_TYPES_(uint32x4)
+NEON_X86_XN_TYPES_(uint64x2)
+NEON_X86_XN_TYPES_(float32x4)
+NEON_X86_XN_TYPES_(float64x2)
+
+typedef float float32_t;
+typedef double float64_t;
+
+
+/* Every type, as X(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq,
+   nq, m, Md, Mq).  kind is i for integers and f for floating point.
+   wrap_t is the type arithmetic is done in: for integers it's the
+   unsigned type of the same width, so it wraps like NEON instead of
+   overflowing.  mask_t is the lane type of comparison results, m the
+   union member holding the SSE register, and Md/Mq the comparison
+   result types. */
+#define NEON_X86_FOREACH_I8_32_(X, op) \
+  X(op, s8,  i, int8_t,   uint8_t,  uint8_t,  int8x8_t,   8, int8x16_t,  16, m128i, uint8x8_t,  uint8x16_t) \
+  X(op, s16, i, int16_t,  uint16_t, uint16_t, int16x4_t,  4, int16x8_t,   8, m128i, uint16x4_t, uint16x8_t) \
+  X(op, s32, i, int32_t,  uint32_t, uint32_t, int32x2_t,  2, int32x4_t,   4, m128i, uint32x2_t, uint32x4_t) \
+  X(op, u8,  i, uint8_t,  uint8_t,  uint8_t,  uint8x8_t,  8, uint8x16_t, 16, m128i, uint8x8_t,  uint8x16_t) \
+  X(op, u16, i, uint16_t, uint16_t, uint16_t, uint16x4_t, 4, uint16x8_t,  8, m128i, uint16x4_t, uint16x8_t) \
+  X(op, u32, i, uint32_t, uint32_t, uint32_t, uint32x2_t, 2, uint32x4_t,  4, m128i, uint32x2_t, uint32x4_t)
+#define NEON_X86_FOREACH_I64_(X, op) \
+  X(op, s64, i, int64_t,  uint64_t, uint64_t, int64x1_t,  1, int64x2_t,   2, m128i, uint64x1_t, uint64x2_t) \
+  X(op, u64, i, uint64_t, uint64_t, uint64_t, uint64x1_t, 1, uint64x2_t,  2, m128i, uint64x1_t, uint64x2_t)
+#define NEON_X86_FOREACH_F_(X, op) \
+  X(op, f32, f, float,    float,    uint32_t, float32x2_t, 2, float32x4_t, 4, m128,  uint32x2_t, uint32x4_t) \
+  X(op, f64, f, double,   double,   uint64_t, float64x1_t, 1, float64x2_t, 2, m128d, uint64x1_t, uint64x2_t)
+#define NEON_X86_FOREACH_INT_(X, op) \
+  NEON_X86_FOREACH_I8_32_(X, op) \
+  NEON_X86_FOREACH_I64_(X, op)
+#define NEON_X86_FOREACH_(X, op) \
+  NEON_X86_FOREACH_INT_(X, op) \
+  NEON_X86_FOREACH_F_(X, op)
+
+/* Scalar implementations: apply expr to every lane. */
+#define NEON_X86_MAP1_(name, R, T, n, expr) \
+  NEON_X86_INLINE R name(T a) { \
+    R r; \
+    int i; \
+    for (i = 0 ; i < (n) ; i++) \
+      r.values[i] = expr(a.values[i]); \
+    return r; \
+  }
+#define NEON_X86_MAP2_(name, R, T, T2, n, expr) \
+  NEON_X86_INLINE R name(T a, T2 b) { \
+    R r; \
+    int i; \
+    for (i = 0 ; i < (n) ; i++) \
+      r.values[i] = expr(a.values[i], b.values[i]); \
+    return r; \
+  }
+#define NEON_X86_MAP2T_(name, T, n, lane_t, wrap_t, expr) \
+  NEON_X86_INLINE T name(T a, T b) { \
+    T r; \
+    int i; \
+    for (i = 0 ; i < (n) ; i++) \
+      r.values[i] = (lane_t) expr(wrap_t, a.values[i], b.values[i]); \
+    return r; \
+  }
+#define NEON_X86_MAP3_(name, R, T, n, expr) \
+  NEON_X86_INLINE R name(T a, T b, T c) { \
+    R r; \
+    int i; \
+    for (i = 0 ; i < (n) ; i++) \
+      r.values[i] = expr(a.values[i], b.values[i], c.values[i]); \
+    return r; \
+  }
+#define NEON_X86_MAP_N_(name, R, T, n, expr) \
+  NEON_X86_INLINE R name(T a, const int n_) { \
+    R r; \
+    int i; \
+    for (i = 0 ; i < (n) ; i++) \
+      r.values[i] = expr(a.values[i], n_); \
+    return r; \
+  }
+
+/* SSE implementations.  m is the union member holding the SSE vector
+   (m128i, m128, or m128d) and rm the one for the result; d types are
+   loaded into the low half of a register and only the low half is
+   stored. */
+#if defined(NEON_X86_SSE2)
+#  define NEON_X86_LOADL_m128i(v) _mm_loadl_epi64((const __m128i*) &(v))
+#  define NEON_X86_LOADL_m128(v) _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*) &(v)))
+#  define NEON_X86_LOADL_m128d(v) _mm_load_sd(&((v).values[0]))
+#  define NEON_X86_STOREL_m128i(v, x) _mm_storel_epi64((__m128i*) &(v), x)
+#  define NEON_X86_STOREL_m128(v, x) _mm_storel_epi64((__m128i*) &(v), _mm_castps_si128(x))
+#  define NEON_X86_STOREL_m128d(v, x) _mm_store_sd(&((v).values[0]), x)
+
+#  define NEON_X86_SSE_D1_(name, R, rm, T, m, kernel) \
+  NEON_X86_INLINE R name(T a) { \
+    R r; \
+    NEON_X86_STOREL_##rm(r, kernel(NEON_X86_LOADL_##m(a))); \
+    return r; \
+  }
+#  define NEON_X86_SSE_Q1_(name, R, rm, T, m, kernel) \
+  NEON_X86_INLINE R name(T a) { \
+    R r; \
+    r.rm = kernel(a.m); \
+    return r; \
+  }
+#  define NEON_X86_SSE_D2_(name, R, rm, T, m, kernel) \
+  NEON_X86_INLINE R name(T a, T b) { \
+    R r; \
+    NEON_X86_STOREL_##rm(r, kernel(NEON_X86_LOADL_##m(a), NEON_X86_LOADL_##m(b))); \
+    return r; \
+  }
+#  define NEON_X86_SSE_Q2_(name, R, rm, T, m, kernel) \
+  NEON_X86_INLINE R name(T a, T b) { \
+    R r; \
+    r.rm = kernel(a.m, b.m); \
+    return r; \
+  }
+#  define NEON_X86_SSE_D3_(name, T, m, kernel) \
+  NEON_X86_INLINE T name(T a, T b, T c) { \
+    T r; \
+    NEON_X86_STOREL_##m(r, kernel(NEON_X86_LOADL_##m(a), NEON_X86_LOADL_##m(b), NEON_X86_LOADL_##m(c))); \
+    return r; \
+  }
+#  define NEON_X86_SSE_Q3_(name, T, m, kernel) \
+  NEON_X86_INLINE T name(T a, T b, T c) { \
+    T r; \
+    r.m = kernel(a.m, b.m, c.m); \
+    return r; \
+  }
+#  define NEON_X86_SSE_D_N_(name, T, m, kernel) \
+  NEON_X86_INLINE T name(T a, const int n) { \
+    T r; \
+    NEON_X86_STOREL_##m(r, kernel(NEON_X86_LOADL_##m(a), n)); \
+    return r; \
+  }
+#  define NEON_X86_SSE_Q_N_(name, T, m, kernel) \
+  NEON_X86_INLINE T name(T a, const int n) { \
+    T r; \
+    r.m = kernel(a.m, n); \
+    return r; \
+  }
+#endif
+
+/* Instantiate the d and q versions of an operation.  With SSE2 the
+   kernel neon_x86_<op>_<sfx>_ is used, otherwise the scalar
+   NEON_X86_S_<op> lane expression. */
+#if defined(NEON_X86_SSE2)
+#  define NEON_X86_BINARY_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_SSE_D2_(v##op##_##sfx, Td, m, Td, m, neon_x86_##op##_##sfx##_) \
+  NEON_X86_SSE_Q2_(v##op##q_##sfx, Tq, m, Tq, m, neon_x86_##op##_##sfx##_)
+#  define NEON_X86_COMPARE_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_SSE_D2_(v##op##_##sfx, Md, m128i, Td, m, neon_x86_##op##_##sfx##_) \
+  NEON_X86_SSE_Q2_(v##op##q_##sfx, Mq, m128i, Tq, m, neon_x86_##op##_##sfx##_)
+#  define NEON_X86_BITWISE_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_SSE_D2_(v##op##_##sfx, Td, m, Td, m, neon_x86_##op##_) \
+  NEON_X86_SSE_Q2_(v##op##q_##sfx, Tq, m, Tq, m, neon_x86_##op##_)
+#  define NEON_X86_MLA_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_SSE_D3_(v##op##_##sfx, Td, m, neon_x86_##op##_##sfx##_) \
+  NEON_X86_SSE_Q3_(v##op##q_##sfx, Tq, m, neon_x86_##op##_##sfx##_)
+#  define NEON_X86_SHIFT_N_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_SSE_D_N_(v##op##_n_##sfx, Td, m, neon_x86_##op##_n_##sfx##_) \
+  NEON_X86_SSE_Q_N_(v##op##q_n_##sfx, Tq, m, neon_x86_##op##_n_##sfx##_)
+#else
+#  define NEON_X86_BINARY_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_MAP2T_(v##op##_##sfx, Td, nd, lane_t, wrap_t, NEON_X86_S_##op##_##kind) \
+  NEON_X86_MAP2T_(v##op##q_##sfx, Tq, nq, lane_t, wrap_t, NEON_X86_S_##op##_##kind)
+#  define NEON_X86_COMPARE_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_MAP2_(v##op##_##sfx, Md, Td, Td, nd, NEON_X86_S_##op##_##mask_t) \
+  NEON_X86_MAP2_(v##op##q_##sfx, Mq, Tq, Tq, nq, NEON_X86_S_##op##_##mask_t)
+#  define NEON_X86_BITWISE_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_MAP2_(v##op##_##sfx, Td, Td, Td, nd, NEON_X86_S_##op) \
+  NEON_X86_MAP2_(v##op##q_##sfx, Tq, Tq, Tq, nq, NEON_X86_S_##op)
+#  define NEON_X86_MLA_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_MAP3_(v##op##_##sfx, Td, Td, nd, NEON_X86_S_##op##_##wrap_t) \
+  NEON_X86_MAP3_(v##op##q_##sfx, Tq, Tq, nq, NEON_X86_S_##op##_##wrap_t)
+#  define NEON_X86_SHIFT_N_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_MAP_N_(v##op##_n_##sfx, Td, Td, nd, NEON_X86_S_##op##_n_##sfx) \
+  NEON_X86_MAP_N_(v##op##q_n_##sfx, Tq, Tq, nq, NEON_X86_S_##op##_n_##sfx)
+#endif
+
+/* Scalar lane expressions.  The _i/_f variants are for integers and
+   floating point, and the ones with a type suffix are for that lane
+   (or result) type.  Integer arithmetic is done on the unsigned type
+   (and at least unsigned int) so it wraps. */
+#define NEON_X86_S_add_i(wrap_t, a, b) ((wrap_t) ((1u * (wrap_t) (a)) + (wrap_t) (b)))
+#define NEON_X86_S_sub_i(wrap_t, a, b) ((wrap_t) ((1u * (wrap_t) (a)) - (wrap_t) (b)))
+#define NEON_X86_S_mul_i(wrap_t, a, b) ((wrap_t) ((1u * (wrap_t) (a)) * (wrap_t) (b)))
+#define NEON_X86_S_add_f(wrap_t, a, b) ((a) + (b))
+#define NEON_X86_S_sub_f(wrap_t, a, b) ((a) - (b))
+#define NEON_X86_S_mul_f(wrap_t, a, b) ((a) * (b))
+#define NEON_X86_S_div_f(wrap_t, a, b) ((a) / (b))
+#define NEON_X86_S_min_i(wrap_t, a, b) (((a) < (b)) ? (a) : (b))
+#define NEON_X86_S_max_i(wrap_t, a, b) (((a) > (b)) ? (a) : (b))
+#define NEON_X86_S_min_f(wrap_t, a, b) neon_x86_fmin_(a, b)
+#define NEON_X86_S_max_f(wrap_t, a, b) neon_x86_fmax_(a, b)
+#define NEON_X86_S_and(a, b) ((a) & (b))
+#define NEON_X86_S_orr(a, b) ((a) | (b))
+#define NEON_X86_S_eor(a, b) ((a) ^ (b))
+#define NEON_X86_S_bic(a, b) ((a) & ~(b))
+#define NEON_X86_S_mvn(a) (~(a))
+#define NEON_X86_S_mla_uint8_t(a, b, c)  ((uint8_t) ((a) + ((1u * (b)) * (c))))
+#define NEON_X86_S_mla_uint16_t(a, b, c) ((uint16_t) ((a) + ((1u * (b)) * (c))))
+#define NEON_X86_S_mla_uint32_t(a, b, c) ((uint32_t) ((a) + ((1u * (b)) * (c))))
+#define NEON_X86_S_mla_float(a, b, c)    ((float) ((a) + (float) ((b) * (c))))
+#define NEON_X86_S_mla_double(a, b, c)   ((a) + ((b) * (c)))
+#define NEON_X86_S_CMP_(mask_t, cond) ((cond) ? ((mask_t) -1) : ((mask_t) 0))
+#define NEON_X86_S_ceq_uint8_t(a, b)  NEON_X86_S_CMP_(uint8_t,  (a) == (b))
+#define NEON_X86_S_ceq_uint16_t(a, b) NEON_X86_S_CMP_(uint16_t, (a) == (b))
+#define NEON_X86_S_ceq_uint32_t(a, b) NEON_X86_S_CMP_(uint32_t, (a) == (b))
+#define NEON_X86_S_ceq_uint64_t(a, b) NEON_X86_S_CMP_(uint64_t, (a) == (b))
+#define NEON_X86_S_cge_uint8_t(a, b)  NEON_X86_S_CMP_(uint8_t,  (a) >= (b))
+#define NEON_X86_S_cge_uint16_t(a, b) NEON_X86_S_CMP_(uint16_t, (a) >= (b))
+#define NEON_X86_S_cge_uint32_t(a, b) NEON_X86_S_CMP_(uint32_t, (a) >= (b))
+#define NEON_X86_S_cge_uint64_t(a, b) NEON_X86_S_CMP_(uint64_t, (a) >= (b))
+#define NEON_X86_S_cgt_uint8_t(a, b)  NEON_X86_S_CMP_(uint8_t,  (a) > (b))
+#define NEON_X86_S_cgt_uint16_t(a, b) NEON_X86_S_CMP_(uint16_t, (a) > (b))
+#define NEON_X86_S_cgt_uint32_t(a, b) NEON_X86_S_CMP_(uint32_t, (a) > (b))
+#define NEON_X86_S_cgt_uint64_t(a, b) NEON_X86_S_CMP_(uint64_t, (a) > (b))
+#define NEON_X86_S_cle_uint8_t(a, b)  NEON_X86_S_CMP_(uint8_t,  (a) <= (b))
+#define NEON_X86_S_cle_uint16_t(a, b) NEON_X86_S_CMP_(uint16_t, (a) <= (b))
+#define NEON_X86_S_cle_uint32_t(a, b) NEON_X86_S_CMP_(uint32_t, (a) <= (b))
+#define NEON_X86_S_cle_uint64_t(a, b) NEON_X86_S_CMP_(uint64_t, (a) <= (b))
+#define NEON_X86_S_clt_uint8_t(a, b)  NEON_X86_S_CMP_(uint8_t,  (a) < (b))
+#define NEON_X86_S_clt_uint16_t(a, b) NEON_X86_S_CMP_(uint16_t, (a) < (b))
+#define NEON_X86_S_clt_uint32_t(a, b) NEON_X86_S_CMP_(uint32_t, (a) < (b))
+#define NEON_X86_S_clt_uint64_t(a, b) NEON_X86_S_CMP_(uint64_t, (a) < (b))
+
+/* NEON's vmin/vmax return NaN if either input is NaN, and treat -0.0
+   as less than 0.0. */
+NEON_X86_INLINE int neon_x86_signbit_(double v) {
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return (int) (bits >> 63);
+}
+NEON_X86_INLINE double neon_x86_fmin_(double a, double b) {
+  if (a != a)
+    return a;
+  if (b != b)
+    return b;
+  if (a == b)
+    return neon_x86_signbit_(a) ? a : b;
+  return (a < b) ? a : b;
+}
+NEON_X86_INLINE double neon_x86_fmax_(double a, double b) {
+  if (a != a)
+    return a;
+  if (b != b)
+    return b;
+  if (a == b)
+    return neon_x86_signbit_(a) ? b : a;
+  return (a > b) ? a : b;
+}
+
+/* Shifts.  C leaves shifts by the width of the type (or more)
+   undefined, while NEON shifts everything out: the result is 0, or -1
+   for negative values shifted right.  Shifting a signed value right
+   by bits - 1 gives the same result.  Negative values are complemented
+   before shifting right so the shift is always of a non-negative
+   value. */
+#define NEON_X86_S_SHL_N_(lane_t, wrap_t, a, n) ((lane_t) (wrap_t) ((1u * (wrap_t) (a)) << (n)))
+#define NEON_X86_S_SHR_U_(bits, a, n) (((n) >= (bits)) ? 0 : ((a) >> (n)))
+#define NEON_X86_S_SHR_S_(bits, a, n) \
+  (((a) < 0) ? ~(~(a) >> (((n) >= (bits)) ? ((bits) - 1) : (n))) : ((a) >> (((n) >= (bits)) ? ((bits) - 1) : (n))))
+#define NEON_X86_S_SHR_N_U_(lane_t, bits, a, n) ((lane_t) NEON_X86_S_SHR_U_(bits, a, n))
+#define NEON_X86_S_SHR_N_S_(lane_t, bits, a, n) ((lane_t) NEON_X86_S_SHR_S_(bits, a, n))
+#define NEON_X86_S_shl_n_s8(a, n)  NEON_X86_S_SHL_N_(int8_t,   uint8_t,  a, n)
+#define NEON_X86_S_shl_n_s16(a, n) NEON_X86_S_SHL_N_(int16_t,  uint16_t, a, n)
+#define NEON_X86_S_shl_n_s32(a, n) NEON_X86_S_SHL_N_(int32_t,  uint32_t, a, n)
+#define NEON_X86_S_shl_n_s64(a, n) NEON_X86_S_SHL_N_(int64_t,  uint64_t, a, n)
+#define NEON_X86_S_shl_n_u8(a, n)  NEON_X86_S_SHL_N_(uint8_t,  uint8_t,  a, n)
+#define NEON_X86_S_shl_n_u16(a, n) NEON_X86_S_SHL_N_(uint16_t, uint16_t, a, n)
+#define NEON_X86_S_shl_n_u32(a, n) NEON_X86_S_SHL_N_(uint32_t, uint32_t, a, n)
+#define NEON_X86_S_shl_n_u64(a, n) NEON_X86_S_SHL_N_(uint64_t, uint64_t, a, n)
+#define NEON_X86_S_shr_n_s8(a, n)  NEON_X86_S_SHR_N_S_(int8_t,    8, a, n)
+#define NEON_X86_S_shr_n_s16(a, n) NEON_X86_S_SHR_N_S_(int16_t,  16, a, n)
+#define NEON_X86_S_shr_n_s32(a, n) NEON_X86_S_SHR_N_S_(int32_t,  32, a, n)
+#define NEON_X86_S_shr_n_s64(a, n) NEON_X86_S_SHR_N_S_(int64_t,  64, a, n)
+#define NEON_X86_S_shr_n_u8(a, n)  NEON_X86_S_SHR_N_U_(uint8_t,   8, a, n)
+#define NEON_X86_S_shr_n_u16(a, n) NEON_X86_S_SHR_N_U_(uint16_t, 16, a, n)
+#define NEON_X86_S_shr_n_u32(a, n) NEON_X86_S_SHR_N_U_(uint32_t, 32, a, n)
+#define NEON_X86_S_shr_n_u64(a, n) NEON_X86_S_SHR_N_U_(uint64_t, 64, a, n)
+
+#if defined(NEON_X86_SSE2)
+/* SSE kernels.  Most of these are a single instruction; the rest
+   emulate an instruction from a later extension when it isn't
+   available. */
+
+/* mask ? a : b */
+NEON_X86_INLINE __m128i neon_x86_select_(__m128i mask, __m128i a, __m128i b) {
+#if defined(NEON_X86_SSE4_1)
+  return _mm_blendv_epi8(b, a, mask);
+#else
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+#endif
+}
+
+#define neon_x86_add_s8_(a, b)  _mm_add_epi8(a, b)
+#define neon_x86_add_s16_(a, b) _mm_add_epi16(a, b)
+#define neon_x86_add_s32_(a, b) _mm_add_epi32(a, b)
+#define neon_x86_add_s64_(a, b) _mm_add_epi64(a, b)
+#define neon_x86_add_u8_(a, b)  _mm_add_epi8(a, b)
+#define neon_x86_add_u16_(a, b) _mm_add_epi16(a, b)
+#define neon_x86_add_u32_(a, b) _mm_add_epi32(a, b)
+#define neon_x86_add_u64_(a, b) _mm_add_epi64(a, b)
+#define neon_x86_add_f32_(a, b) _mm_add_ps(a, b)
+#define neon_x86_add_f64_(a, b) _mm_add_pd(a, b)
+
+#define neon_x86_sub_s8_(a, b)  _mm_sub_epi8(a, b)
+#define neon_x86_sub_s16_(a, b) _mm_sub_epi16(a, b)
+#define neon_x86_sub_s32_(a, b) _mm_sub_epi32(a, b)
+#define neon_x86_sub_s64_(a, b) _mm_sub_epi64(a, b)
+#define neon_x86_sub_u8_(a, b)  _mm_sub_epi8(a, b)
+#define neon_x86_sub_u16_(a, b) _mm_sub_epi16(a, b)
+#define neon_x86_sub_u32_(a, b) _mm_sub_epi32(a, b)
+#define neon_x86_sub_u64_(a, b) _mm_sub_epi64(a, b)
+#define neon_x86_sub_f32_(a, b) _mm_sub_ps(a, b)
+#define neon_x86_sub_f64_(a, b) _mm_sub_pd(a, b)
+
+/* There is no 8-bit multiply, so multiply the even and odd bytes as
+   16-bit lanes and keep the low byte of each. */
+NEON_X86_INLINE __m128i neon_x86_mul8_(__m128i a, __m128i b) {
+  __m128i even = _mm_mullo_epi16(a, b);
+  __m128i odd = _mm_mullo_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+  return _mm_or_si128(_mm_slli_epi16(odd, 8), _mm_and_si128(even, _mm_set1_epi16(0xff)));
+}
+NEON_X86_INLINE __m128i neon_x86_mul32_(__m128i a, __m128i b) {
+#if defined(NEON_X86_SSE4_1)
+  return _mm_mullo_epi32(a, b);
+#else
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+#define neon_x86_mul_s8_(a, b)  neon_x86_mul8_(a, b)
+#define neon_x86_mul_s16_(a, b) _mm_mullo_epi16(a, b)
+#define neon_x86_mul_s32_(a, b) neon_x86_mul32_(a, b)
+#define neon_x86_mul_u8_(a, b)  neon_x86_mul8_(a, b)
+#define neon_x86_mul_u16_(a, b) _mm_mullo_epi16(a, b)
+#define neon_x86_mul_u32_(a, b) neon_x86_mul32_(a, b)
+#define neon_x86_mul_f32_(a, b) _mm_mul_ps(a, b)
+#define neon_x86_mul_f64_(a, b) _mm_mul_pd(a, b)
+
+#define neon_x86_mla_s8_(a, b, c)  _mm_add_epi8(a, neon_x86_mul8_(b, c))
+#define neon_x86_mla_s16_(a, b, c) _mm_add_epi16(a, _mm_mullo_epi16(b, c))
+#define neon_x86_mla_s32_(a, b, c) _mm_add_epi32(a, neon_x86_mul32_(b, c))
+#define neon_x86_mla_u8_(a, b, c)  _mm_add_epi8(a, neon_x86_mul8_(b, c))
+#define neon_x86_mla_u16_(a, b, c) _mm_add_epi16(a, _mm_mullo_epi16(b, c))
+#define neon_x86_mla_u32_(a, b, c) _mm_add_epi32(a, neon_x86_mul32_(b, c))
+#define neon_x86_mla_f32_(a, b, c) _mm_add_ps(a, _mm_mul_ps(b, c))
+#define neon_x86_mla_f64_(a, b, c) _mm_add_pd(a, _mm_mul_pd(b, c))
+
+#define neon_x86_div_f32_(a, b) _mm_div_ps(a, b)
+#define neon_x86_div_f64_(a, b) _mm_div_pd(a, b)
+
+/* Comparisons.  Unsigned comparisons flip the sign bit and use the
+   signed comparison. */
+#define NEON_X86_FLIP8_(a)  _mm_xor_si128(a, _mm_set1_epi8((char) 0x80))
+#define NEON_X86_FLIP16_(a) _mm_xor_si128(a, _mm_set1_epi16((short) 0x8000))
+#define NEON_X86_FLIP32_(a) _mm_xor_si128(a, _mm_set1_epi32((int) 0x80000000))
+#define NEON_X86_FLIP64_(a) _mm_xor_si128(a, _mm_set_epi32((int) 0x80000000, 0, (int) 0x80000000, 0))
+
+NEON_X86_INLINE __m128i neon_x86_ceq64_(__m128i a, __m128i b) {
+#if defined(NEON_X86_SSE4_1)
+  return _mm_cmpeq_epi64(a, b);
+#else
+  __m128i eq = _mm_cmpeq_epi32(a, b);
+  return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+#endif
+}
+NEON_X86_INLINE __m128i neon_x86_cgt64_(__m128i a, __m128i b) {
+#if defined(NEON_X86_SSE4_2)
+  return _mm_cmpgt_epi64(a, b);
+#else
+  /* The high halves decide unless they are equal, in which case the
+     low halves are compared as unsigned. */
+  __m128i flip = _mm_set_epi32(0, (int) 0x80000000, 0, (int) 0x80000000);
+  __m128i ax = _mm_xor_si128(a, flip);
+  __m128i bx = _mm_xor_si128(b, flip);
+  __m128i gt = _mm_cmpgt_epi32(ax, bx);
+  __m128i eq = _mm_cmpeq_epi32(ax, bx);
+  __m128i gt_lo = _mm_shuffle_epi32(gt, _MM_SHUFFLE(2, 2, 0, 0));
+  __m128i gt_hi = _mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1));
+  __m128i eq_hi = _mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1));
+  return _mm_or_si128(gt_hi, _mm_and_si128(eq_hi, gt_lo));
+#endif
+}
+
+#define neon_x86_ceq_s8_(a, b)  _mm_cmpeq_epi8(a, b)
+#define neon_x86_ceq_s16_(a, b) _mm_cmpeq_epi16(a, b)
+#define neon_x86_ceq_s32_(a, b) _mm_cmpeq_epi32(a, b)
+#define neon_x86_ceq_s64_(a, b) neon_x86_ceq64_(a, b)
+#define neon_x86_ceq_u8_(a, b)  _mm_cmpeq_epi8(a, b)
+#define neon_x86_ceq_u16_(a, b) _mm_cmpeq_epi16(a, b)
+#define neon_x86_ceq_u32_(a, b) _mm_cmpeq_epi32(a, b)
+#define neon_x86_ceq_u64_(a, b) neon_x86_ceq64_(a, b)
+#define neon_x86_ceq_f32_(a, b) _mm_castps_si128(_mm_cmpeq_ps(a, b))
+#define neon_x86_ceq_f64_(a, b) _mm_castpd_si128(_mm_cmpeq_pd(a, b))
+
+#define neon_x86_cgt_s8_(a, b)  _mm_cmpgt_epi8(a, b)
+#define neon_x86_cgt_s16_(a, b) _mm_cmpgt_epi16(a, b)
+#define neon_x86_cgt_s32_(a, b) _mm_cmpgt_epi32(a, b)
+#define neon_x86_cgt_s64_(a, b) neon_x86_cgt64_(a, b)
+#define neon_x86_cgt_u8_(a, b)  _mm_cmpgt_epi8(NEON_X86_FLIP8_(a), NEON_X86_FLIP8_(b))
+#define neon_x86_cgt_u16_(a, b) _mm_cmpgt_epi16(NEON_X86_FLIP16_(a), NEON_X86_FLIP16_(b))
+#define neon_x86_cgt_u32_(a, b) _mm_cmpgt_epi32(NEON_X86_FLIP32_(a), NEON_X86_FLIP32_(b))
+#define neon_x86_cgt_u64_(a, b) neon_x86_cgt64_(NEON_X86_FLIP64_(a), NEON_X86_FLIP64_(b))
+#define neon_x86_cgt_f32_(a, b) _mm_castps_si128(_mm_cmpgt_ps(a, b))
+#define neon_x86_cgt_f64_(a, b) _mm_castpd_si128(_mm_cmpgt_pd(a, b))
+
+/* a >= b is !(b > a) for integers; floats need an ordered comparison
+   so NaN compares false. */
+#define NEON_X86_NOT_(a) _mm_xor_si128(a, _mm_set1_epi32(-1))
+#define neon_x86_cge_s8_(a, b)  NEON_X86_NOT_(neon_x86_cgt_s8_(b, a))
+#define neon_x86_cge_s16_(a, b) NEON_X86_NOT_(neon_x86_cgt_s16_(b, a))
+#define neon_x86_cge_s32_(a, b) NEON_X86_NOT_(neon_x86_cgt_s32_(b, a))
+#define neon_x86_cge_s64_(a, b) NEON_X86_NOT_(neon_x86_cgt_s64_(b, a))
+#define neon_x86_cge_u8_(a, b)  NEON_X86_NOT_(neon_x86_cgt_u8_(b, a))
+#define neon_x86_cge_u16_(a, b) NEON_X86_NOT_(neon_x86_cgt_u16_(b, a))
+#define neon_x86_cge_u32_(a, b) NEON_X86_NOT_(neon_x86_cgt_u32_(b, a))
+#define neon_x86_cge_u64_(a, b) NEON_X86_NOT_(neon_x86_cgt_u64_(b, a))
+#define neon_x86_cge_f32_(a, b) _mm_castps_si128(_mm_cmpge_ps(a, b))
+#define neon_x86_cge_f64_(a, b) _mm_castpd_si128(_mm_cmpge_pd(a, b))
+
+#define neon_x86_clt_s8_(a, b)  neon_x86_cgt_s8_(b, a)
+#define neon_x86_clt_s16_(a, b) neon_x86_cgt_s16_(b, a)
+#define neon_x86_clt_s32_(a, b) neon_x86_cgt_s32_(b, a)
+#define neon_x86_clt_s64_(a, b) neon_x86_cgt_s64_(b, a)
+#define neon_x86_clt_u8_(a, b)  neon_x86_cgt_u8_(b, a)
+#define neon_x86_clt_u16_(a, b) neon_x86_cgt_u16_(b, a)
+#define neon_x86_clt_u32_(a, b) neon_x86_cgt_u32_(b, a)
+#define neon_x86_clt_u64_(a, b) neon_x86_cgt_u64_(b, a)
+#define neon_x86_clt_f32_(a, b) neon_x86_cgt_f32_(b, a)
+#define neon_x86_clt_f64_(a, b) neon_x86_cgt_f64_(b, a)
+
+#define neon_x86_cle_s8_(a, b)  neon_x86_cge_s8_(b, a)
+#define neon_x86_cle_s16_(a, b) neon_x86_cge_s16_(b, a)
+#define neon_x86_cle_s32_(a, b) neon_x86_cge_s32_(b, a)
+#define neon_x86_cle_s64_(a, b) neon_x86_cge_s64_(b, a)
+#define neon_x86_cle_u8_(a, b)  neon_x86_cge_u8_(b, a)
+#define neon_x86_cle_u16_(a, b) neon_x86_cge_u16_(b, a)
+#define neon_x86_cle_u32_(a, b) neon_x86_cge_u32_(b, a)
+#define neon_x86_cle_u64_(a, b) neon_x86_cge_u64_(b, a)
+#define neon_x86_cle_f32_(a, b) neon_x86_cge_f32_(b, a)
+#define neon_x86_cle_f64_(a, b) neon_x86_cge_f64_(b, a)
+
+/* Minimum and maximum.  SSE2 only has signed 16-bit and unsigned 8-bit
+   versions; the rest are SSE4.1, or a comparison and a select. */
+#if defined(NEON_X86_SSE4_1)
+#  define neon_x86_min_s8_(a, b)  _mm_min_epi8(a, b)
+#  define neon_x86_min_s32_(a, b) _mm_min_epi32(a, b)
+#  define neon_x86_min_u16_(a, b) _mm_min_epu16(a, b)
+#  define neon_x86_min_u32_(a, b) _mm_min_epu32(a, b)
+#  define neon_x86_max_s8_(a, b)  _mm_max_epi8(a, b)
+#  define neon_x86_max_s32_(a, b) _mm_max_epi32(a, b)
+#  define neon_x86_max_u16_(a, b) _mm_max_epu16(a, b)
+#  define neon_x86_max_u32_(a, b) _mm_max_epu32(a, b)
+#else
+#  define neon_x86_min_s8_(a, b)  neon_x86_select_(neon_x86_cgt_s8_(a, b), b, a)
+#  define neon_x86_min_s32_(a, b) neon_x86_select_(neon_x86_cgt_s32_(a, b), b, a)
+#  define neon_x86_min_u16_(a, b) _mm_sub_epi16(a, _mm_subs_epu16(a, b))
+#  define neon_x86_min_u32_(a, b) neon_x86_select_(neon_x86_cgt_u32_(a, b), b, a)
+#  define neon_x86_max_s8_(a, b)  neon_x86_select_(neon_x86_cgt_s8_(a, b), a, b)
+#  define neon_x86_max_s32_(a, b) neon_x86_select_(neon_x86_cgt_s32_(a, b), a, b)
+#  define neon_x86_max_u16_(a, b) _mm_add_epi16(b, _mm_subs_epu16(a, b))
+#  define neon_x86_max_u32_(a, b) neon_x86_select_(neon_x86_cgt_u32_(a, b), a, b)
+#endif
+#define neon_x86_min_s16_(a, b) _mm_min_epi16(a, b)
+#define neon_x86_min_u8_(a, b)  _mm_min_epu8(a, b)
+#define neon_x86_max_s16_(a, b) _mm_max_epi16(a, b)
+#define neon_x86_max_u8_(a, b)  _mm_max_epu8(a, b)
+
+/* _mm_min_ps returns the second operand if either is NaN or they are
+   equal.  Combining both orders gives NaN if either is NaN, and
+   -0.0 for min(-0.0, 0.0); max needs an extra step for NaN. */
+NEON_X86_INLINE __m128 neon_x86_min_f32_(__m128 a, __m128 b) {
+  return _mm_or_ps(_mm_min_ps(a, b), _mm_min_ps(b, a));
+}
+NEON_X86_INLINE __m128 neon_x86_max_f32_(__m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(_mm_max_ps(a, b), _mm_max_ps(b, a)), _mm_cmpunord_ps(a, b));
+}
+NEON_X86_INLINE __m128d neon_x86_min_f64_(__m128d a, __m128d b) {
+  return _mm_or_pd(_mm_min_pd(a, b), _mm_min_pd(b, a));
+}
+NEON_X86_INLINE __m128d neon_x86_max_f64_(__m128d a, __m128d b) {
+  return _mm_or_pd(_mm_and_pd(_mm_max_pd(a, b), _mm_max_pd(b, a)), _mm_cmpunord_pd(a, b));
+}
+
+/* Bitwise operations don't care about the lane type. */
+#define neon_x86_and_(a, b) _mm_and_si128(a, b)
+#define neon_x86_orr_(a, b) _mm_or_si128(a, b)
+#define neon_x86_eor_(a, b) _mm_xor_si128(a, b)
+#define neon_x86_bic_(a, b) _mm_andnot_si128(b, a)
+#define neon_x86_mvn_(a) NEON_X86_NOT_(a)
+
+/* Shifts by an immediate.  There are no 8-bit shifts, so shift 16-bit
+   lanes and mask off the bits which crossed into the neighboring
+   byte, and no 64-bit arithmetic shift, so do a logical shift and
+   sign-extend with (x ^ m) - m, where m is the shifted sign bit. */
+#define NEON_X86_COUNT_(n) _mm_cvtsi32_si128(n)
+NEON_X86_INLINE __m128i neon_x86_shl_n_8_(__m128i a, const int n) {
+  return _mm_and_si128(_mm_sll_epi16(a, NEON_X86_COUNT_(n)), _mm_set1_epi8((char) (0xff << n)));
+}
+NEON_X86_INLINE __m128i neon_x86_shr_n_u8_(__m128i a, const int n) {
+  return _mm_and_si128(_mm_srl_epi16(a, NEON_X86_COUNT_(n)), _mm_set1_epi8((char) (0xff >> n)));
+}
+NEON_X86_INLINE __m128i neon_x86_shr_n_s8_(__m128i a, int n) {
+  __m128i m;
+
+  if (n == 8)
+    n = 7;
+  m = _mm_set1_epi8((char) (0x80 >> n));
+  return _mm_sub_epi8(_mm_xor_si128(neon_x86_shr_n_u8_(a, n), m), m);
+}
+NEON_X86_INLINE __m128i neon_x86_shr_n_s64_(__m128i a, int n) {
+  __m128i m;
+
+  if (n == 64)
+    n = 63;
+  m = _mm_srl_epi64(_mm_set_epi32((int) 0x80000000, 0, (int) 0x80000000, 0), NEON_X86_COUNT_(n));
+  return _mm_sub_epi64(_mm_xor_si128(_mm_srl_epi64(a, NEON_X86_COUNT_(n)), m), m);
+}
+#define neon_x86_shl_n_s8_(a, n)  neon_x86_shl_n_8_(a, n)
+#define neon_x86_shl_n_s16_(a, n) _mm_sll_epi16(a, NEON_X86_COUNT_(n))
+#define neon_x86_shl_n_s32_(a, n) _mm_sll_epi32(a, NEON_X86_COUNT_(n))
+#define neon_x86_shl_n_s64_(a, n) _mm_sll_epi64(a, NEON_X86_COUNT_(n))
+#define neon_x86_shl_n_u8_(a, n)  neon_x86_shl_n_8_(a, n)
+#define neon_x86_shl_n_u16_(a, n) _mm_sll_epi16(a, NEON_X86_COUNT_(n))
+#define neon_x86_shl_n_u32_(a, n) _mm_sll_epi32(a, NEON_X86_COUNT_(n))
+#define neon_x86_shl_n_u64_(a, n) _mm_sll_epi64(a, NEON_X86_COUNT_(n))
+#define neon_x86_shr_n_s16_(a, n) _mm_sra_epi16(a, NEON_X86_COUNT_(n))
+#define neon_x86_shr_n_s32_(a, n) _mm_sra_epi32(a, NEON_X86_COUNT_(n))
+#define neon_x86_shr_n_u16_(a, n) _mm_srl_epi16(a, NEON_X86_COUNT_(n))
+#define neon_x86_shr_n_u32_(a, n) _mm_srl_epi32(a, NEON_X86_COUNT_(n))
+#define neon_x86_shr_n_u64_(a, n) _mm_srl_epi64(a, NEON_X86_COUNT_(n))
+#endif /* defined(NEON_X86_SSE2) */
+
+/* Load, store, duplicate, and get lane.  The loads and stores are
+   memcpy so they don't need any alignment; compilers turn them into a
+   single unaligned load or store. */
+#define NEON_X86_MEMORY_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_INLINE Td vld1_##sfx(const lane_t* ptr) { \
+    Td r; \
+    memcpy(&r, ptr, sizeof(r)); \
+    return r; \
+  } \
+  NEON_X86_INLINE Tq vld1q_##sfx(const lane_t* ptr) { \
+    Tq r; \
+    memcpy(&r, ptr, sizeof(r)); \
+    return r; \
+  } \
+  NEON_X86_INLINE void vst1_##sfx(lane_t* ptr, Td v) { \
+    memcpy(ptr, &v, sizeof(v)); \
+  } \
+  NEON_X86_INLINE void vst1q_##sfx(lane_t* ptr, Tq v) { \
+    memcpy(ptr, &v, sizeof(v)); \
+  } \
+  NEON_X86_INLINE Td vdup_n_##sfx(lane_t value) { \
+    Td r; \
+    int i; \
+    for (i = 0 ; i < (nd) ; i++) \
+      r.values[i] = value; \
+    return r; \
+  } \
+  NEON_X86_INLINE Tq vdupq_n_##sfx(lane_t value) { \
+    Tq r; \
+    int i; \
+    for (i = 0 ; i < (nq) ; i++) \
+      r.values[i] = value; \
+    return r; \
+  } \
+  NEON_X86_INLINE lane_t vget_lane_##sfx(Td v, const int lane) { \
+    return v.values[lane]; \
+  } \
+  NEON_X86_INLINE lane_t vgetq_lane_##sfx(Tq v, const int lane) { \
+    return v.values[lane]; \
+  }
+NEON_X86_FOREACH_(NEON_X86_MEMORY_, )
+
+/* Arithmetic */
+NEON_X86_FOREACH_(NEON_X86_BINARY_, add)
+NEON_X86_FOREACH_(NEON_X86_BINARY_, sub)
+NEON_X86_FOREACH_I8_32_(NEON_X86_BINARY_, mul)
+NEON_X86_FOREACH_F_(NEON_X86_BINARY_, mul)
+NEON_X86_FOREACH_I8_32_(NEON_X86_MLA_, mla)
+NEON_X86_FOREACH_F_(NEON_X86_MLA_, mla)
+NEON_X86_FOREACH_F_(NEON_X86_BINARY_, div)
+NEON_X86_FOREACH_I8_32_(NEON_X86_BINARY_, min)
+NEON_X86_FOREACH_F_(NEON_X86_BINARY_, min)
+NEON_X86_FOREACH_I8_32_(NEON_X86_BINARY_, max)
+NEON_X86_FOREACH_F_(NEON_X86_BINARY_, max)
+
+NEON_X86_INLINE int64_t vaddd_s64(int64_t a, int64_t b) {
+  return (int64_t) NEON_X86_S_add_i(uint64_t, a, b);
+}
+NEON_X86_INLINE uint64_t vaddd_u64(uint64_t a, uint64_t b) {
+  return NEON_X86_S_add_i(uint64_t, a, b);
+}
+NEON_X86_INLINE int64_t vsubd_s64(int64_t a, int64_t b) {
+  return (int64_t) NEON_X86_S_sub_i(uint64_t, a, b);
+}
+NEON_X86_INLINE uint64_t vsubd_u64(uint64_t a, uint64_t b) {
+  return NEON_X86_S_sub_i(uint64_t, a, b);
+}
+
+/* Comparisons */
+NEON_X86_FOREACH_(NEON_X86_COMPARE_, ceq)
+NEON_X86_FOREACH_(NEON_X86_COMPARE_, cge)
+NEON_X86_FOREACH_(NEON_X86_COMPARE_, cgt)
+NEON_X86_FOREACH_(NEON_X86_COMPARE_, cle)
+NEON_X86_FOREACH_(NEON_X86_COMPARE_, clt)
+
+/* Bitwise */
+NEON_X86_FOREACH_INT_(NEON_X86_BITWISE_, and)
+NEON_X86_FOREACH_INT_(NEON_X86_BITWISE_, orr)
+NEON_X86_FOREACH_INT_(NEON_X86_BITWISE_, eor)
+NEON_X86_FOREACH_INT_(NEON_X86_BITWISE_, bic)
+
+#if defined(NEON_X86_SSE2)
+#  define NEON_X86_MVN_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_SSE_D1_(vmvn_##sfx, Td, m, Td, m, neon_x86_mvn_) \
+  NEON_X86_SSE_Q1_(vmvnq_##sfx, Tq, m, Tq, m, neon_x86_mvn_)
+#else
+#  define NEON_X86_MVN_(op, sfx, kind, lane_t, wrap_t, mask_t, Td, nd, Tq, nq, m, Md, Mq) \
+  NEON_X86_MAP1_(vmvn_##sfx, Td, Td, nd, (lane_t) NEON_X86_S_mvn) \
+  NEON_X86_MAP1_(vmvnq_##sfx, Tq, Tq, nq, (lane_t) NEON_X86_S_mvn)
+#endif
+NEON_X86_FOREACH_I8_32_(NEON_X86_MVN_, )
+
+/* Shifts */
+NEON_X86_FOREACH_INT_(NEON_X86_SHIFT_N_, shl)
+NEON_X86_FOREACH_INT_(NEON_X86_SHIFT_N_, shr)
+
+/* Shift by a vector: the shift count is the signed low byte of each
+   lane of b, and negative counts shift right (rounding toward
+   negative infinity).  Counts of at least the lane width produce 0
+   (or -1 for negative signed values shifted right). */
+#define NEON_X86_S_SHL_(lane_t, wrap_t, bits, shr, a, b) \
+  ((((int8_t) (b)) >= 0) ? \
+    ((lane_t) ((((int8_t) (b)) >= (bits)) ? 0 : ((wrap_t) ((1u * (wrap_t) (a)) << ((int8_t) (b)))))) : \
+    ((lane_t) shr(bits, a, -((int8_t) (b)))))
+#define NEON_X86_S_shl_s8(a, b)  NEON_X86_S_SHL_(int8_t,   uint8_t,   8, NEON_X86_S_SHR_S_, a, b)
+#define NEON_X86_S_shl_s16(a, b) NEON_X86_S_SHL_(int16_t,  uint16_t, 16, NEON_X86_S_SHR_S_, a, b)
+#define NEON_X86_S_shl_s32(a, b) NEON_X86_S_SHL_(int32_t,  uint32_t, 32, NEON_X86_S_SHR_S_, a, b)
+#define NEON_X86_S_shl_s64(a, b) NEON_X86_S_SHL_(int64_t,  uint64_t, 64, NEON_X86_S_SHR_S_, a, b)
+#define NEON_X86_S_shl_u8(a, b)  NEON_X86_S_SHL_(uint8_t,  uint8_t,   8, NEON_X86_S_SHR_U_, a, b)
+#define NEON_X86_S_shl_u16(a, b) NEON_X86_S_SHL_(uint16_t, uint16_t, 16, NEON_X86_S_SHR_U_, a, b)
+#define NEON_X86_S_shl_u32(a, b) NEON_X86_S_SHL_(uint32_t, uint32_t, 32, NEON_X86_S_SHR_U_, a, b)
+#define NEON_X86_S_shl_u64(a, b) NEON_X86_S_SHL_(uint64_t, uint64_t, 64, NEON_X86_S_SHR_U_, a, b)
+
+#if defined(NEON_X86_AVX2)
+/* AVX2 has per-lane shifts for 32-bit lanes, which shift out
+   everything for counts of at least 32, just like NEON. */
+NEON_X86_INLINE __m128i neon_x86_shl_32_(__m128i a, __m128i b, int is_signed) {
+  __m128i count = _mm_srai_epi32(_mm_slli_epi32(b, 24), 24);
+  __m128i neg = _mm_sub_epi32(_mm_setzero_si128(), count);
+  __m128i left = _mm_sllv_epi32(a, count);
+  __m128i right = is_signed ? _mm_srav_epi32(a, neg) : _mm_srlv_epi32(a, neg);
+  return _mm_blendv_epi8(left, right, count);
+}
+#  define neon_x86_shl_s32_(a, b) neon_x86_shl_32_(a, b, 1)
+#  define neon_x86_shl_u32_(a, b) neon_x86_shl_32_(a, b, 0)
+#  define NEON_X86_SHL_(sfx, Td, Sd, nd, Tq, Sq, nq) \
+  NEON_X86_INLINE Td vshl_##sfx(Td a, Sd b) { \
+    Td r; \
+    NEON_X86_STOREL_m128i(r, neon_x86_shl_##sfx##_(NEON_X86_LOADL_m128i(a), NEON_X86_LOADL_m128i(b))); \
+    return r; \
+  } \
+  NEON_X86_INLINE Tq vshlq_##sfx(Tq a, Sq b) { \
+    Tq r; \
+    r.m128i = neon_x86_shl_##sfx##_(a.m128i, b.m128i); \
+    return r; \
+  }
+NEON_X86_SHL_(s32, int32x2_t, int32x2_t, 2, int32x4_t, int32x4_t, 4)
+NEON_X86_SHL_(u32, uint32x2_t, int32x2_t, 2, uint32x4_t, int32x4_t, 4)
+#  undef NEON_X86_SHL_
+#endif
+
+#define NEON_X86_SHL_(sfx, Td, Sd, nd, Tq, Sq, nq) \
+  NEON_X86_MAP2_(vshl_##sfx, Td, Td, Sd, nd, NEON_X86_S_shl_##sfx) \
+  NEON_X86_MAP2_(vshlq_##sfx, Tq, Tq, Sq, nq, NEON_X86_S_shl_##sfx)
+NEON_X86_SHL_(s8,  int8x8_t,   int8x8_t,  8, int8x16_t,  int8x16_t, 16)
+NEON_X86_SHL_(s16, int16x4_t,  int16x4_t, 4, int16x8_t,  int16x8_t,  8)
+NEON_X86_SHL_(s64, int64x1_t,  int64x1_t, 1, int64x2_t,  int64x2_t,  2)
+NEON_X86_SHL_(u8,  uint8x8_t,  int8x8_t,  8, uint8x16_t, int8x16_t, 16)
+NEON_X86_SHL_(u16, uint16x4_t, int16x4_t, 4, uint16x8_t, int16x8_t,  8)
+NEON_X86_SHL_(u64, uint64x1_t, int64x1_t, 1, uint64x2_t, int64x2_t,  2)
+#if !defined(NEON_X86_AVX2)
+NEON_X86_SHL_(s32, int32x2_t,  int32x2_t, 2, int32x4_t,  int32x4_t,  4)
+NEON_X86_SHL_(u32, uint32x2_t, int32x2_t, 2, uint32x4_t, int32x4_t,  4)
+#endif
+
+/* Interleaving loads and stores: vld2 puts even elements in val[0]
+   and odd elements in val[1], and so on. */
+#define NEON_X86_LDN_(name, TX, nvec, lanes, lane_t) \
+  NEON_X86_INLINE TX name(const lane_t* ptr) { \
+    TX r; \
+    int i, j; \
+    for (i = 0 ; i < (lanes) ; i++) \
+      for (j = 0 ; j < (nvec) ; j++) \
+        r.val[j].values[i] = ptr[(i * (nvec)) + j]; \
+    return r; \
+  }
+#define NEON_X86_STN_(name, TX, nvec, lanes, lane_t) \
+  NEON_X86_INLINE void name(lane_t* ptr, TX v) { \
+    int i, j; \
+    for (i = 0 ; i < (lanes) ; i++) \
+      for (j = 0 ; j < (nvec) ; j++) \
+        ptr[(i * (nvec)) + j] = v.val[j].values[i]; \
+  }
+#define NEON_X86_LDST_(sfx, lane_t, base, lanes) \
+  NEON_X86_LDN_(vld2##sfx, base##x2_t, 2, lanes, lane_t) \
+  NEON_X86_LDN_(vld3##sfx, base##x3_t, 3, lanes, lane_t) \
+  NEON_X86_LDN_(vld4##sfx, base##x4_t, 4, lanes, lane_t) \
+  NEON_X86_STN_(vst2##sfx, base##x2_t, 2, lanes, lane_t) \
+  NEON_X86_STN_(vst3##sfx, base##x3_t, 3, lanes, lane_t) \
+  NEON_X86_STN_(vst4##sfx, base##x4_t, 4, lanes, lane_t)
+
+NEON_X86_LDST_(_s8,   int8_t,   int8x8,    8)
+NEON_X86_LDST_(_s16,  int16_t,  int16x4,   4)
+NEON_X86_LDST_(_s32,  int32_t,  int32x2,   2)
+NEON_X86_LDST_(_s64,  int64_t,  int64x1,   1)
+NEON_X86_LDST_(_u8,   uint8_t,  uint8x8,   8)
+NEON_X86_LDST_(_u16,  uint16_t, uint16x4,  4)
+NEON_X86_LDST_(_u32,  uint32_t, uint32x2,  2)
+NEON_X86_LDST_(_u64,  uint64_t, uint64x1,  1)
+NEON_X86_LDST_(_f32,  float,    float32x2, 2)
+NEON_X86_LDST_(_f64,  double,   float64x1, 1)
+NEON_X86_LDST_(q_s16, int16_t,  int16x8,   8)
+NEON_X86_LDST_(q_s32, int32_t,  int32x4,   4)
+NEON_X86_LDST_(q_s64, int64_t,  int64x2,   2)
+NEON_X86_LDST_(q_u16, uint16_t, uint16x8,  8)
+NEON_X86_LDST_(q_u32, uint32_t, uint32x4,  4)
+NEON_X86_LDST_(q_u64, uint64_t, uint64x2,  2)
+NEON_X86_LDST_(q_f32, float,    float32x4, 4)
+NEON_X86_LDST_(q_f64, double,   float64x2, 2)
+
+/* Bytes are the common case (RGB, RGBA, and other packed records), so
+   those get SIMD versions. */
+#if defined(NEON_X86_SSE2)
+/* Split the bytes of lo:hi into even and odd bytes. */
+NEON_X86_INLINE void neon_x86_unzip8_(__m128i lo, __m128i hi, __m128i* even, __m128i* odd) {
+  __m128i mask = _mm_set1_epi16(0xff);
+  *even = _mm_packus_epi16(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+  *odd = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+
+NEON_X86_INLINE uint8x16x2_t vld2q_u8(const uint8_t* ptr) {
+  uint8x16x2_t r;
+  neon_x86_unzip8_(_mm_loadu_si128((const __m128i*) ptr), _mm_loadu_si128((const __m128i*) (ptr + 16)),
+                   &(r.val[0].m128i), &(r.val[1].m128i));
+  return r;
+}
+
+NEON_X86_INLINE uint8x16x4_t vld4q_u8(const uint8_t* ptr) {
+  uint8x16x4_t r;
+  __m128i e01, o01, e23, o23;
+  neon_x86_unzip8_(_mm_loadu_si128((const __m128i*) ptr), _mm_loadu_si128((const __m128i*) (ptr + 16)), &e01, &o01);
+  neon_x86_unzip8_(_mm_loadu_si128((const __m128i*) (ptr + 32)), _mm_loadu_si128((const __m128i*) (ptr + 48)), &e23, &o23);
+  neon_x86_unzip8_(e01, e23, &(r.val[0].m128i), &(r.val[2].m128i));
+  neon_x86_unzip8_(o01, o23, &(r.val[1].m128i), &(r.val[3].m128i));
+  return r;
+}
+
+NEON_X86_INLINE void vst2q_u8(uint8_t* ptr, uint8x16x2_t v) {
+  _mm_storeu_si128((__m128i*) ptr, _mm_unpacklo_epi8(v.val[0].m128i, v.val[1].m128i));
+  _mm_storeu_si128((__m128i*) (ptr + 16), _mm_unpackhi_epi8(v.val[0].m128i, v.val[1].m128i));
+}
+
+NEON_X86_INLINE void vst4q_u8(uint8_t* ptr, uint8x16x4_t v) {
+  __m128i ab_lo = _mm_unpacklo_epi8(v.val[0].m128i, v.val[1].m128i);
+  __m128i ab_hi = _mm_unpackhi_epi8(v.val[0].m128i, v.val[1].m128i);
+  __m128i cd_lo = _mm_unpacklo_epi8(v.val[2].m128i, v.val[3].m128i);
+  __m128i cd_hi = _mm_unpackhi_epi8(v.val[2].m128i, v.val[3].m128i);
+  _mm_storeu_si128((__m128i*) ptr, _mm_unpacklo_epi16(ab_lo, cd_lo));
+  _mm_storeu_si128((__m128i*) (ptr + 16), _mm_unpackhi_epi16(ab_lo, cd_lo));
+  _mm_storeu_si128((__m128i*) (ptr + 32), _mm_unpacklo_epi16(ab_hi, cd_hi));
+  _mm_storeu_si128((__m128i*) (ptr + 48), _mm_unpackhi_epi16(ab_hi, cd_hi));
+}
+#else
+NEON_X86_LDN_(vld2q_u8, uint8x16x2_t, 2, 16, uint8_t)
+NEON_X86_LDN_(vld4q_u8, uint8x16x4_t, 4, 16, uint8_t)
+NEON_X86_STN_(vst2q_u8, uint8x16x2_t, 2, 16, uint8_t)
+NEON_X86_STN_(vst4q_u8, uint8x16x4_t, 4, 16, uint8_t)
+#endif
+
+#if defined(NEON_X86_SSSE3)
+/* Each output vector is gathered from the three input vectors with a
+   byte shuffle; -128 zeroes the byte. */
+#define NEON_X86_SHUF3_(v0, v1, v2, m0, m1, m2) \
+  _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, m0), _mm_shuffle_epi8(v1, m1)), _mm_shuffle_epi8(v2, m2))
+
+NEON_X86_INLINE uint8x16x3_t vld3q_u8(const uint8_t* ptr) {
+  __m128i v0 = _mm_loadu_si128((const __m128i*) ptr);
+  __m128i v1 = _mm_loadu_si128((const __m128i*) (ptr + 16));
+  __m128i v2 = _mm_loadu_si128((const __m128i*) (ptr + 32));
+  uint8x16x3_t r;
+
+  r.val[0].m128i = NEON_X86_SHUF3_(v0, v1, v2,
+    _mm_setr_epi8(0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128),
+    _mm_setr_epi8(-128, -128, -128, -128, -128, -128, 2, 5, 8, 11, 14, -128, -128, -128, -128, -128),
+    _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 1, 4, 7, 10, 13));
+  r.val[1].m128i = NEON_X86_SHUF3_(v0, v1, v2,
+    _mm_setr_epi8(1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128),
+    _mm_setr_epi8(-128, -128, -128, -128, -128, 0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128),
+    _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 2, 5, 8, 11, 14));
+  r.val[2].m128i = NEON_X86_SHUF3_(v0, v1, v2,
+    _mm_setr_epi8(2, 5, 8, 11, 14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128),
+    _mm_setr_epi8(-128, -128, -128, -128, -128, 1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128),
+    _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 0, 3, 6, 9, 12, 15));
+
+  return r;
+}
+
+NEON_X86_INLINE void vst3q_u8(uint8_t* ptr, uint8x16x3_t v) {
+  __m128i a = v.val[0].m128i;
+  __m128i b = v.val[1].m128i;
+  __m128i c = v.val[2].m128i;
+
+  _mm_storeu_si128((__m128i*) ptr, NEON_X86_SHUF3_(a, b, c,
+    _mm_setr_epi8(0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128, 5),
+    _mm_setr_epi8(-128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128),
+    _mm_setr_epi8(-128, -128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128)));
+  _mm_storeu_si128((__m128i*) (ptr + 16), NEON_X86_SHUF3_(a, b, c,
+    _mm_setr_epi8(-128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10, -128),
+    _mm_setr_epi8(5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10),
+    _mm_setr_epi8(-128, 5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128)));
+  _mm_storeu_si128((__m128i*) (ptr + 32), NEON_X86_SHUF3_(a, b, c,
+    _mm_setr_epi8(-128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128, -128),
+    _mm_setr_epi8(-128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128),
+    _mm_setr_epi8(10, -128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15)));
+}
+#else
+NEON_X86_LDN_(vld3q_u8, uint8x16x3_t, 3, 16, uint8_t)
+NEON_X86_STN_(vst3q_u8, uint8x16x3_t, 3, 16, uint8_t)
+#endif
+
+/* The signed byte versions just reinterpret the unsigned ones. */
+#define NEON_X86_LDST_S8_(n) \
+  NEON_X86_INLINE int8x16x##n##_t vld##n##q_s8(const int8_t* ptr) { \
+    uint8x16x##n##_t u = vld##n##q_u8((const uint8_t*) ptr); \
+    int8x16x##n##_t r; \
+    memcpy(&r, &u, sizeof(r)); \
+    return r; \
+  } \
+  NEON_X86_INLINE void vst##n##q_s8(int8_t* ptr, int8x16x##n##_t v) { \
+    uint8x16x##n##_t u; \
+    memcpy(&u, &v, sizeof(u)); \
+    vst##n##q_u8((uint8_t*) ptr, u); \
+  }
+NEON_X86_LDST_S8_(2)
+NEON_X86_LDST_S8_(3)
+NEON_X86_LDST_S8_(4)
+
+/* Across-vector reductions (AArch64).  Integer sums wrap in the lane
+   type; floating-point sums are pairwise, in the same order as
+   faddp. */
+#define NEON_X86_REDUCE_(name, T, lane_t, wrap_t, n, expr) \
+  NEON_X86_INLINE lane_t name(T v) { \
+    lane_t r = v.values[0]; \
+    int i; \
+    for (i = 1 ; i < (n) ; i++) \
+      r = (lane_t) expr(wrap_t, r, v.values[i]); \
+    return r; \
+  }
+#define NEON_X86_REDUCE_MINMAX_(op) \
+  NEON_X86_REDUCE_(v##op##v_s8,   int8x8_t,   int8_t,   uint8_t,   8, NEON_X86_S_##op##_i) \
+  NEON_X86_REDUCE_(v##op##v_s16,  int16x4_t,  int16_t,  uint16_t,  4, NEON_X86_S_##op##_i) \
+  NEON_X86_REDUCE_(v##op##vq_s16, int16x8_t,  int16_t,  uint16_t,  8, NEON_X86_S_##op##_i) \
+  NEON_X86_REDUCE_(v##op##v_s32,  int32x2_t,  int32_t,  uint32_t,  2, NEON_X86_S_##op##_i) \
+  NEON_X86_REDUCE_(v##op##vq_s32, int32x4_t,  int32_t,  uint32_t,  4, NEON_X86_S_##op##_i) \
+  NEON_X86_REDUCE_(v##op##v_u8,   uint8x8_t,  uint8_t,  uint8_t,   8, NEON_X86_S_##op##_i) \
+  NEON_X86_REDUCE_(v##op##v_u16,  uint16x4_t, uint16_t, uint16_t,  4, NEON_X86_S_##op##_i) \
+  NEON_X86_REDUCE_(v##op##vq_u16, uint16x8_t, uint16_t, uint16_t,  8, NEON_X86_S_##op##_i) \
+  NEON_X86_REDUCE_(v##op##v_u32,  uint32x2_t, uint32_t, uint32_t,  2, NEON_X86_S_##op##_i) \
+  NEON_X86_REDUCE_(v##op##vq_u32, uint32x4_t, uint32_t, uint32_t,  4, NEON_X86_S_##op##_i)
+NEON_X86_REDUCE_(vaddvq_s64, int64x2_t, int64_t, uint64_t, 2, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddvq_u64, uint64x2_t, uint64_t, uint64_t, 2, NEON_X86_S_add_i)
+NEON_X86_REDUCE_MINMAX_(max)
+NEON_X86_REDUCE_MINMAX_(min)
+
+#if defined(NEON_X86_SSE2)
+/* Byte maximum and minimum by folding the vector in half four times;
+   vmaxvq_u8 is the usual way to check whether any lane of a
+   comparison is set, so it needs to be fast.  Signed bytes are
+   flipped to unsigned and back. */
+NEON_X86_INLINE uint8_t neon_x86_maxv_u8_(__m128i v) {
+  v = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+  v = _mm_max_epu8(v, _mm_srli_si128(v, 4));
+  v = _mm_max_epu8(v, _mm_srli_si128(v, 2));
+  v = _mm_max_epu8(v, _mm_srli_si128(v, 1));
+  return (uint8_t) _mm_cvtsi128_si32(v);
+}
+NEON_X86_INLINE uint8_t neon_x86_minv_u8_(__m128i v) {
+  v = _mm_min_epu8(v, _mm_srli_si128(v, 8));
+  v = _mm_min_epu8(v, _mm_srli_si128(v, 4));
+  v = _mm_min_epu8(v, _mm_srli_si128(v, 2));
+  v = _mm_min_epu8(v, _mm_srli_si128(v, 1));
+  return (uint8_t) _mm_cvtsi128_si32(v);
+}
+NEON_X86_INLINE uint8_t vmaxvq_u8(uint8x16_t v) {
+  return neon_x86_maxv_u8_(v.m128i);
+}
+NEON_X86_INLINE uint8_t vminvq_u8(uint8x16_t v) {
+  return neon_x86_minv_u8_(v.m128i);
+}
+NEON_X86_INLINE int8_t vmaxvq_s8(int8x16_t v) {
+  return (int8_t) (neon_x86_maxv_u8_(NEON_X86_FLIP8_(v.m128i)) ^ 0x80);
+}
+NEON_X86_INLINE int8_t vminvq_s8(int8x16_t v) {
+  return (int8_t) (neon_x86_minv_u8_(NEON_X86_FLIP8_(v.m128i)) ^ 0x80);
+}
+
+/* The sum of absolute differences against 0 adds up each half. */
+NEON_X86_INLINE uint8_t vaddvq_u8(uint8x16_t v) {
+  __m128i sums = _mm_sad_epu8(v.m128i, _mm_setzero_si128());
+  return (uint8_t) (_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4));
+}
+NEON_X86_INLINE int8_t vaddvq_s8(int8x16_t v) {
+  uint8x16_t u;
+  u.m128i = v.m128i;
+  return (int8_t) vaddvq_u8(u);
+}
+#else
+NEON_X86_REDUCE_(vaddvq_u8, uint8x16_t, uint8_t, uint8_t, 16, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddvq_s8, int8x16_t, int8_t, uint8_t, 16, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vmaxvq_u8, uint8x16_t, uint8_t, uint8_t, 16, NEON_X86_S_max_i)
+NEON_X86_REDUCE_(vminvq_u8, uint8x16_t, uint8_t, uint8_t, 16, NEON_X86_S_min_i)
+NEON_X86_REDUCE_(vmaxvq_s8, int8x16_t, int8_t, uint8_t, 16, NEON_X86_S_max_i)
+NEON_X86_REDUCE_(vminvq_s8, int8x16_t, int8_t, uint8_t, 16, NEON_X86_S_min_i)
+#endif
+NEON_X86_REDUCE_(vaddv_s8,   int8x8_t,   int8_t,   uint8_t,   8, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddv_s16,  int16x4_t,  int16_t,  uint16_t,  4, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddvq_s16, int16x8_t,  int16_t,  uint16_t,  8, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddv_s32,  int32x2_t,  int32_t,  uint32_t,  2, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddvq_s32, int32x4_t,  int32_t,  uint32_t,  4, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddv_u8,   uint8x8_t,  uint8_t,  uint8_t,   8, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddv_u16,  uint16x4_t, uint16_t, uint16_t,  4, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddvq_u16, uint16x8_t, uint16_t, uint16_t,  8, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddv_u32,  uint32x2_t, uint32_t, uint32_t,  2, NEON_X86_S_add_i)
+NEON_X86_REDUCE_(vaddvq_u32, uint32x4_t, uint32_t, uint32_t,  4, NEON_X86_S_add_i)
+
+NEON_X86_INLINE float vaddv_f32(float32x2_t v) {
+  return v.values[0] + v.values[1];
+}
+NEON_X86_INLINE float vaddvq_f32(float32x4_t v) {
+  return (v.values[0] + v.values[1]) + (v.values[2] + v.values[3]);
+}
+NEON_X86_INLINE double vaddvq_f64(float64x2_t v) {
+  return v.values[0] + v.values[1];
+}
+NEON_X86_INLINE float vmaxv_f32(float32x2_t v) {
+  return (float) neon_x86_fmax_(v.values[0], v.values[1]);
+}
+NEON_X86_INLINE float vmaxvq_f32(float32x4_t v) {
+  return (float) neon_x86_fmax_(neon_x86_fmax_(v.values[0], v.values[1]), neon_x86_fmax_(v.values[2], v.values[3]));
+}
+NEON_X86_INLINE double vmaxvq_f64(float64x2_t v) {
+  return neon_x86_fmax_(v.values[0], v.values[1]);
+}
+NEON_X86_INLINE float vminv_f32(float32x2_t v) {
+  return (float) neon_x86_fmin_(v.values[0], v.values[1]);
+}
+NEON_X86_INLINE float vminvq_f32(float32x4_t v) {
+  return (float) neon_x86_fmin_(neon_x86_fmin_(v.values[0], v.values[1]), neon_x86_fmin_(v.values[2], v.values[3]));
+}
+NEON_X86_INLINE double vminvq_f64(float64x2_t v) {
+  return neon_x86_fmin_(v.values[0], v.values[1]);
+}
+
+#endif /* !defined(NEON_X86_H) */